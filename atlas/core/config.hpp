@@ -185,6 +185,13 @@ SETTINGS_D( importer, searchGameInfo, bool, true )
 SETTINGS_D( importer, downloadBanner, bool, false )
 SETTINGS_D( importer, downloadVNDB, bool, false )
 SETTINGS_D( importer, moveImported, bool, true )
+//! Files copied at once when a moved game can't just be renamed. See moveDirectory
+SETTINGS_D( importer, concurrentCopies, int, 4 )
+//! Also check the mtime of each game folder's direct children before using a cached scan of it
+SETTINGS_D( importer, scanCacheChildren, bool, true )
+//! Watch `libraryRoot` for new games in the background. See LibraryWatcher
+SETTINGS_D( importer, watchLibrary, bool, false )
+SETTINGS_D( importer, libraryRoot, QString, "" )
 
 SETTINGS_D( db, first_start, bool, true )
 SETTINGS_D( logging, level, int, 2 )
@@ -291,9 +298,14 @@ SETTINGS_D( images, image_type, QString, "webp" )
 SETTINGS_D( application, font, QString, "" )
 SETTINGS_D( application, fontSize, int, 9 )
 
-SETTINGS_D( remote, last_check, int, 0 )
+//! Seconds since epoch of the last manifest that was handled
+SETTINGS_D( remote, last_check, qint64, 0 )
 SETTINGS_D(
 	remote, check_rate, int, std::chrono::duration_cast< std::chrono::seconds >( std::chrono::hours( 24 ) ).count() )
+//! Number of update packages downloaded at the same time
+SETTINGS_D( remote, max_downloads, int, 4 )
+//! Apply the next update while it downloads instead of waiting for the file
+SETTINGS_D( remote, stream_updates, bool, true )
 
 #ifdef __GNUC__
 #pragma GCC diagnostic pop
@@ -24,6 +24,12 @@ Binder::Binder( const std::string_view sql )
 	max_param_count = sqlite3_bind_parameter_count( stmt );
 }
 
+Binder::Binder( sqlite3_stmt* prepared ) : stmt( prepared ), owning( false )
+{
+	if ( stmt == nullptr ) throw std::runtime_error( "Binder: prepared statement was nullptr" );
+	max_param_count = sqlite3_bind_parameter_count( stmt );
+}
+
 Binder::~Binder()
 {
 	ZoneScoped;
@@ -32,7 +38,67 @@ Binder::~Binder()
 		sqlite3_step( stmt );
 	}
 
-	sqlite3_finalize( stmt );
+	if ( owning )
+		sqlite3_finalize( stmt );
+	else
+	{
+		sqlite3_reset( stmt );
+		sqlite3_clear_bindings( stmt );
+	}
+}
+
+SqlValue columnValue( sqlite3_stmt* stmt, const int index ) noexcept
+{
+	switch ( sqlite3_column_type( stmt, index ) )
+	{
+		case SQLITE_INTEGER:
+			return static_cast< std::int64_t >( sqlite3_column_int64( stmt, index ) );
+		case SQLITE_FLOAT:
+			return sqlite3_column_double( stmt, index );
+		case SQLITE_TEXT:
+			[[fallthrough]];
+		case SQLITE_BLOB:
+			{
+				const auto* data { reinterpret_cast< const char* >( sqlite3_column_text( stmt, index ) ) };
+				if ( data == nullptr ) return std::string();
+				return std::string( data, static_cast< std::size_t >( sqlite3_column_bytes( stmt, index ) ) );
+			}
+		case SQLITE_NULL:
+			[[fallthrough]];
+		default:
+			return std::monostate();
+	}
+}
+
+void Binder::operator>>( std::vector< SqlValue >& row )
+{
+	ZoneScopedN( "Get results into row" );
+	ran = true;
+	row.clear();
+
+	switch ( sqlite3_step( stmt ) )
+	{
+		case SQLITE_ROW:
+			{
+				const int column_count { sqlite3_column_count( stmt ) };
+				row.reserve( static_cast< std::size_t >( column_count ) );
+				for ( int i = 0; i < column_count; ++i ) row.emplace_back( columnValue( stmt, i ) );
+				return;
+			}
+		case SQLITE_DONE:
+			return;
+		default:
+			{
+				spdlog::error(
+					"DB: Query error: \"{}\", Query: \"{}\"",
+					sqlite3_errmsg( &Database::ref() ),
+					sqlite3_expanded_sql( stmt ) );
+				throw std::runtime_error( fmt::format(
+					"DB: Query error: \"{}\", Query: \"{}\"",
+					sqlite3_errmsg( &Database::ref() ),
+					sqlite3_expanded_sql( stmt ) ) );
+			}
+	}
 }
 
 template <>
@@ -46,7 +112,8 @@ template <>
 int bindParameter( sqlite3_stmt* stmt, const std::vector< std::byte > val, const int idx ) noexcept
 {
 	ZoneScopedN( "bindParameter<std::vector<std::byte>>" );
-	return sqlite3_bind_blob( stmt, idx, val.data(), static_cast< int >( val.size() ), nullptr );
+	//`val` is gone once we return. sqlite has to take a copy
+	return sqlite3_bind_blob( stmt, idx, val.data(), static_cast< int >( val.size() ), SQLITE_TRANSIENT );
 }
 
 template <>
@@ -56,6 +123,13 @@ int bindParameter( sqlite3_stmt* stmt, [[maybe_unused]] const std::nullopt_t nul
 	return sqlite3_bind_null( stmt, idx );
 }
 
+template <>
+int bindParameter( sqlite3_stmt* stmt, [[maybe_unused]] const std::monostate monostate, const int idx ) noexcept
+{
+	ZoneScopedN( "bindParameter<std::monostate>" );
+	return sqlite3_bind_null( stmt, idx );
+}
+
 template <>
 int bindParameter( sqlite3_stmt* stmt, const QString val, const int idx ) noexcept
 {
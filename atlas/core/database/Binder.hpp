@@ -7,6 +7,7 @@
 
 #include <sqlite3.h>
 #include <string>
+#include <variant>
 #include <vector>
 
 #include <tracy/TracyC.h>
@@ -14,6 +15,12 @@
 #include "Database.hpp"
 #include "FunctionDecomp.hpp"
 
+//! A column value of any of sqlite's storage classes. std::monostate is NULL. Blobs are read as text.
+using SqlValue = std::variant< std::monostate, std::int64_t, double, std::string >;
+
+//! Reads column `index` of the current row of `stmt` as whatever type sqlite has it stored as.
+SqlValue columnValue( sqlite3_stmt* stmt, const int index ) noexcept;
+
 template < std::uint64_t index, typename T >
 	requires std::is_integral_v< T >
 void extract( sqlite3_stmt* stmt, T& t ) noexcept
@@ -83,6 +90,8 @@ class Binder
 	int param_counter { 0 };
 	int max_param_count { 0 };
 	bool ran { false };
+	//! If false the statement belongs to someone else (StatementCache) and is only reset when we are done
+	bool owning { true };
 
 	Q_DISABLE_COPY_MOVE( Binder )
 
@@ -92,6 +101,9 @@ class Binder
 
 	Binder( const std::string_view sql );
 
+	//! Uses an already prepared statement. The statement is reset instead of finalized on destruction
+	Binder( sqlite3_stmt* prepared );
+
 	template < typename T >
 	Binder& operator<<( T t )
 	{
@@ -162,6 +174,9 @@ class Binder
 		}
 	}
 
+	//! Reads a single row, with every column, into `row`. `row` is left empty if the query returned no rows
+	void operator>>( std::vector< SqlValue >& row );
+
 	template < typename Function >
 	void operator>>( Function&& func )
 	{
@@ -0,0 +1,333 @@
+//
+// Created by kj16609 on 7/25/23.
+//
+
+#include "Catalog.hpp"
+
+#include <atomic>
+
+#include <tracy/Tracy.hpp>
+
+#include "CatalogText.hpp"
+#include "StatementCache.hpp"
+#include "Transaction.hpp"
+#include "core/logging.hpp"
+
+namespace catalog
+{
+	namespace
+	{
+		//! Empty while the catalog is in memory
+		std::filesystem::path catalog_path {};
+
+		std::atomic< std::uint64_t > catalog_generation { 0 };
+
+		constexpr std::array< std::string_view, 2 > catalog_tables { "atlas_data", "f95_zone_data" };
+
+		void exec( sqlite3& db, const std::string& sql )
+		{
+			char* error { nullptr };
+			if ( sqlite3_exec( &db, sql.c_str(), nullptr, nullptr, &error ) != SQLITE_OK )
+			{
+				const std::string what { error != nullptr ? error : sqlite3_errmsg( &db ) };
+				sqlite3_free( error );
+				throw std::runtime_error( fmt::format( "Catalog: \"{}\" failed: {}", sql, what ) );
+			}
+		}
+
+		void attachAs( sqlite3& db, const std::string& path )
+		{
+			sqlite3_stmt* stmt { nullptr };
+			if ( sqlite3_prepare_v2( &db, "ATTACH DATABASE ? AS catalog", -1, &stmt, nullptr ) != SQLITE_OK )
+				throw std::runtime_error( fmt::format( "Catalog: Failed to prepare attach: {}", sqlite3_errmsg( &db ) ) );
+
+			sqlite3_bind_text( stmt, 1, path.c_str(), static_cast< int >( path.size() ), SQLITE_TRANSIENT );
+			const auto ret { sqlite3_step( stmt ) };
+			sqlite3_finalize( stmt );
+
+			if ( ret != SQLITE_DONE )
+				throw std::runtime_error( fmt::format( "Catalog: Failed to attach {}: {}", path, sqlite3_errmsg( &db ) ) );
+		}
+
+		sqlite3* open( const std::filesystem::path& path, const int flags )
+		{
+			sqlite3* db { nullptr };
+			if ( sqlite3_open_v2( path.string().c_str(), &db, flags, nullptr ) != SQLITE_OK )
+			{
+				const std::string what { db != nullptr ? sqlite3_errmsg( db ) : "out of memory" };
+				sqlite3_close_v2( db );
+				throw std::runtime_error( fmt::format( "Catalog: Failed to open {}: {}", path, what ) );
+			}
+
+			return db;
+		}
+
+		std::filesystem::path shadowPath()
+		{
+			auto shadow { catalog_path };
+			shadow += ".shadow";
+			return shadow;
+		}
+
+		//! Copies catalog tables out of main, where versions before the catalog was split kept them
+		void migrate( sqlite3& db )
+		{
+			ZoneScoped;
+			StatementCache statements { db };
+
+			for ( const auto table : catalog_tables )
+			{
+				bool exists { false };
+				( statements << "SELECT name FROM main.sqlite_master WHERE type = 'table' AND name = ?" )
+						<< std::string( table )
+					>> [ &exists ]( [[maybe_unused]] const std::string name ) noexcept { exists = true; };
+
+				if ( !exists ) continue;
+
+				//Older tables can be missing columns (row_hash) so only the ones both have are copied
+				std::string columns {};
+				( statements << "SELECT name FROM pragma_table_info(?, 'main') WHERE name IN "
+				                "(SELECT name FROM pragma_table_info(?, 'catalog'))" )
+						<< std::string( table ) << std::string( table )
+					>> [ &columns ]( const std::string name ) noexcept
+				{
+					if ( !columns.empty() ) columns += ", ";
+					columns += name;
+				};
+
+				spdlog::info( "Moving {} into the catalog", table );
+				exec( db, "BEGIN TRANSACTION" );
+				try
+				{
+					exec(
+						db,
+						fmt::format(
+							"INSERT OR REPLACE INTO catalog.{0} ({1}) SELECT {1} FROM main.{0}", table, columns ) );
+					exec( db, fmt::format( "DROP TABLE main.{}", table ) );
+					exec( db, "COMMIT TRANSACTION" );
+				}
+				catch ( ... )
+				{
+					exec( db, "ROLLBACK TRANSACTION" );
+					throw;
+				}
+			}
+		}
+
+		//! `user_version` of the catalog once long text has been compressed
+		constexpr int compressed_version { 1 };
+
+		//! Compresses text written before `CatalogText` existed. Only runs once per catalog
+		void compressOldText( sqlite3& db )
+		{
+			ZoneScoped;
+			StatementCache statements { db };
+			int version { 0 };
+			( statements << "PRAGMA catalog.user_version" ) >> version;
+			if ( version >= compressed_version ) return;
+
+			exec( db, "BEGIN TRANSACTION" );
+			std::size_t compressed { 0 };
+			try
+			{
+				compressed = compressColumns( db, "catalog" );
+				exec( db, fmt::format( "PRAGMA catalog.user_version = {}", compressed_version ) );
+				exec( db, "COMMIT TRANSACTION" );
+			}
+			catch ( ... )
+			{
+				exec( db, "ROLLBACK TRANSACTION" );
+				throw;
+			}
+
+			if ( compressed == 0 ) return;
+
+			//Compressing only frees pages. The file doesn't shrink until it's rebuilt
+			spdlog::info( "Compressed {} catalog values. Rebuilding the catalog", compressed );
+			exec( db, "VACUUM catalog" );
+		}
+
+		void createViews( sqlite3& db )
+		{
+			exec(
+				db,
+				"CREATE TEMP VIEW IF NOT EXISTS record_atlas_data AS "
+				"SELECT record_id, atlas_data.* FROM atlas_mapping NATURAL JOIN atlas_data" );
+			exec(
+				db,
+				"CREATE TEMP VIEW IF NOT EXISTS record_f95_data AS "
+				"SELECT record_id, f95_zone_data.* FROM atlas_mapping NATURAL JOIN f95_zone_data" );
+		}
+	} // namespace
+
+	std::filesystem::path pathFor( const std::filesystem::path& db_path )
+	{
+		if ( db_path.empty() || db_path == ":memory:" ) return {};
+		return db_path.parent_path() / "catalog.db";
+	}
+
+	void createTables( sqlite3& db, const std::string_view schema )
+	{
+		exec(
+			db,
+			fmt::format(
+				"CREATE TABLE IF NOT EXISTS {}.atlas_data (atlas_id INTEGER PRIMARY KEY, id_name STRING UNIQUE, short_name STRING,"
+				"title STRING, original_name STRING, category STRING, engine STRING, status STRING, version STRING,"
+				"developer STRING, creator STRING, overview STRING, censored STRING, language STRING, translations STRING,"
+				"genre STRING, tags STRING, voice STRING, os STRING, release_date DATE, length STRING, banner STRING, banner_wide STRING,"
+				"cover STRING, logo STRING, wallpaper STRING, previews STRING, last_db_update STRING, row_hash INTEGER);",
+				schema ) );
+
+		exec(
+			db,
+			fmt::format(
+				"CREATE TABLE IF NOT EXISTS {}.f95_zone_data (f95_id INTEGER UNIQUE PRIMARY KEY, atlas_id INTEGER REFERENCES atlas_data(atlas_id) UNIQUE , banner_url STRING, site_url STRING,"
+				"last_thread_comment STRING, thread_publish_date STRING, last_record_update STRING, views STRING, likes STRING, tags STRING, rating STRING,"
+				"screens STRING, replies STRING, row_hash INTEGER);",
+				schema ) );
+
+		//Tag columns of atlas_data split into ids. See remote::parsers::CatalogTagWriter
+		exec(
+			db,
+			fmt::format(
+				"CREATE TABLE IF NOT EXISTS {}.catalog_tags (tag_id INTEGER PRIMARY KEY, type INTEGER NOT NULL, tag TEXT NOT NULL COLLATE NOCASE, UNIQUE(type, tag));",
+				schema ) );
+		exec(
+			db,
+			fmt::format(
+				"CREATE TABLE IF NOT EXISTS {}.catalog_tag_map (atlas_id INTEGER NOT NULL, tag_id INTEGER NOT NULL, PRIMARY KEY(atlas_id, tag_id)) WITHOUT ROWID;",
+				schema ) );
+		exec(
+			db,
+			fmt::format(
+				"CREATE INDEX IF NOT EXISTS {}.catalog_tag_map_by_tag ON catalog_tag_map (tag_id, atlas_id);", schema ) );
+	}
+
+	void attach( sqlite3& db, const std::filesystem::path& db_path )
+	{
+		ZoneScoped;
+		catalog_path = pathFor( db_path );
+
+		//A shadow left behind by a crash was never swapped in. The live catalog is still complete
+		if ( !catalog_path.empty() ) std::filesystem::remove( shadowPath() );
+
+		attachAs( db, catalog_path.empty() ? ":memory:" : catalog_path.string() );
+		registerTextFunctions( db );
+		createTables( db, "catalog" );
+		migrate( db );
+		compressOldText( db );
+		createViews( db );
+	}
+
+	std::filesystem::path path()
+	{
+		return catalog_path;
+	}
+
+	std::uint64_t generation()
+	{
+		return catalog_generation.load();
+	}
+
+	void changed()
+	{
+		++catalog_generation;
+	}
+
+	Shadow::Shadow( const Seed seed ) : m_path( shadowPath() )
+	{
+		ZoneScoped;
+		if ( catalog_path.empty() ) throw std::runtime_error( "Catalog: Can't build a shadow of an in memory catalog" );
+
+		std::filesystem::remove( m_path );
+
+		if ( seed == Live )
+		{
+			//Copied on it's own connection. Readers of the live catalog are not blocked
+			sqlite3* live { open( catalog_path, SQLITE_OPEN_READONLY ) };
+			sqlite3_stmt* stmt { nullptr };
+			int ret { sqlite3_prepare_v2( live, "VACUUM INTO ?", -1, &stmt, nullptr ) };
+			if ( ret == SQLITE_OK )
+			{
+				const auto shadow { m_path.string() };
+				sqlite3_bind_text( stmt, 1, shadow.c_str(), static_cast< int >( shadow.size() ), SQLITE_TRANSIENT );
+				ret = sqlite3_step( stmt );
+			}
+			const std::string what { sqlite3_errmsg( live ) };
+			sqlite3_finalize( stmt );
+			sqlite3_close_v2( live );
+
+			if ( ret != SQLITE_DONE )
+				throw std::runtime_error( fmt::format( "Catalog: Failed to copy the catalog: {}", what ) );
+		}
+
+		m_db = open( m_path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE );
+		registerTextFunctions( *m_db );
+		createTables( *m_db, "main" );
+	}
+
+	Shadow::~Shadow()
+	{
+		if ( m_db != nullptr )
+		{
+			sqlite3_close_v2( m_db );
+			std::error_code ec {};
+			std::filesystem::remove( m_path, ec );
+		}
+	}
+
+	sqlite3& Shadow::ref()
+	{
+		if ( m_db == nullptr ) throw std::runtime_error( "Catalog: Shadow was already swapped in" );
+		return *m_db;
+	}
+
+	void Shadow::write( const std::function< void( sqlite3& ) >& func )
+	{
+		ZoneScoped;
+		auto& db { ref() };
+		exec( db, "BEGIN TRANSACTION" );
+		try
+		{
+			func( db );
+			exec( db, "COMMIT TRANSACTION" );
+		}
+		catch ( ... )
+		{
+			exec( db, "ROLLBACK TRANSACTION" );
+			throw;
+		}
+	}
+
+	void Shadow::swap()
+	{
+		ZoneScoped;
+		sqlite3_close_v2( &ref() );
+		m_db = nullptr;
+
+		auto& db { Database::ref() };
+		//Every transaction, readers included, holds the other side of this. None of them can run while the catalog is
+		//detached. Anything that starts after this sees the new catalog. Nothing has to wait for more then the rename
+		const auto guard { catalogSwapLock() };
+
+		//Nothing can be reading it while the lock is held. A statement still running means something skipped the lock
+		if ( sqlite3_exec( &db, "DETACH DATABASE catalog", nullptr, nullptr, nullptr ) != SQLITE_OK )
+			throw std::runtime_error( fmt::format( "Catalog: Failed to detach: {}", sqlite3_errmsg( &db ) ) );
+
+		std::error_code ec {};
+		std::filesystem::rename( m_path, catalog_path, ec );
+
+		//Reattached even if the rename failed so the old catalog stays usable
+		attachAs( db, catalog_path.string() );
+		++catalog_generation;
+
+		if ( ec )
+		{
+			const auto what { ec.message() };
+			std::filesystem::remove( m_path, ec );
+			throw std::runtime_error( fmt::format( "Catalog: Failed to replace the catalog: {}", what ) );
+		}
+
+		spdlog::info( "Swapped in a new catalog" );
+	}
+} // namespace catalog
@@ -0,0 +1,82 @@
+//
+// Created by kj16609 on 7/25/23.
+//
+
+#ifndef ATLASGAMEMANAGER_CATALOG_HPP
+#define ATLASGAMEMANAGER_CATALOG_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <sqlite3.h>
+
+//! The remote catalog (`atlas_data`, `f95_zone_data`) lives in it's own file, attached to the main DB as `catalog`.
+/**
+ * Queries can keep using the unqualified table names. Views that join user data with the catalog are TEMP views,
+ * since a view stored in main can't reference an attached database.
+ */
+namespace catalog
+{
+	//! Catalog file used for the database at `db_path`. Empty for in memory databases
+	std::filesystem::path pathFor( const std::filesystem::path& db_path );
+
+	//! Creates the catalog tables in `schema` of `db` if they don't exist
+	void createTables( sqlite3& db, const std::string_view schema );
+
+	//! Attaches the catalog to `db` and creates the views that use it.
+	/**
+	 * Catalog tables left in main by older versions are moved into the catalog.
+	 */
+	void attach( sqlite3& db, const std::filesystem::path& db_path );
+
+	//! Path of the attached catalog. Empty if the catalog is in memory
+	std::filesystem::path path();
+
+	//! Bumped every time a shadow is swapped in or `changed()` is called. Lets caches notice changes they can't see
+	std::uint64_t generation();
+
+	//! Bumps `generation()`. For writes an update hook never hears about, like those to WITHOUT ROWID tables
+	void changed();
+
+	//! A copy of the catalog built on it's own connection while the live catalog stays readable.
+	/**
+	 * Nothing else may write to the catalog while a shadow exists. Changes made to the live catalog would be lost on `swap()`.
+	 * The shadow file is deleted if it's never swapped in.
+	 */
+	class Shadow
+	{
+		std::filesystem::path m_path;
+		sqlite3* m_db { nullptr };
+
+	  public:
+
+		enum Seed
+		{
+			//! Start from empty tables. For full refreshes
+			Empty,
+			//! Start from a copy of the live catalog
+			Live
+		};
+
+		//! Throws if the catalog is in memory
+		Shadow( const Seed seed );
+		~Shadow();
+
+		Shadow( const Shadow& ) = delete;
+		Shadow& operator=( const Shadow& ) = delete;
+
+		sqlite3& ref();
+
+		//! Runs `func` inside of a transaction on the shadow. Rolled back if `func` throws
+		void write( const std::function< void( sqlite3& ) >& func );
+
+		//! Replaces the live catalog with the shadow.
+		/**
+		 * Waits for running transactions. Ones started meanwhile wait for the detach, rename and attach, never for the writes.
+		 * Must not be called from inside of a transaction
+		 */
+		void swap();
+	};
+} // namespace catalog
+
+#endif //ATLASGAMEMANAGER_CATALOG_HPP
@@ -0,0 +1,151 @@
+//
+// Created by kj16609 on 7/28/23.
+//
+
+#include "CatalogText.hpp"
+
+#include <lz4.h>
+
+#include <cstring>
+#include <limits>
+
+#include <tracy/Tracy.hpp>
+
+#include "StatementCache.hpp"
+#include "core/logging.hpp"
+
+namespace catalog
+{
+	namespace
+	{
+		constexpr std::size_t header_size { sizeof( std::uint32_t ) };
+
+		//! Anything bigger is corrupt. Overviews are a few KB at most
+		constexpr std::size_t max_text_size { 16 * 1024 * 1024 };
+
+		void catalogText( sqlite3_context* context, [[maybe_unused]] int argc, sqlite3_value** argv )
+		{
+			auto* value { argv[ 0 ] };
+			if ( sqlite3_value_type( value ) != SQLITE_BLOB )
+			{
+				sqlite3_result_value( context, value );
+				return;
+			}
+
+			const std::span< const std::byte > blob {
+				static_cast< const std::byte* >( sqlite3_value_blob( value ) ),
+				static_cast< std::size_t >( sqlite3_value_bytes( value ) )
+			};
+
+			try
+			{
+				const auto text { decompressText( blob ) };
+				sqlite3_result_text( context, text.data(), static_cast< int >( text.size() ), SQLITE_TRANSIENT );
+			}
+			catch ( std::exception& e )
+			{
+				sqlite3_result_error( context, e.what(), -1 );
+			}
+		}
+	} // namespace
+
+	std::vector< std::byte > compressText( const std::string_view text )
+	{
+		ZoneScoped;
+		if ( text.size() > max_text_size )
+			throw std::runtime_error( fmt::format( "Catalog: {} bytes of text is too large to compress", text.size() ) );
+
+		const auto size { static_cast< int >( text.size() ) };
+		std::vector< std::byte > blob( header_size + static_cast< std::size_t >( LZ4_compressBound( size ) ) );
+
+		const auto length { static_cast< std::uint32_t >( text.size() ) };
+		for ( std::size_t i = 0; i < header_size; ++i )
+			blob[ i ] = static_cast< std::byte >( ( length >> ( i * 8 ) ) & 0xFF );
+
+		const auto written { LZ4_compress_default(
+			text.data(),
+			reinterpret_cast< char* >( blob.data() + header_size ),
+			size,
+			static_cast< int >( blob.size() - header_size ) ) };
+		if ( written <= 0 ) throw std::runtime_error( "Catalog: Failed to compress text" );
+
+		blob.resize( header_size + static_cast< std::size_t >( written ) );
+		return blob;
+	}
+
+	std::string decompressText( const std::span< const std::byte > blob )
+	{
+		ZoneScoped;
+		if ( blob.size() < header_size ) throw std::runtime_error( "Catalog: Compressed text is missing it's header" );
+
+		std::uint32_t length { 0 };
+		for ( std::size_t i = 0; i < header_size; ++i )
+			length |= static_cast< std::uint32_t >( blob[ i ] ) << ( i * 8 );
+
+		if ( length > max_text_size )
+			throw std::runtime_error( fmt::format( "Catalog: Compressed text claims to be {} bytes", length ) );
+
+		std::string text( length, '\0' );
+		const auto read { LZ4_decompress_safe(
+			reinterpret_cast< const char* >( blob.data() + header_size ),
+			text.data(),
+			static_cast< int >( blob.size() - header_size ),
+			static_cast< int >( length ) ) };
+
+		if ( read < 0 || static_cast< std::uint32_t >( read ) != length )
+			throw std::runtime_error( "Catalog: Compressed text is corrupt" );
+
+		return text;
+	}
+
+	void registerTextFunctions( sqlite3& db )
+	{
+		if ( sqlite3_create_function_v2(
+				 &db,
+				 "catalog_text",
+				 1,
+				 SQLITE_UTF8 | SQLITE_DETERMINISTIC,
+				 nullptr,
+				 &catalogText,
+				 nullptr,
+				 nullptr,
+				 nullptr )
+		     != SQLITE_OK )
+			throw std::runtime_error(
+				fmt::format( "Catalog: Failed to register catalog_text: {}", sqlite3_errmsg( &db ) ) );
+	}
+
+	std::size_t compressColumns( sqlite3& db, const std::string_view schema )
+	{
+		ZoneScoped;
+		StatementCache statements { db };
+		std::size_t compressed { 0 };
+
+		for ( const auto& [ table, key, column ] : compressed_columns )
+		{
+			//Read a row at a time by key so no read is left running while the row is rewritten
+			const auto select { fmt::format(
+				"SELECT {1}, {2} FROM {0}.{3} WHERE {1} > ? AND typeof({2}) = 'text' AND length(CAST({2} AS BLOB)) >= ? "
+				"ORDER BY {1} LIMIT 1",
+				schema,
+				key,
+				column,
+				table ) };
+			const auto update { fmt::format( "UPDATE {}.{} SET {} = ? WHERE {} = ?", schema, table, column, key ) };
+
+			std::int64_t last_id { std::numeric_limits< std::int64_t >::min() };
+			while ( true )
+			{
+				std::vector< SqlValue > row {};
+				( statements << select ) << last_id << static_cast< std::int64_t >( compress_min_size ) >> row;
+				if ( row.empty() ) break;
+
+				last_id = std::get< std::int64_t >( row[ 0 ] );
+				( statements << update ) << compressText( std::get< std::string >( row[ 1 ] ) ) << last_id;
+				++compressed;
+			}
+		}
+
+		return compressed;
+	}
+} // namespace catalog
@@ -0,0 +1,54 @@
+//
+// Created by kj16609 on 7/28/23.
+//
+
+#ifndef ATLASGAMEMANAGER_CATALOGTEXT_HPP
+#define ATLASGAMEMANAGER_CATALOGTEXT_HPP
+
+#include <array>
+#include <cstddef>
+#include <span>
+#include <sqlite3.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+//! Long catalog text that is rarely read (overviews) is stored as LZ4 blobs.
+/**
+ * A compressed value is the uncompressed size as a little endian uint32 followed by an LZ4 block.
+ * Values shorter then `compress_min_size` stay text, so a column can hold both. Read them with `catalog_text(column)`.
+ */
+namespace catalog
+{
+	struct CompressedColumn
+	{
+		std::string_view table;
+		std::string_view key;
+		std::string_view column;
+	};
+
+	inline constexpr std::array< CompressedColumn, 1 > compressed_columns { { { "atlas_data", "atlas_id", "overview" } } };
+
+	//! LZ4 doesn't gain anything on shorter text
+	inline constexpr std::size_t compress_min_size { 128 };
+
+	constexpr bool isCompressed( const std::string_view table, const std::string_view column )
+	{
+		for ( const auto& compressed : compressed_columns )
+			if ( compressed.table == table && compressed.column == column ) return true;
+		return false;
+	}
+
+	std::vector< std::byte > compressText( const std::string_view text );
+
+	//! Throws if `blob` isn't a compressed value
+	std::string decompressText( const std::span< const std::byte > blob );
+
+	//! Adds `catalog_text(value)` to `db`. Text is given back as is, blobs are decompressed
+	void registerTextFunctions( sqlite3& db );
+
+	//! Compresses long text left in the compressed columns of `schema` by older versions. Returns how many were compressed
+	std::size_t compressColumns( sqlite3& db, const std::string_view schema );
+} // namespace catalog
+
+#endif //ATLASGAMEMANAGER_CATALOGTEXT_HPP
@@ -6,9 +6,11 @@
 
 #include <sqlite3.h>
 
+#include "Catalog.hpp"
 #include "Transaction.hpp"
 #include "core/config.hpp"
 #include "core/database/record/Record.hpp"
+#include "core/remote/parsers/CatalogTags.hpp"
 
 namespace internal
 {
@@ -37,6 +39,22 @@ internal::MtxType& Database::lock()
 	return internal::db_mtx;
 }
 
+//! Adds `column_def` to `table` if the table does not have a column by that name yet
+static void addColumn( RapidTransaction& transaction, const std::string& table, const std::string& column_def )
+{
+	const std::string name { column_def.substr( 0, column_def.find( ' ' ) ) };
+
+	bool exists { false };
+	transaction << "SELECT name FROM pragma_table_info(?) WHERE name = ?" << table << name >>
+		[ &exists ]( [[maybe_unused]] const std::string str ) noexcept { exists = true; };
+
+	if ( !exists )
+	{
+		spdlog::info( "Adding column {} to {}", name, table );
+		transaction << fmt::format( "ALTER TABLE {} ADD COLUMN {}", table, column_def );
+	}
+}
+
 void Database::initalize( const std::filesystem::path init_path )
 {
 	ZoneScoped;
@@ -64,20 +82,9 @@ void Database::initalize( const std::filesystem::path init_path )
 		//Extra data for records
 		"CREATE TABLE IF NOT EXISTS game_notes (record_id INTEGER REFERENCES records(record_id), notes TEXT, UNIQUE(record_id))",
 
-		//Atlas data tables
-		"CREATE TABLE IF NOT EXISTS atlas_data (atlas_id INTEGER PRIMARY KEY, id_name STRING UNIQUE, short_name STRING,"
-		"title STRING, original_name STRING, category STRING, engine STRING, status STRING, version STRING,"
-		"developer STRING, creator STRING, overview STRING, censored STRING, language STRING, translations STRING,"
-		"genre STRING, tags STRING, voice STRING, os STRING, release_date DATE, length STRING, banner STRING, banner_wide STRING,"
-		"cover STRING, logo STRING, wallpaper STRING, previews STRING, last_db_update STRING);",
-
+		//Links to the catalog. The catalog tables themselves are in their own database. See catalog::attach
 		"CREATE TABLE IF NOT EXISTS atlas_mapping (record_id INTEGER REFERENCES records(record_id), atlas_id INTEGER REFERENCES atlas_data(id), UNIQUE(record_id, atlas_id));",
 
-		//F95 data tables
-		"CREATE TABLE IF NOT EXISTS f95_zone_data (f95_id INTEGER UNIQUE PRIMARY KEY, atlas_id INTEGER REFERENCES atlas_data(atlas_id) UNIQUE , banner_url STRING, site_url STRING,"
-		"last_thread_comment STRING, thread_publish_date STRING, last_record_update STRING, views STRING, likes STRING, tags STRING, rating STRING,"
-		"screens STRING, replies STRING);",
-
 		//Update handling
 		"CREATE TABLE IF NOT EXISTS updates (update_time INTEGER PRIMARY KEY, processed_time INTEGER, md5 BLOB);",
 
@@ -97,10 +104,55 @@ void Database::initalize( const std::filesystem::path init_path )
 
 		//Stats tables
 		"CREATE TABLE IF NOT EXISTS data_change (timestamp INTEGER, delta INTEGER)",
+		//Last measured size of whole directories. See size_cache
+		"CREATE TABLE IF NOT EXISTS directory_sizes (path TEXT PRIMARY KEY, bytes INTEGER, allocated INTEGER, files INTEGER, last_change INTEGER)",
+
+		//What the importer found in game folders. See scan_cache
+		"CREATE TABLE IF NOT EXISTS scan_cache (device INTEGER, inode INTEGER, mtime INTEGER, size INTEGER, children_mtime INTEGER, version INTEGER, engine TEXT, folder_size INTEGER, PRIMARY KEY(device, inode))",
+		"CREATE TABLE IF NOT EXISTS scan_cache_files (device INTEGER, inode INTEGER, type INTEGER, position INTEGER, path TEXT, FOREIGN KEY(device, inode) REFERENCES scan_cache(device, inode))",
+		"CREATE INDEX IF NOT EXISTS scan_cache_files_folder ON scan_cache_files(device, inode)",
+		"CREATE TABLE IF NOT EXISTS scan_cache_executables (device INTEGER, inode INTEGER, position INTEGER, format INTEGER, machine INTEGER, bits INTEGER, subsystem INTEGER, file_version TEXT, icon_offset INTEGER, FOREIGN KEY(device, inode) REFERENCES scan_cache(device, inode))",
+		"CREATE INDEX IF NOT EXISTS scan_cache_executables_folder ON scan_cache_executables(device, inode)",
 	};
 
 	for ( const auto& query_str : table_queries ) transaction << query_str;
 
+	catalog::attach( *internal::db_handle, init_path );
+
+	//Columns added after the table was first created. Older databases won't have them.
+	const std::vector< std::pair< std::string, std::string > > added_columns {
+		//Headers of the version's executable. See ExecutableInfo
+		{ "game_metadata", "exec_format INTEGER" },
+		{ "game_metadata", "exec_machine INTEGER" },
+		{ "game_metadata", "exec_bits INTEGER" },
+		{ "game_metadata", "exec_subsystem INTEGER" },
+		{ "game_metadata", "exec_version TEXT" },
+		{ "game_metadata", "exec_icon_offset INTEGER" },
+		//Versions outside of the games folder don't change it's size. See size_cache
+		{ "data_change", "in_place INTEGER" },
+	};
+
+	for ( const auto& [ table, column ] : added_columns ) addColumn( transaction, table, column );
+
+	//Catalogs from before the tag tables existed. Filled once from the text columns
+	bool needs_tag_index { false };
+	transaction << "SELECT EXISTS (SELECT 1 FROM atlas_data) AND NOT EXISTS (SELECT 1 FROM catalog_tag_map)"
+		>> needs_tag_index;
+	if ( needs_tag_index )
+	{
+		Transaction index_transaction {};
+		try
+		{
+			remote::parsers::indexCatalogTags();
+			index_transaction.commit();
+		}
+		catch ( ... )
+		{
+			index_transaction.abort();
+			throw;
+		}
+	}
+
 	config::db::first_start::set( false );
 
 	//Prepare our example record for the config
@@ -173,6 +173,48 @@ void GameMetadata::setRelativeExecPath( const std::filesystem::path& path )
 				<< m_parent->getID() << m_version.toStdString();
 }
 
+void GameMetadata::setExecutableInfo( const std::optional< ExecutableInfo >& info )
+{
+	ZoneScoped;
+	RapidTransaction transaction;
+	if ( !info )
+	{
+		transaction
+			<< "UPDATE game_metadata SET exec_format = NULL, exec_machine = NULL, exec_bits = NULL, exec_subsystem = NULL, exec_version = NULL, exec_icon_offset = NULL WHERE record_id = ? AND version = ?"
+			<< m_parent->getID() << m_version.toStdString();
+		return;
+	}
+
+	transaction
+		<< "UPDATE game_metadata SET exec_format = ?, exec_machine = ?, exec_bits = ?, exec_subsystem = ?, exec_version = ?, exec_icon_offset = ? WHERE record_id = ? AND version = ?"
+		<< static_cast< int >( info->format ) << info->machine << info->bits << info->subsystem << info->version
+		<< info->icon_offset << m_parent->getID() << m_version.toStdString();
+}
+
+std::optional< ExecutableInfo > GameMetadata::getExecutableInfo() const
+{
+	ZoneScoped;
+	RapidTransaction transaction;
+	std::optional< ExecutableInfo > info {};
+	transaction
+			<< "SELECT exec_format, exec_machine, exec_bits, exec_subsystem, COALESCE(exec_version, ''), exec_icon_offset FROM game_metadata WHERE record_id = ? AND version = ? AND exec_format IS NOT NULL"
+			<< m_parent->getID() << m_version.toStdString()
+		>> [ &info ](
+			   const int format,
+			   const std::uint16_t machine,
+			   const std::uint8_t bits,
+			   const std::uint16_t subsystem,
+			   std::string version,
+			   const std::uint32_t icon_offset ) noexcept
+	{
+		info = ExecutableInfo {
+			static_cast< ExecutableFormat >( format ), machine, bits, subsystem, std::move( version ), icon_offset
+		};
+	};
+
+	return info;
+}
+
 std::uint64_t GameMetadata::getImportTime() const
 {
 	ZoneScoped;
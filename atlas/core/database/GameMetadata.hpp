@@ -13,6 +13,7 @@
 #include "core/Types.hpp"
 #include "core/database/Database.hpp"
 #include "core/database/record/Record.hpp"
+#include "core/utils/ExecutableInfo.hpp"
 
 struct RecordData;
 
@@ -37,6 +38,8 @@ struct GameMetadata
 
 	void setVersionName( const QString str );
 	void setRelativeExecPath( const std::filesystem::path& path );
+	//! Stores what the headers of the executable say. Empty clears it
+	void setExecutableInfo( const std::optional< ExecutableInfo >& info );
 
 	//Getters
 	QString getVersionName() const;
@@ -47,6 +50,8 @@ struct GameMetadata
 	std::filesystem::path getPath() const;
 	std::filesystem::path getRelativeExecPath() const;
 	std::filesystem::path getExecPath() const;
+	//! Stored at import instead of reading the executable again. Empty if it wasn't an executable or was never read
+	std::optional< ExecutableInfo > getExecutableInfo() const;
 	std::uint64_t getFolderSize() const;
 	RecordID getParentID() const;
 	std::uint64_t getImportTime() const;
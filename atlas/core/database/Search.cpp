@@ -8,18 +8,27 @@
 
 #include "core/search/QueryBuilder.hpp"
 
-void Search::searchTextChanged( const QString text, const SortOrder order, const bool asc )
+atlas::search::FacetIndex& Search::facets()
+{
+	if ( !facet_index ) facet_index = std::make_unique< atlas::search::FacetIndex >();
+	return *facet_index;
+}
+
+void Search::searchTextChanged( const QString str, const SortOrder order, const bool asc )
 {
 	ZoneScoped;
 	try
 	{
-		if ( !text.isEmpty() )
-			query = generateQuery( text.toStdString(), order, asc );
+		text = str.toStdString();
+		matches = text.empty() ? std::nullopt : facets().evaluate( text );
+
+		if ( !text.empty() && !matches )
+			query = generateQuery( text, order, asc );
 		else
 			query = "SELECT DISTINCT record_id FROM records NATURAL JOIN last_import_times ORDER BY "
 			      + orderToStr( order ) + std::string( asc ? " ASC" : " DESC" );
 
-		runQuery();
+		emitResults();
 	}
 	catch ( std::exception& e )
 	{
@@ -35,13 +44,29 @@ void Search::runQuery()
 		      + orderToStr( SortOrder::Name ) + std::string( " ASC" );
 	}
 
+	//Records may have changed since the search was made
+	if ( matches ) matches = facets().evaluate( text );
+
+	emitResults();
+}
+
+void Search::emitResults()
+{
+	ZoneScoped;
+	const auto allowed { matches ? facets().records( *matches ) : std::vector< RecordID > {} };
+
 	std::vector< Record > records;
+	std::vector< RecordID > ids;
 
 	RapidTransaction transaction {};
 	transaction << query >> [ & ]( const RecordID id )
 	{
-		if ( id > 1 ) records.emplace_back( id );
+		if ( id <= 1 ) return;
+		if ( matches && !std::binary_search( allowed.begin(), allowed.end(), id ) ) return;
+		records.emplace_back( id );
+		ids.emplace_back( id );
 	};
 
 	emit searchCompleted( std::move( records ) );
-}
\ No newline at end of file
+	emit facetCountsChanged( facets().counts( facets().select( ids ) ) );
+}
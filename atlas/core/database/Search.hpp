@@ -5,11 +5,13 @@
 #ifndef ATLAS_SEARCH_HPP
 #define ATLAS_SEARCH_HPP
 
+#include <memory>
 #include <vector>
 
 #include <QString>
 
 #include "core/database/record/Record.hpp"
+#include "core/search/FacetIndex.hpp"
 #include "core/search/QueryBuilder.hpp"
 
 class Search final : public QObject
@@ -17,12 +19,23 @@ class Search final : public QObject
 	Q_OBJECT
 
 	std::string query {};
+	std::string text {};
+	//! Set when `text` was answered by the facet index instead of SQL
+	std::optional< atlas::search::Bitmap > matches {};
+	//! Created on first use so it's built on the search thread
+	std::unique_ptr< atlas::search::FacetIndex > facet_index {};
+
+	atlas::search::FacetIndex& facets();
+	//! Runs `query`, keeping only `matches` if set, and emits the results
+	void emitResults();
 
   public:
 
   signals:
 	//! Emitted when a search is completed
 	void searchCompleted( std::vector< Record > );
+	//! Emitted after `searchCompleted` with the facet counts of the results
+	void facetCountsChanged( std::vector< atlas::search::FacetCount > );
 
   public slots:
 	//! Submits a text to get autocompleted.
@@ -0,0 +1,78 @@
+//
+// Created by kj16609 on 8/1/23.
+//
+
+#include "SizeCache.hpp"
+
+#include <tracy/Tracy.hpp>
+
+#include "core/database/Transaction.hpp"
+#include "core/logging.hpp"
+
+namespace size_cache
+{
+	std::int64_t lastChange()
+	{
+		std::int64_t last { 0 };
+		RapidTransaction() << "SELECT COALESCE(MAX(rowid), 0) FROM data_change" >> last;
+		return last;
+	}
+
+	std::optional< DirectorySize > find( const std::filesystem::path& path, const bool apply_changes )
+	{
+		ZoneScoped;
+		try
+		{
+			RapidTransaction transaction {};
+
+			std::optional< DirectorySize > size {};
+			std::int64_t last_change { 0 };
+			transaction << "SELECT bytes, allocated, files, last_change FROM directory_sizes WHERE path = ?"
+						<< path.string()
+				>> [ & ]( std::uint64_t bytes, std::uint64_t allocated, std::uint64_t files, std::int64_t change ) noexcept
+			{
+				size = DirectorySize { bytes, allocated, files };
+				last_change = change;
+			};
+
+			if ( !size || !apply_changes ) return size;
+
+			std::int64_t delta { 0 };
+			transaction << "SELECT COALESCE(SUM(delta), 0) FROM data_change WHERE rowid > ? AND in_place = 0"
+						<< last_change
+				>> delta;
+
+			//Deltas of versions measured differently then the folder can overshoot. Never below empty
+			const auto apply = [ delta ]( const std::uint64_t value )
+			{
+				return delta < 0 && static_cast< std::uint64_t >( -delta ) > value ?
+				           0 :
+				           static_cast< std::uint64_t >( static_cast< std::int64_t >( value ) + delta );
+			};
+			size->bytes = apply( size->bytes );
+			size->allocated = apply( size->allocated );
+			return size;
+		}
+		catch ( std::exception& e )
+		{
+			spdlog::warn( "size_cache: Failed to read {}: {}", path, e.what() );
+			return std::nullopt;
+		}
+	}
+
+	void store( const std::filesystem::path& path, const DirectorySize& size, const std::int64_t last_change )
+	{
+		ZoneScoped;
+		try
+		{
+			RapidTransaction()
+				<< "INSERT OR REPLACE INTO directory_sizes (path, bytes, allocated, files, last_change) VALUES (?, ?, ?, ?, ?)"
+				<< path.string() << size.bytes << size.allocated << size.files << last_change;
+		}
+		catch ( std::exception& e )
+		{
+			//Only costs showing the size late next time
+			spdlog::warn( "size_cache: Failed to store {}: {}", path, e.what() );
+		}
+	}
+} // namespace size_cache
@@ -0,0 +1,32 @@
+//
+// Created by kj16609 on 8/1/23.
+//
+
+#ifndef ATLASGAMEMANAGER_SIZECACHE_HPP
+#define ATLASGAMEMANAGER_SIZECACHE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+
+#include "core/utils/DirectorySize.hpp"
+
+//! Last measured size of whole directories, like the games and images folders, so they don't have to be walked to be shown.
+/**
+ * A stored size remembers the last row of `data_change` at the time it was measured. Versions added to or removed
+ * from the games folder since then are applied from the deltas after it, so the total stays close until it's
+ * measured again.
+ */
+namespace size_cache
+{
+	//! Row of the newest `data_change`. Taken before measuring and stored with the size
+	std::int64_t lastChange();
+
+	//! Empty if `path` was never measured. With `apply_changes` the deltas of versions that aren't in place are added
+	std::optional< DirectorySize > find( const std::filesystem::path& path, const bool apply_changes );
+
+	//! Replaces anything stored for `path`
+	void store( const std::filesystem::path& path, const DirectorySize& size, const std::int64_t last_change );
+} // namespace size_cache
+
+#endif //ATLASGAMEMANAGER_SIZECACHE_HPP
@@ -0,0 +1,35 @@
+//
+// Created by kj16609 on 7/15/23.
+//
+
+#include "StatementCache.hpp"
+
+StatementCache::StatementCache( sqlite3& db ) : m_db( db )
+{}
+
+StatementCache::~StatementCache()
+{
+	for ( auto& [ sql, stmt ] : m_statements ) sqlite3_finalize( stmt );
+}
+
+Binder StatementCache::operator<<( const std::string& sql )
+{
+	ZoneScoped;
+	auto itter { m_statements.find( sql ) };
+	if ( itter == m_statements.end() )
+	{
+		sqlite3_stmt* stmt { nullptr };
+		if ( sqlite3_prepare_v3(
+				 &m_db, sql.data(), static_cast< int >( sql.size() + 1 ), SQLITE_PREPARE_PERSISTENT, &stmt, nullptr )
+		     != SQLITE_OK )
+		{
+			spdlog::error( "Failed to prepare statement {}", sql );
+			throw std::runtime_error(
+				fmt::format( "DB: Failed to prepare statement: \"{}\", Reason: \"{}\"", sql, sqlite3_errmsg( &m_db ) ) );
+		}
+
+		itter = m_statements.emplace( sql, stmt ).first;
+	}
+
+	return { itter->second };
+}
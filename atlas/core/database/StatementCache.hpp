@@ -0,0 +1,37 @@
+//
+// Created by kj16609 on 7/15/23.
+//
+
+#ifndef ATLASGAMEMANAGER_STATEMENTCACHE_HPP
+#define ATLASGAMEMANAGER_STATEMENTCACHE_HPP
+
+#include <string>
+#include <unordered_map>
+
+#include "Binder.hpp"
+
+//! Keeps prepared statements around so repeated queries only pay for `sqlite3_prepare` once.
+/**
+ * Statements are finalized when the cache is destroyed. The cache must not outlive the connection it was made with.
+ * Binders given out by the cache borrow the statement and must be destroyed before the next call for the same query.
+ */
+class StatementCache
+{
+	sqlite3& m_db;
+	std::unordered_map< std::string, sqlite3_stmt* > m_statements {};
+
+  public:
+
+	StatementCache( sqlite3& db = Database::ref() );
+	~StatementCache();
+
+	StatementCache( const StatementCache& ) = delete;
+	StatementCache& operator=( const StatementCache& ) = delete;
+
+	//! Returns a binder for `sql`. Prepares it the first time it's seen
+	Binder operator<<( const std::string& sql );
+
+	std::size_t size() const { return m_statements.size(); }
+};
+
+#endif //ATLASGAMEMANAGER_STATEMENTCACHE_HPP
@@ -17,14 +17,37 @@ std::lock_guard< std::mutex > getLock()
 	else
 	{
 		last_locked = std::this_thread::get_id();
-		Binder( "BEGIN TRANSACTION" );
 		return std::lock_guard( trans_lock );
 	}
 }
 
+inline static std::shared_mutex catalog_mtx {};
+//! Transactions open on this thread. Only the outermost one holds `catalog_mtx`
+thread_local std::size_t catalog_depth { 0 };
+
+CatalogReadGuard::CatalogReadGuard() : m_owner( catalog_depth++ == 0 )
+{
+	if ( m_owner ) catalog_mtx.lock_shared();
+}
+
+CatalogReadGuard::~CatalogReadGuard()
+{
+	--catalog_depth;
+	if ( m_owner ) catalog_mtx.unlock_shared();
+}
+
+std::unique_lock< std::shared_mutex > catalogSwapLock()
+{
+	if ( catalog_depth != 0 ) throw std::runtime_error( "Deadlock detected! Catalog swapped from inside of a transaction" );
+	return std::unique_lock( catalog_mtx );
+}
+
 template <>
 TransactionBase< true >::TransactionBase() : guard( getLock() )
-{}
+{
+	//Begun only once we hold the lock. Otherwise it would start inside of whichever transaction is running
+	Binder( "BEGIN TRANSACTION" );
+}
 
 template <>
 TransactionBase< true >::~TransactionBase() noexcept( false )
@@ -7,8 +7,28 @@
 
 #include <tracy/Tracy.hpp>
 
+#include <shared_mutex>
+
 #include "Binder.hpp"
 
+//! Held by every transaction while it runs, so the catalog can't be swapped out from under it's statements.
+/**
+ * Shared by all readers. Only the outermost transaction on a thread takes the lock, so nesting them is fine.
+ * See `catalogSwapLock()`
+ */
+class CatalogReadGuard
+{
+	bool m_owner;
+
+  public:
+
+	CatalogReadGuard();
+	~CatalogReadGuard();
+
+	CatalogReadGuard( const CatalogReadGuard& ) = delete;
+	CatalogReadGuard& operator=( const CatalogReadGuard& ) = delete;
+};
+
 template < bool is_commitable = false >
 struct TransactionBase
 {
@@ -21,6 +41,7 @@ struct TransactionBase
 	bool m_finished { false };
 	std::mutex self_mtx {};
 	std::lock_guard< std::mutex > guard;
+	CatalogReadGuard catalog_guard {};
 
 	Binder operator<<( std::string_view sql )
 	{
@@ -64,4 +85,10 @@ struct TransactionBase
 using Transaction = TransactionBase< true >;
 using RapidTransaction = TransactionBase< false >;
 
+//! Waits for every running transaction and keeps new ones from starting while held. For swapping the catalog file
+/**
+ * Throws if this thread is inside of a transaction itself
+ */
+std::unique_lock< std::shared_mutex > catalogSwapLock();
+
 #endif //ATLASGAMEMANAGER_TRANSACTION_HPP
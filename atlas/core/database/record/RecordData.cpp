@@ -96,10 +96,10 @@ void RecordData::addVersion(
 			   .count();
 
 	transaction
-		<< "INSERT INTO data_change (timestamp, delta) VALUES (?, ?)"
+		<< "INSERT INTO data_change (timestamp, delta, in_place) VALUES (?, ?, ?)"
 		<< std::chrono::duration_cast< std::chrono::seconds >( std::chrono::system_clock::now().time_since_epoch() )
 			   .count()
-		<< folder_size;
+		<< folder_size << in_place;
 }
 
 void RecordData::removeVersion( const GameMetadata& version )
@@ -110,15 +110,19 @@ void RecordData::removeVersion( const GameMetadata& version )
 	auto itter { std::find( active_versions.begin(), active_versions.end(), version ) };
 	if ( itter == active_versions.end() ) return;
 
+	//Read before the row is gone
+	const auto folder_size { version.getFolderSize() };
+	const bool in_place { version.isInPlace() };
+
 	RapidTransaction transaction;
 	transaction << "DELETE FROM game_metadata WHERE record_id = ? AND version = ?" << m_id
 				<< version.getVersionName().toStdString();
 
 	transaction
-		<< "INSERT INTO data_change (timestamp, delta) VALUES (?, ?)"
+		<< "INSERT INTO data_change (timestamp, delta, in_place) VALUES (?, ?, ?)"
 		<< std::chrono::duration_cast< std::chrono::seconds >( std::chrono::system_clock::now().time_since_epoch() )
 			   .count()
-		<< ( 0 - static_cast< std::int64_t >( version.getFolderSize() ) );
+		<< ( 0 - static_cast< std::int64_t >( folder_size ) ) << in_place;
 }
 
 RecordData::RecordData( QString title_in, QString creator_in, QString engine_in )
@@ -128,6 +128,7 @@ struct RecordData
 	void linkAtlasData( const AtlasID id );
 
 	//Setters
+	//! `in_place` is true if `game_path` was left where it was imported from, outside the games folder
 	void addVersion(
 		QString version,
 		std::filesystem::path game_path,
@@ -72,4 +72,23 @@ struct AtlasColInfo< AtlasColumns::Engine >
 	static constexpr fgl::string_literal col_name { "engine" };
 };
 
+template <>
+struct AtlasColInfo< AtlasColumns::Overview >
+{
+	using Type = QString;
+	static constexpr fgl::string_literal col_name { "overview" };
+	//! Long overviews are stored compressed. See catalog::compressText
+	static constexpr fgl::string_literal select_name { "catalog_text(overview)" };
+};
+
+//! What to select to read `col`. Only differs from the column name for compressed columns
+template < AtlasColumns col >
+consteval auto atlasSelectName()
+{
+	if constexpr ( requires { AtlasColInfo< col >::select_name; } )
+		return AtlasColInfo< col >::select_name;
+	else
+		return AtlasColInfo< col >::col_name;
+}
+
 #endif //ATLASGAMEMANAGER_ATLASCOLTYPE_HPP
@@ -32,7 +32,7 @@ struct AtlasData
 	{
 		AtlasColType< col > val {};
 		RapidTransaction()
-				<< atlas::database::utility::select_query< AtlasColInfo< col >::col_name, "atlas_data", "atlas_id" >()
+				<< atlas::database::utility::select_query< atlasSelectName< col >(), "atlas_data", "atlas_id" >()
 				<< atlas_id
 			>> val;
 		return val;
@@ -44,7 +44,7 @@ struct AtlasData
 	{
 		std::tuple< AtlasColType< cols >... > tpl {};
 		RapidTransaction() << atlas::database::utility::
-					select_query_t< "atlas_data", "atlas_id", AtlasColInfo< cols >::col_name... >()
+					select_query_t< "atlas_data", "atlas_id", atlasSelectName< cols >()... >()
 						   << atlas_id
 			>> tpl;
 		return tpl;
@@ -6,24 +6,21 @@
 
 #include <tracy/Tracy.hpp>
 
+#include "core/utils/DirectorySize.hpp"
 #include "core/utils/FileScanner.hpp"
+#include "core/utils/ScanVisitor.hpp"
 
 //! Returns the byte size of a folder
 std::size_t folderSize( FileScanner& folder )
 {
 	ZoneScoped;
-	std::size_t counter { 0 };
-
-	for ( const auto& file : folder ) counter += file.size;
-
-	return counter;
+	SizeVisitor size {};
+	scan( folder, size );
+	return size.bytes();
 }
 
 std::size_t folderSize( const std::filesystem::path& path )
 {
 	ZoneScoped;
-	if ( !std::filesystem::exists( path ) || std::filesystem::is_empty( path ) ) return 0;
-
-	FileScanner scanner { path };
-	return folderSize( scanner );
+	return directorySize( path ).bytes;
 }
@@ -6,10 +6,12 @@
 #define ATLASGAMEMANAGER_GAMEIMPORTDATA_HPP
 
 #include <filesystem>
+#include <optional>
 
 #include <QString>
 
 #include "core/config.hpp"
+#include "core/utils/ExecutableInfo.hpp"
 
 struct GameImportData
 {
@@ -23,6 +25,8 @@ struct GameImportData
 	std::filesystem::path executable {};
 	std::array< QString, BannerType::SENTINEL > banners {};
 	std::vector< QString > previews {};
+	//! Headers of `executables`, in the same order. Empty if they weren't read
+	std::vector< ExecutableInfo > executable_info {};
 
 	GameImportData(
 		std::filesystem::path path_in,
@@ -34,7 +38,8 @@ struct GameImportData
 		std::vector< std::filesystem::path > executables_in,
 		std::filesystem::path executable_in,
 		std::array< QString, BannerType::SENTINEL > banners_in,
-		std::vector< QString > previews_in ) :
+		std::vector< QString > previews_in,
+		std::vector< ExecutableInfo > executable_info_in = {} ) :
 	  path( std::move( path_in ) ),
 	  title( std::move( title_in ) ),
 	  creator( std::move( creator_in ) ),
@@ -44,9 +49,18 @@ struct GameImportData
 	  executables( std::move( executables_in ) ),
 	  executable( std::move( executable_in ) ),
 	  banners( std::move( banners_in ) ),
-	  previews( std::move( previews_in ) )
+	  previews( std::move( previews_in ) ),
+	  executable_info( std::move( executable_info_in ) )
 	{}
 
+	//! Headers of `executable`, if they were read
+	std::optional< ExecutableInfo > executableInfo() const
+	{
+		for ( std::size_t i = 0; i < executables.size() && i < executable_info.size(); ++i )
+			if ( executables[ i ] == executable ) return executable_info[ i ];
+		return std::nullopt;
+	}
+
 	GameImportData() = delete;
 	GameImportData( GameImportData&& other ) = default;
 	GameImportData( const GameImportData& other ) = default;
@@ -5,237 +5,289 @@
 #include "GameScanner.hpp"
 
 #include <moc_GameScanner.cpp>
-#include <queue>
-
-#include <QFuture>
-#include <QtConcurrent>
 
 #include <tracy/Tracy.hpp>
 
-#include "core/foldersize.hpp"
+#include "ScanCache.hpp"
 #include "core/utils/FileScanner.hpp"
+#include "core/utils/ScanVisitor.hpp"
+#include "core/utils/StorageInfo.hpp"
+#include "core/utils/WorkStealingPool.hpp"
 #include "core/utils/engineDetection/engineDetection.hpp"
 #include "core/utils/regex/regex.hpp"
 
-void runner(
-	QPromise< GameImportData >& promise,
-	const QString regex,
-	const std::filesystem::path folder,
-	const std::filesystem::path base )
+namespace
 {
-	ZoneScoped;
-	try
+	//! Banners at the top of a game folder and the images in it's `previews` folder. Paths are relative to the folder
+	class BannerVisitor final : public ScanVisitor
 	{
-		if ( promise.isCanceled() ) return;
-		FileScanner scanner { folder };
-		std::vector< std::filesystem::path > potential_executables { detectExecutables( scanner ) };
+		std::vector< std::pair< int, std::filesystem::path > > m_banners {};
+		std::vector< std::filesystem::path > m_previews {};
 
-		if ( promise.isCanceled() ) return;
-		if ( potential_executables.size() > 0 )
-		{
-			const auto [ title, creator, version, engine ] =
-				regex::extractGroups( regex, QString::fromStdString( folder.string() ) );
+	  public:
 
-			//Search for banners
-			std::array< QString, BannerType::SENTINEL > banners {};
+		bool visit( const FileInfo& file ) override
+		{
+			if ( file.depth > 2 ) return false;
+			if ( file.directory ) return true;
 
-			for ( const auto& file : scanner )
+			if ( file.depth == 2 )
 			{
-				if ( promise.isCanceled() ) return;
-				if ( file.depth > 1 ) break;
-
-				const auto& path { file.path };
-				const auto& stem { path.filename().stem() };
-
-				if ( stem == "banner" )
-				{
-					banners[ Normal ] = QString::fromStdString( path.string() );
-				}
-				else if ( stem == "banner_w" )
-				{
-					banners[ Wide ] = QString::fromStdString( path.string() );
-				}
-				else if ( stem == "logo" )
-				{
-					banners[ Logo ] = QString::fromStdString( path.string() );
-				}
-				else if ( stem == "cover" )
-				{
-					banners[ Cover ] = QString::fromStdString( path.string() );
-				}
-				else
-					continue;
+				if ( file.relative().parent_path() == "previews" ) m_previews.emplace_back( file.relative() );
+				return true;
 			}
 
-			std::vector< QString > previews;
+			const auto stem { file.relative().stem() };
 
-			if ( std::filesystem::exists( folder / "previews" ) )
+			if ( stem == "banner" )
 			{
-				for ( const auto& file : std::filesystem::directory_iterator( folder / "previews" ) )
-				{
-					if ( promise.isCanceled() ) return;
-					if ( file.is_regular_file() )
-						previews.emplace_back( QString::fromStdString( file.path().string() ) );
-				}
+				m_banners.emplace_back( Normal, file.relative() );
+			}
+			else if ( stem == "banner_w" )
+			{
+				m_banners.emplace_back( Wide, file.relative() );
+			}
+			else if ( stem == "logo" )
+			{
+				m_banners.emplace_back( Logo, file.relative() );
+			}
+			else if ( stem == "cover" )
+			{
+				m_banners.emplace_back( Cover, file.relative() );
 			}
 
-			if ( promise.isCanceled() ) return;
-			GameImportData data { std::filesystem::relative( folder, base ),
-				                  std::move( title ),
-				                  std::move( creator ),
-				                  engine.isEmpty() ? engineName( determineEngine( scanner ) ) : std::move( engine ),
-				                  version.isEmpty() ? "0.0" : std::move( version ),
-				                  0,
-				                  potential_executables,
-				                  potential_executables.at( 0 ),
-				                  std::move( banners ),
-				                  std::move( previews ) };
-
-			promise.addResult( std::move( data ) );
+			return true;
 		}
-		else
+
+		std::vector< std::pair< int, std::filesystem::path > >& banners() { return m_banners; }
+
+		std::vector< std::filesystem::path >& previews() { return m_previews; }
+	};
+
+	//! Walks `folder` for everything the cache keeps. Empty if stopped first
+	std::optional< scan_cache::Entry > scanFolder( const std::filesystem::path& folder, const std::stop_token stop )
+	{
+		ZoneScoped;
+		//Everything is found in a single walk of the folder
+		FileScanner scanner { folder };
+		ExecutableVisitor executables {};
+		EngineVisitor engine_visitor {};
+		BannerVisitor banner_visitor {};
+		SizeVisitor size {};
+		const std::array< ScanVisitor*, 4 > visitors { &executables, &engine_visitor, &banner_visitor, &size };
+		if ( !scan( scanner, visitors, stop ) ) return std::nullopt;
+
+		return scan_cache::Entry { engineName( engine_visitor.engine() ).toStdString(),
+			                       size.bytes(),
+			                       executables.executables(),
+			                       std::move( banner_visitor.banners() ),
+			                       std::move( banner_visitor.previews() ),
+			                       executables.info() };
+	}
+
+	//! Everything needed to import the game in `folder`. Empty if stopped first
+	std::optional< GameImportData > runner(
+		const QString& regex,
+		const std::filesystem::path& folder,
+		const std::filesystem::path& base,
+		const bool cache_children,
+		const std::stop_token stop )
+	{
+		ZoneScoped;
+		//Unchanged folders are taken from the last scan of them
+		const auto stamp { scan_cache::stamp( folder, cache_children ) };
+		auto found { stamp ? scan_cache::find( *stamp ) : std::nullopt };
+		if ( !found )
+		{
+			found = scanFolder( folder, stop );
+			if ( !found ) return std::nullopt;
+			if ( stamp ) scan_cache::store( *stamp, *found );
+		}
+
+		const auto& potential_executables { found->executables };
+		if ( potential_executables.empty() )
 		{
 			spdlog::warn( "No executables found for path {}", folder );
 			throw std::runtime_error( fmt::format( "Failed to find executables for path {}", folder ) );
 		}
 
-		return;
-	}
-	catch ( const std::exception& e )
-	{
-		spdlog::error( "GameScanner::runner: {}", e.what() );
-		promise.setException( std::current_exception() );
+		std::array< QString, BannerType::SENTINEL > banners {};
+		for ( const auto& [ type, path ] : found->banners )
+			if ( type >= 0 && type < BannerType::SENTINEL )
+				banners[ static_cast< std::size_t >( type ) ] = QString::fromStdString( ( folder / path ).string() );
+
+		std::vector< QString > previews {};
+		for ( const auto& path : found->previews )
+			previews.emplace_back( QString::fromStdString( ( folder / path ).string() ) );
+
+		const auto [ title, creator, version, engine ] =
+			regex::extractGroups( regex, QString::fromStdString( folder.string() ) );
+
+		return GameImportData { std::filesystem::relative( folder, base ),
+			                    std::move( title ),
+			                    std::move( creator ),
+			                    engine.isEmpty() ? QString::fromStdString( found->engine ) : std::move( engine ),
+			                    version.isEmpty() ? "0.0" : std::move( version ),
+			                    found->folder_size,
+			                    potential_executables,
+			                    potential_executables.at( 0 ),
+			                    std::move( banners ),
+			                    std::move( previews ),
+			                    found->executable_info };
 	}
-	catch ( ... )
-	{
-		promise.setException( std::current_exception() );
-	}
-}
+} // namespace
 
-void GameScanner::mainRunner( QPromise< void >& promise, const std::filesystem::path base, const QString regex )
-try
+void GameScanner::spawn( std::function< void( const std::stop_token ) > task )
 {
-	ZoneScoped;
-	using namespace std::chrono_literals;
-	std::this_thread::sleep_for( 10ms );
-
-	std::vector< QFuture< void > > futures;
-
-	//List of futures for all of the 'valid' directories we've found so far.
-	std::queue< std::filesystem::path > to_scan {};
-	to_scan.push( base );
-	while ( to_scan.size() > 0 )
-	{
-		promise.suspendIfRequested();
-		if ( promise.isCanceled() ) return;
-
-		//List of all paths that we found nested. Will only be added to `to_scan` if the current path is NOT a valid match for the regex.
-		const auto current { to_scan.front() };
-		to_scan.pop();
-
-		for ( const auto& file : std::filesystem::directory_iterator( current ) )
+	++m_outstanding;
+	m_pool->submit(
+		[ this, task = std::move( task ), stop = m_stop.get_token() ]()
 		{
-			promise.suspendIfRequested();
-			if ( promise.isCanceled() ) return;
-			const std::filesystem::path& path { file.path() };
-			if ( std::filesystem::is_symlink( file ) )
+			if ( proceed( stop ) )
 			{
-				spdlog::warn( "Symlink found: {}", file.path() );
-				continue;
-			}
-
-			if ( std::filesystem::is_directory( path ) )
-			{
-				ZoneScopedN( "Check directory" );
-				if ( regex::valid( regex, QString::fromStdString( path.string() ) ) )
+				try
+				{
+					task( stop );
+				}
+				catch ( const std::exception& e )
 				{
-					//The regex was a match. We can now process this directory further
-					futures.emplace_back( QtConcurrent::run( &m_thread_pool, runner, regex, path, base )
-					                          .then( [ this ]( const GameImportData data )
-					                                 { emit foundGame( data ); } ) );
-					if ( promise.isCanceled() ) break;
-					//Directory should NOT be added to found_paths to be processed later since we shouldn't continue needing to look deeper.
+					spdlog::error( "GameScanner: {}", e.what() );
 				}
-				else //Directory wasn't a match. But we can try searching deeper.
-					to_scan.push( path );
 			}
-		}
+
+			finishTask();
+		} );
+}
+
+void GameScanner::finishTask()
+{
+	//Continuation of the whole scan. Whoever finishes last reports it
+	if ( --m_outstanding == 0 )
+	{
+		emit scanComplete();
+		m_running = false;
+		m_running.notify_all();
 	}
+}
 
-	spdlog::info( "Waiting for futures to finish" );
+bool GameScanner::proceed( const std::stop_token& stop )
+{
+	m_paused.wait( true );
+	return !stop.stop_requested();
+}
 
-	for ( auto& future : futures )
+void GameScanner::searchDirectory( const std::filesystem::path& path, const std::stop_token stop )
+{
+	ZoneScoped;
+	for ( const auto& file : std::filesystem::directory_iterator( path ) )
 	{
-		while ( true )
-		{
-			promise.suspendIfRequested();
-			if ( promise.isCanceled() )
-			{
-				future.cancel();
-				future.waitForFinished();
-				break;
-			}
+		if ( !proceed( stop ) ) return;
 
-			if ( future.isCanceled() || future.isFinished() ) break;
-			std::this_thread::yield();
-			using namespace std::chrono_literals;
-			std::this_thread::sleep_for( 10ms );
+		if ( file.is_symlink() )
+		{
+			spdlog::warn( "Symlink found: {}", file.path() );
+			continue;
 		}
+
+		if ( !file.is_directory() ) continue;
+
+		const auto& dir { file.path() };
+		if ( regex::valid( m_regex, QString::fromStdString( dir.string() ) ) )
+			//The regex was a match. We can now process this directory further and shouldn't look any deeper
+			spawn( [ this, dir ]( const std::stop_token task_stop ) { scanGame( dir, task_stop ); } );
+		else //Directory wasn't a match. But we can try searching deeper.
+			spawn( [ this, dir ]( const std::stop_token task_stop ) { searchDirectory( dir, task_stop ); } );
 	}
 }
-catch ( std::exception& e )
+
+void GameScanner::scanGame( const std::filesystem::path& path, const std::stop_token stop )
 {
-	spdlog::error( "Ate error before entering Qt space! {}", e.what() );
+	if ( auto data = runner( m_regex, path, m_base, m_cache_children, stop ); data && !stop.stop_requested() )
+		emit foundGame( std::move( *data ) );
 }
-catch ( ... )
+
+void GameScanner::reset( const std::filesystem::path& base, const QString& regex )
 {
-	spdlog::error( "Ate error before entering Qt space!" );
+	abort();
+	wait();
+
+	m_stop = {};
+	m_paused = false;
+	m_base = base;
+	m_regex = regex;
+	m_cache_children = config::importer::scanCacheChildren::get();
+
+	const auto threads { ioThreads( base ) };
+	if ( !m_pool || threads != m_pool->size() ) m_pool = std::make_unique< WorkStealingPool >( threads );
 }
 
 void GameScanner::start( const std::filesystem::path path, const QString regex )
 {
 	ZoneScoped;
-	m_thread_pool.setMaxThreadCount( 5 );
+	reset( path, regex );
+
+	m_running = true;
+	spawn( [ this, path ]( const std::stop_token stop ) { searchDirectory( path, stop ); } );
+}
 
-	m_runner_future = QtConcurrent::run( &m_thread_pool, &GameScanner::mainRunner, this, path, regex );
-	if ( m_runner_future.isFinished() )
-		emitComplete();
-	else
+void GameScanner::start(
+	const std::filesystem::path path, const QString regex, const std::vector< std::filesystem::path > games )
+{
+	ZoneScoped;
+	reset( path, regex );
+
+	if ( games.empty() )
 	{
-		connect( &m_watcher, &QFutureWatcher< void >::finished, this, &GameScanner::emitComplete );
-		m_watcher.setFuture( m_runner_future );
+		emit scanComplete();
+		return;
 	}
+
+	m_running = true;
+	//Counted up front so the first game to finish doesn't see the scan as over
+	++m_outstanding;
+	for ( const auto& game : games )
+		spawn( [ this, game ]( const std::stop_token stop ) { scanGame( game, stop ); } );
+	finishTask();
+}
+
+void GameScanner::wait()
+{
+	m_running.wait( true );
 }
 
 void GameScanner::pause()
 {
-	m_runner_future.suspend();
+	m_paused = true;
 }
 
 void GameScanner::resume()
 {
-	m_runner_future.resume();
+	m_paused = false;
+	m_paused.notify_all();
 }
 
 void GameScanner::abort()
 {
-	m_runner_future.cancel();
+	m_stop.request_stop();
+	//Paused tasks need to wake up to see it
+	resume();
 }
 
 bool GameScanner::isRunning()
 {
-	return m_runner_future.isRunning();
+	return m_running;
 }
 
 bool GameScanner::isPaused()
 {
-	return m_runner_future.isSuspended();
+	return m_paused;
 }
 
+GameScanner::GameScanner() = default;
+
 GameScanner::~GameScanner()
 {
 	ZoneScoped;
-	if ( m_runner_future.isRunning() ) m_runner_future.cancel();
-
-	m_thread_pool.waitForDone();
+	abort();
+	wait();
 }
@@ -5,27 +5,67 @@
 #ifndef ATLASGAMEMANAGER_GAMESCANNER_HPP
 #define ATLASGAMEMANAGER_GAMESCANNER_HPP
 
-#include <QFuture>
-#include <QFutureWatcher>
-#include <QThreadPool>
+#include <QObject>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <stop_token>
+#include <vector>
 
 #include "GameImportData.hpp"
 
+class WorkStealingPool;
+
+//! Searches a folder for games matching a path regex and scans each one it finds.
+/**
+ * Searching directories and scanning games are both tasks on one work stealing pool, sized for the drive being scanned.
+ * `scanComplete` is emitted by whichever task finishes last. Pausing holds tasks before they start,
+ * aborting stops them between files.
+ * Game folders that haven't changed since they were last scanned are taken from the scan_cache instead of walked again.
+ */
 class GameScanner final : public QObject
 {
 	Q_OBJECT
 
-	QThreadPool m_thread_pool {};
-	QFuture< void > m_runner_future {};
-	QFutureWatcher< void > m_watcher {};
+	//! Made on the first start
+	std::unique_ptr< WorkStealingPool > m_pool {};
+	std::stop_source m_stop {};
+
+	//! Tasks queued or running. The scan is over when it reaches 0
+	std::atomic< std::size_t > m_outstanding { 0 };
+	std::atomic< bool > m_running { false };
+	std::atomic< bool > m_paused { false };
 
-	void mainRunner( QPromise< void >& promise, const std::filesystem::path base, const QString regex );
+	std::filesystem::path m_base {};
+	QString m_regex {};
+	//! See config::importer::scanCacheChildren
+	bool m_cache_children { true };
+
+	//! Queues `task`. It's skipped if the scan is stopped before it starts
+	void spawn( std::function< void( const std::stop_token ) > task );
+	//! Waits out a pause. Returns false once the scan is stopped
+	bool proceed( const std::stop_token& stop );
+	//! Ends a task. The last one to end finishes the scan
+	void finishTask();
+	//! Stops any scan still running and gets ready for a new one
+	void reset( const std::filesystem::path& base, const QString& regex );
+
+	void searchDirectory( const std::filesystem::path& path, const std::stop_token stop );
+	void scanGame( const std::filesystem::path& path, const std::stop_token stop );
 
   public:
 
+	//! Stops any scan still running first
 	void start( const std::filesystem::path path, const QString regex );
+	//! Scans only `games`, which are folders under `path` already known to match `regex`
+	void start(
+		const std::filesystem::path path, const QString regex, const std::vector< std::filesystem::path > games );
+	//! Blocks until the scan is over
 	void wait();
 
+	//! Out of line, where WorkStealingPool is complete
+	GameScanner();
 	~GameScanner() override;
 
   public slots:
@@ -35,8 +75,6 @@ class GameScanner final : public QObject
 	bool isRunning();
 	bool isPaused();
 
-	void emitComplete() { emit scanComplete(); }
-
   signals:
 	void scanComplete();
 	void foundGame( const GameImportData data );
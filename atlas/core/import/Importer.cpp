@@ -7,6 +7,8 @@
 #include <QFuture>
 #include <QtConcurrent>
 
+#include <atomic>
+
 #include <tracy/Tracy.hpp>
 #include <tracy/TracyC.h>
 
@@ -15,9 +17,9 @@
 #include "core/database/record/Record.hpp"
 #include "core/database/record/RecordBanner.hpp"
 #include "core/database/record/RecordPreviews.hpp"
-#include "core/foldersize.hpp"
 #include "core/imageManager.hpp"
-#include "core/utils/FileScanner.hpp"
+#include "core/utils/CopyEngine.hpp"
+#include "core/utils/DirectorySize.hpp"
 #include "ui/notifications/NotificationPopup.hpp"
 #include "ui/notifications/ProgressMessage.hpp"
 
@@ -43,11 +45,16 @@ namespace internal
 		const QString& version,
 		const std::array< QString, BannerType::SENTINEL >& banners,
 		const std::vector< QString >& previews,
-		const bool owning )
+		const bool owning,
+		std::optional< std::size_t > folder_size,
+		std::optional< ExecutableInfo > executable_info )
 	try
 	{
 		ZoneScoped;
-		auto signaler { createNotification< ProgressMessage >( QString( "Importing game %1" ).arg( title ), true ) };
+		//Progress goes nowhere without a main window to show it
+		auto signaler { hasNotificationPopup() ?
+			                createNotification< ProgressMessage >( QString( "Importing game %1" ).arg( title ), true ) :
+			                std::make_unique< ProgressMessageSignaler >( std::make_shared< ProgressState >() ) };
 
 		promise.start();
 
@@ -55,6 +62,9 @@ namespace internal
 		//Verify that everything is valid
 		if ( !std::filesystem::exists( root ) )
 			throw std::runtime_error( fmt::format( "Root path {:ce} does not exist", root ) );
+		//Stored as is and looked up under wherever the game ends up. An absolute path would point at the old folder
+		if ( relative_executable.is_absolute() )
+			throw std::runtime_error( fmt::format( "Executable {:ce} is not relative to the game", relative_executable ) );
 		if ( !std::filesystem::exists( root / relative_executable ) )
 			throw std::runtime_error( fmt::format( "Executable {:ce} does not exist", root / relative_executable ) );
 		if ( title.isEmpty() ) throw std::runtime_error( "Title is empty" );
@@ -62,25 +72,46 @@ namespace internal
 		if ( version.isEmpty() ) throw std::runtime_error( "Version is empty" );
 		TracyCZoneEnd( tracy_checkZone );
 
-		TracyCZoneN( tracy_FileScanner, "File scan", true );
-		FileScanner scanner { root };
-
-		//Get the size of the folder
-		signaler->setProgress( Progress::CollectingFileInformation );
-		signaler->setMessage( "Calculating folder size: 0B" );
-		std::size_t folder_size { 0 };
-		std::size_t file_count { 0 };
-		QLocale locale;
-		for ( const auto& file : scanner )
+		//Moved before anything points at it, so a failed move leaves no record behind
+		std::filesystem::path game_path { root };
+		if ( owning )
 		{
-			++file_count;
-			folder_size += file.size;
+			ZoneScopedN( "Moving files" );
+			game_path = config::paths::games::getPath() / creator.toStdString() / title.toStdString()
+			          / version.toStdString();
+
+			//Not walked up front. A copy walks the folder anyway and counts the bytes as it goes
+			signaler->setMax( static_cast< std::int64_t >( folder_size.value_or( 0 ) ) );
+			signaler->setProgress( 0 );
+			signaler->setMessage(
+				folder_size ?
+					QString( "Moving %1" ).arg( QLocale().formattedDataSize( static_cast< qint64 >( *folder_size ) ) ) :
+					QString( "Moving files" ) );
+
+			std::atomic< std::uint64_t > copied { 0 };
+			const auto method { moveDirectory(
+				root,
+				game_path,
+				[ &signaler, &copied ]( const std::uint64_t bytes )
+				{
+					copied += bytes;
+					signaler->addProgress( static_cast< std::int64_t >( bytes ) );
+				},
+				static_cast< std::size_t >( std::max( config::importer::concurrentCopies::get(), 1 ) ) ) };
+
+			spdlog::debug(
+				"importGame: {} {} to {}", method == MoveMethod::Rename ? "Renamed" : "Copied", root, game_path );
+			if ( !folder_size && method == MoveMethod::Copy ) folder_size = copied.load();
+			signaler->setMax( Progress::Complete );
+		}
 
-			if ( folder_size % 1024 == 0 )
-			{
-				signaler->setMessage( QString( "Calculating folder size: %1" )
-				                          .arg( locale.formattedDataSize( static_cast< qint64 >( folder_size ) ) ) );
-			}
+		TracyCZoneN( tracy_FileScanner, "Folder size", true );
+		//Only walked if the size isn't known yet and a rename didn't count it
+		if ( !folder_size )
+		{
+			signaler->setProgress( Progress::CollectingFileInformation );
+			signaler->setMessage( "Calculating folder size" );
+			folder_size = directorySize( game_path ).bytes;
 		}
 		TracyCZoneEnd( tracy_FileScanner );
 
@@ -91,35 +122,22 @@ namespace internal
 		signaler->setProgress( Progress::VersionData );
 		signaler->setMessage( "Importing version data" );
 
-		record->addVersion( version, root, relative_executable, folder_size, owning );
+		//Owned games were moved into the games folder. size_cache only counts versions that aren't in place
+		const bool in_place { !owning };
+		record->addVersion( version, game_path, relative_executable, *folder_size, in_place );
+		if ( !executable_info ) executable_info = readExecutableInfo( game_path / relative_executable );
+		if ( auto added = record->getVersion( version ); added ) added->setExecutableInfo( executable_info );
 
-		if ( owning )
+		//Banners and previews found in the game's folder moved along with it
+		const auto moved = [ & ]( const QString& path ) -> std::filesystem::path
 		{
-			ZoneScopedN( "Copying files" );
-			signaler->setMax( static_cast< int >( file_count ) );
+			const std::filesystem::path original { path.toStdString() };
+			if ( !owning ) return original;
 
-			std::size_t i { 0 };
-			for ( const auto& file : scanner )
-			{
-				++i;
-				const QString r_path_name { QString::fromStdString( file.relative.string() ) };
-				signaler->setProgress( static_cast< int >( i ) );
-				signaler
-					->setMessage( QString( "Copying file %1 %2/%3" ).arg( r_path_name ).arg( i ).arg( file_count ) );
-
-				const auto source { root / file.relative };
-				const std::filesystem::path dest_root { config::paths::games::getPath() / creator.toStdString()
-					                                    / title.toStdString() / version.toStdString() };
-				const auto dest { dest_root / file.relative };
-				std::filesystem::create_directories( dest.parent_path() );
-
-				if ( !std::filesystem::copy_file( source, dest, std::filesystem::copy_options::overwrite_existing ) )
-				{
-					spdlog::error( "importGame: Failed to copy file {} to {}", source.string(), dest.string() );
-					throw std::runtime_error( "Failed to copy file" );
-				}
-			}
-		}
+			const auto relative { original.lexically_relative( root ) };
+			if ( relative.empty() || *relative.begin() == ".." ) return original;
+			return game_path / relative;
+		};
 
 		signaler->setMax( Progress::Complete );
 		signaler->setProgress( Progress::Banners );
@@ -129,20 +147,17 @@ namespace internal
 			const auto path { banners[ static_cast< std::size_t >( i ) ] };
 			if ( !path.isEmpty() )
 			{
-				record->banners().setBanner( path.toStdString(), static_cast< BannerType >( i ) );
+				record->banners().setBanner( moved( path ), static_cast< BannerType >( i ) );
 			}
 		}
 
 		signaler->setMessage( "Importing previews" );
 		signaler->setProgress( Progress::Previews );
-		for ( const auto& path : previews )
-		{
-			signaler->setMessage( QString( "Importing preview %1" ).arg( path ) );
-			record->previews().addPreview( path.toStdString() );
-		}
+		for ( const auto& path : previews ) record->previews().addPreview( moved( path ) );
 
 		signaler->setProgress( Progress::Complete );
 		signaler->setMessage( "Complete" );
+		signaler->setFinished();
 
 		promise.addResult( record->getID() );
 		promise.finish();
@@ -170,7 +185,9 @@ QFuture< RecordID > importGame(
 	std::array< QString, BannerType::SENTINEL > banners,
 	std::vector< QString > previews,
 	bool owning,
-	QThreadPool& pool )
+	QThreadPool& pool,
+	std::optional< std::size_t > folder_size,
+	std::optional< ExecutableInfo > executable_info )
 {
 	ZoneScoped;
 	return QtConcurrent::
@@ -184,18 +201,21 @@ QFuture< RecordID > importGame(
 	         std::move( version ),
 	         std::move( banners ),
 	         std::move( previews ),
-	         owning );
+	         owning,
+	         folder_size,
+	         std::move( executable_info ) );
 }
 
 QFuture< RecordID > importGame( GameImportData data, const std::filesystem::path root, const bool owning )
 {
 	ZoneScoped;
-	auto [ path, title, creator, engine, version, size, executables, executable, banners, previews ] =
+	const auto executable_info { data.executableInfo() };
+	auto [ path, title, creator, engine, version, size, executables, executable, banners, previews, info ] =
 		std::move( data );
 
 	return importGame(
 		root / path,
-		root / path / executable,
+		std::move( executable ),
 		std::move( title ),
 		std::move( creator ),
 		"",
@@ -203,19 +223,22 @@ QFuture< RecordID > importGame( GameImportData data, const std::filesystem::path
 		std::move( banners ),
 		std::move( previews ),
 		owning,
-		*QThreadPool::globalInstance() );
+		*QThreadPool::globalInstance(),
+		size > 0 ? std::optional( size ) : std::nullopt,
+		executable_info );
 }
 
 QFuture< RecordID >
 	importGame( GameImportData data, const std::filesystem::path root, const bool owning, QThreadPool& pool )
 {
 	ZoneScoped;
-	auto [ path, title, creator, engine, version, size, executables, executable, banners, previews ] =
+	const auto executable_info { data.executableInfo() };
+	auto [ path, title, creator, engine, version, size, executables, executable, banners, previews, info ] =
 		std::move( data );
 
 	return importGame(
 		root / path,
-		root / path / executable,
+		std::move( executable ),
 		std::move( title ),
 		std::move( creator ),
 		"",
@@ -223,5 +246,7 @@ QFuture< RecordID >
 		std::move( banners ),
 		std::move( previews ),
 		owning,
-		pool );
+		pool,
+		size > 0 ? std::optional( size ) : std::nullopt,
+		executable_info );
 }
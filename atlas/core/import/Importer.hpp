@@ -6,6 +6,7 @@
 #define ATLASGAMEMANAGER_IMPORTER_HPP
 
 #include <filesystem>
+#include <optional>
 
 #include <QFuture>
 #include <QObject>
@@ -13,6 +14,7 @@
 
 #include "core/Types.hpp"
 #include "core/database/record/Record.hpp"
+#include "core/utils/ExecutableInfo.hpp"
 
 /**
  *
@@ -25,6 +27,8 @@
  * @param banners
  * @param previews
  * @param owning If true. The game will be moved to Atlas' game data directory.
+ * @param folder_size Size of `root` if it's already known. Saves walking it again
+ * @param executable_info Headers of the executable if they were already read. Read from the file otherwise
  * @return
  */
 QFuture< RecordID > importGame(
@@ -37,7 +41,9 @@ QFuture< RecordID > importGame(
 	std::array< QString, BannerType::SENTINEL > banners,
 	std::vector< QString > previews,
 	bool owning = false,
-	QThreadPool& pool = *QThreadPool::globalInstance() );
+	QThreadPool& pool = *QThreadPool::globalInstance(),
+	std::optional< std::size_t > folder_size = std::nullopt,
+	std::optional< ExecutableInfo > executable_info = std::nullopt );
 
 struct GameImportData;
 
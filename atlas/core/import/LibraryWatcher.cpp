@@ -0,0 +1,536 @@
+//
+// Created by kj16609 on 7/30/23.
+//
+
+#include "LibraryWatcher.hpp"
+
+#include <moc_LibraryWatcher.cpp>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <array>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <set>
+#include <unordered_map>
+
+#include <tracy/Tracy.hpp>
+
+#include "core/database/Transaction.hpp"
+#include "core/logging.hpp"
+#include "core/utils/regex/regex.hpp"
+
+//! Where the changes come from. Only ever used by the watcher's thread, except for `wake`
+class WatchBackend
+{
+  public:
+
+	virtual ~WatchBackend() = default;
+
+	//! Watches `dir`, `depth` folders below root `root`. Returns false if nothing more can be watched
+	virtual bool add( const std::size_t root, const std::filesystem::path& dir, const std::size_t depth ) = 0;
+
+	//! Appends what changed to `changes`. Blocks until something did, `timeout` passes or `wake` is called
+	virtual void wait(
+		const std::optional< std::chrono::milliseconds > timeout, std::vector< LibraryWatcher::Change >& changes ) = 0;
+
+	//! Can be called from any thread
+	virtual void wake() = 0;
+};
+
+namespace
+{
+	//! Checks the mtime of every watched folder each interval. Sees folders being added and removed, not files changing
+	class PollingBackend final : public WatchBackend
+	{
+		struct Watched
+		{
+			std::size_t root;
+			std::size_t depth;
+			std::filesystem::file_time_type modified;
+		};
+
+		const std::chrono::milliseconds m_interval;
+		std::chrono::steady_clock::time_point m_next_poll;
+		std::map< std::filesystem::path, Watched > m_watched {};
+
+		std::mutex m_mtx {};
+		std::condition_variable m_wake {};
+		bool m_woken { false };
+
+	  public:
+
+		PollingBackend( const std::chrono::milliseconds interval ) :
+		  m_interval( interval ),
+		  m_next_poll( std::chrono::steady_clock::now() + interval )
+		{}
+
+		bool add( const std::size_t root, const std::filesystem::path& dir, const std::size_t depth ) override
+		{
+			std::error_code ec {};
+			const auto modified { std::filesystem::last_write_time( dir, ec ) };
+			if ( !ec ) m_watched.insert_or_assign( dir, Watched { root, depth, modified } );
+			return true;
+		}
+
+		void wait(
+			const std::optional< std::chrono::milliseconds > timeout,
+			std::vector< LibraryWatcher::Change >& changes ) override
+		{
+			const auto deadline { timeout ? std::min( m_next_poll, std::chrono::steady_clock::now() + *timeout ) :
+				                            m_next_poll };
+			{
+				std::unique_lock lock { m_mtx };
+				m_wake.wait_until( lock, deadline, [ this ]() { return m_woken; } );
+				m_woken = false;
+			}
+
+			if ( std::chrono::steady_clock::now() < m_next_poll ) return;
+			m_next_poll = std::chrono::steady_clock::now() + m_interval;
+
+			ZoneScopedN( "Poll library" );
+			for ( auto itter = m_watched.begin(); itter != m_watched.end(); )
+			{
+				auto& [ path, watched ] { *itter };
+				std::error_code ec {};
+				const auto modified { std::filesystem::last_write_time( path, ec ) };
+
+				if ( ec )
+				{
+					//Removed. It's parent has changed too, so there is nothing to report
+					itter = m_watched.erase( itter );
+					continue;
+				}
+
+				if ( modified != watched.modified )
+				{
+					watched.modified = modified;
+					changes.emplace_back( LibraryWatcher::Change { watched.root, path, watched.depth, true } );
+				}
+				++itter;
+			}
+		}
+
+		void wake() override
+		{
+			{
+				std::lock_guard guard { m_mtx };
+				m_woken = true;
+			}
+			m_wake.notify_one();
+		}
+	};
+
+#ifdef __linux__
+	//! Folders are added, removed or renamed, or a file in a game folder was written
+	constexpr std::uint32_t watch_mask { IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE
+		                                 | IN_ONLYDIR | IN_EXCL_UNLINK };
+
+	class InotifyBackend final : public WatchBackend
+	{
+		struct Watched
+		{
+			std::size_t root;
+			std::filesystem::path path;
+			std::size_t depth;
+		};
+
+		int m_fd { -1 };
+		//! Written to by `wake`
+		int m_wake_fd { -1 };
+		std::unordered_map< int, Watched > m_watched {};
+		//! Path of every root, for when the kernel drops events
+		std::map< std::size_t, std::filesystem::path > m_roots {};
+
+		//! Stops watching `path` and everything under it
+		void remove( const std::filesystem::path& path )
+		{
+			const auto& prefix { path.native() };
+			std::erase_if(
+				m_watched,
+				[ this, &prefix ]( const auto& pair )
+				{
+					const auto& watched { pair.second.path.native() };
+					if ( !watched.starts_with( prefix )
+					     || ( watched.size() != prefix.size() && watched[ prefix.size() ] != '/' ) )
+						return false;
+
+					::inotify_rm_watch( m_fd, pair.first );
+					return true;
+				} );
+		}
+
+	  public:
+
+		InotifyBackend() :
+		  m_fd( ::inotify_init1( IN_NONBLOCK | IN_CLOEXEC ) ),
+		  m_wake_fd( ::eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) )
+		{
+			if ( m_fd < 0 || m_wake_fd < 0 )
+			{
+				const auto error { std::system_category().message( errno ) };
+				if ( m_fd >= 0 ) ::close( m_fd );
+				if ( m_wake_fd >= 0 ) ::close( m_wake_fd );
+				throw std::runtime_error( fmt::format( "InotifyBackend: Failed to start inotify: {}", error ) );
+			}
+		}
+
+		~InotifyBackend() override
+		{
+			::close( m_fd );
+			::close( m_wake_fd );
+		}
+
+		InotifyBackend( const InotifyBackend& ) = delete;
+		InotifyBackend& operator=( const InotifyBackend& ) = delete;
+
+		bool add( const std::size_t root, const std::filesystem::path& dir, const std::size_t depth ) override
+		{
+			if ( depth == 0 ) m_roots.insert_or_assign( root, dir );
+
+			const int wd { ::inotify_add_watch( m_fd, dir.c_str(), watch_mask ) };
+			if ( wd < 0 )
+			{
+				//Out of watches. Anything else is a folder that's gone again, which it's parent will report
+				if ( errno == ENOSPC || errno == ENOMEM )
+				{
+					spdlog::warn( "InotifyBackend: Can't watch {}: {}", dir, std::system_category().message( errno ) );
+					return false;
+				}
+				return true;
+			}
+
+			m_watched.insert_or_assign( wd, Watched { root, dir, depth } );
+			return true;
+		}
+
+		void wait(
+			const std::optional< std::chrono::milliseconds > timeout,
+			std::vector< LibraryWatcher::Change >& changes ) override
+		{
+			std::array< pollfd, 2 > fds { { { m_fd, POLLIN, 0 }, { m_wake_fd, POLLIN, 0 } } };
+			if ( ::poll( fds.data(), fds.size(), timeout ? static_cast< int >( timeout->count() ) : -1 ) <= 0 ) return;
+
+			if ( fds[ 1 ].revents & POLLIN )
+			{
+				std::uint64_t count { 0 };
+				[[maybe_unused]] const auto read { ::read( m_wake_fd, &count, sizeof( count ) ) };
+			}
+
+			if ( !( fds[ 0 ].revents & POLLIN ) ) return;
+
+			ZoneScopedN( "Read inotify events" );
+			alignas( inotify_event ) std::array< char, 16 * 1024 > buffer;
+			while ( true )
+			{
+				const auto read { ::read( m_fd, buffer.data(), buffer.size() ) };
+				if ( read <= 0 ) break;
+
+				for ( std::size_t offset = 0; offset < static_cast< std::size_t >( read ); )
+				{
+					//Only the header is copied out, the name is read in place. Casting the buffer trips -Wcast-align
+					inotify_event event;
+					std::memcpy( &event, buffer.data() + offset, sizeof( inotify_event ) );
+					const char* const name { buffer.data() + offset + sizeof( inotify_event ) };
+					offset += sizeof( inotify_event ) + event.len;
+
+					if ( event.mask & IN_Q_OVERFLOW )
+					{
+						//Events were dropped. Every root has to be looked at again
+						spdlog::warn( "InotifyBackend: Event queue overflowed" );
+						for ( const auto& [ root, path ] : m_roots )
+							changes.emplace_back( LibraryWatcher::Change { root, path, 0, true } );
+						continue;
+					}
+
+					if ( event.mask & IN_IGNORED )
+					{
+						m_watched.erase( event.wd );
+						continue;
+					}
+
+					const auto found { m_watched.find( event.wd ) };
+					if ( found == m_watched.end() || event.len == 0 ) continue;
+
+					const auto& watched { found->second };
+					const auto path { watched.path / name };
+					const bool is_dir { ( event.mask & IN_ISDIR ) != 0 };
+
+					changes.emplace_back( LibraryWatcher::Change {
+						watched.root, path, watched.depth + 1, is_dir && ( event.mask & ( IN_CREATE | IN_MOVED_TO ) ) } );
+
+					//Watches follow a moved folder, with the path it used to have
+					if ( is_dir && ( event.mask & ( IN_DELETE | IN_MOVED_FROM ) ) ) remove( path );
+				}
+			}
+		}
+
+		void wake() override
+		{
+			const std::uint64_t one { 1 };
+			[[maybe_unused]] const auto written { ::write( m_wake_fd, &one, sizeof( one ) ) };
+		}
+	};
+#endif
+
+	//! Number of folders in the importer path template. `{creator}/{title}/{version}` is 3
+	std::size_t templateDepth( const std::filesystem::path& format )
+	{
+		std::size_t depth { 0 };
+		for ( const auto& part : format )
+			if ( !part.empty() && part != "." ) ++depth;
+		return depth;
+	}
+
+	bool isImported( const std::filesystem::path& game )
+	{
+		bool imported { false };
+		RapidTransaction() << "SELECT EXISTS (SELECT 1 FROM game_metadata WHERE game_path = ?)" << game.string()
+			>> imported;
+		return imported;
+	}
+} // namespace
+
+LibraryWatcher::LibraryWatcher(
+	const std::chrono::milliseconds debounce,
+	const std::chrono::milliseconds poll_interval,
+	const bool force_polling ) :
+  m_debounce( debounce ),
+  m_poll_interval( poll_interval ),
+  m_force_polling( force_polling )
+{
+	connect(
+		&m_scanner,
+		&GameScanner::foundGame,
+		this,
+		[ this ]( const GameImportData data )
+		{
+			{
+				std::lock_guard guard { m_pending_mtx };
+				//A folder scanned again replaces what was found in it before
+				const auto& root { m_roots[ m_scanning ].path };
+				m_pending.erase( root / data.path );
+				m_pending.emplace( root / data.path, std::make_pair( root, data ) );
+			}
+			++m_found;
+		},
+		Qt::DirectConnection );
+}
+
+LibraryWatcher::~LibraryWatcher()
+{
+	clear();
+}
+
+void LibraryWatcher::watch( const std::filesystem::path root, const QString format )
+{
+	ZoneScoped;
+	//Same as the batch importer
+	const auto search { std::filesystem::path( format.toStdString() ).make_preferred() };
+	const QString regex { regex::regexify( regex::escapeStr( QString::fromStdString( ( root / search ).string() ) ) ) };
+
+	//Starting over would walk the whole library and look at every game folder again
+	if ( isWatching() && m_roots.size() == 1 && m_roots.front().path == root && m_roots.front().regex == regex ) return;
+
+	clear();
+
+	m_roots.emplace_back( Root { root, regex, templateDepth( search ) } );
+	m_thread = std::jthread( [ this ]( const std::stop_token stop ) { run( stop ); } );
+}
+
+void LibraryWatcher::clear()
+{
+	if ( m_thread.joinable() )
+	{
+		m_thread.request_stop();
+		m_thread.join();
+	}
+
+	m_roots.clear();
+	m_seen.clear();
+}
+
+std::vector< GameImportData > LibraryWatcher::pending( const std::filesystem::path& root )
+{
+	std::lock_guard guard { m_pending_mtx };
+	std::vector< GameImportData > games {};
+	for ( const auto& [ folder, game ] : m_pending )
+		if ( game.first == root ) games.emplace_back( game.second );
+	return games;
+}
+
+void LibraryWatcher::removePending( const std::vector< std::filesystem::path >& folders )
+{
+	std::lock_guard guard { m_pending_mtx };
+	for ( const auto& folder : folders ) m_pending.erase( folder );
+}
+
+void LibraryWatcher::addTree( const std::size_t root, const std::filesystem::path& dir, const std::size_t depth )
+{
+	if ( !m_backend->add( root, dir, depth ) )
+	{
+		//Out of inotify watches. Polling has no limit
+		m_backend = std::make_unique< PollingBackend >( m_poll_interval );
+		for ( std::size_t i = 0; i < m_roots.size(); ++i ) addTree( i, m_roots[ i ].path, 0 );
+		return;
+	}
+
+	if ( depth >= m_roots[ root ].depth ) return;
+
+	std::error_code ec {};
+	for ( auto itter = std::filesystem::directory_iterator( dir, ec ); itter != std::filesystem::directory_iterator();
+	      itter.increment( ec ) )
+		if ( itter->is_directory( ec ) && !itter->is_symlink( ec ) ) addTree( root, itter->path(), depth + 1 );
+}
+
+void LibraryWatcher::run( const std::stop_token stop )
+{
+	ZoneScoped;
+#ifdef __linux__
+	if ( !m_force_polling )
+	{
+		try
+		{
+			m_backend = std::make_unique< InotifyBackend >();
+		}
+		catch ( std::exception& e )
+		{
+			spdlog::warn( "LibraryWatcher: Falling back to polling: {}", e.what() );
+		}
+	}
+#endif
+	if ( !m_backend ) m_backend = std::make_unique< PollingBackend >( m_poll_interval );
+
+	//Anything added while nobody was watching
+	std::vector< Change > changes {};
+	for ( std::size_t i = 0; i < m_roots.size(); ++i )
+	{
+		addTree( i, m_roots[ i ].path, 0 );
+		changes.emplace_back( Change { i, m_roots[ i ].path, 0, false } );
+	}
+	auto quiet_at { std::chrono::steady_clock::now() + m_debounce };
+
+	//The backend is swapped out if it runs out of watches
+	std::mutex backend_mtx {};
+	const std::stop_callback wake_up { stop,
+		                               [ this, &backend_mtx ]()
+		                               {
+										   std::lock_guard guard { backend_mtx };
+										   if ( m_backend ) m_backend->wake();
+									   } };
+
+	while ( !stop.stop_requested() )
+	{
+		std::optional< std::chrono::milliseconds > timeout {};
+		if ( !changes.empty() )
+			timeout = std::max(
+				std::chrono::duration_cast< std::chrono::milliseconds >( quiet_at - std::chrono::steady_clock::now() ),
+				std::chrono::milliseconds( 0 ) );
+
+		const auto seen { changes.size() };
+		m_backend->wait( timeout, changes );
+
+		if ( changes.size() > seen )
+		{
+			std::lock_guard guard { backend_mtx };
+			for ( std::size_t i = seen; i < changes.size(); ++i )
+				if ( changes[ i ].new_directory ) addTree( changes[ i ].root, changes[ i ].path, changes[ i ].depth );
+
+			quiet_at = std::chrono::steady_clock::now() + m_debounce;
+			continue;
+		}
+
+		if ( !changes.empty() && std::chrono::steady_clock::now() >= quiet_at )
+		{
+			flush( changes, stop );
+			changes.clear();
+		}
+	}
+
+	std::lock_guard guard { backend_mtx };
+	m_backend.reset();
+}
+
+void LibraryWatcher::flush( const std::vector< Change >& changes, const std::stop_token stop )
+{
+	ZoneScoped;
+	//Game folders for each root
+	std::vector< std::set< std::filesystem::path > > games( m_roots.size() );
+
+	for ( const auto& change : changes )
+	{
+		const auto& root { m_roots[ change.root ] };
+
+		if ( change.depth >= root.depth )
+		{
+			//Inside a game. The game is the first `depth` folders of the path
+			auto game { root.path };
+			std::size_t depth { 0 };
+			for ( const auto& part : change.path.lexically_relative( root.path ) )
+			{
+				if ( depth++ == root.depth ) break;
+				game /= part;
+			}
+			games[ change.root ].insert( std::move( game ) );
+			continue;
+		}
+
+		//Above the games. Everything under it at the depth of a game could be new
+		std::error_code ec {};
+		for ( auto itter = std::filesystem::recursive_directory_iterator( change.path, ec );
+		      itter != std::filesystem::recursive_directory_iterator();
+		      itter.increment( ec ) )
+		{
+			if ( !itter->is_directory( ec ) )
+			{
+				itter.disable_recursion_pending();
+				continue;
+			}
+
+			if ( change.depth + static_cast< std::size_t >( itter.depth() ) + 1 >= root.depth )
+			{
+				itter.disable_recursion_pending();
+				//Nothing changed in the games that were already looked at
+				if ( !m_seen.contains( itter->path() ) ) games[ change.root ].insert( itter->path() );
+			}
+		}
+	}
+
+	for ( std::size_t i = 0; i < m_roots.size(); ++i )
+	{
+		const auto& root { m_roots[ i ] };
+
+		std::vector< std::filesystem::path > found {};
+		for ( const auto& game : games[ i ] )
+		{
+			m_seen.insert( game );
+			std::error_code ec {};
+			if ( !std::filesystem::is_directory( game, ec ) ) continue;
+			if ( !regex::valid( root.regex, QString::fromStdString( game.string() ) ) ) continue;
+			if ( isImported( game ) ) continue;
+			found.emplace_back( game );
+		}
+
+		if ( found.empty() ) continue;
+
+		if ( stop.stop_requested() ) return;
+
+		spdlog::info( "LibraryWatcher: Scanning {} changed folders in {}", found.size(), root.path );
+		m_scanning = i;
+		m_found = 0;
+		m_scanner.start( root.path, root.regex, std::move( found ) );
+		{
+			const std::stop_callback abort_scan { stop, [ this ]() { m_scanner.abort(); } };
+			m_scanner.wait();
+		}
+
+		if ( m_found > 0 && !stop.stop_requested() ) emit foundGames( root.path, m_found );
+	}
+}
@@ -0,0 +1,113 @@
+//
+// Created by kj16609 on 7/30/23.
+//
+
+#ifndef ATLASGAMEMANAGER_LIBRARYWATCHER_HPP
+#define ATLASGAMEMANAGER_LIBRARYWATCHER_HPP
+
+#include <QObject>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "GameImportData.hpp"
+#include "GameScanner.hpp"
+
+class WatchBackend;
+
+//! Watches library folders for new games and scans only the folders that changed.
+/**
+ * Uses inotify on Linux and polls folder mtimes everywhere else, or once inotify runs out of watches.
+ * Only folders down to the depth of the importer's path template are watched, so a game's own files cost nothing.
+ * Changes are collected until things have been quiet for the debounce time. Each changed path is then mapped to the
+ * game folder it's in, and the folders not imported yet are scanned and kept as pending imports.
+ * The watching thread sleeps until the kernel has an event for it.
+ */
+class LibraryWatcher final : public QObject
+{
+	Q_OBJECT
+
+  public:
+
+	struct Root
+	{
+		std::filesystem::path path;
+		QString regex;
+		//! Folders between the root and a game, including the game itself
+		std::size_t depth;
+	};
+
+	//! Something changed at `path`, `depth` folders below `roots[ root ]`
+	struct Change
+	{
+		std::size_t root;
+		std::filesystem::path path;
+		std::size_t depth;
+		//! A folder was made or moved in. Anything under it needs watching too
+		bool new_directory;
+	};
+
+  private:
+
+	const std::chrono::milliseconds m_debounce;
+	const std::chrono::milliseconds m_poll_interval;
+	const bool m_force_polling;
+
+	std::vector< Root > m_roots {};
+	std::unique_ptr< WatchBackend > m_backend {};
+	GameScanner m_scanner {};
+	//! Root the scanner is working on
+	std::size_t m_scanning { 0 };
+	//! Games the scanner found in it
+	std::atomic< std::size_t > m_found { 0 };
+
+	//! Game folders looked at since watching started. They are only looked at again if something in them changes
+	std::set< std::filesystem::path > m_seen {};
+
+	std::mutex m_pending_mtx {};
+	//! Root and game, by the game's folder
+	std::map< std::filesystem::path, std::pair< std::filesystem::path, GameImportData > > m_pending {};
+
+	std::jthread m_thread {};
+
+	void run( const std::stop_token stop );
+	//! Watches `dir` and the folders under it, down to the depth of a game
+	void addTree( const std::size_t root, const std::filesystem::path& dir, const std::size_t depth );
+	void flush( const std::vector< Change >& changes, const std::stop_token stop );
+
+  public:
+
+	LibraryWatcher(
+		const std::chrono::milliseconds debounce = std::chrono::seconds( 2 ),
+		const std::chrono::milliseconds poll_interval = std::chrono::seconds( 30 ),
+		const bool force_polling = false );
+	~LibraryWatcher() override;
+
+	Q_DISABLE_COPY_MOVE( LibraryWatcher )
+
+	//! Starts watching `root` for games matching the importer path template `format`.
+	//! Games already under it are looked for once first. Does nothing if it's already watching the same
+	void watch( const std::filesystem::path root, const QString format );
+	//! Stops watching everything. Pending games are kept
+	void clear();
+
+	bool isWatching() const { return m_thread.joinable(); }
+
+	//! Games found under `root` that haven't been removed yet. They stay pending
+	std::vector< GameImportData > pending( const std::filesystem::path& root );
+	//! Drops the pending games in `folders`, once they were imported. Anything else stays pending
+	void removePending( const std::vector< std::filesystem::path >& folders );
+
+  signals:
+	//! `count` games were added to the pending imports of `root`
+	void foundGames( const std::filesystem::path root, const std::size_t count );
+};
+
+#endif //ATLASGAMEMANAGER_LIBRARYWATCHER_HPP
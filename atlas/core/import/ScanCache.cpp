@@ -0,0 +1,196 @@
+//
+// Created by kj16609 on 7/30/23.
+//
+
+#include "ScanCache.hpp"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#endif
+
+#include <tracy/Tracy.hpp>
+
+#include "core/database/Transaction.hpp"
+#include "core/logging.hpp"
+
+namespace scan_cache
+{
+	namespace
+	{
+		//! Bumped whenever the scan finds something different for the same folder. Older entries are ignored
+		constexpr int cache_version { 3 };
+
+		enum class FileKind
+		{
+			Executable = 0,
+			Banner = 1,
+			Preview = 2,
+		};
+
+		//! Identity of `path` with symlinks followed. `children_mtime` is left at 0
+		std::optional< Stamp > identity( const std::filesystem::path& path )
+		{
+#ifdef __linux__
+			struct statx info;
+			if ( ::statx( AT_FDCWD, path.c_str(), AT_STATX_DONT_SYNC, STATX_INO | STATX_MTIME | STATX_SIZE, &info )
+			     != 0 )
+				return std::nullopt;
+
+			return Stamp { makedev( info.stx_dev_major, info.stx_dev_minor ),
+				           info.stx_ino,
+				           info.stx_mtime.tv_sec * 1'000'000'000 + info.stx_mtime.tv_nsec,
+				           info.stx_size,
+				           0 };
+#else
+			//No inodes to go by. The path stands in for one, so a renamed folder is scanned again
+			std::error_code ec {};
+			const auto modified { std::filesystem::last_write_time( path, ec ) };
+			if ( ec ) return std::nullopt;
+
+			return Stamp { 0,
+				           std::hash< std::string > {}( std::filesystem::absolute( path ).string() ),
+				           std::chrono::duration_cast< std::chrono::nanoseconds >( modified.time_since_epoch() ).count(),
+				           0,
+				           0 };
+#endif
+		}
+	} // namespace
+
+	std::optional< Stamp > stamp( const std::filesystem::path& folder, const bool children )
+	{
+		ZoneScoped;
+		auto folder_stamp { identity( folder ) };
+		if ( !folder_stamp || !children ) return folder_stamp;
+
+		std::error_code ec {};
+		for ( auto itter = std::filesystem::directory_iterator( folder, ec );
+		      itter != std::filesystem::directory_iterator();
+		      itter.increment( ec ) )
+		{
+			//Broken links don't have an mtime to go by. They are still seen if they are added or removed
+			if ( const auto child = identity( itter->path() ); child )
+				folder_stamp->children_mtime = std::max( folder_stamp->children_mtime, child->mtime );
+		}
+
+		if ( ec ) return std::nullopt;
+		return folder_stamp;
+	}
+
+	std::optional< Entry > find( const Stamp& stamp )
+	{
+		ZoneScoped;
+		try
+		{
+			RapidTransaction transaction {};
+
+			bool found { false };
+			Entry entry {};
+			transaction << "SELECT engine, folder_size FROM scan_cache WHERE device = ? AND inode = ? AND mtime = ? AND size = ? AND children_mtime = ? AND version = ?"
+						<< stamp.device << stamp.inode << stamp.mtime << stamp.size << stamp.children_mtime
+						<< cache_version
+				>> [ & ]( std::string engine, std::uint64_t folder_size ) noexcept
+			{
+				found = true;
+				entry.engine = std::move( engine );
+				entry.folder_size = folder_size;
+			};
+
+			if ( !found ) return std::nullopt;
+
+			transaction << "SELECT type, position, path FROM scan_cache_files WHERE device = ? AND inode = ? ORDER BY type, position"
+						<< stamp.device << stamp.inode
+				>> [ & ]( int type, int position, std::string path )
+			{
+				switch ( static_cast< FileKind >( type ) )
+				{
+					case FileKind::Executable:
+						entry.executables.emplace_back( std::move( path ) );
+						break;
+					case FileKind::Banner:
+						entry.banners.emplace_back( position, std::move( path ) );
+						break;
+					case FileKind::Preview:
+						entry.previews.emplace_back( std::move( path ) );
+						break;
+					default:
+						//Written by a newer version. Skipped rather then guessed at
+						spdlog::debug( "scan_cache: Unknown file kind {} for {}", type, path );
+						break;
+				}
+			};
+
+			transaction << "SELECT format, machine, bits, subsystem, file_version, icon_offset FROM scan_cache_executables WHERE device = ? AND inode = ? ORDER BY position"
+						<< stamp.device << stamp.inode
+				>> [ & ](
+					   int format,
+					   std::uint16_t machine,
+					   std::uint8_t bits,
+					   std::uint16_t subsystem,
+					   std::string file_version,
+					   std::uint32_t icon_offset )
+			{
+				entry.executable_info.emplace_back( ExecutableInfo { static_cast< ExecutableFormat >( format ),
+					                                                 machine,
+					                                                 bits,
+					                                                 subsystem,
+					                                                 std::move( file_version ),
+					                                                 icon_offset } );
+			};
+
+			//Anything else is from a different scan of the folder
+			if ( entry.executable_info.size() != entry.executables.size() ) entry.executable_info.clear();
+
+			return entry;
+		}
+		catch ( std::exception& e )
+		{
+			spdlog::warn( "scan_cache: Failed to read entry: {}", e.what() );
+			return std::nullopt;
+		}
+	}
+
+	void store( const Stamp& stamp, const Entry& entry )
+	{
+		ZoneScoped;
+		Transaction transaction {};
+		try
+		{
+			transaction << "DELETE FROM scan_cache_files WHERE device = ? AND inode = ?" << stamp.device << stamp.inode;
+			transaction << "DELETE FROM scan_cache_executables WHERE device = ? AND inode = ?" << stamp.device
+						<< stamp.inode;
+			transaction << "INSERT OR REPLACE INTO scan_cache (device, inode, mtime, size, children_mtime, version, engine, folder_size) VALUES (?, ?, ?, ?, ?, ?, ?, ?)"
+						<< stamp.device << stamp.inode << stamp.mtime << stamp.size << stamp.children_mtime
+						<< cache_version << entry.engine << entry.folder_size;
+
+			const auto addFile = [ & ]( const FileKind kind, const int position, const std::filesystem::path& path )
+			{
+				transaction << "INSERT INTO scan_cache_files (device, inode, type, position, path) VALUES (?, ?, ?, ?, ?)"
+							<< stamp.device << stamp.inode << static_cast< int >( kind ) << position << path.string();
+			};
+
+			for ( std::size_t i = 0; i < entry.executables.size(); ++i )
+				addFile( FileKind::Executable, static_cast< int >( i ), entry.executables[ i ] );
+			for ( const auto& [ type, path ] : entry.banners ) addFile( FileKind::Banner, type, path );
+			for ( std::size_t i = 0; i < entry.previews.size(); ++i )
+				addFile( FileKind::Preview, static_cast< int >( i ), entry.previews[ i ] );
+
+			for ( std::size_t i = 0; i < entry.executable_info.size(); ++i )
+			{
+				const auto& info { entry.executable_info[ i ] };
+				transaction << "INSERT INTO scan_cache_executables (device, inode, position, format, machine, bits, subsystem, file_version, icon_offset) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?)"
+							<< stamp.device << stamp.inode << static_cast< int >( i ) << static_cast< int >( info.format )
+							<< info.machine << info.bits << info.subsystem << info.version << info.icon_offset;
+			}
+
+			transaction.commit();
+		}
+		catch ( std::exception& e )
+		{
+			//Only costs a walk of the folder next time
+			spdlog::warn( "scan_cache: Failed to store entry: {}", e.what() );
+			transaction.abort();
+		}
+	}
+} // namespace scan_cache
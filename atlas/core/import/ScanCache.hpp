@@ -0,0 +1,65 @@
+//
+// Created by kj16609 on 7/30/23.
+//
+
+#ifndef ATLASGAMEMANAGER_SCANCACHE_HPP
+#define ATLASGAMEMANAGER_SCANCACHE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "core/utils/ExecutableInfo.hpp"
+
+//! What a scan found in a game folder, kept between scans so unchanged folders aren't walked again.
+/**
+ * Entries are keyed by the folder's device and inode, so a folder that was only renamed or moved on the same drive still hits.
+ * They are used only while the folder's mtime and size are the same as when it was scanned.
+ * A directory's mtime only changes when entries are added, removed or renamed in it, so the newest mtime of it's
+ * direct children can be checked too to catch files replaced in place.
+ */
+namespace scan_cache
+{
+	//! Identity of a folder and when it was last changed
+	struct Stamp
+	{
+		std::uint64_t device { 0 };
+		std::uint64_t inode { 0 };
+		//! Nanoseconds
+		std::int64_t mtime { 0 };
+		std::uint64_t size { 0 };
+		//! Newest mtime of the folder's direct children. 0 if they weren't checked
+		std::int64_t children_mtime { 0 };
+
+		bool operator==( const Stamp& ) const = default;
+	};
+
+	//! Paths are relative to the game folder
+	struct Entry
+	{
+		std::string engine {};
+		std::uint64_t folder_size { 0 };
+		//! Best first
+		std::vector< std::filesystem::path > executables {};
+		//! Banner type (See BannerType) and path
+		std::vector< std::pair< int, std::filesystem::path > > banners {};
+		std::vector< std::filesystem::path > previews {};
+		//! Headers of `executables`, in the same order. Empty if they weren't read
+		std::vector< ExecutableInfo > executable_info {};
+
+		bool operator==( const Entry& ) const = default;
+	};
+
+	//! Empty if `folder` can't be read
+	std::optional< Stamp > stamp( const std::filesystem::path& folder, const bool children );
+
+	//! Empty if nothing was stored for the folder or it has changed since
+	std::optional< Entry > find( const Stamp& stamp );
+
+	//! Replaces anything stored for the same folder
+	void store( const Stamp& stamp, const Entry& entry );
+} // namespace scan_cache
+
+#endif //ATLASGAMEMANAGER_SCANCACHE_HPP
@@ -4,22 +4,21 @@
 
 #include "AtlasRemote.hpp"
 
-#include <fstream>
 #include <moc_AtlasRemote.cpp>
 
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QJsonObject>
+#include <QtConcurrent>
 
 #include <tracy/TracyC.h>
 
+#include "core/config.hpp"
+#include "core/database/Catalog.hpp"
 #include "core/database/Transaction.hpp"
 #include "core/logging.hpp"
 #include "core/remote/parsers/parser.hpp"
 #include "core/utils/regex/regex.hpp"
-#include "extract.hpp"
 #include "ui/notifications/NotificationMessage.hpp"
 #include "ui/notifications/NotificationPopup.hpp"
+#include "ui/notifications/ProgressMessage.hpp"
 
 #define REMOTE "https://atlas-gamesdb.com/"
 
@@ -33,6 +32,12 @@ namespace atlas
 		inline static AtlasRemote* remote { nullptr };
 	}
 
+	static std::int64_t secondsSinceEpoch()
+	{
+		return std::chrono::duration_cast< std::chrono::seconds >( std::chrono::system_clock::now().time_since_epoch() )
+		    .count();
+	}
+
 	void initRemoteHandler()
 	{
 		if ( internal::remote == nullptr ) internal::remote = new AtlasRemote();
@@ -52,15 +57,33 @@ namespace atlas
 		return *internal::remote;
 	}
 
-	AtlasRemote::AtlasRemote()
+	AtlasRemote::AtlasRemote() :
+	  m_downloader(
+		  m_manager,
+		  QUrl( REMOTE ),
+		  "./data/updates/",
+		  static_cast< std::size_t >( config::remote::max_downloads::get() ),
+		  this )
 	{
+		m_apply_pool.setMaxThreadCount( 1 );
+
 		m_manager.moveToThread( &m_thread );
 		moveToThread( &m_thread );
 		m_thread.start();
 
 		connect( this, &AtlasRemote::checkRemoteSignal, this, &AtlasRemote::check );
 		connect( this, &AtlasRemote::triggerDownloadFor, this, &AtlasRemote::downloadUpdate );
-		connect( this, &AtlasRemote::triggerParseFor, this, &AtlasRemote::processUpdateFile );
+		connect( this, &AtlasRemote::triggerParseFor, this, &AtlasRemote::processPendingUpdates );
+		connect( &m_downloader, &UpdateDownloader::downloaded, this, &AtlasRemote::processPendingUpdates );
+		connect(
+			&m_downloader,
+			&UpdateDownloader::failed,
+			this,
+			[]( const std::uint64_t update_time, const QString reason )
+			{
+				createNotification< NotificationMessage >(
+					QString( "Failed to download update %1\nWhat: %2" ).arg( update_time ).arg( reason ), true );
+			} );
 	}
 
 	void AtlasRemote::triggerCheckRemote()
@@ -70,6 +93,8 @@ namespace atlas
 
 	void AtlasRemote::check()
 	{
+		ZoneScoped;
+		//Always asked. An unchanged manifest costs an empty 304, and new updates are never hidden behind a timer
 		downloadManifest();
 	}
 
@@ -79,6 +104,8 @@ namespace atlas
 		const QString path { REMOTE "api/updates" };
 		spdlog::info( "Checking remote for updates at {}", path.toStdString() );
 		QNetworkRequest request { QUrl { path } };
+		//An unchanged manifest comes back as an empty 304
+		m_manifest_cache.addConditionalHeaders( request );
 		auto* reply { m_manager.get( request ) };
 
 		connect(
@@ -89,54 +116,28 @@ namespace atlas
 			Qt::SingleShotConnection );
 	}
 
-	void AtlasRemote::handleDownloader( QNetworkReply* reply )
+	void AtlasRemote::downloadUpdate( const std::uint64_t update_time )
 	{
-		spdlog::debug( "Handling downloader from {}", reply->url().path().toStdString() );
 		ZoneScoped;
+		std::vector< std::byte > md5 {};
+		RapidTransaction() << "SELECT md5 FROM updates WHERE update_time = ?" << update_time >>
+			[ &md5 ]( std::vector< std::byte > md5_i ) { md5 = std::move( md5_i ); };
 
-		if ( reply->error() != QNetworkReply::NoError )
-		{
-			spdlog::warn(
-				"Failed to handle downloader from {}. Server returned code {}",
-				reply->url().path().toStdString(),
-				reply->errorString().toStdString() );
-			return;
-		}
-
-		const QString file_name { reply->url().fileName() };
-		const std::filesystem::path dest_folder { "./data/updates/" };
-		std::filesystem::create_directories( dest_folder );
-		if ( std::ofstream ofs( dest_folder / file_name.toStdString(), std::ios::binary ); ofs )
-		{
-			while ( !reply->atEnd() )
-			{
-				std::array< std::byte, 4096 > buffer;
-				const auto read_bytes { reply->read( reinterpret_cast< char* >( buffer.data() ), buffer.size() ) };
-				ofs.write( reinterpret_cast< char* >( buffer.data() ), read_bytes );
-
-				if ( read_bytes == 0 ) break;
-			}
-		}
-
-		//Signal to process update file
-		emit processUpdateFile( static_cast< uint64_t >( file_name.left( file_name.lastIndexOf( '.' ) )
-		                                                     .toLongLong() ) );
-		reply->deleteLater();
+		m_downloader.enqueue(
+			update_time,
+			QByteArray( reinterpret_cast< const char* >( md5.data() ), static_cast< qsizetype >( md5.size() ) ) );
 	}
 
-	void AtlasRemote::downloadUpdate( const std::uint64_t update_time )
+	void AtlasRemote::queueMissingUpdates()
 	{
 		ZoneScoped;
-		const auto update_path { fmt::format( REMOTE "packages/{}.update", update_time ) };
-		QNetworkRequest request { QUrl { QString::fromStdString( update_path ) } };
-		auto* reply { m_manager.get( request ) };
+		for ( const auto& [ update_time, processed_time ] : getUpdatesList() )
+		{
+			if ( processed_time != 0 ) continue;
+			if ( std::filesystem::exists( UpdateDownloader::packagePath( "./data/updates/", update_time ) ) ) continue;
 
-		connect(
-			reply,
-			&QNetworkReply::finished,
-			this,
-			[ =, this ]() { handleDownloader( reply ); },
-			Qt::SingleShotConnection );
+			downloadUpdate( update_time );
+		}
 	}
 
 	void AtlasRemote::handleJsonResponse( QNetworkReply* reply )
@@ -144,7 +145,7 @@ namespace atlas
 	{
 		ZoneScoped;
 		spdlog::debug( "Handling json response from {}", reply->url().path().toStdString() );
-		//Read the json
+		reply->deleteLater();
 
 		if ( reply->error() != QNetworkReply::NoError )
 		{
@@ -155,66 +156,55 @@ namespace atlas
 			return;
 		}
 
-		const QByteArray response_data { reply->readAll() };
-		const QJsonDocument doc { QJsonDocument::fromJson( response_data ) };
-		if ( !doc.isArray() )
+		QByteArray manifest {};
+		const bool not_modified { reply->attribute( QNetworkRequest::HttpStatusCodeAttribute ).toInt() == 304 };
+		if ( not_modified )
 		{
-			spdlog::warn(
-				"Failed to handle json response from {}. The json response was not an array!",
-				reply->url().path().toStdString() );
-			spdlog::warn( "{}", response_data.toStdString() );
+			spdlog::info( "Remote manifest is unchanged" );
+			auto cached { m_manifest_cache.load() };
+			if ( !cached.has_value() ) throw std::runtime_error( "Manifest was not modified but we have no cached copy" );
+			manifest = std::move( *cached );
 		}
-		const QJsonArray& array = doc.array();
+		else
+			manifest = reply->readAll();
 
-		//Check if the update is already in the database
-		for ( const auto& data : array )
-		{
-			const auto& obj { data.toObject() };
-			if ( !obj.contains( "date" ) || !obj.contains( "name" ) || !obj.contains( "md5" ) )
-			{
-				spdlog::warn(
-					"Failed to handle json response from {}. Json object possibly malformed!",
-					reply->url().path().toStdString() );
-				delete reply;
-				return;
-			}
+		reconcileManifest( manifest );
+
+		//Only cached once it parsed so a bad response never replaces a good one
+		if ( !not_modified ) m_manifest_cache.store( manifest, *reply );
+		config::remote::last_check::set( secondsSinceEpoch() );
+	}
+	catch ( const std::exception& e )
+	{
+		spdlog::error(
+			"Failed to handle json response from {}. Exception: {}", reply->url().path().toStdString(), e.what() );
+	}
 
-			const std::uint64_t update_time { static_cast< std::uint64_t >( obj[ "date" ].toInteger() ) };
+	void AtlasRemote::reconcileManifest( const QByteArray& json )
+	{
+		ZoneScoped;
+		const auto entries { parseManifest( json ) };
 
-			if ( update_time == 1686886200 || update_time == 1687918793 ) continue;
+		std::vector< std::uint64_t > known {};
+		for ( const auto& [ update_time, processed_time ] : getUpdatesList() ) known.emplace_back( update_time );
 
-			const auto& md5_str { obj[ "md5" ].toString() };
-			const auto& md5 { QByteArray::fromHex( md5_str.toUtf8() ) };
-			std::vector< std::byte > md5_data_c {};
-			md5_data_c.resize( static_cast< unsigned long >( md5.size() ) );
-			memcpy( md5_data_c.data(), md5.data(), static_cast< size_t >( md5.size() ) );
+		RapidTransaction t {};
+		for ( const auto& [ update_time, md5 ] : newEntries( entries, known ) )
+		{
+			if ( update_time == 1686886200 || update_time == 1687918793 ) continue;
 
-			const auto updates { getUpdatesList() };
-			const auto it = std::find_if(
-				updates.begin(),
-				updates.end(),
-				[ update_time ]( const auto& pair )
-				{ return pair.first == static_cast< std::uint64_t >( update_time ); } );
+			spdlog::debug( "Adding update {} to database", update_time );
+			std::vector< std::byte > md5_data_c( static_cast< std::size_t >( md5.size() ) );
+			std::memcpy( md5_data_c.data(), md5.data(), static_cast< std::size_t >( md5.size() ) );
 
-			RapidTransaction t {};
-			if ( it == updates.end() )
-			{
-				spdlog::debug( "Adding update {} to database", update_time );
-				//Add it to the database
-				t << "INSERT INTO updates (update_time, processed_time, md5) VALUES (?, ?, ?)" << update_time << 0
-				  << md5_data_c;
-				triggerDownloadFor( update_time );
-			}
+			t << "INSERT INTO updates (update_time, processed_time, md5) VALUES (?, ?, ?)" << update_time << 0
+			  << md5_data_c;
 		}
-		reply->deleteLater();
 
+		//Also picks up anything that failed to download last time
+		queueMissingUpdates();
 		processPendingUpdates();
 	}
-	catch ( const std::exception& e )
-	{
-		spdlog::error(
-			"Failed to handle json response from {}. Exception: {}", reply->url().path().toStdString(), e.what() );
-	}
 
 	std::vector< std::pair< std::uint64_t, std::uint64_t > > AtlasRemote::getUpdatesList() const
 	{
@@ -239,49 +229,13 @@ namespace atlas
 		return 0;
 	}
 
-	void parse( const std::vector< char > file_data )
+	void parse( const std::filesystem::path& path )
 	{
 		ZoneScoped;
-		const QByteArray array { file_data.data(), static_cast< qsizetype >( file_data.size() ) };
-
-		const QJsonObject& json { QJsonDocument::fromJson( array ).object() };
-
-		//Figure out what version we are trying to parse.
-
-		if ( !json.contains( "min_ver" ) )
-		{
-			spdlog::error( "Failed to parse update file. Missing min_ver" );
-			qDebug() << json.keys();
-			throw std::runtime_error( "Failed to parse update file. Missing min_ver" );
-		}
-
-		const std::uint64_t version { static_cast< std::uint64_t >( json[ "min_ver" ].toInteger() ) };
-
-		using namespace remote::parsers;
-
-		if ( version > MAX_REMOTE_VERSION )
-		{
-			spdlog::error( "Failed to parse update file! Version was {}. Our max is {}", version, MAX_REMOTE_VERSION );
-			return;
-		}
-
-		switch ( version )
-		{
-			default:
-				{
-					spdlog::error(
-						"Failed to parse update file! Version was {}. Our max is {}!", version, MAX_REMOTE_VERSION );
-					return;
-				}
-			case 0:
-				{
-					v0::processJson( json );
-					break;
-				}
-		}
+		remote::parsers::processFile( path );
 	}
 
-	void AtlasRemote::processUpdateFile( const std::uint64_t update_time )
+	bool AtlasRemote::processUpdateFile( const std::uint64_t update_time )
 	{
 		ZoneScoped;
 		spdlog::info( "Processing update for time {}", update_time );
@@ -293,7 +247,7 @@ namespace atlas
 		if ( !std::filesystem::exists( local_update_archive_path ) )
 		{
 			spdlog::warn( "Update {} doesn't exist. Can't process.", update_time );
-			return;
+			return false;
 		}
 
 		//Check if the file is already processed
@@ -310,7 +264,7 @@ namespace atlas
 		if ( processed_time != 0 )
 		{
 			spdlog::warn( "Update {} is already processed.", update_time );
-			return;
+			return true;
 		}
 
 		//Ensure that we are updating IN ORDER.
@@ -325,49 +279,163 @@ namespace atlas
 		if ( update_time != next_update )
 		{
 			//We are about to update out of order. Abort.
-			return;
+			return false;
 		}
 
 		spdlog::info( "Processing file {:ce}", local_update_archive_path );
 		try
 		{
-			atlas::parse( atlas::extract( local_update_archive_path ) );
+			atlas::parse( local_update_archive_path );
 			markComplete( update_time );
+			return true;
+		}
+		catch ( const std::exception& e )
+		{
+			spdlog::error( "Failed to process update file {}: What: {}", update_time, e.what() );
+			createNotification< NotificationMessage >(
+				QString( "Failed to process update file %1\nWhat: %2" ).arg( update_time ).arg( e.what() ), true );
+			return false;
+		}
+	}
 
-			//Check if the next update file is ready to go
-			const auto next_time { getNextUpdateTime() };
-			if ( next_time != 0 && std::filesystem::exists( fmt::format( "./data/updates/{}.update", next_time ) ) )
-			{
-				//Trigger it
-				processPendingUpdates();
-			}
+	bool AtlasRemote::processUpdateStream( const std::uint64_t update_time, const std::shared_ptr< PackageStream > stream )
+	{
+		ZoneScoped;
+		spdlog::info( "Processing update {} as it downloads", update_time );
+		try
+		{
+			auto signaler {
+				createNotification< ProgressMessage >( QString( "Downloading update %1" ).arg( update_time ), true )
+			};
+
+			remote::parsers::v0::processPackage(
+				[ &stream ]( const remote::parsers::PackageFeed& feed ) { stream->drain( feed ); }, 0, *signaler );
+			markComplete( update_time );
+			return true;
 		}
 		catch ( const std::exception& e )
 		{
 			spdlog::error( "Failed to process update file {}: What: {}", update_time, e.what() );
 			createNotification< NotificationMessage >(
 				QString( "Failed to process update file %1\nWhat: %2" ).arg( update_time ).arg( e.what() ), true );
+			return false;
+		}
+	}
+
+	bool AtlasRemote::processUpdateFiles( const std::vector< std::uint64_t > update_times )
+	{
+		ZoneScoped;
+		spdlog::info(
+			"Compacting {} pending updates from {} to {}", update_times.size(), update_times.front(), update_times.back() );
+
+		//Same guarantee as processUpdateFile. The first update must be the next one
+		if ( update_times.front() != getNextUpdateTime() ) return false;
+
+		try
+		{
+			std::vector< std::filesystem::path > paths {};
+			for ( const auto update_time : update_times )
+				paths.emplace_back( UpdateDownloader::packagePath( "./data/updates/", update_time ) );
+
+			{
+				auto signaler { createNotification< ProgressMessage >(
+					QString( "Processing updates %1 to %2" ).arg( update_times.front() ).arg( update_times.back() ),
+					true ) };
+
+				if ( catalog::path().empty() )
+					remote::parsers::v0::processFiles( paths, *signaler );
+				else
+				{
+					//Built next to the live catalog and swapped in when done, so nothing waits on the writes.
+					//If nothing was ever processed then this is a full refresh and none of the live catalog is kept
+					const auto list { getUpdatesList() };
+					const bool full_refresh { std::none_of(
+						list.begin(), list.end(), []( const auto& update ) { return update.second != 0; } ) };
+
+					catalog::Shadow shadow { full_refresh ? catalog::Shadow::Empty : catalog::Shadow::Live };
+					remote::parsers::v0::processFiles( paths, *signaler, shadow );
+					shadow.swap();
+				}
+			}
+
+			RapidTransaction t {};
+			for ( const auto update_time : update_times )
+				t << "UPDATE updates SET processed_time = ? WHERE update_time = ?"
+				  << std::chrono::duration_cast< std::chrono::milliseconds >(
+						 std::chrono::steady_clock::now().time_since_epoch() )
+						 .count()
+				  << update_time;
+
+			createNotification< NotificationMessage >(
+				QString( "Processed %1 updates up to time %2" ).arg( update_times.size() ).arg( update_times.back() ),
+				true );
+			return true;
+		}
+		catch ( const std::exception& e )
+		{
+			spdlog::error(
+				"Failed to process update files {} to {}: What: {}",
+				update_times.front(),
+				update_times.back(),
+				e.what() );
+			createNotification< NotificationMessage >(
+				QString( "Failed to process update files %1 to %2\nWhat: %3" )
+					.arg( update_times.front() )
+					.arg( update_times.back() )
+					.arg( e.what() ),
+				true );
+			return false;
 		}
 	}
 
 	void AtlasRemote::processPendingUpdates()
 	try
 	{
-		auto update_time { getNextUpdateTime() };
+		ZoneScoped;
+		if ( m_applying ) return;
 
-		while ( update_time != 0 )
+		const auto update_time { getNextUpdateTime() };
+		if ( update_time == 0 ) return;
+
+		//Every pending update that is already on disk, in order, up to the first one that isn't
+		std::vector< std::uint64_t > ready {};
+		for ( const auto& [ pending_time, processed_time ] : getUpdatesList() )
 		{
-			const auto path { fmt::format( "./data/updates/{}.update", update_time ) };
-			if ( !std::filesystem::exists( path ) ) return;
+			if ( processed_time != 0 ) continue;
+			if ( !std::filesystem::exists( UpdateDownloader::packagePath( "./data/updates/", pending_time ) ) ) break;
+			ready.emplace_back( pending_time );
+		}
 
-			processUpdateFile( update_time );
+		//Applied off of the remote thread so the remaining downloads keep going while this one is written
+		QFuture< bool > apply_future {};
+		if ( ready.size() > 1 )
+			apply_future = QtConcurrent::run(
+				&m_apply_pool, [ this, ready = std::move( ready ) ]() { return processUpdateFiles( ready ); } );
+		else if ( ready.size() == 1 )
+			apply_future =
+				QtConcurrent::run( &m_apply_pool, [ this, update_time ]() { return processUpdateFile( update_time ); } );
+		else if ( auto stream = std::make_shared< PackageStream >();
+		          config::remote::stream_updates::get() && m_downloader.attach( update_time, stream ) )
+			apply_future = QtConcurrent::run(
+				&m_apply_pool,
+				[ this, update_time, stream ]() { return processUpdateStream( update_time, stream ); } );
+		else
+			//Not downloaded yet. `downloaded` will bring us back here
+			return;
 
-			markComplete( update_time );
-			update_time = getNextUpdateTime();
-		}
+		m_applying = true;
+		apply_future.then(
+			this,
+			[ this ]( const bool success )
+			{
+				m_applying = false;
+				//Stop on failure. Continuing would apply the next update out of order
+				if ( success ) processPendingUpdates();
+			} );
 	}
 	catch ( std::exception& e )
 	{
+		m_applying = false;
 		spdlog::warn( "Failed to process updates: {}", e.what() );
 	}
 
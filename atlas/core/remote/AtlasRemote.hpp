@@ -7,11 +7,15 @@
 
 #include <QNetworkReply>
 #include <QThread>
+#include <QThreadPool>
 
 class QNetworkReply;
 
 #include <filesystem>
 
+#include "Manifest.hpp"
+#include "UpdateDownloader.hpp"
+
 namespace atlas
 {
 	//! Manages all remote connections to the Atlas remote server
@@ -21,9 +25,20 @@ namespace atlas
 
 		QThread m_thread {};
 		QNetworkAccessManager m_manager {};
+		UpdateDownloader m_downloader;
+		ManifestCache m_manifest_cache { "./data/updates/" };
+
+		//! Updates are applied here one at a time so the remote thread can keep downloading
+		QThreadPool m_apply_pool {};
+		//! True while an update is being applied in `m_apply_pool`
+		bool m_applying { false };
 
 		void downloadManifest();
-		void downloadUpdates();
+		//! Adds any update in the manifest we don't know about yet and starts downloading/applying pending ones
+		void reconcileManifest( const QByteArray& json );
+		//! Queues a download for every unprocessed update that isn't on disk yet
+		void queueMissingUpdates();
+		//! Starts applying the next update if it has been downloaded and nothing else is being applied
 		void processPendingUpdates();
 		void markComplete( const std::uint64_t update_time, const bool yes = true );
 
@@ -45,13 +60,15 @@ namespace atlas
 		void triggerParseFor( const std::uint64_t timestamp );
 
 	  private slots:
-		//! Updates the local DB with the updates available
-		void processUpdateFile( const std::uint64_t update_time );
+		//! Updates the local DB with the updates available. Returns false if the update failed to apply
+		bool processUpdateFile( const std::uint64_t update_time );
+		//! Applies several downloaded updates at once. The rows are folded together and written in one transaction
+		bool processUpdateFiles( const std::vector< std::uint64_t > update_times );
+		//! Applies an update while it's still being downloaded. Returns false if the update failed to apply
+		bool processUpdateStream( const std::uint64_t update_time, const std::shared_ptr< PackageStream > stream );
 		void downloadUpdate( const std::uint64_t update_time );
 		//! Handles manifest requests from the server.
 		void handleJsonResponse( QNetworkReply* reply );
-		//! Handles download responses from the remote
-		void handleDownloader( QNetworkReply* reply );
 		//! Causes the remote to go through a full check. Asking for new updates and processing them.
 		void check();
 	};
@@ -0,0 +1,111 @@
+//
+// Created by kj16609 on 7/22/23.
+//
+
+#include "Manifest.hpp"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <tracy/Tracy.hpp>
+
+#include "core/logging.hpp"
+
+namespace atlas
+{
+	std::vector< ManifestEntry > parseManifest( const QByteArray& json )
+	{
+		ZoneScoped;
+		const QJsonDocument doc { QJsonDocument::fromJson( json ) };
+		if ( !doc.isArray() ) throw std::runtime_error( "Manifest was not a json array" );
+
+		const QJsonArray array { doc.array() };
+		std::vector< ManifestEntry > entries {};
+		entries.reserve( static_cast< std::size_t >( array.size() ) );
+
+		for ( const auto& data : array )
+		{
+			const auto obj { data.toObject() };
+			if ( !obj.contains( "date" ) || !obj.contains( "name" ) || !obj.contains( "md5" ) )
+				throw std::runtime_error( "Manifest entry is missing date, name or md5" );
+
+			entries.emplace_back(
+				static_cast< std::uint64_t >( obj[ "date" ].toInteger() ),
+				QByteArray::fromHex( obj[ "md5" ].toString().toUtf8() ) );
+		}
+
+		std::sort(
+			entries.begin(),
+			entries.end(),
+			[]( const ManifestEntry& left, const ManifestEntry& right )
+			{ return left.update_time < right.update_time; } );
+
+		return entries;
+	}
+
+	std::vector< ManifestEntry >
+		newEntries( const std::vector< ManifestEntry >& manifest, const std::vector< std::uint64_t >& known )
+	{
+		ZoneScoped;
+		std::vector< ManifestEntry > missing {};
+
+		auto known_itter { known.begin() };
+		for ( const auto& entry : manifest )
+		{
+			while ( known_itter != known.end() && *known_itter < entry.update_time ) ++known_itter;
+			if ( known_itter == known.end() || *known_itter != entry.update_time ) missing.emplace_back( entry );
+		}
+
+		return missing;
+	}
+
+	ManifestCache::ManifestCache( const std::filesystem::path& directory ) :
+	  m_json_path( directory / "manifest.json" ),
+	  m_header_path( directory / "manifest.headers" )
+	{}
+
+	std::optional< QByteArray > ManifestCache::load() const
+	{
+		QFile file { QString::fromStdString( m_json_path.string() ) };
+		if ( !file.open( QFile::ReadOnly ) ) return std::nullopt;
+
+		return file.readAll();
+	}
+
+	void ManifestCache::store( const QByteArray& json, const QNetworkReply& reply ) const
+	{
+		ZoneScoped;
+		std::filesystem::create_directories( m_json_path.parent_path() );
+
+		QFile json_file { QString::fromStdString( m_json_path.string() ) };
+		QFile header_file { QString::fromStdString( m_header_path.string() ) };
+		if ( !json_file.open( QFile::WriteOnly | QFile::Truncate )
+		     || !header_file.open( QFile::WriteOnly | QFile::Truncate ) )
+		{
+			spdlog::warn( "Failed to write manifest cache to {}", m_json_path );
+			return;
+		}
+
+		json_file.write( json );
+
+		//One validator per line. Either can be empty
+		header_file.write( reply.rawHeader( "ETag" ) + "\n" + reply.rawHeader( "Last-Modified" ) + "\n" );
+	}
+
+	void ManifestCache::addConditionalHeaders( QNetworkRequest& request ) const
+	{
+		if ( !std::filesystem::exists( m_json_path ) ) return;
+
+		QFile header_file { QString::fromStdString( m_header_path.string() ) };
+		if ( !header_file.open( QFile::ReadOnly ) ) return;
+
+		const auto etag { header_file.readLine().trimmed() };
+		const auto last_modified { header_file.readLine().trimmed() };
+
+		if ( !etag.isEmpty() ) request.setRawHeader( "If-None-Match", etag );
+		if ( !last_modified.isEmpty() ) request.setRawHeader( "If-Modified-Since", last_modified );
+	}
+
+} // namespace atlas
@@ -0,0 +1,54 @@
+//
+// Created by kj16609 on 7/22/23.
+//
+
+#ifndef ATLASGAMEMANAGER_MANIFEST_HPP
+#define ATLASGAMEMANAGER_MANIFEST_HPP
+
+#include <QByteArray>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+namespace atlas
+{
+	struct ManifestEntry
+	{
+		std::uint64_t update_time;
+		//! Raw md5 digest (not hex)
+		QByteArray md5;
+	};
+
+	//! Parses the `api/updates` response. Entries are returned sorted by update time. Throws if the json is malformed
+	std::vector< ManifestEntry > parseManifest( const QByteArray& json );
+
+	//! Returns the entries of `manifest` that are not in `known`. Both must be sorted by update time
+	std::vector< ManifestEntry >
+		newEntries( const std::vector< ManifestEntry >& manifest, const std::vector< std::uint64_t >& known );
+
+	//! Keeps the last manifest on disk along with the validators the server sent with it
+	class ManifestCache
+	{
+		std::filesystem::path m_json_path;
+		std::filesystem::path m_header_path;
+
+	  public:
+
+		ManifestCache( const std::filesystem::path& directory );
+
+		//! Returns the cached manifest if there is one
+		std::optional< QByteArray > load() const;
+
+		//! Stores `json` along with the ETag and Last-Modified headers of `reply`
+		void store( const QByteArray& json, const QNetworkReply& reply ) const;
+
+		//! Adds If-None-Match/If-Modified-Since to `request` if we have a cached manifest
+		void addConditionalHeaders( QNetworkRequest& request ) const;
+	};
+} // namespace atlas
+
+#endif //ATLASGAMEMANAGER_MANIFEST_HPP
@@ -0,0 +1,82 @@
+//
+// Created by kj16609 on 7/21/23.
+//
+
+#include "PackageStream.hpp"
+
+#include <tracy/Tracy.hpp>
+
+#include "core/logging.hpp"
+
+namespace atlas
+{
+	void PackageStream::push( QByteArray chunk )
+	{
+		{
+			std::lock_guard guard { m_mtx };
+			if ( m_abandoned ) return;
+			m_buffered += chunk.size();
+			m_chunks.emplace_back( std::move( chunk ) );
+		}
+		m_cv.notify_one();
+	}
+
+	bool PackageStream::full()
+	{
+		std::lock_guard guard { m_mtx };
+		return !m_abandoned && m_buffered >= max_buffered;
+	}
+
+	void PackageStream::close()
+	{
+		{
+			std::lock_guard guard { m_mtx };
+			m_closed = true;
+		}
+		m_cv.notify_one();
+	}
+
+	void PackageStream::fail( const QString reason )
+	{
+		{
+			std::lock_guard guard { m_mtx };
+			m_closed = true;
+			m_error = reason.isEmpty() ? QString( "Download failed" ) : reason;
+		}
+		m_cv.notify_one();
+	}
+
+	std::optional< QByteArray > PackageStream::pop()
+	{
+		ZoneScoped;
+		std::unique_lock lock { m_mtx };
+		m_cv.wait( lock, [ this ]() { return !m_chunks.empty() || m_closed; } );
+
+		//A failure discards anything still queued
+		if ( !m_error.isEmpty() ) throw std::runtime_error( fmt::format( "Package download failed: {}", m_error ) );
+
+		if ( m_chunks.empty() ) return std::nullopt;
+
+		QByteArray chunk { std::move( m_chunks.front() ) };
+		m_chunks.pop_front();
+		m_buffered -= chunk.size();
+		return chunk;
+	}
+
+	void PackageStream::drain( const remote::parsers::PackageFeed& feed )
+	try
+	{
+		ZoneScoped;
+		while ( const auto chunk = pop() )
+			feed( std::span< const char >( chunk->constData(), static_cast< std::size_t >( chunk->size() ) ) );
+	}
+	catch ( ... )
+	{
+		std::lock_guard guard { m_mtx };
+		m_abandoned = true;
+		m_chunks.clear();
+		m_buffered = 0;
+		throw;
+	}
+
+} // namespace atlas
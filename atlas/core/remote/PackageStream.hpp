@@ -0,0 +1,65 @@
+//
+// Created by kj16609 on 7/21/23.
+//
+
+#ifndef ATLASGAMEMANAGER_PACKAGESTREAM_HPP
+#define ATLASGAMEMANAGER_PACKAGESTREAM_HPP
+
+#include <QByteArray>
+#include <QString>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+
+#include "core/remote/parsers/parser.hpp"
+
+namespace atlas
+{
+	//! Hands a package from the thread downloading it to the thread applying it.
+	/**
+	 * The downloader pushes chunks as they arrive and closes the stream once the package was verified.
+	 * The reader only sees the end of the stream after that. If the download fails the reader throws instead, so a partially applied package is never committed.
+	 */
+	class PackageStream
+	{
+		std::mutex m_mtx {};
+		std::condition_variable m_cv {};
+		std::deque< QByteArray > m_chunks {};
+		//! Total size of `m_chunks`
+		qsizetype m_buffered { 0 };
+		bool m_closed { false };
+		QString m_error {};
+		//! Set once the reader gave up. Anything pushed afterwards is dropped
+		bool m_abandoned { false };
+
+	  public:
+
+		//! Bytes queued before `full()`. The downloader stops reading from the network until the reader catches up
+		static constexpr qsizetype max_buffered { 16 * 1024 * 1024 };
+
+		//! Always takes `chunk`. Check `full()` first to keep the queue bounded
+		void push( QByteArray chunk );
+
+		//! True while the reader is `max_buffered` or more behind. Never true once abandoned
+		bool full();
+
+		//! Marks the end of a successful download
+		void close();
+
+		//! Marks the download as failed. The reader will throw with `reason`
+		void fail( const QString reason );
+
+		//! Blocks until data is available. Returns nothing once the stream was closed
+		std::optional< QByteArray > pop();
+
+		//! Feeds every chunk into `feed` until the stream is closed. For use as a `remote::parsers::PackageSource`
+		/**
+		 * If `feed` throws the stream is abandoned and the exception is rethrown
+		 */
+		void drain( const remote::parsers::PackageFeed& feed );
+	};
+} // namespace atlas
+
+#endif //ATLASGAMEMANAGER_PACKAGESTREAM_HPP
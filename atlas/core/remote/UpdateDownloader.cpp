@@ -0,0 +1,206 @@
+//
+// Created by kj16609 on 7/20/23.
+//
+
+#include "UpdateDownloader.hpp"
+
+#include <moc_UpdateDownloader.cpp>
+
+#include <QTimer>
+
+#include <tracy/Tracy.hpp>
+
+#include "core/logging.hpp"
+
+namespace atlas
+{
+	//! How long a read waits for a full stream before checking again
+	constexpr int stream_retry_ms { 10 };
+
+	UpdateDownloader::UpdateDownloader(
+		QNetworkAccessManager& manager,
+		QUrl base,
+		std::filesystem::path dest,
+		const std::size_t max_active,
+		QObject* parent ) :
+	  QObject( parent ),
+	  m_manager( manager ),
+	  m_base( std::move( base ) ),
+	  m_dest( std::move( dest ) ),
+	  m_max_active( std::max( max_active, std::size_t( 1 ) ) )
+	{}
+
+	std::filesystem::path
+		UpdateDownloader::packagePath( const std::filesystem::path& dest, const std::uint64_t update_time )
+	{
+		return dest / fmt::format( "{}.update", update_time );
+	}
+
+	void UpdateDownloader::enqueue( const std::uint64_t update_time, QByteArray md5 )
+	{
+		ZoneScoped;
+		if ( m_active.contains( update_time ) ) return;
+		if ( std::find_if(
+				 m_queue.begin(),
+				 m_queue.end(),
+				 [ update_time ]( const Job& job ) { return job.update_time == update_time; } )
+		     != m_queue.end() )
+			return;
+
+		m_queue.emplace_back( update_time, std::move( md5 ) );
+		startNext();
+	}
+
+	bool UpdateDownloader::attach( const std::uint64_t update_time, std::shared_ptr< PackageStream > stream )
+	{
+		ZoneScoped;
+		if ( const auto itter = m_active.find( update_time ); itter != m_active.end() )
+		{
+			if ( itter->second->received != 0 || itter->second->stream ) return false;
+			itter->second->stream = std::move( stream );
+			return true;
+		}
+
+		const auto itter { std::find_if(
+			m_queue.begin(),
+			m_queue.end(),
+			[ update_time ]( const Job& job ) { return job.update_time == update_time; } ) };
+		if ( itter == m_queue.end() || itter->stream ) return false;
+
+		itter->stream = std::move( stream );
+		return true;
+	}
+
+	void UpdateDownloader::startNext()
+	{
+		ZoneScoped;
+		std::filesystem::create_directories( m_dest );
+
+		while ( m_active.size() < m_max_active && !m_queue.empty() )
+		{
+			auto [ update_time, md5, stream ] = std::move( m_queue.front() );
+			m_queue.pop_front();
+
+			auto download { std::make_unique< ActiveDownload >() };
+			download->md5 = std::move( md5 );
+			download->stream = std::move( stream );
+
+			const auto part_path { packagePath( m_dest, update_time ).string() + ".part" };
+			download->file.setFileName( QString::fromStdString( part_path ) );
+			if ( !download->file.open( QFile::WriteOnly | QFile::Truncate ) )
+			{
+				const QString reason {
+					QString( "Failed to open %1: %2" ).arg( download->file.fileName(), download->file.errorString() )
+				};
+				if ( download->stream ) download->stream->fail( reason );
+				fail( update_time, reason );
+				continue;
+			}
+
+			const QUrl url { m_base.resolved( QUrl( QString( "packages/%1.update" ).arg( update_time ) ) ) };
+			spdlog::debug( "Downloading update {} from {}", update_time, url.toString() );
+			download->reply = m_manager.get( QNetworkRequest( url ) );
+			//Stops reading from the socket while the stream is full, instead of buffering the whole package
+			if ( download->stream ) download->reply->setReadBufferSize( PackageStream::max_buffered );
+
+			connect(
+				download->reply,
+				&QNetworkReply::readyRead,
+				this,
+				[ this, update_time ]() { handleReadyRead( update_time ); } );
+			connect(
+				download->reply,
+				&QNetworkReply::finished,
+				this,
+				[ this, update_time ]() { handleFinished( update_time ); },
+				Qt::SingleShotConnection );
+
+			m_active.emplace( update_time, std::move( download ) );
+			m_peak_active = std::max( m_peak_active, m_active.size() );
+		}
+
+		//Also reached when every remaining job failed to start, with no reply left to finish
+		if ( idle() ) emit finished();
+	}
+
+	void UpdateDownloader::handleReadyRead( const std::uint64_t update_time, const bool force )
+	{
+		ZoneScoped;
+		const auto itter { m_active.find( update_time ) };
+		if ( itter == m_active.end() ) return;
+		auto& download { *itter->second };
+
+		//Left in the reply until the reader catches up. readyRead isn't emitted again for data already buffered
+		if ( !force && download.stream && download.stream->full() )
+		{
+			if ( !download.retry_pending )
+			{
+				download.retry_pending = true;
+				QTimer::singleShot(
+					stream_retry_ms,
+					this,
+					[ this, update_time ]()
+					{
+						const auto retry { m_active.find( update_time ) };
+						if ( retry == m_active.end() ) return;
+						retry->second->retry_pending = false;
+						handleReadyRead( update_time );
+					} );
+			}
+			return;
+		}
+
+		const QByteArray data { download.reply->readAll() };
+		download.received += data.size();
+		download.hash.addData( data );
+		download.file.write( data );
+		if ( download.stream ) download.stream->push( data );
+	}
+
+	void UpdateDownloader::handleFinished( const std::uint64_t update_time )
+	{
+		ZoneScoped;
+		//Anything left over after the last readyRead. At most the reply's read buffer
+		handleReadyRead( update_time, true );
+
+		auto node { m_active.extract( update_time ) };
+		if ( node.empty() ) return;
+		auto& download { *node.mapped() };
+		download.reply->deleteLater();
+		download.file.close();
+
+		const std::filesystem::path part_path { download.file.fileName().toStdString() };
+
+		QString error {};
+		if ( download.reply->error() != QNetworkReply::NoError )
+			error = download.reply->errorString();
+		else if ( !download.md5.isEmpty() && download.hash.result() != download.md5 )
+			error = QString( "md5 mismatch. Expected %1 got %2" )
+			            .arg(
+							QString::fromLatin1( download.md5.toHex() ),
+							QString::fromLatin1( download.hash.result().toHex() ) );
+
+		if ( !error.isEmpty() )
+		{
+			std::filesystem::remove( part_path );
+			if ( download.stream ) download.stream->fail( error );
+			fail( update_time, error );
+		}
+		else
+		{
+			std::filesystem::rename( part_path, packagePath( m_dest, update_time ) );
+			//Closed after the rename so the reader never finishes before the package is on disk
+			if ( download.stream ) download.stream->close();
+			emit downloaded( update_time );
+		}
+
+		startNext();
+	}
+
+	void UpdateDownloader::fail( const std::uint64_t update_time, const QString reason )
+	{
+		spdlog::warn( "Failed to download update {}: {}", update_time, reason );
+		emit failed( update_time, reason );
+	}
+
+} // namespace atlas
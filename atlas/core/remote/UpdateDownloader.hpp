@@ -0,0 +1,107 @@
+//
+// Created by kj16609 on 7/20/23.
+//
+
+#ifndef ATLASGAMEMANAGER_UPDATEDOWNLOADER_HPP
+#define ATLASGAMEMANAGER_UPDATEDOWNLOADER_HPP
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QObject>
+#include <QUrl>
+
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <unordered_map>
+
+#include "PackageStream.hpp"
+
+namespace atlas
+{
+	//! Downloads update packages with a bounded number of requests in flight.
+	/**
+	 * Packages are written to `<dest>/<update_time>.update.part` as they arrive and hashed at the same time.
+	 * Once the md5 matches the one from the manifest the file is renamed to `<update_time>.update` and `downloaded` is emitted.
+	 * Packages finish in whatever order the server answers. Ordering is left to the receiver.
+	 */
+	class UpdateDownloader final : public QObject
+	{
+		Q_OBJECT
+		Q_DISABLE_COPY_MOVE( UpdateDownloader )
+
+		struct Job
+		{
+			std::uint64_t update_time;
+			//! Expected md5. Empty to skip the check
+			QByteArray md5;
+			std::shared_ptr< PackageStream > stream {};
+		};
+
+		struct ActiveDownload
+		{
+			QNetworkReply* reply { nullptr };
+			QByteArray md5;
+			QFile file;
+			QCryptographicHash hash { QCryptographicHash::Md5 };
+			//! Receives a copy of everything written to `file`. Optional
+			std::shared_ptr< PackageStream > stream {};
+			qint64 received { 0 };
+			//! A read was put off because `stream` was full. See `handleReadyRead`
+			bool retry_pending { false };
+		};
+
+		QNetworkAccessManager& m_manager;
+		QUrl m_base;
+		std::filesystem::path m_dest;
+		std::size_t m_max_active;
+
+		std::deque< Job > m_queue {};
+		std::unordered_map< std::uint64_t, std::unique_ptr< ActiveDownload > > m_active {};
+		std::size_t m_peak_active { 0 };
+
+		void startNext();
+		//! With `force` everything in the reply is read even if the stream is full
+		void handleReadyRead( const std::uint64_t update_time, const bool force = false );
+		void handleFinished( const std::uint64_t update_time );
+		void fail( const std::uint64_t update_time, const QString reason );
+
+	  public:
+
+		UpdateDownloader(
+			QNetworkAccessManager& manager,
+			QUrl base,
+			std::filesystem::path dest,
+			const std::size_t max_active,
+			QObject* parent = nullptr );
+
+		//! Queues a package for download. Does nothing if it is already queued or downloading.
+		void enqueue( const std::uint64_t update_time, QByteArray md5 );
+
+		//! Sends the package to `stream` while it's downloaded. The file on disk is still written.
+		/**
+		 * @return false if the package isn't queued or has already started arriving
+		 */
+		bool attach( const std::uint64_t update_time, std::shared_ptr< PackageStream > stream );
+
+		//! True if nothing is queued or downloading
+		bool idle() const { return m_queue.empty() && m_active.empty(); }
+
+		//! Highest number of downloads that were in flight at once
+		std::size_t peakActive() const { return m_peak_active; }
+
+		static std::filesystem::path packagePath( const std::filesystem::path& dest, const std::uint64_t update_time );
+
+	  signals:
+		//! The package was fully downloaded and verified. It's at `packagePath()`
+		void downloaded( const std::uint64_t update_time );
+		void failed( const std::uint64_t update_time, const QString reason );
+		//! Emitted when the last queued download completes
+		void finished();
+	};
+} // namespace atlas
+
+#endif //ATLASGAMEMANAGER_UPDATEDOWNLOADER_HPP
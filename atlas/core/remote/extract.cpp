@@ -2,124 +2,185 @@
 // Created by kj16609 on 6/14/23.
 //
 
-#include <filesystem>
-#include <fstream>
-#include <lz4frame.h>
+#include "extract.hpp"
+
+#include <memory>
 
 #include <tracy/Tracy.hpp>
 
 #include "core/logging.hpp"
+#include "core/utils/MappedFile.hpp"
 
 namespace atlas
 {
+	//! Size of the buffer decompressed data is staged in before being handed to the sink
+	constexpr std::size_t DECOMPRESSION_BUFFER_SIZE { 1 << 18 };
 
-	std::size_t get_block_size( const LZ4F_frameInfo_t* info )
+	FrameDecompressor::FrameDecompressor( ExtractSink sink ) : m_sink( std::move( sink ) )
 	{
-		switch ( info->blockSizeID )
+		if ( const auto status = LZ4F_createDecompressionContext( &m_dctx, LZ4F_VERSION ); LZ4F_isError( status ) )
 		{
-			default:
-				throw std::runtime_error( "Invalid block size" );
-			case LZ4F_default:
-				[[fallthrough]];
-			case LZ4F_max64KB:
-				return 1 << 16;
-			case LZ4F_max256KB:
-				return 1 << 18;
-			case LZ4F_max1MB:
-				return 1 << 20;
-			case LZ4F_max4MB:
-				return 1 << 22;
+			throw std::runtime_error(
+				fmt::format( "Failed to create decompression context: {}", LZ4F_getErrorName( status ) ) );
 		}
+
+		m_buffer.resize( DECOMPRESSION_BUFFER_SIZE );
 	}
 
-	std::vector< char > extract( const std::filesystem::path path )
+	FrameDecompressor::~FrameDecompressor()
+	{
+		LZ4F_freeDecompressionContext( m_dctx );
+	}
+
+	void FrameDecompressor::feed( const char* data, std::size_t size )
 	{
 		ZoneScoped;
-		spdlog::info( "Extracting {}", path );
-		LZ4F_dctx* dctx { nullptr };
-		if ( const auto status = LZ4F_createDecompressionContext( &dctx, LZ4F_VERSION ); LZ4F_isError( status ) )
+		std::size_t out_size { 0 };
+
+		//LZ4F can keep decompressed data internally if our buffer was filled. So we have to keep going until we get a partial buffer back.
+		do
 		{
-			throw std::runtime_error(
-				fmt::format( "Failed to create decompression context: {}", LZ4F_getErrorName( status ) ) );
-		}
+			//Gets overwritten with the number of bytes consumed from `data`
+			std::size_t in_size { size };
+			//Gets overwritten with the number of bytes written to the buffer
+			out_size = m_buffer.size();
+
+			const auto ret { LZ4F_decompress( m_dctx, m_buffer.data(), &out_size, data, &in_size, nullptr ) };
 
-		std::vector< char > out_data;
-		out_data.reserve( std::filesystem::file_size( path ) );
+			if ( LZ4F_isError( ret ) )
+			{
+				spdlog::error( "Failed to decompress: {}", LZ4F_getErrorName( ret ) );
+				throw std::runtime_error( fmt::format( "Failed to decompress: {}", LZ4F_getErrorName( ret ) ) );
+			}
+
+			data += in_size;
+			size -= in_size;
+
+			//A return of zero means a frame was fully decoded.
+			m_finished = ret == 0;
+
+			if ( out_size > 0 )
+			{
+				m_total_out += out_size;
+				m_sink( m_buffer.data(), out_size );
+			}
+		}
+		//Stop as soon as the frame ends. Calling again would start reading a new frame and reset `m_finished`
+		while ( !m_finished && ( size > 0 || out_size == m_buffer.size() ) );
+	}
 
-		if ( std::ifstream ifs( path, std::ios::binary ); ifs )
+	namespace
+	{
+		struct DctxDeleter
 		{
-			//Read header
-			std::array< char, LZ4F_HEADER_SIZE_MAX > header_buffer;
-			ifs.read( header_buffer.data(), header_buffer.size() );
+			void operator()( LZ4F_dctx* ctx ) const { LZ4F_freeDecompressionContext( ctx ); }
+		};
 
-			std::size_t processed_bytes { LZ4F_HEADER_SIZE_MAX };
+		using DctxPtr = std::unique_ptr< LZ4F_dctx, DctxDeleter >;
 
-			LZ4F_frameInfo_t info;
-			if ( const auto fires = LZ4F_getFrameInfo( dctx, &info, header_buffer.data(), &processed_bytes );
-			     LZ4F_isError( fires ) )
+		DctxPtr createContext()
+		{
+			LZ4F_dctx* ctx { nullptr };
+			if ( const auto status = LZ4F_createDecompressionContext( &ctx, LZ4F_VERSION ); LZ4F_isError( status ) )
 			{
-				throw std::runtime_error( fmt::format( "Failed to get frame info: {}", LZ4F_getErrorName( fires ) ) );
+				throw std::runtime_error(
+					fmt::format( "Failed to create decompression context: {}", LZ4F_getErrorName( status ) ) );
 			}
 
-			const auto block_size { get_block_size( &info ) };
+			return DctxPtr( ctx );
+		}
+	} // namespace
 
-			char* const decompression_buffer = new char[ block_size ];
-			std::memset( decompression_buffer, 0, block_size );
+	void decompress( const std::span< const char > src, std::vector< char >& out )
+	{
+		ZoneScoped;
+		out.clear();
 
-			spdlog::info( "Header ate {} bytes", processed_bytes );
-			//Rewind file
-			ifs.seekg( static_cast< long long >( processed_bytes ), std::ios::beg );
+		const auto dctx { createContext() };
 
-			std::size_t ret { 1 };
+		LZ4F_frameInfo_t info {};
+		//Gets overwritten with the size of the frame header
+		std::size_t header_size { src.size() };
+		if ( const auto ret = LZ4F_getFrameInfo( dctx.get(), &info, src.data(), &header_size ); LZ4F_isError( ret ) )
+			throw std::runtime_error( fmt::format( "Failed to read frame header: {}", LZ4F_getErrorName( ret ) ) );
 
-			std::array< char, 1 << 16 > buffer;
-			std::size_t bytes_left { 0 };
+		if ( info.contentSize == 0 )
+		{
+			//Size is unknown. Fallback to decompressing in pieces and letting the vector grow
+			out.reserve( src.size() * 4 );
+			FrameDecompressor decompressor { [ &out ]( const char* data, const std::size_t size )
+				                             { out.insert( out.end(), data, data + size ); } };
+			decompressor.feed( src.data(), src.size() );
+
+			if ( !decompressor.finished() ) throw std::runtime_error( "Compressed data ended unexpectedly" );
+			return;
+		}
+
+		out.resize( static_cast< std::size_t >( info.contentSize ) );
+
+		LZ4F_decompressOptions_t options {};
+		//`out` never moves. So LZ4F can skip staging data in it's own buffers
+		options.stableDst = 1;
+
+		auto remaining { src.subspan( header_size ) };
+		std::size_t written { 0 };
+		std::size_t ret { 1 };
+		while ( ret != 0 )
+		{
+			//Gets overwritten with the number of bytes consumed from `remaining`
+			std::size_t in_size { remaining.size() };
+			//Gets overwritten with the number of bytes written to `out`
+			std::size_t out_size { out.size() - written };
+
+			ret = LZ4F_decompress( dctx.get(), out.data() + written, &out_size, remaining.data(), &in_size, &options );
 
-			while ( ret != 0 && ifs.good() && !ifs.eof() )
+			if ( LZ4F_isError( ret ) )
 			{
-				bytes_left += static_cast< size_t >(
-					ifs.readsome( buffer.data() + bytes_left, static_cast< long >( buffer.size() - bytes_left ) ) );
-
-				assert( bytes_left <= buffer.size() );
-
-				//This counter gets overwritten with the number of bytes read from buffer
-				// This counter is set with the number of bytes we have
-				std::size_t in_buffer_bytes { bytes_left };
-
-				//This counter gets overwritten with the number of bytes written to decomp buffer.
-				// This counter is set with the output buffer size
-				std::size_t out_buffer_bytes { block_size };
-
-				if ( bytes_left == 0 ) break;
-				ret = LZ4F_decompress(
-					dctx, decompression_buffer, &out_buffer_bytes, buffer.data(), &in_buffer_bytes, nullptr );
-				const auto bytes_processed { in_buffer_bytes };
-
-				if ( LZ4F_isError( ret ) )
-				{
-					spdlog::error( "Failed to decompress: {}", LZ4F_getErrorName( ret ) );
-					throw std::runtime_error( fmt::format( "Failed to decompress: {}", LZ4F_getErrorName( ret ) ) );
-				}
-				//Shift buffer over by ready_bytes (bytes read by LZ4F_decompress)
-				std::memmove( buffer.data(), buffer.data() + bytes_processed, buffer.size() - bytes_processed );
-				//Narrow down bytes_left to new range
-				bytes_left = buffer.size() - bytes_processed;
-
-				//Copy into out buffer
-				const auto pre_size { out_data.size() };
-				out_data.resize( out_data.size() + out_buffer_bytes );
-				std::memcpy( out_data.data() + pre_size, decompression_buffer, out_buffer_bytes );
+				spdlog::error( "Failed to decompress: {}", LZ4F_getErrorName( ret ) );
+				throw std::runtime_error( fmt::format( "Failed to decompress: {}", LZ4F_getErrorName( ret ) ) );
 			}
+
+			written += out_size;
+			remaining = remaining.subspan( in_size );
+
+			//No progress means we either ran out of input or the frame is bigger then it's header claimed
+			if ( ret != 0 && in_size == 0 && out_size == 0 )
+				throw std::runtime_error( "Compressed data ended unexpectedly" );
 		}
-		else
-			throw std::runtime_error( fmt::format( "Failed to open file: {}", path.string() ) );
 
-		LZ4F_freeDecompressionContext( dctx );
-		const auto file_size { std::filesystem::file_size( path ) };
-		const auto data_size { out_data.size() };
-		const float percent { static_cast< float >( data_size ) / static_cast< float >( file_size ) };
+		out.resize( written );
+	}
+
+	void extract( const std::filesystem::path& path, const ExtractSink& sink )
+	{
+		ZoneScoped;
+		spdlog::info( "Extracting {}", path );
+
+		const MappedFile file { path };
+		FrameDecompressor decompressor { sink };
+
+		decompressor.feed( file.data().data(), file.size() );
+
+		if ( !decompressor.finished() )
+			throw std::runtime_error( fmt::format( "Compressed data in {} ended unexpectedly", path.string() ) );
+
 		spdlog::info(
-			"Finished extracting file {} -> {}: {}%", std::filesystem::file_size( path ), out_data.size(), percent );
+			"Finished extracting file {} -> {}: {}%",
+			file.size(),
+			decompressor.totalOut(),
+			static_cast< float >( decompressor.totalOut() ) / static_cast< float >( file.size() ) );
+	}
+
+	std::vector< char > extract( const std::filesystem::path path )
+	{
+		ZoneScoped;
+		spdlog::info( "Extracting {}", path );
+
+		const MappedFile file { path };
+
+		std::vector< char > out_data {};
+		decompress( file.data(), out_data );
+
 		return out_data;
 	}
 
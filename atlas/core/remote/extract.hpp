@@ -6,10 +6,57 @@
 #define ATLASGAMEMANAGER_EXTRACT_HPP
 
 #include <filesystem>
+#include <functional>
+#include <lz4frame.h>
+#include <span>
+#include <vector>
 
 namespace atlas
 {
+	//! Receives decompressed data. The pointer is only valid for the duration of the call.
+	using ExtractSink = std::function< void( const char*, const std::size_t ) >;
+
+	//! Incremental LZ4 frame decompressor.
+	/**
+	 * Compressed data is pushed in with `feed()` in chunks of any size.
+	 * Decompressed data is handed to the sink as soon as it's available, so memory use does not grow with the size of the frame.
+	 */
+	class FrameDecompressor
+	{
+		LZ4F_dctx* m_dctx { nullptr };
+		std::vector< char > m_buffer {};
+		ExtractSink m_sink;
+		bool m_finished { false };
+		std::size_t m_total_out { 0 };
+
+	  public:
+
+		FrameDecompressor( ExtractSink sink );
+		~FrameDecompressor();
+
+		FrameDecompressor( const FrameDecompressor& ) = delete;
+		FrameDecompressor& operator=( const FrameDecompressor& ) = delete;
+
+		void feed( const char* data, std::size_t size );
+
+		//! True if the last byte fed completed a frame
+		bool finished() const { return m_finished; }
+
+		std::size_t totalOut() const { return m_total_out; }
+	};
+
+	//! Decompresses a complete LZ4 frame from memory straight into `out`.
+	/**
+	 * If the frame header stores the content size then `out` is sized once and decompressed into directly.
+	 * Otherwise `out` is grown as needed. Any previous contents of `out` are discarded.
+	 */
+	void decompress( const std::span< const char > src, std::vector< char >& out );
+
+	//! Streams the decompressed contents of `path` into `sink`. The file is memory mapped.
+	void extract( const std::filesystem::path& path, const ExtractSink& sink );
+
+	//! Decompresses `path` into a single buffer. The file is memory mapped.
 	std::vector< char > extract( const std::filesystem::path path );
-}
+} // namespace atlas
 
 #endif //ATLASGAMEMANAGER_EXTRACT_HPP
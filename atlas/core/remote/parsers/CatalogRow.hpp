@@ -0,0 +1,172 @@
+//
+// Created by kj16609 on 7/12/23.
+//
+
+#ifndef ATLASGAMEMANAGER_CATALOGROW_HPP
+#define ATLASGAMEMANAGER_CATALOGROW_HPP
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+
+namespace remote::parsers
+{
+	enum DataSet
+	{
+		SetAtlas,
+		SetF95,
+		InvalidSet
+	};
+
+	inline DataSet nameToSet( const std::string_view str )
+	{
+		if ( str == "atlas" ) return SetAtlas;
+		if ( str == "f95_zone" ) return SetF95;
+
+		return InvalidSet;
+	}
+
+	enum class ColumnType
+	{
+		Integer,
+		Real,
+		Text
+	};
+
+	struct ColumnDef
+	{
+		std::string_view name;
+		ColumnType type;
+		//! If true then the column must be present for the row to be considered a full row (insert)
+		bool required;
+	};
+
+	// clang-format off
+	inline constexpr std::array< ColumnDef, 28 > atlas_columns {
+		{ { "atlas_id", ColumnType::Integer, true },
+		  { "id_name", ColumnType::Text, true },
+		  { "short_name", ColumnType::Text, true },
+		  { "title", ColumnType::Text, true },
+		  { "original_name", ColumnType::Text, true },
+		  { "category", ColumnType::Text, true },
+		  { "engine", ColumnType::Text, true },
+		  { "status", ColumnType::Text, true },
+		  { "version", ColumnType::Text, true },
+		  { "developer", ColumnType::Text, true },
+		  { "creator", ColumnType::Text, true },
+		  { "overview", ColumnType::Text, true },
+		  { "censored", ColumnType::Text, true },
+		  { "language", ColumnType::Text, true },
+		  { "translations", ColumnType::Text, true },
+		  { "genre", ColumnType::Text, true },
+		  { "tags", ColumnType::Text, true },
+		  { "voice", ColumnType::Text, true },
+		  { "os", ColumnType::Text, true },
+		  { "release_date", ColumnType::Integer, true },
+		  { "length", ColumnType::Text, true },
+		  { "banner", ColumnType::Text, true },
+		  { "banner_wide", ColumnType::Text, true },
+		  { "cover", ColumnType::Text, true },
+		  { "logo", ColumnType::Text, true },
+		  { "wallpaper", ColumnType::Text, true },
+		  { "previews", ColumnType::Text, true },
+		  { "last_db_update", ColumnType::Integer, true } }
+	};
+
+	inline constexpr std::array< ColumnDef, 13 > f95_columns {
+		{ { "f95_id", ColumnType::Integer, true },
+		  { "atlas_id", ColumnType::Integer, true },
+		  { "banner_url", ColumnType::Text, true },
+		  { "site_url", ColumnType::Text, true },
+		  { "last_thread_comment", ColumnType::Integer, true },
+		  { "thread_publish_date", ColumnType::Integer, true },
+		  { "last_record_update", ColumnType::Integer, false },
+		  { "views", ColumnType::Integer, true },
+		  { "likes", ColumnType::Integer, true },
+		  { "tags", ColumnType::Text, true },
+		  { "rating", ColumnType::Real, true },
+		  { "screens", ColumnType::Text, true },
+		  { "replies", ColumnType::Integer, true } }
+	};
+
+	// clang-format on
+
+	template < DataSet set >
+	struct SetInfo;
+
+	template <>
+	struct SetInfo< SetAtlas >
+	{
+		static constexpr std::string_view table_name { "atlas_data" };
+		static constexpr const auto& columns { atlas_columns };
+	};
+
+	template <>
+	struct SetInfo< SetF95 >
+	{
+		static constexpr std::string_view table_name { "f95_zone_data" };
+		static constexpr const auto& columns { f95_columns };
+	};
+
+	//! std::monostate is used for json `null`
+	using FieldValue = std::variant< std::monostate, std::int64_t, double, std::string >;
+
+	//! A single row of catalog data as it comes from the remote.
+	/**
+	 * Columns are stored in the order of `SetInfo<set>::columns`. The first column is always the primary key.
+	 * Rows that do not contain every required column are partial rows and are applied as updates.
+	 */
+	template < DataSet data_set >
+	struct CatalogRow
+	{
+		static constexpr std::size_t column_count { SetInfo< data_set >::columns.size() };
+		static_assert( column_count <= 64, "Presence mask only supports up to 64 columns" );
+
+		std::array< FieldValue, column_count > values {};
+		std::uint64_t present { 0 };
+
+		static constexpr std::optional< std::size_t > columnIndex( const std::string_view name )
+		{
+			for ( std::size_t i = 0; i < column_count; ++i )
+				if ( SetInfo< data_set >::columns[ i ].name == name ) return i;
+
+			return std::nullopt;
+		}
+
+		static constexpr std::uint64_t requiredMask()
+		{
+			std::uint64_t mask { 0 };
+			for ( std::size_t i = 0; i < column_count; ++i )
+				if ( SetInfo< data_set >::columns[ i ].required ) mask |= std::uint64_t( 1 ) << i;
+			return mask;
+		}
+
+		bool has( const std::size_t idx ) const { return present & ( std::uint64_t( 1 ) << idx ); }
+
+		void set( const std::size_t idx, FieldValue value )
+		{
+			values[ idx ] = std::move( value );
+			present |= std::uint64_t( 1 ) << idx;
+		}
+
+		//! Returns true if the row contains every required column
+		bool isFull() const { return ( present & requiredMask() ) == requiredMask(); }
+
+		bool hasKey() const { return has( 0 ); }
+
+		std::int64_t key() const
+		{
+			if ( const auto* ptr = std::get_if< std::int64_t >( &values[ 0 ] ); ptr != nullptr ) return *ptr;
+			return 0;
+		}
+	};
+
+	using AtlasRow = CatalogRow< SetAtlas >;
+	using F95Row = CatalogRow< SetF95 >;
+
+} // namespace remote::parsers
+
+#endif //ATLASGAMEMANAGER_CATALOGROW_HPP
@@ -0,0 +1,131 @@
+//
+// Created by kj16609 on 7/26/23.
+//
+
+#include "CatalogTags.hpp"
+
+#include <tracy/Tracy.hpp>
+
+#include "core/database/Catalog.hpp"
+
+namespace remote::parsers
+{
+	namespace
+	{
+		constexpr std::array< std::size_t, TagTypeEnd > tagColumnIndexes()
+		{
+			std::array< std::size_t, TagTypeEnd > indexes {};
+			for ( std::size_t i = 0; i < TagTypeEnd; ++i ) indexes[ i ] = *AtlasRow::columnIndex( catalog_tag_columns[ i ] );
+			return indexes;
+		}
+
+		constexpr auto tag_column_indexes { tagColumnIndexes() };
+
+		std::string_view trim( std::string_view str )
+		{
+			constexpr std::string_view whitespace { " \t\r\n" };
+			const auto start { str.find_first_not_of( whitespace ) };
+			if ( start == str.npos ) return {};
+			const auto end { str.find_last_not_of( whitespace ) };
+			return str.substr( start, end - start + 1 );
+		}
+	} // namespace
+
+	std::vector< std::string_view > splitTags( const std::string_view text )
+	{
+		std::vector< std::string_view > tags {};
+		std::size_t start { 0 };
+		while ( start <= text.size() )
+		{
+			const auto end { std::min( text.find( ',', start ), text.size() ) };
+			if ( const auto tag = trim( text.substr( start, end - start ) ); !tag.empty() ) tags.emplace_back( tag );
+			start = end + 1;
+		}
+
+		return tags;
+	}
+
+	CatalogTagWriter::CatalogTagWriter( sqlite3& db ) : m_statements( db )
+	{}
+
+	std::int64_t CatalogTagWriter::tagID( const CatalogTagType type, const std::string_view tag )
+	{
+		std::string key { static_cast< char >( '0' + type ) };
+		for ( const char c : tag ) key += static_cast< char >( std::tolower( static_cast< unsigned char >( c ) ) );
+
+		if ( const auto itter = m_ids.find( key ); itter != m_ids.end() ) return itter->second;
+
+		//The no-op update makes RETURNING give us the id of an existing tag as well
+		std::int64_t id { 0 };
+		( m_statements << "INSERT INTO catalog_tags (type, tag) VALUES (?, ?) "
+		                  "ON CONFLICT(type, tag) DO UPDATE SET type = excluded.type RETURNING tag_id" )
+				<< static_cast< std::int64_t >( type ) << std::string( tag )
+			>> id;
+
+		if ( id == 0 ) throw std::runtime_error( fmt::format( "Failed to get an id for tag {}", tag ) );
+
+		m_ids.emplace( std::move( key ), id );
+		return id;
+	}
+
+	void CatalogTagWriter::apply( const AtlasRow& row )
+	{
+		ZoneScoped;
+		for ( std::size_t type = 0; type < TagTypeEnd; ++type )
+		{
+			const auto column { tag_column_indexes[ type ] };
+			if ( !row.has( column ) ) continue;
+
+			//catalog_tag_map is WITHOUT ROWID, so update hooks never see this. Anything caching it has to reload
+			catalog::changed();
+
+			( m_statements << "DELETE FROM catalog_tag_map WHERE atlas_id = ? AND tag_id IN "
+			                  "(SELECT tag_id FROM catalog_tags WHERE type = ?)" )
+				<< row.key() << static_cast< std::int64_t >( type );
+
+			const auto* text { std::get_if< std::string >( &row.values[ column ] ) };
+			if ( text == nullptr ) continue;
+
+			for ( const auto tag : splitTags( *text ) )
+			{
+				const auto id { tagID( static_cast< CatalogTagType >( type ), tag ) };
+				( m_statements << "INSERT OR IGNORE INTO catalog_tag_map (atlas_id, tag_id) VALUES (?, ?)" )
+					<< row.key() << id;
+			}
+		}
+	}
+
+	void indexCatalogTags( sqlite3& db )
+	{
+		ZoneScoped;
+		spdlog::info( "Indexing catalog tags" );
+
+		std::string columns { "atlas_id" };
+		for ( const auto column : catalog_tag_columns ) columns += fmt::format( ", {}", column );
+
+		CatalogTagWriter writer { db };
+		StatementCache statements { db };
+
+		const auto query {
+			fmt::format( "SELECT {} FROM atlas_data WHERE atlas_id > ? ORDER BY atlas_id LIMIT 1", columns )
+		};
+		std::vector< SqlValue > values {};
+
+		//Read a row at a time by key so no read is left running while the writer changes the tables
+		std::int64_t last_id { std::numeric_limits< std::int64_t >::min() };
+		while ( true )
+		{
+			( statements << query ) << last_id >> values;
+			if ( values.empty() ) break;
+
+			AtlasRow row {};
+			row.set( 0, std::get< std::int64_t >( values[ 0 ] ) );
+			for ( std::size_t type = 0; type < TagTypeEnd; ++type )
+				row.set( tag_column_indexes[ type ], std::move( values[ type + 1 ] ) );
+
+			last_id = row.key();
+			writer.apply( row );
+		}
+	}
+
+} // namespace remote::parsers
@@ -0,0 +1,61 @@
+//
+// Created by kj16609 on 7/26/23.
+//
+
+#ifndef ATLASGAMEMANAGER_CATALOGTAGS_HPP
+#define ATLASGAMEMANAGER_CATALOGTAGS_HPP
+
+#include <unordered_map>
+
+#include "CatalogRow.hpp"
+#include "core/database/StatementCache.hpp"
+
+namespace remote::parsers
+{
+	//! Value of `catalog_tags.type`. Each is split out of the `atlas_data` column of the same name
+	enum CatalogTagType
+	{
+		TagTags,
+		TagGenre,
+		TagLanguage,
+		TagVoice,
+		TagOs,
+		TagTypeEnd
+	};
+
+	inline constexpr std::array< std::string_view, TagTypeEnd > catalog_tag_columns { "tags",
+		                                                                              "genre",
+		                                                                              "language",
+		                                                                              "voice",
+		                                                                              "os" };
+
+	//! Splits a comma separated column into it's tags. Whitespace is trimmed and empty entries are dropped
+	std::vector< std::string_view > splitTags( const std::string_view text );
+
+	//! Keeps `catalog_tags` and `catalog_tag_map` in step with the free text tag columns of `atlas_data`.
+	/**
+	 * Tags are compared without case. Ids are cached for the lifetime of the writer. Must be used inside of a transaction.
+	 * Every write bumps `catalog::generation()`.
+	 */
+	class CatalogTagWriter
+	{
+		StatementCache m_statements;
+		//! Keyed by type followed by the lowercase tag
+		std::unordered_map< std::string, std::int64_t > m_ids {};
+
+		std::int64_t tagID( const CatalogTagType type, const std::string_view tag );
+
+	  public:
+
+		CatalogTagWriter( sqlite3& db = Database::ref() );
+
+		//! Replaces the tags of `row` for every tag column it contains
+		void apply( const AtlasRow& row );
+	};
+
+	//! Fills the tag tables from what's already in `atlas_data`. For catalogs written before they existed
+	void indexCatalogTags( sqlite3& db = Database::ref() );
+
+} // namespace remote::parsers
+
+#endif //ATLASGAMEMANAGER_CATALOGTAGS_HPP
@@ -0,0 +1,342 @@
+//
+// Created by kj16609 on 7/15/23.
+//
+
+#include "CatalogWriter.hpp"
+
+#include <tracy/Tracy.hpp>
+
+#define XXH_STATIC_LINKING_ONLY
+#include <xxhash.h>
+
+#include "JsonRowReader.hpp"
+#include "core/database/CatalogText.hpp"
+
+namespace remote::parsers
+{
+	namespace
+	{
+		constexpr std::uint64_t bit( const std::size_t idx )
+		{
+			return std::uint64_t( 1 ) << idx;
+		}
+
+		//! Columns of `set` stored through `catalog::compressText`
+		template < DataSet set >
+		constexpr std::uint64_t compressedColumns()
+		{
+			constexpr auto& columns { SetInfo< set >::columns };
+			std::uint64_t mask { 0 };
+			for ( std::size_t i = 0; i < columns.size(); ++i )
+				if ( catalog::isCompressed( SetInfo< set >::table_name, columns[ i ].name ) ) mask |= bit( i );
+			return mask;
+		}
+
+		template < DataSet set >
+		void bindValue( Binder& binder, const FieldValue& value, const std::size_t idx )
+		{
+			if ( const auto* text = std::get_if< std::string >( &value );
+			     text != nullptr && ( compressedColumns< set >() & bit( idx ) )
+			     && text->size() >= catalog::compress_min_size )
+			{
+				binder << catalog::compressText( *text );
+				return;
+			}
+
+			std::visit( [ &binder ]( const auto& val ) { binder << val; }, value );
+		}
+
+		//! Returns a mask of the columns in `set` that exist in the database
+		template < DataSet set >
+		std::uint64_t schemaColumns( sqlite3& db )
+		{
+			ZoneScoped;
+			//Kept out of the writer's cache. It's only needed once
+			StatementCache statements { db };
+			constexpr auto& columns { SetInfo< set >::columns };
+
+			std::uint64_t mask { 0 };
+			( statements << "SELECT name FROM pragma_table_info(?)" ) << std::string( SetInfo< set >::table_name )
+				>> [ &mask ]( const std::string name ) noexcept
+			{
+				if ( const auto idx = CatalogRow< set >::columnIndex( name ); idx.has_value() ) mask |= bit( *idx );
+			};
+
+			if ( ( mask & bit( 0 ) ) == 0 )
+				throw std::runtime_error( fmt::format(
+					"Table {} is missing it's primary key {}", SetInfo< set >::table_name, columns[ 0 ].name ) );
+
+			for ( std::size_t i = 0; i < columns.size(); ++i )
+				if ( ( mask & bit( i ) ) == 0 )
+					spdlog::warn(
+						"Column {} does not exist in {}. It will be skipped", columns[ i ].name, SetInfo< set >::table_name );
+
+			return mask;
+		}
+
+		//! `INSERT INTO table (...) VALUES (...) ON CONFLICT(key) DO UPDATE SET ...` for the columns in `mask`
+		template < DataSet set >
+		std::string insertQuery( const std::uint64_t mask )
+		{
+			constexpr auto& columns { SetInfo< set >::columns };
+
+			std::string names {};
+			std::string params {};
+			std::string updates {};
+
+			for ( std::size_t i = 0; i < columns.size(); ++i )
+			{
+				if ( ( mask & bit( i ) ) == 0 ) continue;
+
+				if ( !names.empty() )
+				{
+					names += ", ";
+					params += ",";
+				}
+				names += columns[ i ].name;
+				params += "?";
+
+				if ( i == 0 ) continue;
+				if ( !updates.empty() ) updates += ", ";
+				updates += fmt::format( "{0} = excluded.{0}", columns[ i ].name );
+			}
+
+			return fmt::format(
+				"INSERT INTO {} ({}, row_hash) VALUES ({},?) ON CONFLICT({}) DO UPDATE SET {}{}row_hash = excluded.row_hash",
+				SetInfo< set >::table_name,
+				names,
+				params,
+				columns[ 0 ].name,
+				updates,
+				updates.empty() ? "" : ", " );
+		}
+
+		//! `UPDATE table SET a = ?, b = ? WHERE key = ?` for the columns in `mask`
+		template < DataSet set >
+		std::string updateQuery( const std::uint64_t mask )
+		{
+			constexpr auto& columns { SetInfo< set >::columns };
+
+			std::string updates {};
+			for ( std::size_t i = 1; i < columns.size(); ++i )
+			{
+				if ( ( mask & bit( i ) ) == 0 ) continue;
+				if ( !updates.empty() ) updates += ", ";
+				updates += fmt::format( "{} = ?", columns[ i ].name );
+			}
+
+			return fmt::format(
+				"UPDATE {} SET {}, row_hash = ? WHERE {} = ?", SetInfo< set >::table_name, updates, columns[ 0 ].name );
+		}
+
+		//! `SELECT <columns in mask>, row_hash FROM table WHERE key = ?`
+		template < DataSet set >
+		std::string rowQuery( const std::uint64_t mask )
+		{
+			constexpr auto& columns { SetInfo< set >::columns };
+
+			std::string names {};
+			for ( std::size_t i = 0; i < columns.size(); ++i )
+			{
+				if ( ( mask & bit( i ) ) == 0 ) continue;
+				//Compared against the uncompressed text of updates
+				if ( compressedColumns< set >() & bit( i ) )
+					names += fmt::format( "catalog_text({})", columns[ i ].name );
+				else
+					names += columns[ i ].name;
+				names += ", ";
+			}
+
+			return fmt::format(
+				"SELECT {}row_hash FROM {} WHERE {} = ?", names, SetInfo< set >::table_name, columns[ 0 ].name );
+		}
+
+		template < DataSet set >
+		std::string hashQuery()
+		{
+			return fmt::format(
+				"SELECT row_hash FROM {} WHERE {} = ?", SetInfo< set >::table_name, SetInfo< set >::columns[ 0 ].name );
+		}
+
+		//! Hashes as signed so it can be stored in an INTEGER column
+		std::int64_t storable( const std::uint64_t hash )
+		{
+			return static_cast< std::int64_t >( hash );
+		}
+	} // namespace
+
+	template < DataSet set >
+	std::uint64_t rowHash( const CatalogRow< set >& row, const std::uint64_t mask )
+	{
+		XXH64_state_t state_storage;
+		XXH64_state_t* const state { &state_storage };
+		XXH64_reset( state, 0 );
+
+		for ( std::size_t i = 0; i < row.values.size(); ++i )
+		{
+			if ( ( mask & bit( i ) ) == 0 ) continue;
+
+			const FieldValue null_value {};
+			const FieldValue& value { row.has( i ) ? row.values[ i ] : null_value };
+
+			//The type goes in first so that `1` and `"1"` hash differently
+			const auto type { static_cast< std::uint8_t >( value.index() ) };
+			XXH64_update( state, &type, sizeof( type ) );
+
+			std::visit(
+				[ state ]( const auto& val )
+				{
+					using T = std::decay_t< decltype( val ) >;
+					if constexpr ( std::is_same_v< T, std::string > )
+					{
+						const std::uint64_t size { val.size() };
+						XXH64_update( state, &size, sizeof( size ) );
+						XXH64_update( state, val.data(), val.size() );
+					}
+					else if constexpr ( !std::is_same_v< T, std::monostate > )
+						XXH64_update( state, &val, sizeof( val ) );
+				},
+				value );
+		}
+
+		return XXH64_digest( state );
+	}
+
+	template std::uint64_t rowHash< SetAtlas >( const AtlasRow& row, const std::uint64_t mask );
+	template std::uint64_t rowHash< SetF95 >( const F95Row& row, const std::uint64_t mask );
+
+	CatalogWriter::CatalogWriter( sqlite3& db ) :
+	  m_statements( db ),
+	  m_atlas( { schemaColumns< SetAtlas >( db ), hashQuery< SetAtlas >(), {} } ),
+	  m_f95( { schemaColumns< SetF95 >( db ), hashQuery< SetF95 >(), {} } ),
+	  m_tags( db )
+	{
+		m_atlas.row_query = rowQuery< SetAtlas >( m_atlas.columns );
+		m_f95.row_query = rowQuery< SetF95 >( m_f95.columns );
+	}
+
+	template < DataSet set >
+	CatalogWriter::TableState& CatalogWriter::table()
+	{
+		if constexpr ( set == SetAtlas )
+			return m_atlas;
+		else
+			return m_f95;
+	}
+
+	template < DataSet set >
+	const std::string& CatalogWriter::query( const std::uint64_t mask, const bool full )
+	{
+		static_assert( CatalogRow< set >::column_count < 64, "Top bit of the query key is used for full rows" );
+		auto& queries { table< set >().queries };
+
+		const auto key { mask | ( full ? bit( 63 ) : 0 ) };
+		if ( auto itter = queries.find( key ); itter != queries.end() ) return itter->second;
+
+		return queries.emplace( key, full ? insertQuery< set >( mask ) : updateQuery< set >( mask ) ).first->second;
+	}
+
+	template < DataSet set >
+	CatalogWriter::Result CatalogWriter::applyFull( const CatalogRow< set >& row )
+	{
+		const auto mask { row.present & table< set >().columns };
+		const auto hash { storable( rowHash( row, table< set >().columns ) ) };
+
+		std::vector< SqlValue > stored {};
+		( m_statements << table< set >().hash_query ) << row.key() >> stored;
+
+		if ( !stored.empty() )
+		{
+			if ( const auto* stored_hash = std::get_if< std::int64_t >( &stored[ 0 ] );
+			     stored_hash != nullptr && *stored_hash == hash )
+				return Result::Skipped;
+		}
+
+		auto binder { m_statements << query< set >( mask, true ) };
+		for ( std::size_t i = 0; i < row.values.size(); ++i )
+			if ( mask & bit( i ) ) bindValue< set >( binder, row.values[ i ], i );
+		binder << hash;
+
+		return stored.empty() ? Result::Inserted : Result::Updated;
+	}
+
+	template < DataSet set >
+	CatalogWriter::Result CatalogWriter::applyPartial( const CatalogRow< set >& row )
+	{
+		constexpr auto& columns { SetInfo< set >::columns };
+		const auto valid { table< set >().columns };
+		const auto mask { row.present & valid };
+
+		//Nothing to update
+		if ( ( mask & ~bit( 0 ) ) == 0 ) return Result::Skipped;
+
+		std::vector< SqlValue > stored {};
+		( m_statements << table< set >().row_query ) << row.key() >> stored;
+
+		if ( stored.empty() )
+		{
+			spdlog::debug( "Skipping update for {} {} which does not exist", SetInfo< set >::table_name, row.key() );
+			return Result::Skipped;
+		}
+
+		//Rebuild the stored row and lay the update over it to get the hash of the result
+		CatalogRow< set > merged {};
+		std::size_t stored_idx { 0 };
+		for ( std::size_t i = 0; i < columns.size(); ++i )
+		{
+			if ( ( valid & bit( i ) ) == 0 ) continue;
+			merged.set( i, coerce( std::move( stored[ stored_idx++ ] ), columns[ i ].type ) );
+		}
+
+		//Rows from before row_hash existed have to be hashed now
+		const auto* stored_hash_ptr { std::get_if< std::int64_t >( &stored.back() ) };
+		const auto stored_hash { stored_hash_ptr != nullptr ? *stored_hash_ptr : storable( rowHash( merged, valid ) ) };
+
+		for ( std::size_t i = 1; i < columns.size(); ++i )
+			if ( mask & bit( i ) ) merged.set( i, row.values[ i ] );
+
+		const auto hash { storable( rowHash( merged, valid ) ) };
+		if ( hash == stored_hash ) return Result::Skipped;
+
+		auto binder { m_statements << query< set >( mask, false ) };
+		for ( std::size_t i = 1; i < columns.size(); ++i )
+			if ( mask & bit( i ) ) bindValue< set >( binder, row.values[ i ], i );
+		binder << hash << row.key();
+
+		return Result::Updated;
+	}
+
+	template < DataSet set >
+	CatalogWriter::Result CatalogWriter::apply( const CatalogRow< set >& row, const bool may_insert )
+	{
+		ZoneScoped;
+		if ( !row.hasKey() )
+			throw std::runtime_error( fmt::format( "{} did not contain it's pkey!", SetInfo< set >::table_name ) );
+
+		const auto result { row.isFull() && may_insert ? applyFull( row ) : applyPartial( row ) };
+
+		if constexpr ( set == SetAtlas )
+			if ( result != Result::Skipped ) m_tags.apply( row );
+
+		switch ( result )
+		{
+			case Result::Inserted:
+				++m_stats.inserted;
+				break;
+			case Result::Updated:
+				++m_stats.updated;
+				break;
+			case Result::Skipped:
+				[[fallthrough]];
+			default:
+				++m_stats.skipped;
+				break;
+		}
+
+		return result;
+	}
+
+	template CatalogWriter::Result CatalogWriter::apply< SetAtlas >( const AtlasRow& row, const bool may_insert );
+	template CatalogWriter::Result CatalogWriter::apply< SetF95 >( const F95Row& row, const bool may_insert );
+
+} // namespace remote::parsers
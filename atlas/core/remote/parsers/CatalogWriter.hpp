@@ -0,0 +1,100 @@
+//
+// Created by kj16609 on 7/15/23.
+//
+
+#ifndef ATLASGAMEMANAGER_CATALOGWRITER_HPP
+#define ATLASGAMEMANAGER_CATALOGWRITER_HPP
+
+#include <unordered_map>
+
+#include "CatalogRow.hpp"
+#include "CatalogTags.hpp"
+#include "core/database/StatementCache.hpp"
+
+namespace remote::parsers
+{
+	//! Hash of the canonical values of the columns in `mask`. Missing columns hash as null.
+	template < DataSet set >
+	std::uint64_t rowHash( const CatalogRow< set >& row, const std::uint64_t mask );
+
+	//! Writes catalog rows into `atlas_data` and `f95_zone_data` of `db`. Must be used inside of a transaction.
+	/**
+	 * Full rows are upserted. Partial rows become a single `UPDATE ... SET a = ?, b = ? WHERE key = ?`.
+	 * Queries are generated and prepared once per distinct set of columns and reused for the lifetime of the writer.
+	 * Column names are checked against the table schema on construction. Columns the table does not have are skipped.
+	 *
+	 * Each row stores a hash of it's values in `row_hash`. Rows that would not change the stored values are skipped.
+	 * Tag columns of atlas rows that are written are split into `catalog_tag_map`. See CatalogTagWriter
+	 */
+	class CatalogWriter
+	{
+	  public:
+
+		enum class Result
+		{
+			Inserted,
+			Updated,
+			Skipped
+		};
+
+		struct Stats
+		{
+			std::size_t inserted { 0 };
+			std::size_t updated { 0 };
+			std::size_t skipped { 0 };
+		};
+
+	  private:
+
+		struct TableState
+		{
+			//! Columns that exist in the table
+			std::uint64_t columns;
+			//! `SELECT row_hash ...`
+			std::string hash_query;
+			//! `SELECT <columns>, row_hash ...`
+			std::string row_query;
+			std::unordered_map< std::uint64_t, std::string > queries {};
+		};
+
+		StatementCache m_statements;
+
+		TableState m_atlas;
+		TableState m_f95;
+
+		CatalogTagWriter m_tags;
+
+		Stats m_stats {};
+
+		template < DataSet set >
+		TableState& table();
+
+		template < DataSet set >
+		const std::string& query( const std::uint64_t mask, const bool full );
+
+		template < DataSet set >
+		Result applyFull( const CatalogRow< set >& row );
+
+		template < DataSet set >
+		Result applyPartial( const CatalogRow< set >& row );
+
+	  public:
+
+		CatalogWriter( sqlite3& db = Database::ref() );
+
+		CatalogWriter( const CatalogWriter& ) = delete;
+		CatalogWriter& operator=( const CatalogWriter& ) = delete;
+
+		//! Inserts full rows and updates partial ones. Without `may_insert` full rows only update an existing row too
+		template < DataSet set >
+		Result apply( const CatalogRow< set >& row, const bool may_insert = true );
+
+		const Stats& stats() const { return m_stats; }
+
+		//! Number of distinct statements prepared so far
+		std::size_t statementCount() const { return m_statements.size(); }
+	};
+
+} // namespace remote::parsers
+
+#endif //ATLASGAMEMANAGER_CATALOGWRITER_HPP
@@ -0,0 +1,573 @@
+//
+// Created by kj16609 on 7/12/23.
+//
+
+#include "JsonRowReader.hpp"
+
+#include <charconv>
+
+#include <tracy/Tracy.hpp>
+
+#include "core/logging.hpp"
+
+namespace remote::parsers
+{
+	FieldValue coerce( FieldValue value, const ColumnType type )
+	{
+		switch ( type )
+		{
+			case ColumnType::Integer:
+				{
+					if ( const auto* dbl = std::get_if< double >( &value ); dbl != nullptr )
+						return static_cast< std::int64_t >( *dbl );
+					if ( const auto* str = std::get_if< std::string >( &value ); str != nullptr )
+					{
+						std::int64_t num { 0 };
+						std::from_chars( str->data(), str->data() + str->size(), num );
+						return num;
+					}
+					return value;
+				}
+			case ColumnType::Real:
+				{
+					if ( const auto* num = std::get_if< std::int64_t >( &value ); num != nullptr )
+						return static_cast< double >( *num );
+					if ( const auto* str = std::get_if< std::string >( &value ); str != nullptr )
+					{
+						try
+						{
+							return std::stod( *str );
+						}
+						catch ( ... )
+						{
+							return 0.0;
+						}
+					}
+					return value;
+				}
+			case ColumnType::Text:
+				{
+					if ( const auto* num = std::get_if< std::int64_t >( &value ); num != nullptr )
+						return std::to_string( *num );
+					if ( const auto* dbl = std::get_if< double >( &value ); dbl != nullptr )
+						return fmt::format( "{}", *dbl );
+					return value;
+				}
+			default:
+				return value;
+		}
+	}
+
+	JsonRowReader::JsonRowReader( Callbacks callbacks ) : m_callbacks( std::move( callbacks ) )
+	{}
+
+	JsonRowReader::JsonRowReader( Callbacks callbacks, const DataSet set ) :
+	  m_callbacks( std::move( callbacks ) ),
+	  m_state( ParseState::ArrayElement ),
+	  m_set( set ),
+	  m_fragment( true )
+	{
+		if ( m_set == InvalidSet ) throw std::runtime_error( "Unexpected set!" );
+		m_callbacks.row_batch = nullptr;
+	}
+
+	void JsonRowReader::appendCodepoint( const std::uint32_t cp )
+	{
+		if ( cp < 0x80 )
+			m_token.push_back( static_cast< char >( cp ) );
+		else if ( cp < 0x800 )
+		{
+			m_token.push_back( static_cast< char >( 0xC0 | ( cp >> 6 ) ) );
+			m_token.push_back( static_cast< char >( 0x80 | ( cp & 0x3F ) ) );
+		}
+		else if ( cp < 0x10000 )
+		{
+			m_token.push_back( static_cast< char >( 0xE0 | ( cp >> 12 ) ) );
+			m_token.push_back( static_cast< char >( 0x80 | ( ( cp >> 6 ) & 0x3F ) ) );
+			m_token.push_back( static_cast< char >( 0x80 | ( cp & 0x3F ) ) );
+		}
+		else
+		{
+			m_token.push_back( static_cast< char >( 0xF0 | ( cp >> 18 ) ) );
+			m_token.push_back( static_cast< char >( 0x80 | ( ( cp >> 12 ) & 0x3F ) ) );
+			m_token.push_back( static_cast< char >( 0x80 | ( ( cp >> 6 ) & 0x3F ) ) );
+			m_token.push_back( static_cast< char >( 0x80 | ( cp & 0x3F ) ) );
+		}
+	}
+
+	//! Writes out a dangling high surrogate as U+FFFD
+	void JsonRowReader::flushSurrogate()
+	{
+		if ( m_high_surrogate == 0 ) return;
+		appendCodepoint( 0xFFFD );
+		m_high_surrogate = 0;
+	}
+
+	void JsonRowReader::finishUnicode()
+	{
+		const auto cp { m_unicode };
+
+		if ( cp >= 0xDC00 && cp <= 0xDFFF && m_high_surrogate != 0 )
+		{
+			appendCodepoint( 0x10000 + ( ( m_high_surrogate - 0xD800 ) << 10 ) + ( cp - 0xDC00 ) );
+			m_high_surrogate = 0;
+			return;
+		}
+
+		flushSurrogate();
+
+		if ( cp >= 0xD800 && cp <= 0xDBFF )
+			m_high_surrogate = cp;
+		else
+			appendCodepoint( cp );
+	}
+
+	void JsonRowReader::feed( const char* const data, const std::size_t size )
+	{
+		ZoneScoped;
+		std::size_t i { 0 };
+		while ( i < size )
+		{
+			const char c { data[ i ] };
+
+			switch ( m_lex )
+			{
+				case LexState::String:
+					{
+						//Fast path. Copy everything up to the next quote or escape in one go.
+						std::size_t end { i };
+						while ( end < size && data[ end ] != '"' && data[ end ] != '\\' ) ++end;
+
+						if ( end > i )
+						{
+							flushSurrogate();
+							m_token.append( data + i, end - i );
+						}
+
+						if ( end == size )
+						{
+							i = size;
+							break;
+						}
+
+						if ( data[ end ] == '"' )
+						{
+							flushSurrogate();
+							m_lex = LexState::None;
+							handleToken( Token::String );
+						}
+						else
+							m_lex = LexState::StringEscape;
+
+						i = end + 1;
+						break;
+					}
+				case LexState::StringEscape:
+					{
+						m_lex = LexState::String;
+						if ( c == 'u' )
+						{
+							m_lex = LexState::StringUnicode;
+							m_unicode = 0;
+							m_unicode_digits = 0;
+							++i;
+							break;
+						}
+
+						flushSurrogate();
+						switch ( c )
+						{
+							case '"':
+								[[fallthrough]];
+							case '\\':
+								[[fallthrough]];
+							case '/':
+								m_token.push_back( c );
+								break;
+							case 'b':
+								m_token.push_back( '\b' );
+								break;
+							case 'f':
+								m_token.push_back( '\f' );
+								break;
+							case 'n':
+								m_token.push_back( '\n' );
+								break;
+							case 'r':
+								m_token.push_back( '\r' );
+								break;
+							case 't':
+								m_token.push_back( '\t' );
+								break;
+							default:
+								throw std::runtime_error( fmt::format( "Invalid escape sequence \\{} in update data", c ) );
+						}
+						++i;
+						break;
+					}
+				case LexState::StringUnicode:
+					{
+						std::uint32_t digit { 0 };
+						if ( c >= '0' && c <= '9' )
+							digit = static_cast< std::uint32_t >( c - '0' );
+						else if ( c >= 'a' && c <= 'f' )
+							digit = static_cast< std::uint32_t >( c - 'a' + 10 );
+						else if ( c >= 'A' && c <= 'F' )
+							digit = static_cast< std::uint32_t >( c - 'A' + 10 );
+						else
+							throw std::runtime_error( "Invalid unicode escape in update data" );
+
+						m_unicode = ( m_unicode << 4 ) | digit;
+						if ( ++m_unicode_digits == 4 )
+						{
+							finishUnicode();
+							m_lex = LexState::String;
+						}
+						++i;
+						break;
+					}
+				case LexState::Bare:
+					{
+						if ( ( c >= '0' && c <= '9' ) || ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) || c == '-'
+						     || c == '+' || c == '.' )
+						{
+							m_token.push_back( c );
+							++i;
+						}
+						else
+						{
+							//Don't advance. The delimiter still needs to be processed
+							m_lex = LexState::None;
+							handleToken( Token::Bare );
+						}
+						break;
+					}
+				case LexState::Raw:
+					{
+						//Only strings and braces matter here. Everything else is copied as is for the batch reader to deal with.
+						std::size_t end { i };
+						bool row_done { false };
+						for ( ; end < size; ++end )
+						{
+							const char ch { data[ end ] };
+							if ( m_raw_escape )
+								m_raw_escape = false;
+							else if ( m_raw_string )
+							{
+								if ( ch == '\\' )
+									m_raw_escape = true;
+								else if ( ch == '"' )
+									m_raw_string = false;
+							}
+							else if ( ch == '"' )
+								m_raw_string = true;
+							else if ( ch == '{' )
+								++m_raw_depth;
+							else if ( ch == '}' && --m_raw_depth == 0 )
+							{
+								++end;
+								row_done = true;
+								break;
+							}
+						}
+
+						m_batch.append( data + i, end - i );
+						i = end;
+
+						if ( row_done )
+						{
+							m_lex = LexState::None;
+							++m_row_count;
+							++m_batch_rows;
+							m_state = ParseState::ArrayNext;
+							if ( m_batch.size() >= batch_size ) flushBatch();
+						}
+						break;
+					}
+				case LexState::None:
+					[[fallthrough]];
+				default:
+					{
+						++i;
+						switch ( c )
+						{
+							case ' ':
+								[[fallthrough]];
+							case '\t':
+								[[fallthrough]];
+							case '\r':
+								[[fallthrough]];
+							case '\n':
+								break;
+							case '{':
+								handleToken( Token::ObjectBegin );
+								break;
+							case '}':
+								handleToken( Token::ObjectEnd );
+								break;
+							case '[':
+								handleToken( Token::ArrayBegin );
+								break;
+							case ']':
+								handleToken( Token::ArrayEnd );
+								break;
+							case ':':
+								handleToken( Token::Colon );
+								break;
+							case ',':
+								handleToken( Token::Comma );
+								break;
+							case '"':
+								m_token.clear();
+								m_lex = LexState::String;
+								break;
+							default:
+								m_token.clear();
+								m_token.push_back( c );
+								m_lex = LexState::Bare;
+								break;
+						}
+					}
+			}
+		}
+	}
+
+	void JsonRowReader::finish()
+	{
+		if ( m_lex == LexState::Bare )
+		{
+			m_lex = LexState::None;
+			handleToken( Token::Bare );
+		}
+
+		const bool complete { m_fragment ? m_state == ParseState::ArrayElement || m_state == ParseState::ArrayNext :
+			                               m_state == ParseState::Done };
+
+		if ( m_lex != LexState::None || !complete ) throw std::runtime_error( "Update data ended unexpectedly" );
+	}
+
+	FieldValue JsonRowReader::bareValue() const
+	{
+		if ( m_token == "null" ) return std::monostate();
+		if ( m_token == "true" ) return std::int64_t( 1 );
+		if ( m_token == "false" ) return std::int64_t( 0 );
+
+		const char* const begin { m_token.data() };
+		const char* const end { m_token.data() + m_token.size() };
+
+		if ( m_token.find_first_of( ".eE" ) == std::string::npos )
+		{
+			std::int64_t num { 0 };
+			if ( const auto [ ptr, ec ] = std::from_chars( begin, end, num ); ec == std::errc() && ptr == end )
+				return num;
+		}
+
+		try
+		{
+			std::size_t pos { 0 };
+			const double num { std::stod( m_token, &pos ) };
+			if ( pos == m_token.size() ) return num;
+		}
+		catch ( ... )
+		{}
+
+		throw std::runtime_error( fmt::format( "Invalid value \"{}\" in update data", m_token ) );
+	}
+
+	void JsonRowReader::unexpected( const Token token ) const
+	{
+		throw std::runtime_error( fmt::format(
+			"Unexpected token {} in update data (state {}, key \"{}\")",
+			static_cast< int >( token ),
+			static_cast< int >( m_state ),
+			m_key ) );
+	}
+
+	void JsonRowReader::setField( FieldValue value )
+	{
+		if ( !m_column.has_value() ) return;
+
+		const auto idx { m_column.value() };
+		switch ( m_set )
+		{
+			case SetAtlas:
+				m_atlas_row.set( idx, coerce( std::move( value ), atlas_columns[ idx ].type ) );
+				break;
+			case SetF95:
+				m_f95_row.set( idx, coerce( std::move( value ), f95_columns[ idx ].type ) );
+				break;
+			case InvalidSet:
+				[[fallthrough]];
+			default:
+				throw std::runtime_error( "Unexpected set!" );
+		}
+	}
+
+	void JsonRowReader::emitRow()
+	{
+		++m_row_count;
+		switch ( m_set )
+		{
+			case SetAtlas:
+				if ( m_callbacks.atlas_row ) m_callbacks.atlas_row( std::move( m_atlas_row ) );
+				m_atlas_row = {};
+				break;
+			case SetF95:
+				if ( m_callbacks.f95_row ) m_callbacks.f95_row( std::move( m_f95_row ) );
+				m_f95_row = {};
+				break;
+			case InvalidSet:
+				[[fallthrough]];
+			default:
+				throw std::runtime_error( "Unexpected set!" );
+		}
+	}
+
+	void JsonRowReader::beginRawRow()
+	{
+		if ( !m_batch.empty() ) m_batch.push_back( ',' );
+		m_batch.push_back( '{' );
+		m_raw_depth = 1;
+		m_raw_string = false;
+		m_raw_escape = false;
+		m_lex = LexState::Raw;
+	}
+
+	void JsonRowReader::flushBatch()
+	{
+		if ( m_batch_rows == 0 ) return;
+
+		m_callbacks.row_batch( m_set, std::move( m_batch ), m_batch_rows );
+		m_batch = {};
+		m_batch_rows = 0;
+	}
+
+	void JsonRowReader::handleToken( const Token token )
+	{
+		switch ( m_state )
+		{
+			case ParseState::Start:
+				if ( token != Token::ObjectBegin ) unexpected( token );
+				m_state = ParseState::TopKey;
+				return;
+			case ParseState::TopKey:
+				if ( token == Token::ObjectEnd )
+				{
+					m_state = ParseState::Done;
+					return;
+				}
+				if ( token != Token::String ) unexpected( token );
+				m_key = std::move( m_token );
+				m_state = ParseState::TopColon;
+				return;
+			case ParseState::TopColon:
+				if ( token != Token::Colon ) unexpected( token );
+				m_state = ParseState::TopValue;
+				return;
+			case ParseState::TopValue:
+				switch ( token )
+				{
+					case Token::ArrayBegin:
+						m_set = nameToSet( m_key );
+						if ( m_set == InvalidSet )
+							throw std::runtime_error( fmt::format( "Unexpected data in set! Key = {}", m_key ) );
+						TracyMessage( m_key.c_str(), m_key.size() );
+						m_state = ParseState::ArrayElement;
+						return;
+					case Token::String:
+						if ( m_callbacks.scalar ) m_callbacks.scalar( m_key, FieldValue( std::move( m_token ) ) );
+						m_state = ParseState::TopNext;
+						return;
+					case Token::Bare:
+						if ( m_callbacks.scalar ) m_callbacks.scalar( m_key, bareValue() );
+						m_state = ParseState::TopNext;
+						return;
+					case Token::ObjectBegin:
+						[[fallthrough]];
+					case Token::ObjectEnd:
+						[[fallthrough]];
+					case Token::ArrayEnd:
+						[[fallthrough]];
+					case Token::Colon:
+						[[fallthrough]];
+					case Token::Comma:
+						[[fallthrough]];
+					default:
+						unexpected( token );
+				}
+			case ParseState::TopNext:
+				if ( token == Token::Comma )
+					m_state = ParseState::TopKey;
+				else if ( token == Token::ObjectEnd )
+					m_state = ParseState::Done;
+				else
+					unexpected( token );
+				return;
+			case ParseState::ArrayElement:
+				if ( token == Token::ArrayEnd && !m_fragment )
+				{
+					if ( m_callbacks.row_batch ) flushBatch();
+					m_state = ParseState::TopNext;
+					return;
+				}
+				if ( token != Token::ObjectBegin ) unexpected( token );
+				if ( m_callbacks.row_batch )
+					beginRawRow();
+				else
+					m_state = ParseState::RowKey;
+				return;
+			case ParseState::ArrayNext:
+				if ( token == Token::Comma )
+					m_state = ParseState::ArrayElement;
+				else if ( token == Token::ArrayEnd && !m_fragment )
+				{
+					if ( m_callbacks.row_batch ) flushBatch();
+					m_state = ParseState::TopNext;
+				}
+				else
+					unexpected( token );
+				return;
+			case ParseState::RowKey:
+				if ( token == Token::ObjectEnd )
+				{
+					emitRow();
+					m_state = ParseState::ArrayNext;
+					return;
+				}
+				if ( token != Token::String ) unexpected( token );
+				m_column = m_set == SetAtlas ? AtlasRow::columnIndex( m_token ) : F95Row::columnIndex( m_token );
+				if ( !m_column.has_value() ) spdlog::debug( "Skipping unknown key {} in set {}", m_token, m_key );
+				m_state = ParseState::RowColon;
+				return;
+			case ParseState::RowColon:
+				if ( token != Token::Colon ) unexpected( token );
+				m_state = ParseState::RowValue;
+				return;
+			case ParseState::RowValue:
+				if ( token == Token::String )
+					setField( std::move( m_token ) );
+				else if ( token == Token::Bare )
+					setField( bareValue() );
+				else
+					throw std::runtime_error( "Unexpected type when parsing update data!" );
+				m_state = ParseState::RowNext;
+				return;
+			case ParseState::RowNext:
+				if ( token == Token::Comma )
+					m_state = ParseState::RowKey;
+				else if ( token == Token::ObjectEnd )
+				{
+					emitRow();
+					m_state = ParseState::ArrayNext;
+				}
+				else
+					unexpected( token );
+				return;
+			case ParseState::Done:
+				[[fallthrough]];
+			default:
+				unexpected( token );
+		}
+	}
+
+} // namespace remote::parsers
@@ -0,0 +1,155 @@
+//
+// Created by kj16609 on 7/12/23.
+//
+
+#ifndef ATLASGAMEMANAGER_JSONROWREADER_HPP
+#define ATLASGAMEMANAGER_JSONROWREADER_HPP
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "CatalogRow.hpp"
+
+namespace remote::parsers
+{
+	//! Converts a json value into the type the column expects.
+	FieldValue coerce( FieldValue value, const ColumnType type );
+
+	//! Incremental (SAX style) reader for v0 update packages.
+	/**
+	 * The reader accepts the json document in chunks of any size and emits each row of the `atlas` and `f95_zone` arrays
+	 * as soon as its closing brace has been read. Only the row that is currently being read is kept in memory.
+	 *
+	 * Expected layout:
+	 * @code
+	 * { "min_ver": 0, "atlas": [ { ... }, ... ], "f95_zone": [ { ... }, ... ] }
+	 * @endcode
+	 */
+	class JsonRowReader
+	{
+	  public:
+
+		struct Callbacks
+		{
+			std::function< void( AtlasRow&& ) > atlas_row {};
+			std::function< void( F95Row&& ) > f95_row {};
+			//! Called for every top level key that is not an array (`min_ver`)
+			std::function< void( std::string_view, const FieldValue& ) > scalar {};
+			//! If set rows are not parsed. Their raw text is collected into comma separated batches instead.
+			/**
+			 * Batches can be parsed later (and on any thread) with a JsonRowReader constructed for the batch's set.
+			 * `atlas_row` and `f95_row` are not called when this is set.
+			 */
+			std::function< void( DataSet, std::string&&, std::size_t ) > row_batch {};
+		};
+
+	  private:
+
+		enum class Token
+		{
+			ObjectBegin,
+			ObjectEnd,
+			ArrayBegin,
+			ArrayEnd,
+			Colon,
+			Comma,
+			String,
+			Bare
+		};
+
+		enum class LexState
+		{
+			None,
+			String,
+			StringEscape,
+			StringUnicode,
+			Bare,
+			//! Copying a row as is into `m_batch`
+			Raw
+		};
+
+		enum class ParseState
+		{
+			Start,
+			TopKey,
+			TopColon,
+			TopValue,
+			TopNext,
+			ArrayElement,
+			ArrayNext,
+			RowKey,
+			RowColon,
+			RowValue,
+			RowNext,
+			Done
+		};
+
+		Callbacks m_callbacks;
+
+		LexState m_lex { LexState::None };
+		ParseState m_state { ParseState::Start };
+
+		std::string m_token {};
+		std::uint32_t m_unicode { 0 };
+		std::uint8_t m_unicode_digits { 0 };
+		std::uint32_t m_high_surrogate { 0 };
+
+		std::string m_key {};
+		DataSet m_set { InvalidSet };
+		//! Column index of the current row key. Unknown keys are skipped
+		std::optional< std::size_t > m_column {};
+
+		AtlasRow m_atlas_row {};
+		F95Row m_f95_row {};
+
+		std::size_t m_row_count { 0 };
+
+		//! True if we are reading a batch produced by `Callbacks::row_batch`
+		bool m_fragment { false };
+
+		std::string m_batch {};
+		std::size_t m_batch_rows { 0 };
+		std::size_t m_raw_depth { 0 };
+		bool m_raw_string { false };
+		bool m_raw_escape { false };
+
+		void appendCodepoint( std::uint32_t codepoint );
+		void flushSurrogate();
+		void finishUnicode();
+
+		void handleToken( const Token token );
+		void emitRow();
+		void beginRawRow();
+		void flushBatch();
+		void setField( FieldValue value );
+		FieldValue bareValue() const;
+
+		[[noreturn]] void unexpected( const Token token ) const;
+
+	  public:
+
+		//! Size (in bytes) a batch is allowed to grow to before it is handed to `Callbacks::row_batch`
+		static constexpr std::size_t batch_size { 1 << 18 };
+
+		JsonRowReader( Callbacks callbacks );
+
+		//! Creates a reader for a batch of rows from `set`, as given to `Callbacks::row_batch`
+		JsonRowReader( Callbacks callbacks, const DataSet set );
+
+		JsonRowReader( const JsonRowReader& ) = delete;
+		JsonRowReader& operator=( const JsonRowReader& ) = delete;
+
+		//! Feeds the next chunk of the document. Chunks may split tokens at any point.
+		void feed( const char* data, const std::size_t size );
+
+		//! Signals that the document is complete. Throws if the document was truncated.
+		void finish();
+
+		std::size_t rowCount() const { return m_row_count; }
+	};
+
+} // namespace remote::parsers
+
+#endif //ATLASGAMEMANAGER_JSONROWREADER_HPP
@@ -0,0 +1,28 @@
+//
+// Created by kj16609 on 7/24/23.
+//
+
+#include "parser.hpp"
+
+#include <fstream>
+
+#include <tracy/Tracy.hpp>
+
+#include "v1_format.hpp"
+
+namespace remote::parsers
+{
+	CatalogWriter::Stats processFile( const std::filesystem::path& path )
+	{
+		ZoneScoped;
+		std::array< char, v1::MAGIC.size() > magic {};
+		std::ifstream ifs { path, std::ios::binary };
+		ifs.read( magic.data(), magic.size() );
+
+		//v0 packages are an LZ4 frame. Those never start with the v1 magic
+		if ( v1::isPackage( { magic.data(), static_cast< std::size_t >( ifs.gcount() ) } ) )
+			return v1::processFile( path );
+
+		return v0::processFile( path );
+	}
+} // namespace remote::parsers
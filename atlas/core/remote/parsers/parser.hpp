@@ -5,11 +5,25 @@
 #ifndef ATLASGAMEMANAGER_PARSER_HPP
 #define ATLASGAMEMANAGER_PARSER_HPP
 
-#include <QJsonObject>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "CatalogWriter.hpp"
+
+class ProgressMessageSignaler;
+
+namespace catalog
+{
+	class Shadow;
+}
 
 namespace remote::parsers
 {
 
+	//! Highest `min_ver` of a JSON (v0) package we understand. Binary packages have their own version, see v1::FORMAT_VERSION
 	//This is clearly used. Yet gcc thinks it is not
 #ifdef __GNUC__
 #pragma GCC diagnostic push
@@ -20,10 +34,54 @@ namespace remote::parsers
 	constexpr std::uint64_t MAX_REMOTE_VERSION { 0 };
 #endif
 
+	//! Receives compressed package data as it becomes available
+	using PackageFeed = std::function< void( const std::span< const char > ) >;
+	//! Pushes an entire compressed package into the feed. Returning means the package has ended
+	using PackageSource = std::function< void( const PackageFeed& ) >;
+
 	namespace v0
 	{
-		void processJson( const QJsonObject& json );
-	}
+		//! Streams the update package at `path` into the database inside of a single transaction
+		/**
+		 * @return Number of rows inserted, updated and skipped because they were unchanged
+		 */
+		CatalogWriter::Stats processFile( const std::filesystem::path& path );
+
+		//! Same as `processFile` but the compressed package is pulled from `source`. The package is never fully in memory
+		/**
+		 * @param compressed_size Used for progress only. Zero if unknown
+		 */
+		CatalogWriter::Stats processPackage(
+			const PackageSource& source, const std::size_t compressed_size, ProgressMessageSignaler& signaler );
+
+		//! Applies several packages at once inside of a single transaction.
+		/**
+		 * Rows are folded by primary key first, with later packages winning, so each catalog row is written at most once.
+		 * The end result is the same as calling `processFile` on each path in order. v1 packages may be mixed in.
+		 * @param paths Packages in the order they would have been applied
+		 */
+		CatalogWriter::Stats
+			processFiles( const std::vector< std::filesystem::path >& paths, ProgressMessageSignaler& signaler );
+
+		//! Same as `processFiles` but the rows are written into `shadow` instead of the live catalog
+		CatalogWriter::Stats processFiles(
+			const std::vector< std::filesystem::path >& paths, ProgressMessageSignaler& signaler, catalog::Shadow& shadow );
+	} // namespace v0
+
+	namespace v1
+	{
+		//! Hands every row of the v1 package in `data` to the callbacks. All atlas rows come before any f95 rows
+		void readRows(
+			const std::span< const char > data,
+			const std::function< void( AtlasRow&& ) >& atlas_row,
+			const std::function< void( F95Row&& ) >& f95_row );
+
+		//! Applies the v1 package at `path` inside of a single transaction. The file is memory mapped
+		CatalogWriter::Stats processFile( const std::filesystem::path& path );
+	} // namespace v1
+
+	//! Applies the package at `path` with whichever parser understands it
+	CatalogWriter::Stats processFile( const std::filesystem::path& path );
 } // namespace remote::parsers
 
 #endif //ATLASGAMEMANAGER_PARSER_HPP
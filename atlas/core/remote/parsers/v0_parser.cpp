@@ -2,239 +2,358 @@
 // Created by kj16609 on 6/28/23.
 //
 
-#include <QJsonArray>
+#include <QFuture>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
 
+#include <deque>
+#include <map>
+
+#include "CatalogWriter.hpp"
+#include "JsonRowReader.hpp"
+#include "core/database/Catalog.hpp"
 #include "core/database/Transaction.hpp"
+#include "core/remote/extract.hpp"
 #include "core/remote/parsers/parser.hpp"
+#include "core/utils/MappedFile.hpp"
 #include "ui/notifications/ProgressMessage.hpp"
+#include "v1_format.hpp"
 
 namespace remote::parsers::v0
 {
-	enum DataSet
+	struct UnsupportedVersion : public std::runtime_error
+	{
+		UnsupportedVersion( const std::uint64_t version ) :
+		  std::runtime_error( fmt::format(
+			  "Failed to parse update file! Version was {}. Our max is {}", version, MAX_REMOTE_VERSION ) )
+		{}
+	};
+
+	//! Rows parsed from a single batch. Only the vector for the batch's set is filled
+	struct RowBatch
 	{
-		SetAtlas,
-		SetF95,
-		InvalidSet
+		std::vector< AtlasRow > atlas {};
+		std::vector< F95Row > f95 {};
+		//! Set if parsing failed. Rethrown by the writer
+		std::exception_ptr error {};
 	};
 
-	DataSet nameToSet( const QString str )
+	RowBatch parseBatch( const DataSet set, const std::string& text, const std::size_t row_count )
 	{
-		if ( str == "atlas" ) return SetAtlas;
-		if ( str == "f95_zone" ) return SetF95;
+		ZoneScoped;
+		RowBatch batch {};
+		try
+		{
+			if ( set == SetAtlas )
+				batch.atlas.reserve( row_count );
+			else
+				batch.f95.reserve( row_count );
+
+			JsonRowReader reader { { [ &batch ]( AtlasRow&& row ) { batch.atlas.emplace_back( std::move( row ) ); },
+				                     [ &batch ]( F95Row&& row ) { batch.f95.emplace_back( std::move( row ) ); } },
+				                   set };
+			reader.feed( text.data(), text.size() );
+			reader.finish();
+
+			//Key checks happen here so the writer only has to write
+			for ( const auto& row : batch.atlas )
+				if ( !row.hasKey() ) throw std::runtime_error( "atlas_data did not contain it's pkey!" );
+			for ( const auto& row : batch.f95 )
+				if ( !row.hasKey() ) throw std::runtime_error( "f95_zone_data did not contain it's pkey!" );
+		}
+		catch ( ... )
+		{
+			batch.error = std::current_exception();
+		}
 
-		return InvalidSet;
+		return batch;
 	}
 
-#define KEY_CHECK( key )                                                                                               \
-	if ( !obj.contains( key ) ) return false;
-
-	bool validateAtlasKeys( const QJsonObject& obj )
-	{
-		KEY_CHECK( "atlas_id" )
-		KEY_CHECK( "id_name" )
-		KEY_CHECK( "short_name" )
-		KEY_CHECK( "title" )
-		KEY_CHECK( "original_name" )
-		KEY_CHECK( "category" )
-		KEY_CHECK( "engine" )
-		KEY_CHECK( "status" )
-		KEY_CHECK( "version" )
-		KEY_CHECK( "developer" )
-		KEY_CHECK( "creator" )
-		KEY_CHECK( "overview" )
-		KEY_CHECK( "censored" )
-		KEY_CHECK( "language" )
-		KEY_CHECK( "translations" )
-		KEY_CHECK( "genre" )
-		KEY_CHECK( "tags" )
-		KEY_CHECK( "voice" )
-		KEY_CHECK( "os" )
-		KEY_CHECK( "release_date" )
-		KEY_CHECK( "length" )
-		KEY_CHECK( "banner" )
-		KEY_CHECK( "banner_wide" )
-		KEY_CHECK( "cover" )
-		KEY_CHECK( "logo" )
-		KEY_CHECK( "wallpaper" )
-		KEY_CHECK( "previews" )
-		KEY_CHECK( "last_db_update" )
-
-		return true;
+	void applyBatch( const RowBatch& batch, CatalogWriter& writer )
+	{
+		ZoneScoped;
+		if ( batch.error ) std::rethrow_exception( batch.error );
+
+		for ( const auto& row : batch.atlas ) writer.apply( row );
+		for ( const auto& row : batch.f95 ) writer.apply( row );
 	}
 
-	void updateAtlasData( const QJsonObject& obj, Transaction& trans )
+	//! Decompresses and parses a package, handing each batch of rows to `consume` in the order they appear
+	/**
+	 * Throws UnsupportedVersion if the package is newer then we understand.
+	 */
+	void readPackage(
+		const PackageSource& source,
+		const std::size_t compressed_size,
+		ProgressMessageSignaler& signaler,
+		const std::function< void( RowBatch&& ) >& consume )
 	{
-		const auto keys { obj.keys() };
+		ZoneScoped;
+		//Progress is tracked in KiB of compressed data read
+		signaler.setMax( static_cast< std::int64_t >( compressed_size / 1024 ) );
 
-		if ( !obj.contains( "atlas_id" ) ) throw std::runtime_error( "Atlas data did not contain it's pkey!" );
+		//Workers convert batches of rows while this thread decompresses and writes.
+		QThreadPool parse_pool {};
+		parse_pool.setMaxThreadCount( std::max( QThread::idealThreadCount() - 1, 1 ) );
 
-		const auto pkey { obj[ "atlas_id" ].toInteger() };
+		//Bounds the number of batches parsed (or waiting to be written) at once. Once full we write before reading more.
+		const auto max_in_flight { static_cast< std::size_t >( parse_pool.maxThreadCount() ) * 2 };
+		std::deque< QFuture< RowBatch > > in_flight {};
+		std::size_t rows_read { 0 };
 
-		for ( const auto& key : keys )
+		const auto consumeNext = [ &in_flight, &consume, &rows_read ]()
 		{
-			const auto& data { obj[ key ] };
-			if ( data.isString() )
-				trans << fmt::format( "UPDATE atlas_data SET {} = ? WHERE atlas_id = ?", key ) << data.toString()
-					  << pkey;
-			else if ( data.isDouble() )
-				trans << fmt::format( "UPDATE atlas_data SET {} = ? WHERE atlas_id = ?", key ) << data.toInteger()
-					  << pkey;
-			else
-				throw std::runtime_error( "Unexpected type when parsing atlas data!" );
-		}
-	}
+			RowBatch batch { in_flight.front().takeResult() };
+			in_flight.pop_front();
+
+			rows_read += batch.atlas.size() + batch.f95.size();
+			consume( std::move( batch ) );
+		};
+
+		try
+		{
+			std::optional< std::uint64_t > version { std::nullopt };
+
+			JsonRowReader reader { { {},
+				                     {},
+				                     [ &version ]( const std::string_view key, const FieldValue& value )
+				                     {
+										 if ( key != "min_ver" ) return;
+										 const auto* ver { std::get_if< std::int64_t >( &value ) };
+										 if ( ver == nullptr ) throw std::runtime_error( "min_ver was not a number" );
+
+										 version = static_cast< std::uint64_t >( *ver );
+										 if ( version > MAX_REMOTE_VERSION ) throw UnsupportedVersion( *version );
+									 },
+				                     [ &in_flight, &parse_pool, &consumeNext, max_in_flight ](
+					                     const DataSet set, std::string&& text, const std::size_t row_count )
+				                     {
+										 in_flight.emplace_back( QtConcurrent::run(
+											 &parse_pool,
+											 [ set, text = std::move( text ), row_count ]()
+											 { return parseBatch( set, text, row_count ); } ) );
+
+										 while ( in_flight.size() > max_in_flight ) consumeNext();
+									 } } };
+
+			atlas::FrameDecompressor decompressor { [ &reader ]( const char* data, const std::size_t size )
+				                                    { reader.feed( data, size ); } };
+
+			std::size_t consumed { 0 };
+			source(
+				[ & ]( const std::span< const char > data )
+				{
+					decompressor.feed( data.data(), data.size() );
+
+					consumed += data.size();
+					signaler.setProgress( static_cast< std::int64_t >( consumed / 1024 ) );
+					signaler.setMessage( QString( "%1 rows" ).arg( rows_read ) );
+				} );
 
-	void insertAtlasData( const QJsonObject& obj, Transaction& trans )
-	{
-		constexpr std::string_view query { "INSERT INTO atlas_data ("
-			                               "atlas_id, id_name, short_name, title, original_name, category, "
-			                               "engine, status, version, developer, creator, overview, censored, "
-			                               "language, translations, genre, tags, voice, os, release_date, length, "
-			                               "banner, banner_wide, cover, logo, wallpaper, previews, last_db_update) "
-			                               "VALUES (?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)" };
-
-		trans << query << obj[ "atlas_id" ].toInteger() << obj[ "id_name" ].toString() << obj[ "short_name" ].toString()
-			  << obj[ "title" ].toString() << obj[ "original_name" ].toString() << obj[ "category" ].toString()
-			  << obj[ "engine" ].toString() << obj[ "status" ].toString() << obj[ "version" ].toString()
-			  << obj[ "developer" ].toString() << obj[ "creator" ].toString() << obj[ "overview" ].toString()
-			  << obj[ "censored" ].toString() << obj[ "language" ].toString() << obj[ "translations" ].toString()
-			  << obj[ "genre" ].toString() << obj[ "tags" ].toString() << obj[ "voice" ].toString()
-			  << obj[ "os" ].toString() << obj[ "release_date" ].toInteger() << obj[ "length" ].toString()
-			  << obj[ "banner" ].toString() << obj[ "banner_wide" ].toString() << obj[ "cover" ].toString()
-			  << obj[ "logo" ].toString() << obj[ "wallpaper" ].toString() << obj[ "previews" ].toString()
-			  << obj[ "last_db_update" ].toInteger();
+			if ( !decompressor.finished() ) throw std::runtime_error( "Compressed data ended unexpectedly" );
+			reader.finish();
+
+			while ( !in_flight.empty() ) consumeNext();
+
+			if ( !version.has_value() )
+			{
+				spdlog::error( "Failed to parse update file. Missing min_ver" );
+				throw std::runtime_error( "Failed to parse update file. Missing min_ver" );
+			}
+
+			signaler.setMax( static_cast< std::int64_t >( consumed / 1024 ) );
+			signaler.setProgress( static_cast< std::int64_t >( consumed / 1024 ) );
+		}
+		catch ( ... )
+		{
+			parse_pool.waitForDone();
+			std::rethrow_exception( std::current_exception() );
+		}
 	}
 
-	void parseAtlasArray( const QJsonArray& data, Transaction& trans )
+	PackageSource mappedSource( const MappedFile& file )
 	{
-		auto signaler { createNotification< ProgressMessage >( QString( "Processing update for Atlas data" ), true ) };
-		const int max { static_cast< int >( data.size() - 1 ) };
-		signaler->setMax( max );
-		int counter { 0 };
-		for ( const auto& obj_data : data )
+		return [ &file ]( const PackageFeed& feed )
 		{
-			const auto& obj { obj_data.toObject() };
+			const auto data { file.data() };
 
-			if ( !validateAtlasKeys( obj ) )
-				updateAtlasData( obj, trans ); //This is probably an update
-			else
-				insertAtlasData( obj, trans );
-			++counter;
-			signaler->setProgress( counter );
-			signaler->setMessage( QString( "%1/%2" ).arg( counter ).arg( max ) );
-		}
+			//Fed in slices so we can report progress
+			constexpr std::size_t slice_size { 1 << 20 };
+			for ( std::size_t offset = 0; offset < data.size(); offset += slice_size )
+				feed( data.subspan( offset, std::min( slice_size, data.size() - offset ) ) );
+		};
 	}
 
-	bool validateF95Keys( const QJsonObject& obj )
-	{
-		KEY_CHECK( "f95_id" )
-		KEY_CHECK( "atlas_id" )
-		KEY_CHECK( "banner_url" )
-		KEY_CHECK( "site_url" )
-		KEY_CHECK( "last_thread_comment" )
-		KEY_CHECK( "thread_publish_date" )
-		KEY_CHECK( "views" )
-		KEY_CHECK( "likes" )
-		KEY_CHECK( "tags" )
-		KEY_CHECK( "rating" )
-		KEY_CHECK( "rating" )
-		KEY_CHECK( "screens" )
-		KEY_CHECK( "replies" )
-
-		return true;
+	void reportStats( ProgressMessageSignaler& signaler, const CatalogWriter::Stats& stats )
+	{
+		signaler.setMessage( QString( "%1 inserted, %2 updated, %3 unchanged" )
+		                         .arg( stats.inserted )
+		                         .arg( stats.updated )
+		                         .arg( stats.skipped ) );
+		spdlog::info(
+			"Processed {} rows: {} inserted, {} updated, {} unchanged",
+			stats.inserted + stats.updated + stats.skipped,
+			stats.inserted,
+			stats.updated,
+			stats.skipped );
 	}
 
-	void updateF95Data( const QJsonObject& obj, Transaction& trans )
+	CatalogWriter::Stats processFile( const std::filesystem::path& path )
 	{
-		const auto keys { obj.keys() };
+		ZoneScoped;
+		auto signaler { createNotification< ProgressMessage >(
+			QString( "Processing update %1" ).arg( QString::fromStdString( path.stem().string() ) ), true ) };
+
+		const MappedFile file { path };
 
-		if ( !obj.contains( "f95_id" ) ) throw std::runtime_error( "F95 data did not contain it's pkey!" );
+		return processPackage( mappedSource( file ), file.size(), *signaler );
+	}
 
-		const auto pkey { obj[ "f95_id" ].toInteger() };
+	CatalogWriter::Stats
+		processPackage( const PackageSource& source, const std::size_t compressed_size, ProgressMessageSignaler& signaler )
+	{
+		ZoneScoped;
+		Transaction transaction {};
 
-		for ( const auto& key : keys )
+		try
 		{
-			const auto& data { obj[ key ] };
-			if ( data.isString() )
-				trans << fmt::format( "UPDATE f95_zone_data SET {} = ? WHERE f95_id = ?", key ) << data.toString()
-					  << pkey;
-			else if ( data.isDouble() )
-				trans << fmt::format( "UPDATE f95_zone_data SET {} = ? WHERE f95_id = ?", key ) << data.toInteger()
-					  << pkey;
-			else
-				throw std::runtime_error( "Unexpected type when parsing f95zone data!" );
+			CatalogWriter writer {};
+			readPackage(
+				source, compressed_size, signaler, [ &writer ]( RowBatch&& batch ) { applyBatch( batch, writer ); } );
+
+			transaction.commit();
+
+			reportStats( signaler, writer.stats() );
+			return writer.stats();
+		}
+		catch ( const UnsupportedVersion& e )
+		{
+			transaction.abort();
+			spdlog::error( "{}", e.what() );
+			return {};
+		}
+		catch ( ... )
+		{
+			transaction.abort();
+			std::rethrow_exception( std::current_exception() );
 		}
 	}
 
-	void insertF95Data( const QJsonObject& obj, Transaction& trans )
+	template < DataSet set >
+	struct FoldedRow
 	{
-		constexpr std::string_view query {
-			"INSERT INTO f95_zone_data (f95_id, atlas_id, banner_url, site_url, last_thread_comment, thread_publish_date, last_record_update, views, likes, tags, rating, screens, replies) VALUES (?,?,?,?,?,?,?,?,?,?,?,?,?)"
-		};
+		CatalogRow< set > row;
+		//! One of the rows folded into it was full. Partial rows alone never insert, even if they add up to a full row
+		bool from_full;
+	};
+
+	//! One row per primary key. Ordered so they are written in key order
+	template < DataSet set >
+	using FoldedRows = std::map< std::int64_t, FoldedRow< set > >;
 
-		trans << query << obj[ "f95_id" ].toInteger() << obj[ "atlas_id" ].toInteger() << obj[ "banner_url" ].toString()
-			  << obj[ "site_url" ].toString() << obj[ "last_thread_comment" ].toInteger()
-			  << obj[ "thread_publish_date" ].toInteger() << obj[ "last_record_update" ].toInteger()
-			  << obj[ "views" ].toInteger() << obj[ "likes" ].toInteger() << obj[ "tags" ].toString()
-			  << obj[ "rating" ].toDouble() << obj[ "screens" ].toString() << obj[ "replies" ].toInteger();
+	//! Merges `row` into `rows`. Columns present in `row` replace what is already there, as applying them in order would
+	template < DataSet set >
+	void foldRow( FoldedRows< set >& rows, CatalogRow< set >&& row, const bool from_full )
+	{
+		const auto key { row.key() };
+		const auto [ itter, inserted ] = rows.try_emplace( key, std::move( row ), from_full );
+		if ( inserted ) return;
+
+		auto& existing { itter->second };
+		existing.from_full = existing.from_full || from_full;
+		for ( std::size_t i = 0; i < CatalogRow< set >::column_count; ++i )
+			if ( row.has( i ) ) existing.row.set( i, std::move( row.values[ i ] ) );
 	}
 
-	void parseF95Array( const QJsonArray& data, Transaction& trans )
+	template < DataSet set >
+	void foldRow( FoldedRows< set >& rows, CatalogRow< set >&& row )
 	{
-		auto signaler { createNotification< ProgressMessage >( QString( "Processing update for F95 data" ), true ) };
-		const int max { static_cast< int >( data.size() - 1 ) };
-		signaler->setMax( max );
-		int counter { 0 };
-		for ( const auto& obj_data : data )
-		{
-			const auto& obj { obj_data.toObject() };
+		const bool full { row.isFull() };
+		foldRow( rows, std::move( row ), full );
+	}
 
-			if ( !validateF95Keys( obj ) )
-				updateF95Data( obj, trans );
-			else
-				insertF95Data( obj, trans );
+	//! Every row of `paths` folded by primary key
+	struct FoldedPackages
+	{
+		FoldedRows< SetAtlas > atlas {};
+		FoldedRows< SetF95 > f95 {};
+
+		std::size_t size() const { return atlas.size() + f95.size(); }
 
-			++counter;
-			signaler->setProgress( counter );
-			signaler->setMessage( QString( "%1/%2" ).arg( counter ).arg( max ) );
+		void write( CatalogWriter& writer ) const
+		{
+			ZoneScoped;
+			for ( const auto& [ key, folded ] : atlas ) writer.apply( folded.row, folded.from_full );
+			for ( const auto& [ key, folded ] : f95 ) writer.apply( folded.row, folded.from_full );
 		}
-	}
+	};
 
-	void processJson( const QJsonObject& json )
+	FoldedPackages foldFiles( const std::vector< std::filesystem::path >& paths, ProgressMessageSignaler& signaler )
 	{
-		Transaction transaction {};
-		try
+		ZoneScoped;
+		FoldedPackages folded {};
+
+		for ( const auto& path : paths )
 		{
-			const auto keys { json.keys() };
-			for ( const auto& table_key : keys )
-			{
-				if ( table_key == "min_ver" ) continue;
+			//Folded separately first so a package we can't read contributes nothing
+			FoldedRows< SetAtlas > package_atlas {};
+			FoldedRows< SetF95 > package_f95 {};
 
-				const auto set { nameToSet( table_key ) };
-				if ( set == InvalidSet )
+			try
+			{
+				const MappedFile file { path };
+				if ( v1::isPackage( file.data() ) )
 				{
-					throw std::runtime_error( fmt::format( "Unexpected data in set! Key = {}", table_key ) );
+					v1::readRows(
+						file.data(),
+						[ &package_atlas ]( AtlasRow&& row ) { foldRow( package_atlas, std::move( row ) ); },
+						[ &package_f95 ]( F95Row&& row ) { foldRow( package_f95, std::move( row ) ); } );
 				}
+				else
+					readPackage(
+						mappedSource( file ),
+						file.size(),
+						signaler,
+						[ &package_atlas, &package_f95 ]( RowBatch&& batch )
+						{
+							if ( batch.error ) std::rethrow_exception( batch.error );
+
+							for ( auto& row : batch.atlas ) foldRow( package_atlas, std::move( row ) );
+							for ( auto& row : batch.f95 ) foldRow( package_f95, std::move( row ) );
+						} );
+			}
+			catch ( const UnsupportedVersion& e )
+			{
+				//Same as processFile. The package is skipped
+				spdlog::error( "{}: {}", path, e.what() );
+				continue;
+			}
+
+			for ( auto& [ key, row ] : package_atlas ) foldRow( folded.atlas, std::move( row.row ), row.from_full );
+			for ( auto& [ key, row ] : package_f95 ) foldRow( folded.f95, std::move( row.row ), row.from_full );
+		}
 
-				ZoneScopedN( "Process set" );
-				const auto& key_str { table_key.toStdString() };
-				TracyMessage( key_str.c_str(), key_str.size() );
-				const QJsonArray& data = json[ table_key ].toArray();
+		signaler.setMessage( QString( "Writing %1 rows" ).arg( folded.size() ) );
+		return folded;
+	}
 
-				switch ( set )
-				{
-					case SetAtlas:
-						parseAtlasArray( data, transaction );
-						break;
-					case SetF95:
-						parseF95Array( data, transaction );
-						break;
-					default:
-						throw std::runtime_error( "Unexpected set!" );
-				}
-			}
+	CatalogWriter::Stats
+		processFiles( const std::vector< std::filesystem::path >& paths, ProgressMessageSignaler& signaler )
+	{
+		ZoneScoped;
+		const auto folded { foldFiles( paths, signaler ) };
+
+		Transaction transaction {};
+		try
+		{
+			CatalogWriter writer {};
+			folded.write( writer );
 
 			transaction.commit();
+
+			reportStats( signaler, writer.stats() );
+			return writer.stats();
 		}
 		catch ( ... )
 		{
@@ -243,4 +362,23 @@ namespace remote::parsers::v0
 		}
 	}
 
-} // namespace remote::parsers::v0
\ No newline at end of file
+	CatalogWriter::Stats processFiles(
+		const std::vector< std::filesystem::path >& paths, ProgressMessageSignaler& signaler, catalog::Shadow& shadow )
+	{
+		ZoneScoped;
+		const auto folded { foldFiles( paths, signaler ) };
+
+		CatalogWriter::Stats stats {};
+		shadow.write(
+			[ &folded, &stats ]( sqlite3& db )
+			{
+				CatalogWriter writer { db };
+				folded.write( writer );
+				stats = writer.stats();
+			} );
+
+		reportStats( signaler, stats );
+		return stats;
+	}
+
+} // namespace remote::parsers::v0
@@ -0,0 +1,89 @@
+//
+// Created by kj16609 on 7/24/23.
+//
+
+#ifndef ATLASGAMEMANAGER_V1_FORMAT_HPP
+#define ATLASGAMEMANAGER_V1_FORMAT_HPP
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+
+/**
+ * @page V1Packages v1 update packages
+ *
+ * Binary, column oriented catalog packages. All integers are little endian.
+ *
+ * @code
+ * Header    magic "ATC1" | u32 format version | u32 section count
+ * Section   u8 data set | u32 row count | u32 column count | Column...
+ * Column    u8 name length | name | u8 encoding | u64 block size | block (LZ4 frame, content size set)
+ * @endcode
+ *
+ * Every decompressed block starts with two bitmaps of `(rows + 7) / 8` bytes. The first marks rows the column is
+ * present in, the second marks present rows that are `null`. The values follow, one per row (absent rows included):
+ * |Encoding	| Values |
+ * |-----------|--------|
+ * | Integer	| i64 per row |
+ * | Real		| f64 per row |
+ * | TextDict	| u32 entry count, u32 offsets[count + 1], string bytes, u32 entry index per row |
+ * | TextPlain	| u32 offsets[rows + 1], string bytes |
+ * | Mixed		| u8 FieldValue index per row, then per row: i64, f64 or u32 length + bytes (Nothing for null) |
+ */
+
+namespace remote::parsers::v1
+{
+	static_assert( std::endian::native == std::endian::little, "v1 packages are read in place as little endian" );
+
+	inline constexpr std::array< char, 4 > MAGIC { 'A', 'T', 'C', '1' };
+	inline constexpr std::uint32_t FORMAT_VERSION { 1 };
+
+	enum class Encoding : std::uint8_t
+	{
+		Integer,
+		Real,
+		TextDict,
+		TextPlain,
+		Mixed
+	};
+
+	inline bool isPackage( const std::span< const char > data )
+	{
+		return data.size() >= MAGIC.size() && std::memcmp( data.data(), MAGIC.data(), MAGIC.size() ) == 0;
+	}
+
+	//! Bounds checked reads from a package or block
+	class Cursor
+	{
+		std::span< const char > m_data;
+		std::size_t m_pos { 0 };
+
+	  public:
+
+		Cursor( const std::span< const char > data ) : m_data( data ) {}
+
+		std::span< const char > take( const std::size_t size )
+		{
+			if ( size > m_data.size() - m_pos ) throw std::runtime_error( "v1 package ended unexpectedly" );
+			const auto span { m_data.subspan( m_pos, size ) };
+			m_pos += size;
+			return span;
+		}
+
+		template < typename T >
+			requires std::is_trivially_copyable_v< T >
+		T read()
+		{
+			T t {};
+			std::memcpy( &t, take( sizeof( T ) ).data(), sizeof( T ) );
+			return t;
+		}
+
+		bool atEnd() const { return m_pos == m_data.size(); }
+	};
+} // namespace remote::parsers::v1
+
+#endif //ATLASGAMEMANAGER_V1_FORMAT_HPP
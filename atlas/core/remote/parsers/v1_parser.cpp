@@ -0,0 +1,326 @@
+//
+// Created by kj16609 on 7/24/23.
+//
+
+#include <QFuture>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent>
+
+#include "CatalogWriter.hpp"
+#include "core/database/Transaction.hpp"
+#include "core/remote/extract.hpp"
+#include "core/remote/parsers/parser.hpp"
+#include "core/utils/MappedFile.hpp"
+#include "ui/notifications/ProgressMessage.hpp"
+#include "v1_format.hpp"
+
+namespace remote::parsers::v1
+{
+	namespace
+	{
+		struct ColumnBlock
+		{
+			std::string_view name;
+			Encoding encoding;
+			std::span< const char > compressed;
+		};
+
+		struct Section
+		{
+			DataSet set;
+			std::uint32_t row_count;
+			std::vector< ColumnBlock > columns {};
+		};
+
+		//! Walks the package without decompressing anything
+		std::vector< Section > readLayout( const std::span< const char > data )
+		{
+			ZoneScoped;
+			if ( !isPackage( data ) ) throw std::runtime_error( "Not a v1 package" );
+
+			Cursor cursor { data };
+			cursor.take( MAGIC.size() );
+
+			if ( const auto version = cursor.read< std::uint32_t >(); version != FORMAT_VERSION )
+				throw std::runtime_error( fmt::format( "Unsupported v1 package version {}", version ) );
+
+			std::vector< Section > sections( cursor.read< std::uint32_t >() );
+			for ( auto& section : sections )
+			{
+				section.set = static_cast< DataSet >( cursor.read< std::uint8_t >() );
+				if ( section.set != SetAtlas && section.set != SetF95 )
+					throw std::runtime_error( "v1 package contains an unknown data set" );
+
+				section.row_count = cursor.read< std::uint32_t >();
+				section.columns.resize( cursor.read< std::uint32_t >() );
+
+				for ( auto& column : section.columns )
+				{
+					const auto name { cursor.take( cursor.read< std::uint8_t >() ) };
+					column.name = { name.data(), name.size() };
+					column.encoding = static_cast< Encoding >( cursor.read< std::uint8_t >() );
+					column.compressed = cursor.take( static_cast< std::size_t >( cursor.read< std::uint64_t >() ) );
+				}
+			}
+
+			if ( !cursor.atEnd() ) throw std::runtime_error( "Trailing data after v1 package" );
+
+			return sections;
+		}
+
+		bool bit( const std::span< const char > bitmap, const std::size_t idx )
+		{
+			return ( static_cast< unsigned char >( bitmap[ idx / 8 ] ) >> ( idx % 8 ) ) & 1u;
+		}
+
+		template < typename T >
+		T at( const std::span< const char > values, const std::size_t idx )
+		{
+			T t {};
+			std::memcpy( &t, values.data() + idx * sizeof( T ), sizeof( T ) );
+			return t;
+		}
+
+		//! Reads `count + 1` string offsets followed by the string bytes they index
+		struct StringTable
+		{
+			std::span< const char > offsets;
+			std::span< const char > bytes;
+
+			StringTable( Cursor& cursor, const std::size_t count ) :
+			  offsets( cursor.take( ( count + 1 ) * sizeof( std::uint32_t ) ) ),
+			  bytes( cursor.take( at< std::uint32_t >( offsets, count ) ) )
+			{}
+
+			std::string get( const std::size_t idx ) const
+			{
+				const auto begin { at< std::uint32_t >( offsets, idx ) };
+				const auto end { at< std::uint32_t >( offsets, idx + 1 ) };
+				if ( begin > end || end > bytes.size() ) throw std::runtime_error( "v1 string table is corrupt" );
+				return { bytes.data() + begin, end - begin };
+			}
+		};
+
+		template < DataSet set >
+		void decodeColumn(
+			std::vector< CatalogRow< set > >& rows,
+			const std::size_t column,
+			const Encoding encoding,
+			const std::span< const char > block )
+		{
+			ZoneScoped;
+			const std::size_t row_count { rows.size() };
+			Cursor cursor { block };
+			const auto present { cursor.take( ( row_count + 7 ) / 8 ) };
+			const auto nulls { cursor.take( ( row_count + 7 ) / 8 ) };
+
+			//Calls `get(row)` for every row the column has a non null value in
+			const auto fill = [ & ]( const auto& get )
+			{
+				for ( std::size_t r = 0; r < row_count; ++r )
+				{
+					if ( !bit( present, r ) ) continue;
+					if ( bit( nulls, r ) )
+						rows[ r ].set( column, std::monostate() );
+					else
+						rows[ r ].set( column, get( r ) );
+				}
+			};
+
+			switch ( encoding )
+			{
+				case Encoding::Integer:
+					{
+						const auto values { cursor.take( row_count * sizeof( std::int64_t ) ) };
+						fill( [ &values ]( const std::size_t r ) { return at< std::int64_t >( values, r ); } );
+						break;
+					}
+				case Encoding::Real:
+					{
+						const auto values { cursor.take( row_count * sizeof( double ) ) };
+						fill( [ &values ]( const std::size_t r ) { return at< double >( values, r ); } );
+						break;
+					}
+				case Encoding::TextDict:
+					{
+						const auto entry_count { cursor.read< std::uint32_t >() };
+						const StringTable table { cursor, entry_count };
+						const auto indices { cursor.take( row_count * sizeof( std::uint32_t ) ) };
+
+						//Decoded once. Rows get copies
+						std::vector< std::string > entries( entry_count );
+						for ( std::size_t i = 0; i < entry_count; ++i ) entries[ i ] = table.get( i );
+
+						fill(
+							[ &indices, &entries ]( const std::size_t r )
+							{
+								const auto idx { at< std::uint32_t >( indices, r ) };
+								if ( idx >= entries.size() ) throw std::runtime_error( "v1 dictionary index out of range" );
+								return entries[ idx ];
+							} );
+						break;
+					}
+				case Encoding::TextPlain:
+					{
+						const StringTable table { cursor, row_count };
+						fill( [ &table ]( const std::size_t r ) { return table.get( r ); } );
+						break;
+					}
+				case Encoding::Mixed:
+					{
+						const auto tags { cursor.take( row_count ) };
+						for ( std::size_t r = 0; r < row_count; ++r )
+						{
+							if ( !bit( present, r ) ) continue;
+							switch ( static_cast< std::uint8_t >( tags[ r ] ) )
+							{
+								case 0:
+									rows[ r ].set( column, std::monostate() );
+									break;
+								case 1:
+									rows[ r ].set( column, cursor.read< std::int64_t >() );
+									break;
+								case 2:
+									rows[ r ].set( column, cursor.read< double >() );
+									break;
+								case 3:
+									{
+										const auto str { cursor.take( cursor.read< std::uint32_t >() ) };
+										rows[ r ].set( column, std::string( str.data(), str.size() ) );
+										break;
+									}
+								default:
+									throw std::runtime_error( "v1 mixed column has an unknown type" );
+							}
+						}
+						break;
+					}
+				default:
+					throw std::runtime_error(
+						fmt::format( "v1 column has unknown encoding {}", static_cast< int >( encoding ) ) );
+			}
+		}
+
+		template < DataSet set >
+		void readSection(
+			const Section& section, QThreadPool& pool, const std::function< void( CatalogRow< set >&& ) >& callback )
+		{
+			ZoneScoped;
+			//Decompression is the expensive part. It's done for every column at once while the rows are assembled in order.
+			std::vector< std::pair< std::optional< std::size_t >, QFuture< std::vector< char > > > > blocks {};
+			for ( const auto& column : section.columns )
+			{
+				//Columns we don't know about are skipped without being decompressed
+				const auto idx { CatalogRow< set >::columnIndex( column.name ) };
+				if ( !idx.has_value() ) continue;
+
+				blocks.emplace_back(
+					idx,
+					QtConcurrent::run(
+						&pool,
+						[ compressed = column.compressed ]()
+						{
+							std::vector< char > block {};
+							atlas::decompress( compressed, block );
+							return block;
+						} ) );
+			}
+
+			std::vector< CatalogRow< set > > rows( section.row_count );
+			std::size_t block_idx { 0 };
+			for ( const auto& column : section.columns )
+			{
+				if ( !CatalogRow< set >::columnIndex( column.name ).has_value() ) continue;
+
+				auto& [ idx, future ] = blocks[ block_idx++ ];
+				decodeColumn( rows, *idx, column.encoding, future.takeResult() );
+			}
+
+			for ( auto& row : rows )
+			{
+				if ( !row.hasKey() )
+					throw std::runtime_error(
+						fmt::format( "{} did not contain it's pkey!", SetInfo< set >::table_name ) );
+				callback( std::move( row ) );
+			}
+		}
+	} // namespace
+
+	void readRows(
+		const std::span< const char > data,
+		const std::function< void( AtlasRow&& ) >& atlas_row,
+		const std::function< void( F95Row&& ) >& f95_row )
+	{
+		ZoneScoped;
+		const auto sections { readLayout( data ) };
+
+		QThreadPool pool {};
+		pool.setMaxThreadCount( QThread::idealThreadCount() );
+
+		try
+		{
+			for ( const auto& section : sections )
+			{
+				if ( section.set == SetAtlas )
+					readSection< SetAtlas >( section, pool, atlas_row );
+				else
+					readSection< SetF95 >( section, pool, f95_row );
+			}
+		}
+		catch ( ... )
+		{
+			pool.waitForDone();
+			std::rethrow_exception( std::current_exception() );
+		}
+	}
+
+	CatalogWriter::Stats processFile( const std::filesystem::path& path )
+	{
+		ZoneScoped;
+		auto signaler { createNotification< ProgressMessage >(
+			QString( "Processing update %1" ).arg( QString::fromStdString( path.stem().string() ) ), true ) };
+
+		const MappedFile file { path };
+
+		Transaction transaction {};
+		try
+		{
+			CatalogWriter writer {};
+			readRows(
+				file.data(),
+				[ &writer, &signaler ]( AtlasRow&& row )
+				{
+					writer.apply( row );
+					signaler->addProgress();
+				},
+				[ &writer, &signaler ]( F95Row&& row )
+				{
+					writer.apply( row );
+					signaler->addProgress();
+				} );
+
+			transaction.commit();
+
+			const auto& stats { writer.stats() };
+			signaler->setMessage( QString( "%1 inserted, %2 updated, %3 unchanged" )
+			                          .arg( stats.inserted )
+			                          .arg( stats.updated )
+			                          .arg( stats.skipped ) );
+			spdlog::info(
+				"Processed {}: {} inserted, {} updated, {} unchanged",
+				path,
+				stats.inserted,
+				stats.updated,
+				stats.skipped );
+
+			return stats;
+		}
+		catch ( ... )
+		{
+			transaction.abort();
+			std::rethrow_exception( std::current_exception() );
+		}
+	}
+
+} // namespace remote::parsers::v1
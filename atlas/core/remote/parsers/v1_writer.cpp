@@ -0,0 +1,247 @@
+//
+// Created by kj16609 on 7/24/23.
+//
+
+#include "v1_writer.hpp"
+
+#include <lz4frame.h>
+
+#include <unordered_map>
+
+#include <tracy/Tracy.hpp>
+
+#include "JsonRowReader.hpp"
+#include "core/logging.hpp"
+#include "v1_format.hpp"
+
+namespace remote::parsers::v1
+{
+	namespace
+	{
+		template < typename T >
+			requires std::is_trivially_copyable_v< T >
+		void append( std::vector< char >& out, const T t )
+		{
+			const auto offset { out.size() };
+			out.resize( offset + sizeof( T ) );
+			std::memcpy( out.data() + offset, &t, sizeof( T ) );
+		}
+
+		void append( std::vector< char >& out, const std::string_view str )
+		{
+			out.insert( out.end(), str.begin(), str.end() );
+		}
+
+		void setBit( std::vector< char >& out, const std::size_t bitmap_offset, const std::size_t idx )
+		{
+			auto& byte { out[ bitmap_offset + idx / 8 ] };
+			byte = static_cast< char >( static_cast< unsigned char >( byte ) | ( 1u << ( idx % 8 ) ) );
+		}
+
+		Encoding pickEncoding( const bool ints, const bool reals, const bool strings, const bool mostly_unique )
+		{
+			if ( ints + reals + strings > 1 ) return Encoding::Mixed;
+			if ( reals ) return Encoding::Real;
+			if ( strings ) return mostly_unique ? Encoding::TextPlain : Encoding::TextDict;
+			return Encoding::Integer;
+		}
+
+		//! Appends `str` to `bytes` and it's end to `offsets`
+		void appendString( std::vector< char >& bytes, std::vector< std::uint32_t >& offsets, const std::string_view str )
+		{
+			bytes.insert( bytes.end(), str.begin(), str.end() );
+			if ( bytes.size() > std::numeric_limits< std::uint32_t >::max() )
+				throw std::runtime_error( "v1 column exceeds 4GiB of text" );
+			offsets.emplace_back( static_cast< std::uint32_t >( bytes.size() ) );
+		}
+
+		template < DataSet set >
+		void writeColumn( std::vector< char >& out, const std::vector< CatalogRow< set > >& rows, const std::size_t column )
+		{
+			ZoneScoped;
+			const std::size_t row_count { rows.size() };
+			const std::size_t bitmap_size { ( row_count + 7 ) / 8 };
+
+			std::vector< char > block( bitmap_size * 2, '\0' );
+
+			bool any_present { false };
+			bool ints { false };
+			bool reals { false };
+			bool strings { false };
+			std::size_t string_count { 0 };
+			std::unordered_map< std::string_view, std::uint32_t > dictionary {};
+
+			for ( std::size_t r = 0; r < row_count; ++r )
+			{
+				if ( !rows[ r ].has( column ) ) continue;
+				any_present = true;
+				setBit( block, 0, r );
+
+				const auto& value { rows[ r ].values[ column ] };
+				if ( std::holds_alternative< std::monostate >( value ) ) setBit( block, bitmap_size, r );
+				ints |= std::holds_alternative< std::int64_t >( value );
+				reals |= std::holds_alternative< double >( value );
+				if ( const auto* str = std::get_if< std::string >( &value ); str != nullptr )
+				{
+					strings = true;
+					++string_count;
+					dictionary.try_emplace( *str, static_cast< std::uint32_t >( dictionary.size() ) );
+				}
+			}
+
+			//Nothing to store
+			if ( !any_present ) return;
+
+			//A dictionary only pays off when values repeat
+			const auto encoding { pickEncoding( ints, reals, strings, dictionary.size() * 2 > string_count ) };
+
+			switch ( encoding )
+			{
+				case Encoding::Integer:
+					for ( const auto& row : rows )
+					{
+						const auto* val { std::get_if< std::int64_t >( &row.values[ column ] ) };
+						append< std::int64_t >( block, ( row.has( column ) && val != nullptr ) ? *val : 0 );
+					}
+					break;
+				case Encoding::Real:
+					for ( const auto& row : rows )
+					{
+						const auto* val { std::get_if< double >( &row.values[ column ] ) };
+						append< double >( block, ( row.has( column ) && val != nullptr ) ? *val : 0.0 );
+					}
+					break;
+				case Encoding::TextDict:
+					{
+						//Entries in the order they were first seen
+						std::vector< std::string_view > entries( dictionary.size() );
+						for ( const auto& [ str, idx ] : dictionary ) entries[ idx ] = str;
+
+						std::vector< char > bytes {};
+						std::vector< std::uint32_t > offsets { 0 };
+						for ( const auto& entry : entries ) appendString( bytes, offsets, entry );
+
+						append< std::uint32_t >( block, static_cast< std::uint32_t >( entries.size() ) );
+						for ( const auto offset : offsets ) append( block, offset );
+						block.insert( block.end(), bytes.begin(), bytes.end() );
+
+						for ( const auto& row : rows )
+						{
+							const auto* str { std::get_if< std::string >( &row.values[ column ] ) };
+							append< std::uint32_t >(
+								block, ( row.has( column ) && str != nullptr ) ? dictionary.at( *str ) : 0 );
+						}
+						break;
+					}
+				case Encoding::TextPlain:
+					{
+						std::vector< char > bytes {};
+						std::vector< std::uint32_t > offsets { 0 };
+						for ( const auto& row : rows )
+						{
+							const auto* str { std::get_if< std::string >( &row.values[ column ] ) };
+							appendString( bytes, offsets, ( row.has( column ) && str != nullptr ) ? *str : "" );
+						}
+
+						for ( const auto offset : offsets ) append( block, offset );
+						block.insert( block.end(), bytes.begin(), bytes.end() );
+						break;
+					}
+				case Encoding::Mixed:
+					{
+						for ( const auto& row : rows )
+							append< std::uint8_t >(
+								block, row.has( column ) ? static_cast< std::uint8_t >( row.values[ column ].index() ) : 0 );
+
+						for ( const auto& row : rows )
+						{
+							if ( !row.has( column ) ) continue;
+							const auto& value { row.values[ column ] };
+							if ( const auto* i = std::get_if< std::int64_t >( &value ); i != nullptr )
+								append( block, *i );
+							else if ( const auto* d = std::get_if< double >( &value ); d != nullptr )
+								append( block, *d );
+							else if ( const auto* str = std::get_if< std::string >( &value ); str != nullptr )
+							{
+								append< std::uint32_t >( block, static_cast< std::uint32_t >( str->size() ) );
+								append( block, *str );
+							}
+						}
+						break;
+					}
+				default:
+					throw std::runtime_error( fmt::format(
+						"Unknown encoding {} for column {}", static_cast< int >( encoding ), column ) );
+			}
+
+			LZ4F_preferences_t prefs {};
+			prefs.frameInfo.contentSize = block.size();
+			prefs.frameInfo.blockSizeID = LZ4F_max4MB;
+			prefs.compressionLevel = 9;
+
+			std::vector< char > compressed( LZ4F_compressFrameBound( block.size(), &prefs ) );
+			const auto compressed_size {
+				LZ4F_compressFrame( compressed.data(), compressed.size(), block.data(), block.size(), &prefs )
+			};
+			if ( LZ4F_isError( compressed_size ) )
+				throw std::runtime_error(
+					fmt::format( "Failed to compress column: {}", LZ4F_getErrorName( compressed_size ) ) );
+
+			const auto name { SetInfo< set >::columns[ column ].name };
+			append< std::uint8_t >( out, static_cast< std::uint8_t >( name.size() ) );
+			append( out, name );
+			append< std::uint8_t >( out, static_cast< std::uint8_t >( encoding ) );
+			append< std::uint64_t >( out, compressed_size );
+			out.insert( out.end(), compressed.begin(), compressed.begin() + static_cast< std::ptrdiff_t >( compressed_size ) );
+		}
+
+		template < DataSet set >
+		void writeSection( std::vector< char >& out, const std::vector< CatalogRow< set > >& rows )
+		{
+			ZoneScoped;
+			append< std::uint8_t >( out, static_cast< std::uint8_t >( set ) );
+			append< std::uint32_t >( out, static_cast< std::uint32_t >( rows.size() ) );
+
+			//Filled in once we know how many columns had data
+			const auto column_count_offset { out.size() };
+			append< std::uint32_t >( out, 0 );
+
+			std::uint32_t column_count { 0 };
+			for ( std::size_t column = 0; column < CatalogRow< set >::column_count; ++column )
+			{
+				const auto before { out.size() };
+				writeColumn( out, rows, column );
+				if ( out.size() != before ) ++column_count;
+			}
+
+			std::memcpy( out.data() + column_count_offset, &column_count, sizeof( column_count ) );
+		}
+	} // namespace
+
+	std::vector< char > PackageWriter::finish() const
+	{
+		ZoneScoped;
+		std::vector< char > out { MAGIC.begin(), MAGIC.end() };
+		append( out, FORMAT_VERSION );
+		append< std::uint32_t >( out, 2 );
+
+		writeSection( out, m_atlas );
+		writeSection( out, m_f95 );
+
+		return out;
+	}
+
+	std::vector< char > convert( const std::span< const char > json )
+	{
+		ZoneScoped;
+		PackageWriter writer {};
+
+		JsonRowReader reader { { [ &writer ]( AtlasRow&& row ) { writer.add( std::move( row ) ); },
+			                     [ &writer ]( F95Row&& row ) { writer.add( std::move( row ) ); } } };
+		reader.feed( json.data(), json.size() );
+		reader.finish();
+
+		return writer.finish();
+	}
+
+} // namespace remote::parsers::v1
@@ -0,0 +1,35 @@
+//
+// Created by kj16609 on 7/24/23.
+//
+
+#ifndef ATLASGAMEMANAGER_V1_WRITER_HPP
+#define ATLASGAMEMANAGER_V1_WRITER_HPP
+
+#include <span>
+#include <vector>
+
+#include "CatalogRow.hpp"
+
+namespace remote::parsers::v1
+{
+	//! Builds a v1 package. See @ref V1Packages
+	class PackageWriter
+	{
+		std::vector< AtlasRow > m_atlas {};
+		std::vector< F95Row > m_f95 {};
+
+	  public:
+
+		void add( AtlasRow&& row ) { m_atlas.emplace_back( std::move( row ) ); }
+
+		void add( F95Row&& row ) { m_f95.emplace_back( std::move( row ) ); }
+
+		//! Serializes every row added so far
+		std::vector< char > finish() const;
+	};
+
+	//! Converts the json of a v0 package (already decompressed) into a v1 package
+	std::vector< char > convert( const std::span< const char > json );
+} // namespace remote::parsers::v1
+
+#endif //ATLASGAMEMANAGER_V1_WRITER_HPP
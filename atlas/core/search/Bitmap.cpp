@@ -0,0 +1,380 @@
+//
+// Created by kj16609 on 7/27/23.
+//
+
+#include "Bitmap.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <iterator>
+
+namespace atlas::search
+{
+	namespace
+	{
+		std::uint16_t high( const std::uint32_t value )
+		{
+			return static_cast< std::uint16_t >( value >> 16 );
+		}
+
+		std::uint16_t low( const std::uint32_t value )
+		{
+			return static_cast< std::uint16_t >( value & 0xFFFF );
+		}
+
+		std::vector< std::uint64_t > toBits( const std::vector< std::uint16_t >& array )
+		{
+			std::vector< std::uint64_t > bits( Bitmap::BITSET_WORDS, 0 );
+			for ( const auto value : array ) bits[ value / 64 ] |= std::uint64_t( 1 ) << ( value % 64 );
+			return bits;
+		}
+
+		std::uint32_t countBits( const std::vector< std::uint64_t >& bits )
+		{
+			std::uint32_t count { 0 };
+			for ( const auto word : bits ) count += static_cast< std::uint32_t >( std::popcount( word ) );
+			return count;
+		}
+	} // namespace
+
+	bool Bitmap::Container::contains( const std::uint16_t value ) const
+	{
+		if ( isBitset() ) return ( bits[ value / 64 ] >> ( value % 64 ) ) & 1;
+		return std::binary_search( array.begin(), array.end(), value );
+	}
+
+	void Bitmap::Container::normalize()
+	{
+		if ( isBitset() && cardinality <= ARRAY_MAX )
+		{
+			array.clear();
+			array.reserve( cardinality );
+			for ( std::size_t word = 0; word < bits.size(); ++word )
+			{
+				for ( auto remaining = bits[ word ]; remaining != 0; remaining &= remaining - 1 )
+					array.emplace_back( static_cast< std::uint16_t >( word * 64
+					                                                  + static_cast< std::size_t >( std::countr_zero(
+																		  remaining ) ) ) );
+			}
+			bits.clear();
+			bits.shrink_to_fit();
+		}
+		else if ( !isBitset() && cardinality > ARRAY_MAX )
+		{
+			bits = toBits( array );
+			array.clear();
+			array.shrink_to_fit();
+		}
+	}
+
+	Bitmap::Container* Bitmap::find( const std::uint16_t key )
+	{
+		const auto itter { std::lower_bound(
+			m_containers.begin(),
+			m_containers.end(),
+			key,
+			[]( const Container& container, const std::uint16_t k ) { return container.key < k; } ) };
+		if ( itter == m_containers.end() || itter->key != key ) return nullptr;
+		return &*itter;
+	}
+
+	const Bitmap::Container* Bitmap::find( const std::uint16_t key ) const
+	{
+		return const_cast< Bitmap* >( this )->find( key );
+	}
+
+	Bitmap Bitmap::range( const std::uint32_t end )
+	{
+		Bitmap bitmap {};
+		for ( std::uint32_t start = 0; start < end; start += 65536 )
+		{
+			const auto count { std::min< std::uint32_t >( 65536, end - start ) };
+
+			Container container { high( start ), {}, std::vector< std::uint64_t >( BITSET_WORDS, 0 ), count };
+			for ( std::uint32_t word = 0; word < count / 64; ++word ) container.bits[ word ] = ~std::uint64_t( 0 );
+			if ( count % 64 != 0 ) container.bits[ count / 64 ] = ( std::uint64_t( 1 ) << ( count % 64 ) ) - 1;
+
+			container.normalize();
+			bitmap.m_containers.emplace_back( std::move( container ) );
+		}
+		return bitmap;
+	}
+
+	void Bitmap::add( const std::uint32_t value )
+	{
+		const auto key { high( value ) };
+		auto itter { std::lower_bound(
+			m_containers.begin(),
+			m_containers.end(),
+			key,
+			[]( const Container& container, const std::uint16_t k ) { return container.key < k; } ) };
+		if ( itter == m_containers.end() || itter->key != key ) itter = m_containers.insert( itter, Container { key } );
+
+		auto& container { *itter };
+		const auto bits { low( value ) };
+		if ( container.isBitset() )
+		{
+			auto& word { container.bits[ bits / 64 ] };
+			const auto mask { std::uint64_t( 1 ) << ( bits % 64 ) };
+			if ( word & mask ) return;
+			word |= mask;
+		}
+		else
+		{
+			const auto pos { std::lower_bound( container.array.begin(), container.array.end(), bits ) };
+			if ( pos != container.array.end() && *pos == bits ) return;
+			container.array.insert( pos, bits );
+		}
+
+		++container.cardinality;
+		container.normalize();
+	}
+
+	void Bitmap::remove( const std::uint32_t value )
+	{
+		auto* container { find( high( value ) ) };
+		if ( container == nullptr ) return;
+
+		const auto bits { low( value ) };
+		if ( container->isBitset() )
+		{
+			auto& word { container->bits[ bits / 64 ] };
+			const auto mask { std::uint64_t( 1 ) << ( bits % 64 ) };
+			if ( ( word & mask ) == 0 ) return;
+			word &= ~mask;
+		}
+		else
+		{
+			const auto pos { std::lower_bound( container->array.begin(), container->array.end(), bits ) };
+			if ( pos == container->array.end() || *pos != bits ) return;
+			container->array.erase( pos );
+		}
+
+		if ( --container->cardinality == 0 )
+			m_containers.erase( m_containers.begin() + ( container - m_containers.data() ) );
+		else
+			container->normalize();
+	}
+
+	bool Bitmap::contains( const std::uint32_t value ) const
+	{
+		const auto* container { find( high( value ) ) };
+		return container != nullptr && container->contains( low( value ) );
+	}
+
+	std::size_t Bitmap::cardinality() const
+	{
+		std::size_t count { 0 };
+		for ( const auto& container : m_containers ) count += container.cardinality;
+		return count;
+	}
+
+	Bitmap::Container Bitmap::intersect( const Container& left, const Container& right )
+	{
+		Container out { left.key };
+		if ( !left.isBitset() && !right.isBitset() )
+			std::set_intersection(
+				left.array.begin(),
+				left.array.end(),
+				right.array.begin(),
+				right.array.end(),
+				std::back_inserter( out.array ) );
+		else if ( !left.isBitset() || !right.isBitset() )
+		{
+			const auto& array { left.isBitset() ? right.array : left.array };
+			const auto& bitset { left.isBitset() ? left : right };
+			for ( const auto value : array )
+				if ( bitset.contains( value ) ) out.array.emplace_back( value );
+		}
+		else
+		{
+			out.bits.resize( BITSET_WORDS );
+			for ( std::size_t i = 0; i < BITSET_WORDS; ++i ) out.bits[ i ] = left.bits[ i ] & right.bits[ i ];
+			out.cardinality = countBits( out.bits );
+			out.normalize();
+			return out;
+		}
+
+		out.cardinality = static_cast< std::uint32_t >( out.array.size() );
+		return out;
+	}
+
+	Bitmap::Container Bitmap::unite( const Container& left, const Container& right )
+	{
+		Container out { left.key };
+		if ( !left.isBitset() && !right.isBitset() && left.cardinality + right.cardinality <= ARRAY_MAX )
+		{
+			std::set_union(
+				left.array.begin(),
+				left.array.end(),
+				right.array.begin(),
+				right.array.end(),
+				std::back_inserter( out.array ) );
+			out.cardinality = static_cast< std::uint32_t >( out.array.size() );
+			return out;
+		}
+
+		out.bits = left.isBitset() ? left.bits : toBits( left.array );
+		if ( right.isBitset() )
+			for ( std::size_t i = 0; i < BITSET_WORDS; ++i ) out.bits[ i ] |= right.bits[ i ];
+		else
+			for ( const auto value : right.array ) out.bits[ value / 64 ] |= std::uint64_t( 1 ) << ( value % 64 );
+
+		out.cardinality = countBits( out.bits );
+		out.normalize();
+		return out;
+	}
+
+	Bitmap::Container Bitmap::subtract( const Container& left, const Container& right )
+	{
+		Container out { left.key };
+		if ( !left.isBitset() )
+		{
+			for ( const auto value : left.array )
+				if ( !right.contains( value ) ) out.array.emplace_back( value );
+			out.cardinality = static_cast< std::uint32_t >( out.array.size() );
+			return out;
+		}
+
+		out.bits = left.bits;
+		if ( right.isBitset() )
+			for ( std::size_t i = 0; i < BITSET_WORDS; ++i ) out.bits[ i ] &= ~right.bits[ i ];
+		else
+			for ( const auto value : right.array ) out.bits[ value / 64 ] &= ~( std::uint64_t( 1 ) << ( value % 64 ) );
+
+		out.cardinality = countBits( out.bits );
+		out.normalize();
+		return out;
+	}
+
+	std::size_t Bitmap::intersectCount( const Container& left, const Container& right )
+	{
+		if ( left.isBitset() && right.isBitset() )
+		{
+			std::size_t count { 0 };
+			for ( std::size_t i = 0; i < BITSET_WORDS; ++i )
+				count += static_cast< std::size_t >( std::popcount( left.bits[ i ] & right.bits[ i ] ) );
+			return count;
+		}
+
+		if ( left.isBitset() || right.isBitset() )
+		{
+			const auto& array { left.isBitset() ? right.array : left.array };
+			const auto& bitset { left.isBitset() ? left : right };
+			return static_cast< std::size_t >(
+				std::count_if( array.begin(), array.end(), [ &bitset ]( const auto value ) { return bitset.contains( value ); } ) );
+		}
+
+		//Both sorted. Walk them together
+		std::size_t count { 0 };
+		auto l { left.array.begin() };
+		auto r { right.array.begin() };
+		while ( l != left.array.end() && r != right.array.end() )
+		{
+			if ( *l < *r )
+				++l;
+			else if ( *r < *l )
+				++r;
+			else
+			{
+				++count;
+				++l;
+				++r;
+			}
+		}
+		return count;
+	}
+
+	Bitmap Bitmap::operator&( const Bitmap& other ) const
+	{
+		Bitmap out {};
+		auto l { m_containers.begin() };
+		auto r { other.m_containers.begin() };
+		while ( l != m_containers.end() && r != other.m_containers.end() )
+		{
+			if ( l->key < r->key )
+				++l;
+			else if ( r->key < l->key )
+				++r;
+			else
+			{
+				if ( auto container = intersect( *l, *r ); container.cardinality != 0 )
+					out.m_containers.emplace_back( std::move( container ) );
+				++l;
+				++r;
+			}
+		}
+		return out;
+	}
+
+	Bitmap Bitmap::operator|( const Bitmap& other ) const
+	{
+		Bitmap out {};
+		auto l { m_containers.begin() };
+		auto r { other.m_containers.begin() };
+		while ( l != m_containers.end() || r != other.m_containers.end() )
+		{
+			if ( r == other.m_containers.end() || ( l != m_containers.end() && l->key < r->key ) )
+				out.m_containers.emplace_back( *l++ );
+			else if ( l == m_containers.end() || r->key < l->key )
+				out.m_containers.emplace_back( *r++ );
+			else
+				out.m_containers.emplace_back( unite( *l++, *r++ ) );
+		}
+		return out;
+	}
+
+	Bitmap Bitmap::andNot( const Bitmap& other ) const
+	{
+		Bitmap out {};
+		for ( const auto& container : m_containers )
+		{
+			if ( const auto* right = other.find( container.key ); right != nullptr )
+			{
+				if ( auto remaining = subtract( container, *right ); remaining.cardinality != 0 )
+					out.m_containers.emplace_back( std::move( remaining ) );
+			}
+			else
+				out.m_containers.emplace_back( container );
+		}
+		return out;
+	}
+
+	std::size_t Bitmap::andCardinality( const Bitmap& other ) const
+	{
+		std::size_t count { 0 };
+		auto l { m_containers.begin() };
+		auto r { other.m_containers.begin() };
+		while ( l != m_containers.end() && r != other.m_containers.end() )
+		{
+			if ( l->key < r->key )
+				++l;
+			else if ( r->key < l->key )
+				++r;
+			else
+				count += intersectCount( *l++, *r++ );
+		}
+		return count;
+	}
+
+	std::vector< std::uint32_t > Bitmap::values() const
+	{
+		std::vector< std::uint32_t > out {};
+		out.reserve( cardinality() );
+		for ( const auto& container : m_containers )
+		{
+			const auto base { static_cast< std::uint32_t >( container.key ) << 16 };
+			if ( container.isBitset() )
+			{
+				for ( std::size_t word = 0; word < container.bits.size(); ++word )
+					for ( auto remaining = container.bits[ word ]; remaining != 0; remaining &= remaining - 1 )
+						out.emplace_back(
+							base + static_cast< std::uint32_t >( word * 64 )
+							+ static_cast< std::uint32_t >( std::countr_zero( remaining ) ) );
+			}
+			else
+				for ( const auto value : container.array ) out.emplace_back( base + value );
+		}
+		return out;
+	}
+} // namespace atlas::search
@@ -0,0 +1,83 @@
+//
+// Created by kj16609 on 7/27/23.
+//
+
+#ifndef ATLASGAMEMANAGER_BITMAP_HPP
+#define ATLASGAMEMANAGER_BITMAP_HPP
+
+#include <cstdint>
+#include <vector>
+
+namespace atlas::search
+{
+	//! Compressed set of 32 bit values, laid out like a roaring bitmap.
+	/**
+	 * Values are split by their high 16 bits into containers. A container holds a sorted array of the low 16 bits
+	 * until it has more then `ARRAY_MAX` values, after which it becomes a 65536 bit bitset.
+	 * Set operations work container by container so sparse and dense sets are both cheap.
+	 */
+	class Bitmap
+	{
+	  public:
+
+		static constexpr std::size_t ARRAY_MAX { 4096 };
+		static constexpr std::size_t BITSET_WORDS { 65536 / 64 };
+
+	  private:
+
+		struct Container
+		{
+			std::uint16_t key { 0 };
+			//! Sorted low bits. Used while there are `ARRAY_MAX` or fewer values
+			std::vector< std::uint16_t > array {};
+			//! Used once there are more then `ARRAY_MAX` values. Empty otherwise
+			std::vector< std::uint64_t > bits {};
+			std::uint32_t cardinality { 0 };
+
+			bool isBitset() const { return !bits.empty(); }
+
+			bool contains( const std::uint16_t low ) const;
+			//! Switches between array and bitset to match the cardinality
+			void normalize();
+		};
+
+		//! Sorted by key. Never holds an empty container
+		std::vector< Container > m_containers {};
+
+		Container* find( const std::uint16_t key );
+		const Container* find( const std::uint16_t key ) const;
+
+		static Container intersect( const Container& left, const Container& right );
+		static Container unite( const Container& left, const Container& right );
+		static Container subtract( const Container& left, const Container& right );
+		static std::size_t intersectCount( const Container& left, const Container& right );
+
+	  public:
+
+		//! Every value in [0, end)
+		static Bitmap range( const std::uint32_t end );
+
+		void add( const std::uint32_t value );
+		void remove( const std::uint32_t value );
+		bool contains( const std::uint32_t value ) const;
+
+		std::size_t cardinality() const;
+
+		bool empty() const { return m_containers.empty(); }
+
+		Bitmap operator&( const Bitmap& other ) const;
+		Bitmap operator|( const Bitmap& other ) const;
+		//! Values in this that are not in `other`
+		Bitmap andNot( const Bitmap& other ) const;
+
+		//! Same as `( *this & other ).cardinality()` without building the intersection
+		std::size_t andCardinality( const Bitmap& other ) const;
+
+		//! Every value in ascending order
+		std::vector< std::uint32_t > values() const;
+
+		bool operator==( const Bitmap& other ) const { return values() == other.values(); }
+	};
+} // namespace atlas::search
+
+#endif //ATLASGAMEMANAGER_BITMAP_HPP
@@ -0,0 +1,352 @@
+//
+// Created by kj16609 on 7/27/23.
+//
+
+#include "FacetIndex.hpp"
+
+#include <algorithm>
+#include <functional>
+
+#include <tracy/Tracy.hpp>
+
+#include "QueryBuilder.hpp"
+#include "core/database/Catalog.hpp"
+#include "core/database/Transaction.hpp"
+#include "core/remote/parsers/CatalogTags.hpp"
+
+namespace atlas::search
+{
+	static_assert( FacetPlatform - FacetCatalogTag + 1 == remote::parsers::TagTypeEnd );
+
+	namespace
+	{
+		//! Tables where an insert tells us which record changed, by looking up the row afterwards
+		constexpr std::array< std::string_view, 2 > mapping_tables { "tag_mappings", "atlas_mapping" };
+
+		//! Tables where a change can touch any number of records
+		constexpr std::array< std::string_view, 3 > shared_tables { "tags", "atlas_data", "catalog_tags" };
+
+		std::string lowercase( const std::string_view str )
+		{
+			std::string out { str };
+			for ( auto& c : out ) c = static_cast< char >( std::tolower( static_cast< unsigned char >( c ) ) );
+			return out;
+		}
+
+		std::string_view trim( const std::string_view str )
+		{
+			const auto start { str.find_first_not_of( ' ' ) };
+			if ( start == str.npos ) return {};
+			return str.substr( start, str.find_last_not_of( ' ' ) - start + 1 );
+		}
+
+		//! Recursive descent over the tokens of a search. `|` binds loosest, then `&`, then `!`
+		struct Parser
+		{
+			const std::vector< std::string_view >& tokens;
+			const std::function< std::optional< Bitmap >( std::string_view ) >& term;
+			const Bitmap& all;
+			std::size_t pos { 0 };
+
+			bool accept( const std::string_view op )
+			{
+				if ( pos >= tokens.size() || tokens[ pos ] != op ) return false;
+				++pos;
+				return true;
+			}
+
+			std::optional< Bitmap > either()
+			{
+				auto left { both() };
+				while ( left && accept( "|" ) )
+				{
+					const auto right { both() };
+					if ( !right ) return std::nullopt;
+					left = *left | *right;
+				}
+				return left;
+			}
+
+			std::optional< Bitmap > both()
+			{
+				auto left { negated() };
+				while ( left && accept( "&" ) )
+				{
+					const auto right { negated() };
+					if ( !right ) return std::nullopt;
+					left = *left & *right;
+				}
+				return left;
+			}
+
+			std::optional< Bitmap > negated()
+			{
+				if ( accept( "!" ) )
+				{
+					const auto inner { negated() };
+					if ( !inner ) return std::nullopt;
+					return all.andNot( *inner );
+				}
+
+				if ( pos >= tokens.size() ) return std::nullopt;
+				return term( tokens[ pos++ ] );
+			}
+		};
+	} // namespace
+
+	FacetIndex::FacetIndex( sqlite3& db ) : m_db( db ), m_statements( db )
+	{
+		sqlite3_update_hook( &m_db, &FacetIndex::updateHook, this );
+	}
+
+	FacetIndex::~FacetIndex()
+	{
+		sqlite3_update_hook( &m_db, nullptr, nullptr );
+	}
+
+	void FacetIndex::updateHook(
+		void* self, const int op, [[maybe_unused]] const char* db, const char* table, const sqlite3_int64 rowid )
+	{
+		//Runs inside of the write. Must not touch the database
+		auto& index { *static_cast< FacetIndex* >( self ) };
+		const std::string_view name { table };
+
+		std::lock_guard guard { index.m_dirty_mtx };
+		if ( name == "records" )
+			index.m_dirty.insert( static_cast< RecordID >( rowid ) );
+		else if ( const auto mapping = std::find( mapping_tables.begin(), mapping_tables.end(), name );
+		          mapping != mapping_tables.end() )
+		{
+			if ( op == SQLITE_DELETE )
+				index.m_stale = true;
+			else
+				index.m_new_rows.emplace_back( *mapping, rowid );
+		}
+		else if ( std::find( shared_tables.begin(), shared_tables.end(), name ) != shared_tables.end() )
+			index.m_stale = true;
+	}
+
+	void FacetIndex::sync()
+	{
+		ZoneScoped;
+		std::unordered_set< RecordID > dirty {};
+		std::vector< std::pair< std::string_view, sqlite3_int64 > > new_rows {};
+		bool stale { false };
+		{
+			std::lock_guard guard { m_dirty_mtx };
+			std::swap( dirty, m_dirty );
+			std::swap( new_rows, m_new_rows );
+			std::swap( stale, m_stale );
+		}
+
+		if ( stale || m_generation != catalog::generation() )
+		{
+			rebuild();
+			return;
+		}
+
+		for ( const auto& [ table, rowid ] : new_rows )
+			( m_statements << fmt::format( "SELECT record_id FROM {} WHERE rowid = ?", table ) ) << rowid
+				>> [ &dirty ]( const RecordID id ) noexcept { dirty.insert( id ); };
+
+		for ( const auto id : dirty )
+		{
+			const auto itter { m_ordinals.find( id ) };
+			if ( itter != m_ordinals.end() )
+			{
+				const auto ord { itter->second };
+				m_all.remove( ord );
+				for ( auto& facets : m_facets )
+				{
+					for ( auto facet = facets.begin(); facet != facets.end(); )
+					{
+						facet->second.records.remove( ord );
+						if ( facet->second.records.empty() )
+							facet = facets.erase( facet );
+						else
+							++facet;
+					}
+				}
+			}
+
+			load( id );
+		}
+	}
+
+	void FacetIndex::rebuild()
+	{
+		ZoneScoped;
+		m_records.clear();
+		m_ordinals.clear();
+		m_all = {};
+		for ( auto& facets : m_facets ) facets.clear();
+		m_generation = catalog::generation();
+
+		load( std::nullopt );
+		spdlog::debug( "Facet index rebuilt with {} records", m_all.cardinality() );
+	}
+
+	void FacetIndex::load( const std::optional< RecordID > only )
+	{
+		ZoneScoped;
+		const auto select = [ this, &only ]( const std::string_view sql, auto func )
+		{
+			if ( only )
+				( m_statements << fmt::format( "{} WHERE record_id = ?", sql ) ) << *only >> std::move( func );
+			else
+				( m_statements << std::string( sql ) ) >> std::move( func );
+		};
+
+		select(
+			"SELECT record_id, IFNULL(engine, ''), IFNULL(creator, '') FROM records",
+			[ this ]( const RecordID id, const std::string engine, const std::string creator ) noexcept
+			{
+				m_all.add( ordinal( id ) );
+				add( FacetEngine, engine, id );
+				add( FacetCreator, creator, id );
+			} );
+
+		select(
+			"SELECT record_id, IFNULL(tag, '') FROM tag_mappings NATURAL JOIN tags",
+			[ this ]( const RecordID id, const std::string tag ) noexcept { add( FacetUserTag, tag, id ); } );
+
+		select(
+			"SELECT record_id, type, tag FROM atlas_mapping NATURAL JOIN catalog_tag_map NATURAL JOIN catalog_tags",
+			[ this ]( const RecordID id, const std::int64_t type, const std::string tag ) noexcept
+			{
+				if ( type >= 0 && type < remote::parsers::TagTypeEnd )
+					add( static_cast< FacetType >( FacetCatalogTag + type ), tag, id );
+			} );
+
+		select(
+			"SELECT record_id, IFNULL(status, '') FROM atlas_mapping NATURAL JOIN atlas_data",
+			[ this ]( const RecordID id, const std::string status ) noexcept { add( FacetStatus, status, id ); } );
+	}
+
+	void FacetIndex::add( const FacetType type, const std::string_view name, const RecordID id )
+	{
+		//Rows can outlive their record. Only records that exist are indexed
+		const auto itter { m_ordinals.find( id ) };
+		if ( name.empty() || itter == m_ordinals.end() || !m_all.contains( itter->second ) ) return;
+
+		auto& facet { m_facets[ type ].try_emplace( lowercase( name ), Facet { std::string( name ), {} } ).first->second };
+		facet.records.add( itter->second );
+	}
+
+	std::uint32_t FacetIndex::ordinal( const RecordID id )
+	{
+		const auto [ itter, inserted ] = m_ordinals.try_emplace( id, static_cast< std::uint32_t >( m_records.size() ) );
+		if ( inserted ) m_records.emplace_back( id );
+		return itter->second;
+	}
+
+	std::optional< Bitmap > FacetIndex::term( const std::string_view token )
+	{
+		if ( token.starts_with( '(' ) )
+		{
+			if ( !token.ends_with( ')' ) ) return std::nullopt;
+			return parse( token.substr( 1, token.size() - 2 ) );
+		}
+
+		const auto pos { token.find( ':' ) };
+		if ( pos == token.npos ) return std::nullopt;
+
+		const auto [ name, value ] = seperateNamespace( token );
+		const auto type { std::find( facet_namespaces.begin(), facet_namespaces.end(), name ) };
+		if ( type == facet_namespaces.end() ) return std::nullopt;
+
+		const auto key { lowercase( trim( value ) ) };
+		//Patterns are left to SQL
+		if ( key.find_first_of( "%_" ) != key.npos ) return std::nullopt;
+
+		const auto& facets { m_facets[ static_cast< std::size_t >( type - facet_namespaces.begin() ) ] };
+		if ( const auto itter = facets.find( key ); itter != facets.end() ) return itter->second.records;
+		return Bitmap {};
+	}
+
+	std::optional< Bitmap > FacetIndex::parse( std::string_view text )
+	{
+		std::vector< std::string_view > tokens {};
+		text = trim( text );
+		//Same limit as `processString`
+		for ( std::uint64_t cycles = 0; !text.empty(); ++cycles )
+		{
+			if ( cycles == 512 ) return std::nullopt;
+			if ( const auto token = trim( extractUntilNext( text ) ); !token.empty() ) tokens.emplace_back( token );
+		}
+
+		const std::function< std::optional< Bitmap >( std::string_view ) > lookup {
+			[ this ]( const std::string_view token ) { return term( token ); }
+		};
+
+		Parser parser { tokens, lookup, m_all };
+		auto result { parser.either() };
+		//Leftovers are terms without an operator between them, which SQL would reject as well
+		if ( parser.pos != tokens.size() ) return std::nullopt;
+		return result;
+	}
+
+	std::optional< Bitmap > FacetIndex::evaluate( const std::string_view text )
+	{
+		ZoneScoped;
+		RapidTransaction transaction {};
+		std::lock_guard guard { m_mtx };
+		sync();
+		return parse( text );
+	}
+
+	Bitmap FacetIndex::all()
+	{
+		RapidTransaction transaction {};
+		std::lock_guard guard { m_mtx };
+		sync();
+		return m_all;
+	}
+
+	std::vector< RecordID > FacetIndex::records( const Bitmap& matches )
+	{
+		std::lock_guard guard { m_mtx };
+		std::vector< RecordID > ids {};
+		for ( const auto ord : matches.values() )
+			if ( ord < m_records.size() ) ids.emplace_back( m_records[ ord ] );
+		std::sort( ids.begin(), ids.end() );
+		return ids;
+	}
+
+	Bitmap FacetIndex::select( const std::vector< RecordID >& ids )
+	{
+		std::lock_guard guard { m_mtx };
+		Bitmap out {};
+		for ( const auto id : ids )
+			if ( const auto itter = m_ordinals.find( id ); itter != m_ordinals.end() ) out.add( itter->second );
+		return out;
+	}
+
+	std::vector< FacetCount > FacetIndex::counts( const Bitmap& within, const std::size_t limit )
+	{
+		ZoneScoped;
+		RapidTransaction transaction {};
+		std::lock_guard guard { m_mtx };
+		sync();
+
+		std::vector< FacetCount > out {};
+		for ( std::size_t type = 0; type < FacetTypeEnd; ++type )
+		{
+			const auto start { out.size() };
+			for ( const auto& [ key, facet ] : m_facets[ type ] )
+				if ( const auto count = facet.records.andCardinality( within ); count != 0 )
+					out.emplace_back( static_cast< FacetType >( type ), facet.name, count );
+
+			const auto keep { std::min( limit, out.size() - start ) };
+			std::partial_sort(
+				out.begin() + static_cast< std::ptrdiff_t >( start ),
+				out.begin() + static_cast< std::ptrdiff_t >( start + keep ),
+				out.end(),
+				[]( const FacetCount& left, const FacetCount& right )
+				{ return left.count != right.count ? left.count > right.count : left.name < right.name; } );
+			out.resize( start + keep );
+		}
+
+		return out;
+	}
+} // namespace atlas::search
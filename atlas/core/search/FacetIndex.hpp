@@ -0,0 +1,133 @@
+//
+// Created by kj16609 on 7/27/23.
+//
+
+#ifndef ATLASGAMEMANAGER_FACETINDEX_HPP
+#define ATLASGAMEMANAGER_FACETINDEX_HPP
+
+#include <array>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "Bitmap.hpp"
+#include "core/Types.hpp"
+#include "core/database/Database.hpp"
+#include "core/database/StatementCache.hpp"
+
+namespace atlas::search
+{
+	//! Catalog facets follow the order of `remote::parsers::CatalogTagType`, starting at `FacetCatalogTag`
+	enum FacetType
+	{
+		FacetUserTag,
+		FacetCatalogTag,
+		FacetGenre,
+		FacetLanguage,
+		FacetVoice,
+		FacetPlatform,
+		FacetEngine,
+		FacetCreator,
+		FacetStatus,
+		FacetTypeEnd
+	};
+
+	//! Search namespace of each facet. See @ref NamespaceParsingList
+	inline constexpr std::array< std::string_view, FacetTypeEnd > facet_namespaces {
+		"tag", "catalog", "genre", "language", "voice", "platform", "engine", "creator", "status"
+	};
+
+	struct FacetCount
+	{
+		FacetType type;
+		std::string name;
+		std::size_t count;
+	};
+
+	//! In memory index of which records have each tag, engine, creator and status.
+	/**
+	 * Records are numbered with dense ordinals and every facet value keeps a `Bitmap` of them.
+	 * Searches made only of facet namespaces and `& | ! ()` are answered with bitmap operations instead of SQL.
+	 *
+	 * Changes to the database are picked up through an update hook, which only notes what changed.
+	 * The index catches up at the start of the next call. Changed records are reloaded one at a time,
+	 * anything the hook can't tie to a record (deletes from mapping tables, catalog updates) reloads everything.
+	 * So does a change of `catalog::generation()`, which covers `catalog_tag_map` as the hook never fires for it.
+	 * Catching up runs inside of a `RapidTransaction`, so the catalog can't be swapped out while it's read.
+	 */
+	class FacetIndex
+	{
+		struct Facet
+		{
+			//! As first seen. Lookups are done without case
+			std::string name;
+			Bitmap records;
+		};
+
+		sqlite3& m_db;
+		StatementCache m_statements;
+
+		//! Indexed by ordinal
+		std::vector< RecordID > m_records {};
+		std::unordered_map< RecordID, std::uint32_t > m_ordinals {};
+		//! Every record that currently exists
+		Bitmap m_all {};
+		//! Keyed by the lowercase value
+		std::array< std::unordered_map< std::string, Facet >, FacetTypeEnd > m_facets {};
+		std::uint64_t m_generation { 0 };
+
+		std::mutex m_mtx {};
+
+		//! Filled by the update hook. Guarded by `m_dirty_mtx`, never held while running SQL
+		std::mutex m_dirty_mtx {};
+		std::unordered_set< RecordID > m_dirty {};
+		//! Rows inserted into mapping tables. The record they belong to is looked up later
+		std::vector< std::pair< std::string_view, sqlite3_int64 > > m_new_rows {};
+		bool m_stale { true };
+
+		static void updateHook( void* self, int op, const char* db, const char* table, sqlite3_int64 rowid );
+
+		//! Applies everything the hook noted. Must hold `m_mtx`, taken inside of a `RapidTransaction`
+		void sync();
+		void rebuild();
+		//! Reads the facets of every record, or only of `only`
+		void load( const std::optional< RecordID > only );
+		void add( const FacetType type, const std::string_view name, const RecordID id );
+		std::uint32_t ordinal( const RecordID id );
+
+		std::optional< Bitmap > term( const std::string_view token );
+		std::optional< Bitmap > parse( std::string_view text );
+
+	  public:
+
+		FacetIndex( sqlite3& db = Database::ref() );
+		~FacetIndex();
+
+		FacetIndex( const FacetIndex& ) = delete;
+		FacetIndex& operator=( const FacetIndex& ) = delete;
+
+		//! Evaluates a search on the index. Empty if the search uses anything it can't answer
+		/**
+		 * `title:`, `version:` and `system:` need SQL, as do values with `LIKE` wildcards (`%` or `_`).
+		 * Values are compared without case, the same as `LIKE`.
+		 */
+		std::optional< Bitmap > evaluate( const std::string_view text );
+
+		//! Every indexed record
+		Bitmap all();
+
+		//! Ids of the records in `matches`, ascending
+		std::vector< RecordID > records( const Bitmap& matches );
+
+		//! Bitmap of the given records. Ids that aren't indexed are skipped
+		Bitmap select( const std::vector< RecordID >& ids );
+
+		//! How many records in `within` have each facet value. Up to `limit` values per type, largest first
+		std::vector< FacetCount > counts( const Bitmap& within, const std::size_t limit = 25 );
+	};
+} // namespace atlas::search
+
+#endif //ATLASGAMEMANAGER_FACETINDEX_HPP
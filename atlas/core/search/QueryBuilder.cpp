@@ -6,6 +6,8 @@
 
 #include <tracy/Tracy.hpp>
 
+#include "core/remote/parsers/CatalogTags.hpp"
+
 enum TokenOperators
 {
 	NOT,
@@ -28,14 +30,46 @@ enum Namespaces
 	ENGINE,
 	TITLE,
 	TAG,
+	CATALOG_TAG,
+	GENRE,
+	LANGUAGE,
+	VOICE,
+	PLATFORM,
+	STATUS,
 	NAMESPACE_END,
 	INVALID_NAMESPACE
 };
 
+//Names must not contain one another. `extractUntilNext` would split them
 inline static constexpr std::array< std::pair< std::string_view, Namespaces >, NAMESPACE_END > namespaces {
-	{ { "system:", SYSTEM }, { "creator:", CREATOR }, { "engine:", ENGINE }, { "title:", TITLE }, { "tag:", TAG } }
+	{ { "system:", SYSTEM },
+	  { "creator:", CREATOR },
+	  { "engine:", ENGINE },
+	  { "title:", TITLE },
+	  { "tag:", TAG },
+	  { "catalog:", CATALOG_TAG },
+	  { "genre:", GENRE },
+	  { "language:", LANGUAGE },
+	  { "voice:", VOICE },
+	  { "platform:", PLATFORM },
+	  { "status:", STATUS } }
 };
 
+//! Records linked to catalog entries with a `type` tag like `tag`. Every step is an index lookup
+/**
+ * `tag` is compared with = unless it has wildcards. The column is NOCASE, so both ignore case, but only = uses the index
+ */
+std::string catalogTagQuery( const remote::parsers::CatalogTagType type, const std::string_view tag )
+{
+	const bool wildcards { tag.find_first_of( "%_" ) != std::string_view::npos };
+	return fmt::format(
+		" record_id IN (SELECT record_id FROM atlas_mapping WHERE atlas_id IN (SELECT atlas_id FROM catalog_tag_map WHERE "
+		"tag_id IN (SELECT tag_id FROM catalog_tags WHERE type = {} AND tag {} \'{}\')))",
+		static_cast< int >( type ),
+		wildcards ? "LIKE" : "=",
+		escape( tag ) );
+}
+
 enum SystemTokens
 {
 	FILESIZE,
@@ -220,8 +254,20 @@ std::string parseNamespace( const std::string_view str )
 						return fmt::format(
 							" record_id IN (SELECT record_id FROM tag_mappings NATURAL JOIN tags WHERE tag LIKE \'{}\')",
 							escape( sub ) );
-						//TODO: Do the tag system
-						return "";
+					case CATALOG_TAG:
+						return catalogTagQuery( remote::parsers::TagTags, sub );
+					case GENRE:
+						return catalogTagQuery( remote::parsers::TagGenre, sub );
+					case LANGUAGE:
+						return catalogTagQuery( remote::parsers::TagLanguage, sub );
+					case VOICE:
+						return catalogTagQuery( remote::parsers::TagVoice, sub );
+					case PLATFORM:
+						return catalogTagQuery( remote::parsers::TagOs, sub );
+					case STATUS:
+						return fmt::format(
+							" record_id IN (SELECT record_id FROM atlas_mapping NATURAL JOIN atlas_data WHERE status LIKE \'{}\')",
+							escape( sub ) );
 					case SYSTEM:
 						[[fallthrough]];
 					case NAMESPACE_END:
@@ -30,6 +30,12 @@
  * | title | Searches for a specific title | title:Haremon | v1.0.0 |
  * | creator | Searches for a specific creator/developer | creator:TsunAmie | v1.0.0 |
  * | version | Searches for a specific version text | version:v1.0 | v1.0.0 |
+ * | catalog | Searches for a tag from the remote catalog | catalog:Sandbox | v1.0.0 |
+ * | genre | Searches for a genre from the remote catalog | genre:RPG | v1.0.0 |
+ * | language | Searches for a language from the remote catalog | language:English | v1.0.0 |
+ * | voice | Searches for a voice option from the remote catalog | voice:Full | v1.0.0 |
+ * | platform | Searches for an OS from the remote catalog | platform:Linux | v1.0.0 |
+ * | status | Searches for a development status from the remote catalog | status:Completed | v1.0.0 |
  *
  *
  * @anchor SystemParsingList
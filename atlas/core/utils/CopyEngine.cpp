@@ -0,0 +1,282 @@
+//
+// Created by kj16609 on 8/2/23.
+//
+
+#include "CopyEngine.hpp"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <array>
+#include <atomic>
+#include <vector>
+
+#include <tracy/Tracy.hpp>
+
+#include "WorkStealingPool.hpp"
+#include "core/logging.hpp"
+
+namespace
+{
+	//! Largest piece copied in one call. Small enough for the progress to move on large files
+	constexpr std::size_t copy_chunk { 16 * 1024 * 1024 };
+
+#ifdef __linux__
+	class FileDescriptor
+	{
+		int m_fd;
+
+	  public:
+
+		explicit FileDescriptor( const int fd ) : m_fd( fd ) {}
+
+		~FileDescriptor()
+		{
+			if ( m_fd >= 0 ) ::close( m_fd );
+		}
+
+		FileDescriptor( const FileDescriptor& ) = delete;
+		FileDescriptor& operator=( const FileDescriptor& ) = delete;
+
+		int get() const { return m_fd; }
+
+		bool isOpen() const { return m_fd >= 0; }
+	};
+
+	[[noreturn]] void throwError( const std::string_view what, const std::filesystem::path& path )
+	{
+		throw std::runtime_error(
+			fmt::format( "copyFile: {} {}: {}", what, path, std::system_category().message( errno ) ) );
+	}
+
+	//! Not supported between these files, as opposed to failing part way
+	bool unsupported( const int error )
+	{
+		return error == EXDEV || error == EINVAL || error == ENOSYS || error == EOPNOTSUPP || error == ENOTSUP;
+	}
+
+	//! Copies from the current position of both files until `remaining` is 0. Returns the errno it stopped on, or 0
+	template < typename Copy >
+	int copyLoop( std::uint64_t& remaining, std::uint64_t& copied, const CopyCallback& on_copied, Copy copy )
+	{
+		while ( remaining > 0 )
+		{
+			const auto read { copy( static_cast< std::size_t >( std::min< std::uint64_t >( remaining, copy_chunk ) ) ) };
+			if ( read < 0 )
+			{
+				if ( errno == EINTR ) continue;
+				return errno;
+			}
+			//Source is shorter then when it was opened. Caught by the size check
+			if ( read == 0 ) break;
+
+			remaining -= static_cast< std::uint64_t >( read );
+			copied += static_cast< std::uint64_t >( read );
+			if ( on_copied ) on_copied( static_cast< std::uint64_t >( read ) );
+		}
+		return 0;
+	}
+#endif
+} // namespace
+
+std::uint64_t copyFile(
+	const std::filesystem::path& source, const std::filesystem::path& dest, const CopyCallback& on_copied )
+{
+	ZoneScoped;
+#ifdef __linux__
+	const FileDescriptor in { ::open( source.c_str(), O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK ) };
+	if ( !in.isOpen() ) throwError( "Failed to open", source );
+
+	struct stat info;
+	if ( ::fstat( in.get(), &info ) != 0 ) throwError( "Failed to stat", source );
+	if ( !S_ISREG( info.st_mode ) )
+		throw std::runtime_error( fmt::format( "copyFile: {} is not a regular file", source ) );
+
+	const FileDescriptor out {
+		::open( dest.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOCTTY, info.st_mode & 07777 )
+	};
+	if ( !out.isOpen() ) throwError( "Failed to create", dest );
+
+	const auto size { static_cast< std::uint64_t >( info.st_size ) };
+	std::uint64_t copied { 0 };
+
+	//Shares the extents on btrfs and xfs. Nothing is copied at all
+	if ( ::ioctl( out.get(), FICLONE, in.get() ) == 0 )
+	{
+		copied = size;
+		if ( on_copied ) on_copied( size );
+	}
+	else
+	{
+		std::uint64_t remaining { size };
+		int error { copyLoop(
+			remaining,
+			copied,
+			on_copied,
+			[ & ]( const std::size_t length )
+			{ return ::copy_file_range( in.get(), nullptr, out.get(), nullptr, length, 0 ); } ) };
+
+		//Both positions moved with what was copied, so sendfile carries on where it stopped
+		if ( unsupported( error ) )
+			error = copyLoop(
+				remaining,
+				copied,
+				on_copied,
+				[ & ]( const std::size_t length ) { return ::sendfile( out.get(), in.get(), nullptr, length ); } );
+
+		if ( error != 0 )
+		{
+			errno = error;
+			throwError( "Failed to copy", source );
+		}
+	}
+
+	const std::array< timespec, 2 > times { info.st_atim, info.st_mtim };
+	if ( ::futimens( out.get(), times.data() ) != 0 )
+		spdlog::debug( "copyFile: Failed to set times of {}: {}", dest, std::system_category().message( errno ) );
+
+	struct stat written;
+	if ( ::fstat( out.get(), &written ) != 0 ) throwError( "Failed to stat", dest );
+	if ( copied != size || static_cast< std::uint64_t >( written.st_size ) != size )
+		throw std::runtime_error(
+			fmt::format( "copyFile: {} is {} bytes after copying, expected {}", dest, written.st_size, size ) );
+
+	return size;
+#else
+	std::filesystem::copy_file( source, dest, std::filesystem::copy_options::overwrite_existing );
+
+	const auto size { std::filesystem::file_size( source ) };
+	if ( std::filesystem::file_size( dest ) != size )
+		throw std::runtime_error(
+			fmt::format( "copyFile: {} is {} bytes after copying, expected {}", dest, std::filesystem::file_size( dest ), size ) );
+
+	if ( on_copied ) on_copied( size );
+	return size;
+#endif
+}
+
+namespace
+{
+	//! Throws unless `dest` is missing or an empty directory. Anything in it would be overwritten or mixed in
+	void checkDestination( const std::string_view caller, const std::filesystem::path& dest )
+	{
+		std::error_code ec {};
+		if ( !std::filesystem::exists( std::filesystem::symlink_status( dest, ec ) ) ) return;
+		if ( !std::filesystem::is_directory( std::filesystem::symlink_status( dest, ec ) )
+		     || !std::filesystem::is_empty( dest, ec ) )
+			throw std::runtime_error( fmt::format( "{}: {} already exists and isn't empty", caller, dest ) );
+	}
+} // namespace
+
+std::uint64_t copyDirectory(
+	const std::filesystem::path& source,
+	const std::filesystem::path& dest,
+	const CopyCallback& on_copied,
+	const std::size_t max_copies )
+{
+	ZoneScoped;
+	if ( !std::filesystem::is_directory( source ) )
+		throw std::runtime_error( fmt::format( "copyDirectory: {} is not a directory", source ) );
+	checkDestination( "copyDirectory", dest );
+
+	//Only renamed to `dest` once everything is in it. Left over from an earlier attempt if it exists already
+	auto partial { dest };
+	partial += ".partial";
+	std::filesystem::remove_all( partial );
+	std::filesystem::create_directories( partial );
+
+	try
+	{
+		//Directories and links are made during the walk. Only the files are left for the copies
+		std::vector< std::filesystem::path > files {};
+		std::uint64_t expected { 0 };
+		for ( auto itter = std::filesystem::recursive_directory_iterator( source );
+		      itter != std::filesystem::recursive_directory_iterator();
+		      ++itter )
+		{
+			const auto relative { itter->path().lexically_relative( source ) };
+			if ( itter->is_symlink() )
+				std::filesystem::copy_symlink( itter->path(), partial / relative );
+			else if ( itter->is_directory() )
+				std::filesystem::create_directory( partial / relative );
+			else
+			{
+				files.emplace_back( relative );
+				expected += itter->is_regular_file() ? itter->file_size() : 0;
+			}
+		}
+
+		std::atomic< std::size_t > next { 0 };
+		std::atomic< std::uint64_t > copied { 0 };
+		//Stops the other copies after the first failure
+		std::atomic< bool > failed { false };
+
+		TaskGroup group {};
+		for ( std::size_t i = 0; i < std::min( std::max< std::size_t >( max_copies, 1 ), files.size() ); ++i )
+		{
+			group.run(
+				[ & ]()
+				{
+					for ( auto index = next++; index < files.size() && !failed; index = next++ )
+					{
+						try
+						{
+							copied += copyFile( source / files[ index ], partial / files[ index ], on_copied );
+						}
+						catch ( ... )
+						{
+							failed = true;
+							throw;
+						}
+					}
+				} );
+		}
+		group.wait();
+
+		if ( copied != expected )
+			throw std::runtime_error(
+				fmt::format( "copyDirectory: Copied {} bytes from {}, expected {}", copied.load(), source, expected ) );
+
+		//An empty `dest` is replaced. Renaming over a directory isn't portable
+		std::filesystem::remove( dest );
+		std::filesystem::rename( partial, dest );
+		return expected;
+	}
+	catch ( ... )
+	{
+		std::error_code ec {};
+		std::filesystem::remove_all( partial, ec );
+		throw;
+	}
+}
+
+MoveMethod moveDirectory(
+	const std::filesystem::path& source,
+	const std::filesystem::path& dest,
+	const CopyCallback& on_copied,
+	const std::size_t max_copies )
+{
+	ZoneScoped;
+	if ( !std::filesystem::is_directory( source ) )
+		throw std::runtime_error( fmt::format( "moveDirectory: {} is not a directory", source ) );
+	checkDestination( "moveDirectory", dest );
+
+	std::filesystem::create_directories( dest.parent_path() );
+
+	std::error_code ec {};
+	std::filesystem::remove( dest, ec );
+	std::filesystem::rename( source, dest, ec );
+	if ( !ec ) return MoveMethod::Rename;
+
+	spdlog::debug( "moveDirectory: Can't rename {} to {} ({}). Copying instead", source, dest, ec.message() );
+
+	copyDirectory( source, dest, on_copied, max_copies );
+	std::filesystem::remove_all( source );
+	return MoveMethod::Copy;
+}
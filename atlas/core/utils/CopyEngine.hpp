@@ -0,0 +1,59 @@
+//
+// Created by kj16609 on 8/2/23.
+//
+
+#ifndef ATLASGAMEMANAGER_COPYENGINE_HPP
+#define ATLASGAMEMANAGER_COPYENGINE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+
+//! How `moveDirectory` got the files to their destination
+enum class MoveMethod : std::uint8_t
+{
+	//! Same filesystem. Nothing was copied
+	Rename,
+	//! Copied file by file, then the source was removed
+	Copy,
+};
+
+//! Called with the bytes copied since the last call. Called from the copying threads
+using CopyCallback = std::function< void( std::uint64_t ) >;
+
+inline constexpr std::size_t default_concurrent_copies { 4 };
+
+//! Copies one file, replacing `dest`. Permissions and modification time are kept.
+/**
+ * On Linux it tries a reflink (`FICLONE`) first, then `copy_file_range`, then `sendfile`.
+ * Throws if the file can't be copied or if `dest` doesn't end up the same size as `source`.
+ * @return Bytes copied
+ */
+std::uint64_t copyFile(
+	const std::filesystem::path& source, const std::filesystem::path& dest, const CopyCallback& on_copied = {} );
+
+//! Copies the directory `source` to `dest`, which has to be missing or empty. Symlinks are copied as links.
+/**
+ * Everything goes into `dest` with `.partial` added first, with the files copied by `copyFile` at most `max_copies` at
+ * a time. It's renamed to `dest` once every file was copied and the total matches, so `dest` is never half written.
+ * Throws on the first file that fails, after removing the partial copy.
+ * @return Bytes copied
+ */
+std::uint64_t copyDirectory(
+	const std::filesystem::path& source,
+	const std::filesystem::path& dest,
+	const CopyCallback& on_copied = {},
+	const std::size_t max_copies = default_concurrent_copies );
+
+//! Moves the directory `source` to `dest`, which has to be missing or empty.
+/**
+ * Renamed if both are on the same filesystem. Otherwise copied with `copyDirectory` and the source removed after.
+ * Throws if `dest` has anything in it or the copy fails. `source` is left as it was and nothing is left at `dest`.
+ */
+MoveMethod moveDirectory(
+	const std::filesystem::path& source,
+	const std::filesystem::path& dest,
+	const CopyCallback& on_copied = {},
+	const std::size_t max_copies = default_concurrent_copies );
+
+#endif //ATLASGAMEMANAGER_COPYENGINE_HPP
@@ -0,0 +1,59 @@
+//
+// Created by kj16609 on 8/1/23.
+//
+
+#ifndef ATLASGAMEMANAGER_DIRECTORYREADER_HPP
+#define ATLASGAMEMANAGER_DIRECTORYREADER_HPP
+
+#ifdef __linux__
+
+#include <dirent.h>
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+//! One entry given by `readDirectory`
+struct DirectoryEntry
+{
+	//! Null terminated. Points into the read buffer, so it's only valid during the callback
+	const char* name;
+	//! `DT_` value from getdents64. `DT_UNKNOWN` if the filesystem doesn't fill it in
+	unsigned char type;
+};
+
+//! Calls `on_entry` with every entry of the open directory `dir_fd`, except `.` and `..`.
+/**
+ * Reads with getdents64 into a buffer on the stack, so nothing is allocated per entry.
+ * Returns false if reading failed part way, with `errno` set. The entries before it were still given.
+ */
+template < typename Func >
+bool readDirectory( const int dir_fd, Func&& on_entry )
+{
+	std::array< char, 32 * 1024 > buffer;
+	while ( true )
+	{
+		const auto read { ::getdents64( dir_fd, buffer.data(), buffer.size() ) };
+		if ( read < 0 ) return false;
+		if ( read == 0 ) return true;
+
+		for ( std::size_t offset = 0; offset < static_cast< std::size_t >( read ); )
+		{
+			//Only the header is copied out. Casting the buffer would need it aligned for every entry
+			dirent64 header;
+			std::memcpy( &header, buffer.data() + offset, offsetof( dirent64, d_name ) );
+			const char* const name { buffer.data() + offset + offsetof( dirent64, d_name ) };
+			offset += header.d_reclen;
+
+			const std::string_view view { name };
+			if ( view == "." || view == ".." ) continue;
+
+			on_entry( DirectoryEntry { name, header.d_type } );
+		}
+	}
+}
+
+#endif
+
+#endif //ATLASGAMEMANAGER_DIRECTORYREADER_HPP
@@ -0,0 +1,176 @@
+//
+// Created by kj16609 on 8/1/23.
+//
+
+#include "DirectorySize.hpp"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#endif
+
+#include <mutex>
+#include <set>
+#include <string>
+
+#include <tracy/Tracy.hpp>
+
+#include "DirectoryReader.hpp"
+#include "WorkStealingPool.hpp"
+#include "core/logging.hpp"
+
+namespace
+{
+	class SizeWalker
+	{
+		DirectorySizeProgress& m_progress;
+		const std::stop_token m_stop;
+		TaskGroup m_group {};
+
+		std::mutex m_links_mtx {};
+		//! Device and inode of files with more then one link, so they are only counted once
+		std::set< std::pair< std::uint64_t, std::uint64_t > > m_links {};
+
+		bool firstLink( const std::uint64_t device, const std::uint64_t inode )
+		{
+			std::lock_guard guard { m_links_mtx };
+			return m_links.emplace( device, inode ).second;
+		}
+
+		void add( const DirectorySize& size )
+		{
+			m_progress.bytes += size.bytes;
+			m_progress.allocated += size.allocated;
+			m_progress.files += size.files;
+			++m_progress.directories;
+		}
+
+		void spawn( std::string dir )
+		{
+			m_group.run( [ this, dir = std::move( dir ) ]() { walk( dir ); } );
+		}
+
+#ifdef __linux__
+		void walk( const std::string& dir )
+		{
+			ZoneScoped;
+			if ( m_stop.stop_requested() ) return;
+
+			const int dir_fd { ::open( dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC ) };
+			if ( dir_fd < 0 )
+			{
+				spdlog::warn( "directorySize: Failed to open {}: {}", dir, std::system_category().message( errno ) );
+				return;
+			}
+
+			DirectorySize size {};
+			const bool complete { readDirectory(
+				dir_fd,
+				[ & ]( const DirectoryEntry& entry )
+				{
+					if ( entry.type == DT_DIR )
+					{
+						spawn( dir + '/' + entry.name );
+						return;
+					}
+					if ( entry.type != DT_REG && entry.type != DT_UNKNOWN ) return;
+
+					struct statx info;
+					if ( ::statx(
+							 dir_fd,
+							 entry.name,
+							 AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC,
+							 STATX_TYPE | STATX_SIZE | STATX_BLOCKS | STATX_NLINK | STATX_INO,
+							 &info )
+					     != 0 )
+						return;
+
+					if ( S_ISDIR( info.stx_mode ) )
+					{
+						spawn( dir + '/' + entry.name );
+						return;
+					}
+					if ( !S_ISREG( info.stx_mode ) ) return;
+
+					if ( info.stx_nlink > 1
+					     && !firstLink( makedev( info.stx_dev_major, info.stx_dev_minor ), info.stx_ino ) )
+						return;
+
+					size.bytes += info.stx_size;
+					size.allocated += info.stx_blocks * 512;
+					++size.files;
+				} ) };
+
+			if ( !complete )
+				spdlog::warn( "directorySize: Failed to read {}: {}", dir, std::system_category().message( errno ) );
+
+			::close( dir_fd );
+			add( size );
+		}
+#else
+		void walk( const std::string& dir )
+		{
+			ZoneScoped;
+			if ( m_stop.stop_requested() ) return;
+
+			DirectorySize size {};
+			std::error_code ec {};
+			for ( auto itter = std::filesystem::directory_iterator( dir, ec );
+			      itter != std::filesystem::directory_iterator();
+			      itter.increment( ec ) )
+			{
+				if ( itter->is_symlink( ec ) ) continue;
+
+				if ( itter->is_directory( ec ) )
+				{
+					spawn( itter->path().string() );
+					continue;
+				}
+				if ( !itter->is_regular_file( ec ) ) continue;
+
+				//No inodes to tell hard links apart by, and no block counts
+				const auto file_size { itter->file_size( ec ) };
+				if ( ec ) continue;
+				size.bytes += file_size;
+				size.allocated += file_size;
+				++size.files;
+			}
+
+			if ( ec ) spdlog::warn( "directorySize: Failed to read {}: {}", dir, ec.message() );
+			add( size );
+		}
+#endif
+
+	  public:
+
+		SizeWalker( DirectorySizeProgress& progress, const std::stop_token stop ) :
+		  m_progress( progress ),
+		  m_stop( stop )
+		{}
+
+		void run( const std::filesystem::path& path )
+		{
+			auto root { path.string() };
+			while ( root.size() > 1 && root.ends_with( static_cast< char >( std::filesystem::path::preferred_separator ) ) )
+				root.pop_back();
+
+			spawn( std::move( root ) );
+			m_group.wait();
+		}
+	};
+} // namespace
+
+DirectorySize directorySize( const std::filesystem::path& path, DirectorySizeProgress* progress, std::stop_token stop )
+{
+	ZoneScoped;
+	DirectorySizeProgress local {};
+	auto& totals { progress ? *progress : local };
+
+	std::error_code ec {};
+	if ( !std::filesystem::is_directory( path, ec ) ) return totals.current();
+
+	SizeWalker( totals, stop ).run( path );
+	return totals.current();
+}
@@ -0,0 +1,45 @@
+//
+// Created by kj16609 on 8/1/23.
+//
+
+#ifndef ATLASGAMEMANAGER_DIRECTORYSIZE_HPP
+#define ATLASGAMEMANAGER_DIRECTORYSIZE_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <stop_token>
+
+struct DirectorySize
+{
+	//! Sum of the file sizes
+	std::uint64_t bytes { 0 };
+	//! Space taken on disk. Less then `bytes` for sparse or compressed files, more for lots of small ones
+	std::uint64_t allocated { 0 };
+	std::uint64_t files { 0 };
+
+	bool operator==( const DirectorySize& ) const = default;
+};
+
+//! Totals of a walk still running. Can be read from any thread while it runs
+struct DirectorySizeProgress
+{
+	std::atomic< std::uint64_t > bytes { 0 };
+	std::atomic< std::uint64_t > allocated { 0 };
+	std::atomic< std::uint64_t > files { 0 };
+	std::atomic< std::uint64_t > directories { 0 };
+
+	DirectorySize current() const { return { bytes, allocated, files }; }
+};
+
+//! Adds up the size of every regular file under `path`.
+/**
+ * Only the metadata of each entry is read, with `statx` on Linux. Nothing is kept per file.
+ * Directories are read in parallel on `WorkStealingPool::current()`.
+ * Symlinks aren't followed and hard links are counted once, the same as `du`.
+ * Directories that can't be read count as empty. Returns what was added up so far if `stop` is requested.
+ */
+DirectorySize directorySize(
+	const std::filesystem::path& path, DirectorySizeProgress* progress = nullptr, std::stop_token stop = {} );
+
+#endif //ATLASGAMEMANAGER_DIRECTORYSIZE_HPP
@@ -0,0 +1,366 @@
+//
+// Created by kj16609 on 7/31/23.
+//
+
+#include "ExecutableInfo.hpp"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <fstream>
+#include <span>
+#include <vector>
+
+#include <tracy/Tracy.hpp>
+
+#include "core/logging.hpp"
+#include "core/system.hpp"
+
+namespace
+{
+#if defined( __x86_64__ ) || defined( _M_X64 )
+	constexpr std::uint16_t native_pe_machine { 0x8664 };
+	constexpr std::uint16_t native_elf_machine { 62 };
+#elif defined( __aarch64__ ) || defined( _M_ARM64 )
+	constexpr std::uint16_t native_pe_machine { 0xAA64 };
+	constexpr std::uint16_t native_elf_machine { 183 };
+#else
+	constexpr std::uint16_t native_pe_machine { 0x014C };
+	constexpr std::uint16_t native_elf_machine { 3 };
+#endif
+
+	//! Anything bigger is a broken header, not a real executable
+	constexpr std::size_t max_sections { 96 };
+	constexpr std::size_t max_resource_entries { 256 };
+	//! VS_FIXEDFILEINFO is always near the start of the version resource
+	constexpr std::size_t version_search_size { 256 };
+
+	//! Reads parts of a file by offset
+	class HeaderReader
+	{
+#ifdef __linux__
+		int m_fd { -1 };
+#else
+		std::ifstream m_file;
+#endif
+
+	  public:
+
+		HeaderReader( const std::filesystem::path& path )
+#ifdef __linux__
+		  :
+		  m_fd( ::open( path.c_str(), O_RDONLY | O_CLOEXEC | O_NOCTTY ) )
+#else
+		  :
+		  m_file( path, std::ios::binary )
+#endif
+		{}
+
+		~HeaderReader()
+		{
+#ifdef __linux__
+			if ( m_fd >= 0 ) ::close( m_fd );
+#endif
+		}
+
+		HeaderReader( const HeaderReader& ) = delete;
+		HeaderReader& operator=( const HeaderReader& ) = delete;
+
+		bool isOpen() const
+		{
+#ifdef __linux__
+			return m_fd >= 0;
+#else
+			return m_file.is_open();
+#endif
+		}
+
+		//! Reads up to `out.size()` bytes at `offset`. Returns how many were read
+		std::size_t read( const std::uint64_t offset, const std::span< char > out )
+		{
+#ifdef __linux__
+			const auto read { ::pread( m_fd, out.data(), out.size(), static_cast< off_t >( offset ) ) };
+			return read < 0 ? 0 : static_cast< std::size_t >( read );
+#else
+			m_file.clear();
+			m_file.seekg( static_cast< std::streamoff >( offset ) );
+			m_file.read( out.data(), static_cast< std::streamsize >( out.size() ) );
+			return static_cast< std::size_t >( m_file.gcount() );
+#endif
+		}
+
+		//! False unless all of `out` could be read
+		bool readExact( const std::uint64_t offset, const std::span< char > out )
+		{
+			return read( offset, out ) == out.size();
+		}
+	};
+
+	template < typename T >
+	T little( const char* data )
+	{
+		T value { 0 };
+		for ( std::size_t i = 0; i < sizeof( T ); ++i )
+			value |= static_cast< T >( static_cast< T >( static_cast< unsigned char >( data[ i ] ) ) << ( 8 * i ) );
+		return value;
+	}
+
+	template < typename T >
+	T big( const char* data )
+	{
+		T value { 0 };
+		for ( std::size_t i = 0; i < sizeof( T ); ++i )
+			value = static_cast< T >( ( value << 8 ) | static_cast< unsigned char >( data[ i ] ) );
+		return value;
+	}
+
+	struct Section
+	{
+		std::uint32_t address;
+		std::uint32_t size;
+		std::uint32_t offset;
+	};
+
+	struct ResourceEntry
+	{
+		std::uint32_t id;
+		//! From the start of the resource section
+		std::uint32_t offset;
+		bool directory;
+	};
+
+	class PeParser
+	{
+		HeaderReader& m_reader;
+		std::vector< Section > m_sections {};
+		std::uint64_t m_resources { 0 };
+
+		std::optional< std::uint64_t > fileOffset( const std::uint32_t address ) const
+		{
+			for ( const auto& section : m_sections )
+				if ( address >= section.address && address - section.address < section.size )
+					return static_cast< std::uint64_t >( section.offset ) + ( address - section.address );
+			return std::nullopt;
+		}
+
+		std::vector< ResourceEntry > directory( const std::uint32_t offset )
+		{
+			std::array< char, 16 > header {};
+			if ( !m_reader.readExact( m_resources + offset, header ) ) return {};
+
+			const std::size_t count { std::min< std::size_t >(
+				static_cast< std::size_t >( little< std::uint16_t >( header.data() + 12 ) )
+					+ little< std::uint16_t >( header.data() + 14 ),
+				max_resource_entries ) };
+
+			std::vector< char > raw( count * 8 );
+			const auto read { m_reader.read( m_resources + offset + header.size(), raw ) / 8 };
+
+			std::vector< ResourceEntry > entries {};
+			for ( std::size_t i = 0; i < read; ++i )
+			{
+				const auto target { little< std::uint32_t >( raw.data() + i * 8 + 4 ) };
+				entries.emplace_back( ResourceEntry {
+					little< std::uint32_t >( raw.data() + i * 8 ), target & 0x7FFFFFFF, ( target & 0x80000000 ) != 0 } );
+			}
+			return entries;
+		}
+
+		//! Data of the first resource of `type`, in any name and language. File offset and size
+		std::optional< std::pair< std::uint64_t, std::uint32_t > > resource( const std::uint32_t type )
+		{
+			const auto types { directory( 0 ) };
+			const auto found { std::find_if(
+				types.begin(),
+				types.end(),
+				[ type ]( const ResourceEntry& entry ) { return entry.id == type && entry.directory; } ) };
+			if ( found == types.end() ) return std::nullopt;
+
+			//Name, then language
+			auto entry { *found };
+			for ( int level = 0; level < 2 && entry.directory; ++level )
+			{
+				const auto children { directory( entry.offset ) };
+				if ( children.empty() ) return std::nullopt;
+				entry = children.front();
+			}
+			if ( entry.directory ) return std::nullopt;
+
+			std::array< char, 8 > data {};
+			if ( !m_reader.readExact( m_resources + entry.offset, data ) ) return std::nullopt;
+
+			const auto offset { fileOffset( little< std::uint32_t >( data.data() ) ) };
+			if ( !offset ) return std::nullopt;
+			return std::make_pair( *offset, little< std::uint32_t >( data.data() + 4 ) );
+		}
+
+	  public:
+
+		PeParser( HeaderReader& reader ) : m_reader( reader ) {}
+
+		void parse( const std::span< const char > dos, ExecutableInfo& info )
+		{
+			if ( dos.size() < 0x40 ) return;
+			const std::uint32_t nt_offset { little< std::uint32_t >( dos.data() + 0x3C ) };
+
+			//Signature, COFF header and the largest optional header
+			std::array< char, 4 + 20 + 240 > nt {};
+			const auto nt_read { m_reader.read( nt_offset, nt ) };
+			if ( nt_read < 24 + 72 || !std::equal( nt.begin(), nt.begin() + 4, "PE\0\0" ) ) return;
+
+			info.machine = little< std::uint16_t >( nt.data() + 4 );
+			const std::size_t section_count { std::min< std::size_t >( little< std::uint16_t >( nt.data() + 6 ),
+				                                                        max_sections ) };
+			const std::uint16_t optional_size { little< std::uint16_t >( nt.data() + 20 ) };
+
+			const char* optional { nt.data() + 24 };
+			const auto magic { little< std::uint16_t >( optional ) };
+			if ( magic != 0x10B && magic != 0x20B ) return;
+			info.bits = magic == 0x20B ? 64 : 32;
+			info.subsystem = little< std::uint16_t >( optional + 68 );
+
+			//Resource table is the third data directory
+			const std::size_t directories { magic == 0x20B ? 112u : 96u };
+			if ( optional_size < directories + 3 * 8 || nt_read < 24 + directories + 3 * 8 ) return;
+			if ( little< std::uint32_t >( optional + directories - 4 ) < 3 ) return;
+			const auto resource_address { little< std::uint32_t >( optional + directories + 2 * 8 ) };
+			if ( resource_address == 0 ) return;
+
+			std::vector< char > sections( section_count * 40 );
+			const auto sections_read { m_reader.read( nt_offset + 24 + optional_size, sections ) / 40 };
+			for ( std::size_t i = 0; i < sections_read; ++i )
+			{
+				const char* section { sections.data() + i * 40 };
+				m_sections.emplace_back( Section { little< std::uint32_t >( section + 12 ),
+					                               std::max( little< std::uint32_t >( section + 8 ),
+					                                         little< std::uint32_t >( section + 16 ) ),
+					                               little< std::uint32_t >( section + 20 ) } );
+			}
+
+			const auto resources { fileOffset( resource_address ) };
+			if ( !resources ) return;
+			m_resources = *resources;
+
+			//RT_ICON
+			if ( const auto icon = resource( 3 ); icon ) info.icon_offset = static_cast< std::uint32_t >( icon->first );
+
+			//RT_VERSION
+			if ( const auto version = resource( 16 ); version )
+			{
+				std::vector< char > data( std::min< std::size_t >( version->second, version_search_size ) );
+				data.resize( m_reader.read( version->first, data ) );
+
+				//VS_FIXEDFILEINFO starts with it's signature, 4 byte aligned
+				for ( std::size_t i = 0; i + 16 <= data.size(); i += 4 )
+				{
+					if ( little< std::uint32_t >( data.data() + i ) != 0xFEEF04BD ) continue;
+
+					const auto high { little< std::uint32_t >( data.data() + i + 8 ) };
+					const auto low { little< std::uint32_t >( data.data() + i + 12 ) };
+					info.version = fmt::format( "{}.{}.{}.{}", high >> 16, high & 0xFFFF, low >> 16, low & 0xFFFF );
+					break;
+				}
+			}
+		}
+	};
+
+	void parseElf( const std::span< const char > header, ExecutableInfo& info )
+	{
+		if ( header.size() < 20 ) return;
+		info.bits = header[ 4 ] == 2 ? 64 : header[ 4 ] == 1 ? 32 : 0;
+		info.machine = header[ 5 ] == 2 ? big< std::uint16_t >( header.data() + 18 ) :
+		                                  little< std::uint16_t >( header.data() + 18 );
+	}
+} // namespace
+
+bool ExecutableInfo::isNative() const
+{
+	switch ( format )
+	{
+		case ExecutableFormat::PE:
+			return sys::is_windows && machine == native_pe_machine;
+		case ExecutableFormat::ELF:
+			return sys::is_linux && machine == native_elf_machine;
+		default:
+			return false;
+	}
+}
+
+std::string ExecutableInfo::machineName() const
+{
+	if ( format == ExecutableFormat::PE )
+	{
+		switch ( machine )
+		{
+			case 0x014C:
+				return "x86";
+			case 0x8664:
+				return "x86-64";
+			case 0xAA64:
+				return "ARM64";
+			case 0x01C4:
+				return "ARM";
+			default:
+				break;
+		}
+	}
+	else if ( format == ExecutableFormat::ELF )
+	{
+		switch ( machine )
+		{
+			case 3:
+				return "x86";
+			case 62:
+				return "x86-64";
+			case 183:
+				return "ARM64";
+			case 40:
+				return "ARM";
+			default:
+				break;
+		}
+	}
+
+	return machine == 0 ? "" : fmt::format( "{:#06x}", machine );
+}
+
+std::optional< ExecutableInfo > readExecutableInfo( const std::filesystem::path& path, const std::string_view ext )
+{
+	ZoneScoped;
+	HeaderReader reader { path };
+	if ( !reader.isOpen() ) return std::nullopt;
+
+	std::array< char, sniff_size > header {};
+	const std::span< const char > read { header.data(), reader.read( 0, header ) };
+
+	ExecutableInfo info {};
+	info.format = sniffHeader( read, ext );
+
+	switch ( info.format )
+	{
+		case ExecutableFormat::None:
+			return std::nullopt;
+		case ExecutableFormat::PE:
+			PeParser( reader ).parse( read, info );
+			break;
+		case ExecutableFormat::ELF:
+			parseElf( read, info );
+			break;
+		default:
+			break;
+	}
+
+	return info;
+}
+
+std::optional< ExecutableInfo > readExecutableInfo( const std::filesystem::path& path )
+{
+	std::string ext { path.extension().string() };
+	std::transform( ext.begin(), ext.end(), ext.begin(), []( const unsigned char c ) { return std::tolower( c ); } );
+	return readExecutableInfo( path, ext );
+}
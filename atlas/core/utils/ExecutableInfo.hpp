@@ -0,0 +1,53 @@
+//
+// Created by kj16609 on 7/31/23.
+//
+
+#ifndef ATLASGAMEMANAGER_EXECUTABLEINFO_HPP
+#define ATLASGAMEMANAGER_EXECUTABLEINFO_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "ExecutableSniffer.hpp"
+
+//! What the headers of an executable say about it. Only the headers are read, never the code
+struct ExecutableInfo
+{
+	ExecutableFormat format { ExecutableFormat::None };
+	//! PE `Machine` or ELF `e_machine`. 0 for anything else
+	std::uint16_t machine { 0 };
+	//! 32 or 64. 0 if not known
+	std::uint8_t bits { 0 };
+	//! PE subsystem. 2 is a GUI, 3 is a console. 0 for anything else
+	std::uint16_t subsystem { 0 };
+	//! File version from the PE version resource, like `1.2.0.0`. Empty if there is none
+	std::string version {};
+	//! File offset of the first icon in the PE resources. 0 if there is none
+	std::uint32_t icon_offset { 0 };
+
+	//! Opens a window instead of a console. Only known for PE
+	bool isGui() const { return subsystem == 2; }
+
+	//! Runs on this machine without wine or emulation
+	bool isNative() const;
+
+	//! Like `x86-64`. Empty if there is no machine
+	std::string machineName() const;
+
+	bool operator==( const ExecutableInfo& ) const = default;
+};
+
+//! Sniffs `path` and reads it's PE or ELF headers. Empty if it isn't an executable with extension `ext` (lower case)
+/**
+ * A PE costs a few small reads: The DOS and NT headers, the section table and the resource directories.
+ * Broken or truncated headers give what could be read up to that point.
+ */
+std::optional< ExecutableInfo > readExecutableInfo( const std::filesystem::path& path, const std::string_view ext );
+
+//! Same as above, with the extension taken from `path`
+std::optional< ExecutableInfo > readExecutableInfo( const std::filesystem::path& path );
+
+#endif //ATLASGAMEMANAGER_EXECUTABLEINFO_HPP
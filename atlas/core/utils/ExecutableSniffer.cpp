@@ -0,0 +1,89 @@
+//
+// Created by kj16609 on 7/31/23.
+//
+
+#include "ExecutableSniffer.hpp"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <fstream>
+
+#include <tracy/Tracy.hpp>
+
+#include "core/system.hpp"
+
+namespace
+{
+	bool startsWith( const std::span< const char > header, const std::string_view magic )
+	{
+		return header.size() >= magic.size() && std::equal( magic.begin(), magic.end(), header.begin() );
+	}
+
+	bool isMachO( const std::span< const char > header )
+	{
+		//32 and 64 bit in either byte order, and fat binaries
+		constexpr std::array< std::string_view, 5 > magics { std::string_view( "\xFE\xED\xFA\xCE", 4 ),
+			                                                 std::string_view( "\xCE\xFA\xED\xFE", 4 ),
+			                                                 std::string_view( "\xFE\xED\xFA\xCF", 4 ),
+			                                                 std::string_view( "\xCF\xFA\xED\xFE", 4 ),
+			                                                 std::string_view( "\xCA\xFE\xBA\xBE", 4 ) };
+		return std::ranges::any_of( magics, [ &header ]( const auto magic ) { return startsWith( header, magic ); } );
+	}
+
+	//! No NUL bytes. Good enough to tell a page from a binary with the wrong extension
+	bool isText( const std::span< const char > header )
+	{
+		return std::find( header.begin(), header.end(), '\0' ) == header.end();
+	}
+} // namespace
+
+bool isExecutableExtension( const std::string_view ext )
+{
+	if ( ext == ".exe" || ext == ".html" ) return true;
+	if constexpr ( sys::is_linux )
+		return ext == ".sh" || ext == ".x86_64";
+	else
+		return false;
+}
+
+ExecutableFormat sniffHeader( const std::span< const char > header, const std::string_view ext )
+{
+	if ( startsWith( header, "MZ" ) ) return ext == ".exe" ? ExecutableFormat::PE : ExecutableFormat::None;
+	if ( startsWith( header, "\x7F"
+	                         "ELF" ) )
+		return ext == ".exe" || ext == ".html" ? ExecutableFormat::None : ExecutableFormat::ELF;
+	if ( isMachO( header ) ) return ext == ".exe" || ext == ".html" ? ExecutableFormat::None : ExecutableFormat::MachO;
+	if ( startsWith( header, "#!" ) ) return ext == ".sh" ? ExecutableFormat::Script : ExecutableFormat::None;
+
+	if ( ext == ".html" && isText( header ) ) return ExecutableFormat::HTML;
+	return ExecutableFormat::None;
+}
+
+ExecutableFormat sniffExecutable( const std::filesystem::path& path, const std::string_view ext )
+{
+	ZoneScoped;
+	std::array< char, sniff_size > header {};
+	std::size_t read { 0 };
+
+#ifdef __linux__
+	const int fd { ::open( path.c_str(), O_RDONLY | O_CLOEXEC | O_NOCTTY ) };
+	if ( fd < 0 ) return ExecutableFormat::None;
+	const auto result { ::pread( fd, header.data(), header.size(), 0 ) };
+	::close( fd );
+	if ( result < 0 ) return ExecutableFormat::None;
+	read = static_cast< std::size_t >( result );
+#else
+	std::ifstream file { path, std::ios::binary };
+	if ( !file ) return ExecutableFormat::None;
+	file.read( header.data(), static_cast< std::streamsize >( header.size() ) );
+	read = static_cast< std::size_t >( file.gcount() );
+#endif
+
+	return sniffHeader( { header.data(), read }, ext );
+}
@@ -0,0 +1,40 @@
+//
+// Created by kj16609 on 7/31/23.
+//
+
+#ifndef ATLASGAMEMANAGER_EXECUTABLESNIFFER_HPP
+#define ATLASGAMEMANAGER_EXECUTABLESNIFFER_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string_view>
+
+//! What a file can be run as, going by it's first bytes
+enum class ExecutableFormat : std::uint8_t
+{
+	None = 0,
+	//! MZ header. Windows executables
+	PE,
+	ELF,
+	MachO,
+	//! Starts with `#!`
+	Script,
+	//! Text. A doctype isn't needed, plenty of games leave it out
+	HTML,
+};
+
+//! Bytes read from the start of a file. Enough for every magic number and a doctype after some whitespace
+inline constexpr std::size_t sniff_size { 64 };
+
+//! True if files ending in `ext` (lower case) can be a game's executable. Anything else isn't read
+bool isExecutableExtension( const std::string_view ext );
+
+//! Format of a file starting with `header`, named with extension `ext` (lower case).
+//! None if the bytes don't fit the extension, like a `.exe` without an MZ header
+ExecutableFormat sniffHeader( const std::span< const char > header, const std::string_view ext );
+
+//! Reads the first `sniff_size` bytes of `path` with a single read. None if it can't be read
+ExecutableFormat sniffExecutable( const std::filesystem::path& path, const std::string_view ext );
+
+#endif //ATLASGAMEMANAGER_EXECUTABLESNIFFER_HPP
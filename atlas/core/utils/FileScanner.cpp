@@ -4,140 +4,274 @@
 
 #include "FileScanner.hpp"
 
-#include <queue>
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include <tracy/Tracy.hpp>
 
+#include "DirectoryReader.hpp"
+#include "WorkStealingPool.hpp"
 #include "core/logging.hpp"
 
-FileInfo FileScannerGenerator::operator()()
+namespace
 {
-	ZoneScoped;
-	if ( m_h.done() ) throw std::runtime_error( "FileScannerGenerator is done." );
-	m_h();
+	constexpr char separator { static_cast< char >( std::filesystem::path::preferred_separator ) };
 
-	if ( m_h.promise().exception ) std::rethrow_exception( m_h.promise().exception );
-	if ( m_h.promise().value.has_value() )
-		return m_h.promise().value.value();
-	else
-		throw std::runtime_error( "Failed to get value from FileScannerGenerator." );
-}
+	//! Contents of a single directory. The names of all entries share one buffer
+	struct DirectoryListing
+	{
+		struct Entry
+		{
+			std::uint32_t name_offset;
+			std::uint32_t name_length;
+			std::uint64_t size;
+			bool directory;
+		};
 
-#ifdef __GNUC__
-#pragma GCC diagnostic push
-#pragma GCC diagnostic ignored "-Wswitch-default" // Added due to GCC bug 109867
-#pragma GCC diagnostic ignored                                                                                         \
-	"-Wzero-as-null-pointer-constant" // Added due to FileScannerGenerator returns being weird at the end of scan_files and thinking that it's somehow returning zero as a nullptr. Probably UB but we throw at the end anyways so *shrug* Should be defined enough.
-#endif
+		std::string names {};
+		std::vector< Entry > entries {};
 
-FileScannerGenerator scan_files( const std::filesystem::path path )
-{
-	if ( !std::filesystem::exists( path ) )
+		void add( const std::string_view name, const std::uint64_t size, const bool directory )
+		{
+			entries.emplace_back( Entry { static_cast< std::uint32_t >( names.size() ),
+			                              static_cast< std::uint32_t >( name.size() ),
+			                              size,
+			                              directory } );
+			names += name;
+		}
+
+		std::string_view name( const Entry& entry ) const
+		{
+			return std::string_view( names ).substr( entry.name_offset, entry.name_length );
+		}
+	};
+
+	//! Checked before anything is opened
+	const std::filesystem::path& existing( const std::filesystem::path& path )
 	{
-		spdlog::error( "scan_files: Path {} does not exist.", path.string() );
-		throw std::runtime_error( "Path does not exist." );
+		if ( !std::filesystem::exists( path ) )
+		{
+			spdlog::error( "FileScanner: Path {} does not exist.", path.string() );
+			throw std::runtime_error( "Path does not exist." );
+		}
+		return path;
 	}
+} // namespace
+
+FileInfo::FileInfo(
+	const std::string_view full_path_in,
+	const std::size_t relative_offset,
+	const std::size_t filesize,
+	const std::uint8_t file_depth,
+	const bool is_directory ) :
+  full_path( full_path_in ),
+  relative_path( relative_offset < full_path_in.size() ? full_path_in.substr( relative_offset ) : "." ),
+  filename( full_path_in.substr( full_path_in.find_last_of( separator ) + 1 ) ),
+  size( filesize ),
+  depth( file_depth ),
+  directory( is_directory )
+{
+	//Same as std::filesystem::path::extension. A leading dot is a hidden file, not an extension
+	const auto dot { filename.find_last_of( '.' ) };
+	if ( dot != std::string_view::npos && dot != 0 ) ext = filename.substr( dot );
+}
+
+#ifdef __linux__
 
-	auto dir_empty = []( const std::filesystem::path& dir_path ) -> bool
-	{ return std::filesystem::directory_iterator( dir_path ) == std::filesystem::directory_iterator(); };
+//! The scanned directory, kept open so everything under it is opened relative to it
+struct ScanRoot
+{
+	int fd { -1 };
 
-	if ( dir_empty( path ) ) co_return FileInfo { path, path, 0, 0 };
+	ScanRoot( const std::filesystem::path& path ) :
+	  fd( ::open( path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC ) )
+	{
+		if ( fd < 0 )
+			throw std::runtime_error( fmt::format(
+				"FileScanner: Failed to open {}: {}", path.string(), std::system_category().message( errno ) ) );
+	}
 
-	std::queue< std::pair< std::filesystem::path, std::uint8_t > > dirs {};
+	~ScanRoot() { ::close( fd ); }
 
-	dirs.push( { path, 0 } );
+	ScanRoot( const ScanRoot& ) = delete;
+	ScanRoot& operator=( const ScanRoot& ) = delete;
 
-	while ( dirs.size() > 0 )
+	//! Lists `relative`, which is empty for the root itself. Directories that can't be read are treated as empty
+	DirectoryListing list( const std::string& relative ) const
 	{
-		const auto [ dir, depth ] { std::move( dirs.front() ) };
-		dirs.pop();
-		std::vector< std::filesystem::path > nested_dirs;
+		ZoneScoped;
+		DirectoryListing listing {};
 
-		//Recurse through the directory.
-		for ( auto itter = std::filesystem::directory_iterator( dir ); itter != std::filesystem::directory_iterator(); )
+		const int dir_fd { ::openat( fd, relative.empty() ? "." : relative.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC ) };
+		if ( dir_fd < 0 )
 		{
-			if ( itter->is_directory() )
+			spdlog::warn( "FileScanner: Failed to open {}: {}", relative, std::system_category().message( errno ) );
+			return listing;
+		}
+
+		const bool complete { readDirectory(
+			dir_fd,
+			[ & ]( const DirectoryEntry& entry )
 			{
-				//Add directory to scan list.
-				nested_dirs.emplace_back( *itter );
-				++itter;
-				continue;
-			}
+				bool directory { entry.type == DT_DIR };
+				std::uint64_t size { 0 };
 
-			FileInfo info {
-				*itter, path, itter->is_regular_file() ? itter->file_size() : 0, std::uint8_t( depth + 1 )
-			};
+				//Only regular files have a size. Links and unknown types are followed like std::filesystem::is_directory
+				if ( entry.type == DT_REG || entry.type == DT_LNK || entry.type == DT_UNKNOWN )
+				{
+					struct statx info;
+					if ( ::statx( dir_fd, entry.name, AT_STATX_DONT_SYNC, STATX_TYPE | STATX_SIZE, &info ) == 0 )
+					{
+						directory = S_ISDIR( info.stx_mode );
+						if ( S_ISREG( info.stx_mode ) ) size = info.stx_size;
+					}
+				}
 
-			++itter;
+				listing.add( entry.name, size, directory );
+			} ) };
 
-			//If we are at the last file and there are no more directories to scan then return.
-			if ( itter == std::filesystem::directory_iterator() && dirs.size() == 0 && nested_dirs.size() == 0 )
-				co_return std::move( info );
-			else
-				co_yield std::move( info );
-		}
+		if ( !complete )
+			spdlog::warn( "FileScanner: Failed to read {}: {}", relative, std::system_category().message( errno ) );
 
-		//Add the nested dirs to the scanlist and yield them
-		for ( std::size_t i = 0; i < nested_dirs.size(); ++i )
+		::close( dir_fd );
+		return listing;
+	}
+};
+
+#else
+
+struct ScanRoot
+{
+	std::filesystem::path path;
+
+	ScanRoot( const std::filesystem::path& path_in ) : path( path_in )
+	{
+		if ( !std::filesystem::is_directory( path ) )
+			throw std::runtime_error( fmt::format( "FileScanner: {} is not a directory", path.string() ) );
+	}
+
+	//! Lists `relative`, which is empty for the root itself. Directories that can't be read are treated as empty
+	DirectoryListing list( const std::string& relative ) const
+	{
+		ZoneScoped;
+		DirectoryListing listing {};
+
+		std::error_code ec {};
+		for ( auto itter = std::filesystem::directory_iterator( path / relative, ec );
+		      itter != std::filesystem::directory_iterator();
+		      itter.increment( ec ) )
 		{
-			// Check if the directory is empty and if it's not then add it to the scan queue.
-			if ( !dir_empty( nested_dirs.at( i ) ) )
-			{
-				dirs.push( { nested_dirs.at( i ), depth + 1 } );
-				co_yield FileInfo { nested_dirs.at( i ), path, 0, std::uint8_t( depth + 1 ) };
-			}
-			else
-			{
-				//Dir is empty. If we don't have anything else to process then return. Else yield.
-				if ( i == nested_dirs.size() - 1 && dirs.size() == 0 )
-					co_return FileInfo { nested_dirs.at( i ), path, 0, std::uint8_t( depth + 1 ) };
-				else
-					co_yield FileInfo { nested_dirs.at( i ), path, 0, std::uint8_t( depth + 1 ) };
-			}
+			const bool is_file { itter->is_regular_file( ec ) };
+			listing.add(
+				itter->path().filename().string(),
+				is_file ? itter->file_size( ec ) : 0,
+				!is_file && itter->is_directory( ec ) );
 		}
-	}
 
-	spdlog::error( "Managed to escape loop in coroutine scan_files" );
-	throw std::runtime_error( "Managed to escape loop in coroutine scan_files" );
-}
+		if ( ec ) spdlog::warn( "FileScanner: Failed to read {}: {}", relative, ec.message() );
+		return listing;
+	}
+};
 
-#ifdef __GNUC__
-#pragma GCC diagnostic pop
 #endif
 
 FileScanner::FileScanner( const std::filesystem::path& path ) :
-  m_path( path ),
-  file_scanner( scan_files( path ) ),
-  files( { file_scanner() } )
-{}
+  m_path( existing( path ) ),
+  m_root( std::make_unique< ScanRoot >( path ) )
+{
+	ZoneScoped;
+	m_unread.emplace_back();
 
-const FileInfo& FileScanner::at( std::size_t index )
+	readNextDepth();
+	if ( files.empty() )
+	{
+		const std::string_view root { m_names.emplace_back( m_path.string() ) };
+		files.emplace_back( root, root.size(), 0, 0, true );
+	}
+}
+
+FileScanner::~FileScanner() = default;
+
+bool FileScanner::readNextDepth()
 {
 	ZoneScoped;
-	if ( index >= files.size() && !file_scanner.m_h.done() )
+	if ( m_unread.empty() ) return false;
+
+	auto dirs { std::exchange( m_unread, {} ) };
+	std::vector< DirectoryListing > listings( dirs.size() );
+
+	if ( dirs.size() == 1 )
+		listings[ 0 ] = m_root->list( dirs[ 0 ] );
+	else
 	{
-		// Index is higher then what we have.
-		// Scanner is also NOT done.
-		// We use the coroutine to fetch what the next file should be.
+		TaskGroup group {};
+		for ( std::size_t i = 0; i < dirs.size(); ++i )
+			group.run( [ this, &dirs, &listings, i ]() { listings[ i ] = m_root->list( dirs[ i ] ); } );
+		group.wait();
+	}
+
+	//Every path is built once from it's parts, into one buffer for the whole depth. The relative path is everything after the prefix
+	auto prefix { m_path.string() };
+	if ( !prefix.ends_with( separator ) ) prefix += separator;
+	const auto depth { static_cast< std::uint8_t >( m_unread_depth + 1 ) };
 
-		std::size_t diff { index - ( files.size() - 1 ) };
+	//Sized up front. Growing it would move the names already given out
+	std::size_t total { 0 };
+	for ( std::size_t i = 0; i < dirs.size(); ++i )
+		total += listings[ i ].entries.size() * ( prefix.size() + dirs[ i ].size() ) + listings[ i ].names.size();
 
-		while ( diff > 0 && !file_scanner.m_h.done() )
+	auto& names { m_names.emplace_back() };
+	names.reserve( total );
+
+	for ( std::size_t i = 0; i < dirs.size(); ++i )
+	{
+		const auto& listing { listings[ i ] };
+
+		//Files first, then the directories so they come out in the same order they are read
+		for ( const bool directories : { false, true } )
 		{
-			files.emplace_back( file_scanner() );
-			--diff;
+			for ( const auto& entry : listing.entries )
+			{
+				if ( entry.directory != directories ) continue;
+
+				const auto start { names.size() };
+				names += prefix;
+				names += dirs[ i ];
+				names += listing.name( entry );
+				const auto& file {
+					files.emplace_back( std::string_view( names ).substr( start ), prefix.size(), entry.size, depth, entry.directory )
+				};
+
+				if ( entry.directory ) m_unread.emplace_back( std::string( file.relative_path ) + separator );
+			}
 		}
 	}
 
-	if ( files.size() < index )
+	m_unread_depth = depth;
+	return true;
+}
+
+const FileInfo& FileScanner::at( std::size_t index )
+{
+	ZoneScoped;
+	while ( index >= files.size() && readNextDepth() )
+		;
+
+	if ( index >= files.size() )
 		throw std::
 			runtime_error( fmt::format( "FileScanner::at({}): size < index : {} < {}", index, files.size(), index ) );
 
-	return files.at( index );
+	return files[ index ];
 }
 
 bool FileScanner::iterator::operator==( const std::unreachable_sentinel_t ) const
 {
 	ZoneScoped;
-	return m_scanner.file_scanner.m_h.done() && ( m_idx == m_scanner.files.size() );
+	while ( m_idx >= m_scanner.files.size() && m_scanner.readNextDepth() )
+		;
+
+	return m_idx >= m_scanner.files.size();
 }
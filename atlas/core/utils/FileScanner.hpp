@@ -5,112 +5,74 @@
 #ifndef ATLASGAMEMANAGER_FILESCANNER_HPP
 #define ATLASGAMEMANAGER_FILESCANNER_HPP
 
-#include <coroutine>
+#include <deque>
 #include <filesystem>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "core/logging.hpp"
 
+//! One entry of a `FileScanner`.
+/**
+ * The names are views into the scanner, which builds every path of a depth in one buffer.
+ * They stay valid for as long as the scanner does. Copy them out to keep them any longer.
+ */
 struct FileInfo
 {
-	std::string filename { "" };
-	std::string ext { "" };
-	std::filesystem::path path { "" };
+	//! Starts with the scanned directory
+	std::string_view full_path { "" };
+	//! Everything after the scanned directory. `.` for the scanned directory itself
+	std::string_view relative_path { "" };
+	std::string_view filename { "" };
+	//! Includes the dot. Empty if there is none
+	std::string_view ext { "" };
 	std::size_t size { 0 };
 	std::uint8_t depth { 0 };
-	std::filesystem::path relative { "" };
+	//! Symlinks to directories count as directories
+	bool directory { false };
 
 	FileInfo() = delete;
 
+	//! `full_path` must start with the scanned directory, `relative_offset` long including the separator
 	FileInfo(
-		std::filesystem::path path_in,
-		const std::filesystem::path& source,
+		const std::string_view full_path_in,
+		const std::size_t relative_offset,
 		const std::size_t filesize,
-		const std::uint8_t file_depth ) :
-	  filename( path_in.filename().string() ),
-	  ext( path_in.extension().string() ),
-	  path( path_in ),
-	  size( filesize ),
-	  depth( file_depth ),
-	  relative( std::filesystem::relative( std::move( path_in ), source ) )
-	{}
-};
-
-struct FileScannerGenerator
-{
-	struct promise_type;
-	using handle_type = std::coroutine_handle< promise_type >;
-
-	struct promise_type
-	{
-		std::optional< FileInfo > value { std::nullopt };
-		std::exception_ptr exception { nullptr };
-
-		FileScannerGenerator get_return_object() { return FileScannerGenerator( handle_type::from_promise( *this ) ); }
+		const std::uint8_t file_depth,
+		const bool is_directory );
 
-		std::suspend_always initial_suspend() noexcept { return {}; }
+	std::filesystem::path path() const { return full_path; }
 
-		std::suspend_always final_suspend() noexcept { return {}; }
-
-		void unhandled_exception()
-		{
-			if ( exception )
-			{
-				try
-				{
-					std::rethrow_exception( exception );
-				}
-				catch ( std::exception& e )
-				{
-					spdlog::critical( "FileScannerGenerator: Unhandled exception in coroutine! {}", e.what() );
-				}
-				catch ( ... )
-				{
-					spdlog::critical( "FileScannerGenerator: Unhandled exception in coroutine! FUCK!" );
-				}
-			}
-			else
-				spdlog::critical( "FileScannerGenerator: Unhandled exception but no value!" );
-			std::terminate();
-		}
-
-		void return_value( FileInfo&& from )
-		{
-			if ( from.filename == "" )
-				throw std::runtime_error( "FileScannerGenerator: return value had no filename!" );
-
-			value = std::move( from );
-		}
-
-		std::suspend_always yield_value( FileInfo from )
-		{
-			if ( from.filename == "" )
-				throw std::runtime_error( "FromScannerGenerator:: yield value had no filename!" );
-
-			value = std::move( from );
-			return {};
-		}
-	};
-
-	handle_type m_h;
-
-	FileScannerGenerator( handle_type h ) : m_h( h ) {}
-
-	~FileScannerGenerator() { m_h.destroy(); }
-
-	FileInfo operator()();
+	std::filesystem::path relative() const { return relative_path; }
 };
 
-struct FileScanner
+struct ScanRoot;
+
+//! Breadth first listing of every file and directory under a path.
+/**
+ * Files of a directory come before it's subdirectories, and all of a depth comes before the next.
+ * The listing is read a depth at a time as it's iterated, with the directories of a depth read in parallel on
+ * `WorkStealingPool::current()`. Stopping at a depth doesn't read anything deeper.
+ * An empty directory gives only itself.
+ */
+class FileScanner
 {
 	std::filesystem::path m_path;
-	FileScannerGenerator file_scanner;
-	std::vector< FileInfo > files;
+	std::unique_ptr< ScanRoot > m_root;
+	std::vector< FileInfo > files {};
+	//! Every path in `files`, one buffer per depth. A deque so the buffers never move
+	std::deque< std::string > m_names {};
+
+	//! Directories found but not yet read, relative to `m_path` with a trailing separator
+	std::vector< std::string > m_unread {};
+	std::uint8_t m_unread_depth { 0 };
 
-	friend class iterator;
+	//! Reads every directory in `m_unread`. Returns false if there were none
+	bool readNextDepth();
 
-  private:
+	const FileInfo& at( std::size_t index );
 
 	class iterator
 	{
@@ -127,9 +89,7 @@ struct FileScanner
 			return *this;
 		}
 
-		// Operator != required to check for end I assume. Where if the this returns true then we are good to continue
-		// So instead we can just return the state of the scanner. And if the scanner is complete then we'll return false here.
-		//bool operator !=
+		//! Reads more of the tree if needed. True once there is nothing left
 		bool operator==( const std::unreachable_sentinel_t ) const;
 
 		// Required for the for loop
@@ -138,13 +98,12 @@ struct FileScanner
 
   public:
 
+	//! Throws if `path` doesn't exist or isn't a directory
 	FileScanner( const std::filesystem::path& path );
+	~FileScanner();
 
-  private:
-
-	const FileInfo& at( std::size_t index );
-
-  public:
+	FileScanner( const FileScanner& ) = delete;
+	FileScanner& operator=( const FileScanner& ) = delete;
 
 	iterator begin() { return iterator( 0, *this ); }
 
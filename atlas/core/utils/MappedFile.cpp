@@ -0,0 +1,30 @@
+//
+// Created by kj16609 on 7/13/23.
+//
+
+#include "MappedFile.hpp"
+
+#include <tracy/Tracy.hpp>
+
+#include "core/logging.hpp"
+
+MappedFile::MappedFile( const std::filesystem::path& path ) : m_file( path )
+{
+	ZoneScoped;
+	if ( !m_file.open( QFile::ReadOnly ) )
+		throw std::runtime_error( fmt::format( "Failed to open {} for mapping: {}", path, m_file.errorString() ) );
+
+	const auto file_size { m_file.size() };
+	uchar* ptr { m_file.map( 0, file_size ) };
+	if ( ptr == nullptr )
+		throw std::runtime_error( fmt::format( "Failed to map {}: {}", path, m_file.errorString() ) );
+
+	m_data = reinterpret_cast< const char* >( ptr );
+	m_size = static_cast< std::size_t >( file_size );
+}
+
+MappedFile::~MappedFile()
+{
+	//QFile would unmap on close anyways. But be explicit about it.
+	m_file.unmap( reinterpret_cast< uchar* >( const_cast< char* >( m_data ) ) );
+}
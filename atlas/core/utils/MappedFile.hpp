@@ -0,0 +1,37 @@
+//
+// Created by kj16609 on 7/13/23.
+//
+
+#ifndef ATLASGAMEMANAGER_MAPPEDFILE_HPP
+#define ATLASGAMEMANAGER_MAPPEDFILE_HPP
+
+#include <QFile>
+
+#include <filesystem>
+#include <span>
+
+//! Read only memory mapping of an entire file.
+/**
+ * The mapping is released when the object is destroyed. `data()` is only valid for the lifetime of the object.
+ * Throws if the file can't be opened or mapped (Including empty files which can't be mapped).
+ */
+class MappedFile
+{
+	QFile m_file;
+	const char* m_data { nullptr };
+	std::size_t m_size { 0 };
+
+  public:
+
+	MappedFile( const std::filesystem::path& path );
+	~MappedFile();
+
+	MappedFile( const MappedFile& ) = delete;
+	MappedFile& operator=( const MappedFile& ) = delete;
+
+	std::span< const char > data() const { return { m_data, m_size }; }
+
+	std::size_t size() const { return m_size; }
+};
+
+#endif //ATLASGAMEMANAGER_MAPPEDFILE_HPP
@@ -0,0 +1,35 @@
+//
+// Created by kj16609 on 7/29/23.
+//
+
+#include "ScanVisitor.hpp"
+
+#include <tracy/Tracy.hpp>
+
+bool scan( FileScanner& scanner, const std::span< ScanVisitor* const > visitors, const std::stop_token stop )
+{
+	ZoneScoped;
+	std::vector< ScanVisitor* > active { visitors.begin(), visitors.end() };
+
+	for ( const auto& file : scanner )
+	{
+		if ( stop.stop_requested() ) return false;
+
+		std::erase_if( active, [ &file ]( ScanVisitor* visitor ) { return !visitor->visit( file ); } );
+		//Before advancing, which could read the next depth
+		if ( active.empty() ) break;
+	}
+
+	for ( auto* visitor : visitors ) visitor->finish( scanner.path() );
+	return true;
+}
+
+bool SizeVisitor::visit( const FileInfo& file )
+{
+	if ( !file.directory )
+	{
+		m_bytes += file.size;
+		++m_files;
+	}
+	return true;
+}
@@ -0,0 +1,59 @@
+//
+// Created by kj16609 on 7/29/23.
+//
+
+#ifndef ATLASGAMEMANAGER_SCANVISITOR_HPP
+#define ATLASGAMEMANAGER_SCANVISITOR_HPP
+
+#include <array>
+#include <span>
+#include <stop_token>
+
+#include "FileScanner.hpp"
+
+//! Something that wants to see the files of a folder. Any number of them share a single walk with `scan`
+class ScanVisitor
+{
+  public:
+
+	virtual ~ScanVisitor() = default;
+
+	//! Given every file and directory in the order `FileScanner` lists them. Return false once nothing more is needed
+	virtual bool visit( const FileInfo& file ) = 0;
+
+	//! Called once the walk is over, even if `visit` was never called
+	virtual void finish( [[maybe_unused]] const std::filesystem::path& root ) {}
+};
+
+//! Walks `scanner` once and gives each file to every visitor still wanting more.
+/**
+ * Stops as soon as every visitor is done, so nothing deeper then the deepest visitor wants is read.
+ * Returns false if stopped by `stop`, in which case the visitors are not finished.
+ */
+bool scan( FileScanner& scanner, std::span< ScanVisitor* const > visitors, std::stop_token stop = {} );
+
+template < typename... Visitors >
+	requires( std::derived_from< Visitors, ScanVisitor > && ... )
+bool scan( FileScanner& scanner, Visitors&... visitors )
+{
+	const std::array< ScanVisitor*, sizeof...( Visitors ) > list { &visitors... };
+	return scan( scanner, list );
+}
+
+//! Total size and count of the files in a folder
+class SizeVisitor final : public ScanVisitor
+{
+	std::size_t m_bytes { 0 };
+	std::size_t m_files { 0 };
+
+  public:
+
+	bool visit( const FileInfo& file ) override;
+
+	std::size_t bytes() const { return m_bytes; }
+
+	//! Directories aren't counted
+	std::size_t files() const { return m_files; }
+};
+
+#endif //ATLASGAMEMANAGER_SCANVISITOR_HPP
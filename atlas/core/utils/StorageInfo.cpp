@@ -0,0 +1,54 @@
+//
+// Created by kj16609 on 7/30/23.
+//
+
+#include "StorageInfo.hpp"
+
+#ifdef __linux__
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#endif
+
+#include <fstream>
+
+#include "WorkStealingPool.hpp"
+#include "core/logging.hpp"
+
+namespace
+{
+	//! Enough to keep one reading while the other works on what it read
+	constexpr std::size_t rotational_threads { 2 };
+} // namespace
+
+StorageType storageType( [[maybe_unused]] const std::filesystem::path& path )
+{
+#ifdef __linux__
+	struct stat info;
+	if ( ::stat( path.c_str(), &info ) != 0 ) return StorageType::Unknown;
+
+	//Partitions don't have a queue of their own. It's on the disk they are part of
+	const auto device { std::filesystem::path( "/sys/dev/block" )
+		                / fmt::format( "{}:{}", major( info.st_dev ), minor( info.st_dev ) ) };
+	for ( const auto& queue : { device / "queue", device / ".." / "queue" } )
+	{
+		std::ifstream ifs { queue / "rotational" };
+		char rotational { 0 };
+		if ( ifs >> rotational ) return rotational == '1' ? StorageType::Rotational : StorageType::Solid;
+	}
+#endif
+
+	return StorageType::Unknown;
+}
+
+std::size_t ioThreads( const std::filesystem::path& path )
+{
+	const auto type { storageType( path ) };
+	spdlog::debug(
+		"{} is on {} storage",
+		path,
+		type == StorageType::Rotational ? "rotational" :
+		type == StorageType::Solid      ? "solid state" :
+		                                  "unknown" );
+
+	return type == StorageType::Rotational ? rotational_threads : WorkStealingPool::defaultThreads();
+}
@@ -0,0 +1,27 @@
+//
+// Created by kj16609 on 7/30/23.
+//
+
+#ifndef ATLASGAMEMANAGER_STORAGEINFO_HPP
+#define ATLASGAMEMANAGER_STORAGEINFO_HPP
+
+#include <filesystem>
+
+enum class StorageType
+{
+	//! Network shares, virtual filesystems and anything on platforms we can't ask
+	Unknown,
+	Solid,
+	Rotational
+};
+
+//! What kind of drive `path` is stored on
+StorageType storageType( const std::filesystem::path& path );
+
+//! Threads worth reading files under `path` with.
+/**
+ * Every hardware thread, except on spinning disks where more readers only add seeking.
+ */
+std::size_t ioThreads( const std::filesystem::path& path );
+
+#endif //ATLASGAMEMANAGER_STORAGEINFO_HPP
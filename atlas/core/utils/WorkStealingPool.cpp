@@ -0,0 +1,217 @@
+//
+// Created by kj16609 on 7/29/23.
+//
+
+#include "WorkStealingPool.hpp"
+
+#include <tracy/Tracy.hpp>
+
+#include "core/logging.hpp"
+
+namespace
+{
+	//! Pool and queue of the worker running on this thread
+	thread_local WorkStealingPool* current_pool { nullptr };
+	thread_local std::size_t current_index { 0 };
+} // namespace
+
+std::size_t WorkStealingPool::defaultThreads()
+{
+	return std::max( std::thread::hardware_concurrency(), 1u );
+}
+
+WorkStealingPool::WorkStealingPool( const std::size_t threads )
+{
+	const auto count { std::max( threads, std::size_t( 1 ) ) };
+	for ( std::size_t i = 0; i < count + 1; ++i ) m_queues.emplace_back( std::make_unique< Queue >() );
+	for ( std::size_t i = 0; i < count; ++i ) m_threads.emplace_back( [ this, i ]() { work( i ); } );
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+	{
+		std::lock_guard guard { m_sleep_mtx };
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	m_threads.clear();
+}
+
+WorkStealingPool& WorkStealingPool::global()
+{
+	static WorkStealingPool pool {};
+	return pool;
+}
+
+WorkStealingPool& WorkStealingPool::current()
+{
+	return current_pool ? *current_pool : global();
+}
+
+void WorkStealingPool::notify( const bool all )
+{
+	//Taking the lock orders this with a sleeper checking it's condition
+	{
+		std::lock_guard guard { m_sleep_mtx };
+	}
+	if ( all )
+		m_wake.notify_all();
+	else
+		m_wake.notify_one();
+}
+
+std::uint64_t WorkStealingPool::push( Task task )
+{
+	const auto index { current_pool == this ? current_index : m_queues.size() - 1 };
+	std::uint64_t sequence { 0 };
+	{
+		auto& queue { *m_queues[ index ] };
+		std::lock_guard guard { queue.mtx };
+		sequence = task.sequence = m_sequence++;
+		queue.tasks.emplace_back( std::move( task ) );
+	}
+	++m_pending;
+	notify( false );
+	return sequence;
+}
+
+void WorkStealingPool::submit( std::function< void() > task )
+{
+	push( { std::move( task ) } );
+}
+
+WorkStealingPool::Task WorkStealingPool::take( const std::optional< std::uint64_t > since )
+{
+	const bool is_worker { current_pool == this };
+
+	//Newest from our own queue
+	if ( is_worker )
+	{
+		auto& queue { *m_queues[ current_index ] };
+		std::lock_guard guard { queue.mtx };
+		if ( !queue.tasks.empty() && queue.tasks.back().sequence >= since.value_or( 0 ) )
+		{
+			auto task { std::move( queue.tasks.back() ) };
+			queue.tasks.pop_back();
+			--m_pending;
+			return task;
+		}
+
+		if ( since ) return {};
+	}
+
+	//Oldest from anyone else, starting after ourselves so workers don't all pick on the same queue
+	const auto start { is_worker ? current_index + 1 : 0 };
+	for ( std::size_t i = 0; i < m_queues.size(); ++i )
+	{
+		auto& queue { *m_queues[ ( start + i ) % m_queues.size() ] };
+		std::lock_guard guard { queue.mtx };
+		if ( !queue.tasks.empty() )
+		{
+			auto task { std::move( queue.tasks.front() ) };
+			queue.tasks.pop_front();
+			--m_pending;
+			return task;
+		}
+	}
+
+	return {};
+}
+
+bool WorkStealingPool::run( const std::optional< std::uint64_t > since )
+{
+	auto task { take( since ) };
+	if ( !task.run ) return false;
+
+	try
+	{
+		task.run();
+	}
+	catch ( std::exception& e )
+	{
+		spdlog::error( "WorkStealingPool: Task threw: {}", e.what() );
+	}
+	catch ( ... )
+	{
+		spdlog::error( "WorkStealingPool: Task threw something that wasn't an exception" );
+	}
+
+	return true;
+}
+
+bool WorkStealingPool::runOne()
+{
+	return run( std::nullopt );
+}
+
+void WorkStealingPool::work( const std::size_t index )
+{
+	current_pool = this;
+	current_index = index;
+
+	while ( true )
+	{
+		if ( runOne() ) continue;
+
+		std::unique_lock lock { m_sleep_mtx };
+		m_wake.wait( lock, [ this ]() { return m_stop || m_pending > 0; } );
+		if ( m_stop ) return;
+	}
+}
+
+TaskGroup::~TaskGroup()
+{
+	try
+	{
+		wait();
+	}
+	catch ( ... )
+	{
+		//Nobody asked for it
+	}
+}
+
+void TaskGroup::run( std::function< void() > task )
+{
+	++m_outstanding;
+	auto wrapped = [ this, &pool = m_pool, task = std::move( task ) ]()
+	{
+		try
+		{
+			task();
+		}
+		catch ( ... )
+		{
+			std::lock_guard guard { m_exception_mtx };
+			if ( !m_exception ) m_exception = std::current_exception();
+		}
+
+		//Anything waiting on the group sleeps with the pool's workers. The group can be gone once this hits zero
+		if ( --m_outstanding == 0 ) pool.notify( true );
+	};
+
+	const auto sequence { m_pool.push( { std::move( wrapped ) } ) };
+	//Only the first one counts. Everything after it is newer
+	std::uint64_t none { no_tasks };
+	m_first.compare_exchange_strong( none, sequence );
+}
+
+void TaskGroup::wait()
+{
+	ZoneScoped;
+	const bool is_worker { current_pool == &m_pool };
+	while ( m_outstanding > 0 )
+	{
+		if ( m_pool.run( is_worker ? std::optional( m_first.load() ) : std::nullopt ) ) continue;
+
+		//A worker can't do anything more until the tasks other workers took are done
+		std::unique_lock lock { m_pool.m_sleep_mtx };
+		m_pool.m_wake.wait(
+			lock, [ this, is_worker ]() { return m_outstanding == 0 || ( !is_worker && m_pool.m_pending > 0 ); } );
+	}
+
+	m_first = no_tasks;
+
+	std::lock_guard guard { m_exception_mtx };
+	if ( m_exception ) std::rethrow_exception( std::exchange( m_exception, nullptr ) );
+}
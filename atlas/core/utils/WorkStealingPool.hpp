@@ -0,0 +1,128 @@
+//
+// Created by kj16609 on 7/29/23.
+//
+
+#ifndef ATLASGAMEMANAGER_WORKSTEALINGPOOL_HPP
+#define ATLASGAMEMANAGER_WORKSTEALINGPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+class TaskGroup;
+
+//! Fixed set of threads where every thread has it's own queue of tasks.
+/**
+ * Tasks submitted from a worker go to that worker's queue and it takes the newest first, so work that
+ * spawns more work (walking a directory tree) stays on the thread that has it cached.
+ * A worker with nothing left steals the oldest task from another queue. Threads outside the pool submit to a shared queue.
+ */
+class WorkStealingPool
+{
+	struct Task
+	{
+		std::function< void() > run;
+		//! Order tasks were pushed in. Only ever increases within a worker's queue
+		std::uint64_t sequence { 0 };
+	};
+
+	struct Queue
+	{
+		std::mutex mtx {};
+		std::deque< Task > tasks {};
+	};
+
+	//! One per worker, followed by the shared queue
+	std::vector< std::unique_ptr< Queue > > m_queues {};
+	std::vector< std::jthread > m_threads {};
+
+	//! Tasks queued but not yet taken
+	std::atomic< std::size_t > m_pending { 0 };
+	std::atomic< std::uint64_t > m_sequence { 0 };
+	std::mutex m_sleep_mtx {};
+	std::condition_variable m_wake {};
+	bool m_stop { false };
+
+	friend class TaskGroup;
+
+	void work( const std::size_t index );
+	//! Returns the sequence given to the task
+	std::uint64_t push( Task task );
+	//! With `since` set a worker takes just the newest task of it's own queue, if it was pushed at or after `since`.
+	//! It doesn't steal
+	Task take( const std::optional< std::uint64_t > since );
+	bool run( const std::optional< std::uint64_t > since );
+	//! Wakes anything sleeping in `work` or `TaskGroup::wait`
+	void notify( const bool all );
+
+  public:
+
+	//! Threads used when none are given. One per hardware thread
+	static std::size_t defaultThreads();
+
+	explicit WorkStealingPool( const std::size_t threads = defaultThreads() );
+	~WorkStealingPool();
+
+	WorkStealingPool( const WorkStealingPool& ) = delete;
+	WorkStealingPool& operator=( const WorkStealingPool& ) = delete;
+
+	//! Shared by everything that doesn't need a pool of it's own
+	static WorkStealingPool& global();
+
+	//! The pool running the calling thread, or `global()` outside of any pool
+	static WorkStealingPool& current();
+
+	//! Exceptions thrown by `task` are logged and dropped. Use a `TaskGroup` to get them back
+	void submit( std::function< void() > task );
+
+	//! Runs a queued task on the calling thread. Returns false if there was nothing to run
+	bool runOne();
+
+	std::size_t size() const { return m_threads.size(); }
+};
+
+//! Tasks that are waited on together.
+/**
+ * `wait()` runs queued tasks on the calling thread while the group isn't done, so it's safe to wait from inside a task.
+ * A worker waiting only runs tasks of it's own queue pushed since the group's first task. That's the group's tasks and
+ * whatever they queued on top of them, which would otherwise block the ones under them. Older work in the queue, and
+ * work of other workers, is left alone so waits don't nest through unrelated tasks.
+ * The first exception thrown by a task is rethrown by `wait()`.
+ */
+class TaskGroup
+{
+	static constexpr std::uint64_t no_tasks { std::numeric_limits< std::uint64_t >::max() };
+
+	WorkStealingPool& m_pool;
+	std::atomic< std::size_t > m_outstanding { 0 };
+	//! Sequence of the first task run since the last `wait()`
+	std::atomic< std::uint64_t > m_first { no_tasks };
+
+	std::mutex m_exception_mtx {};
+	std::exception_ptr m_exception { nullptr };
+
+  public:
+
+	TaskGroup( WorkStealingPool& pool = WorkStealingPool::current() ) : m_pool( pool ) {}
+
+	//! Waits for any tasks still running
+	~TaskGroup();
+
+	TaskGroup( const TaskGroup& ) = delete;
+	TaskGroup& operator=( const TaskGroup& ) = delete;
+
+	void run( std::function< void() > task );
+
+	void wait();
+};
+
+#endif //ATLASGAMEMANAGER_WORKSTEALINGPOOL_HPP
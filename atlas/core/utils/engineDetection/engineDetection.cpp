@@ -4,27 +4,19 @@
 
 #include "engineDetection.hpp"
 
+#include <algorithm>
 #include <array>
+#include <bit>
+#include <cctype>
 #include <iostream>
-#include <algorithm>
+#include <optional>
 #include <string>
 
-#include <QMimeDatabase>
+#include <tracy/Tracy.hpp>
 
 #include "../../system.hpp"
 #include "core/logging.hpp"
-
-template <>
-bool isEngineT< ENGINES_BEGIN >( [[maybe_unused]] FileScanner& scanner )
-{
-	return false;
-}
-
-template <>
-bool isEngineT< ENGINES_END >( [[maybe_unused]] FileScanner& scanner )
-{
-	return true;
-}
+#include "core/utils/WorkStealingPool.hpp"
 
 constexpr std::tuple blacklist_execs { std::string_view( "UnityCrashHandler32.exe" ),
 	                                   std::string_view( "UnityCrashHandler64.exe" ),
@@ -42,17 +34,17 @@ constexpr std::tuple blacklist_execs { std::string_view( "UnityCrashHandler32.ex
 	                                   std::string_view( "UE4PrereqSetup_X64.exe" ),
 	                                   std::string_view( "UEPrereqSetup_x64.exe" ) };
 
-bool isBlacklistT( const std::string& name, const std::string_view comp )
+bool isBlacklistT( const std::string_view name, const std::string_view comp )
 {
 	return name == comp;
 }
 
-bool isBlacklistT( const std::string& name, std::string_view comp, std::same_as< std::string_view > auto... comps )
+bool isBlacklistT( const std::string_view name, std::string_view comp, std::same_as< std::string_view > auto... comps )
 {
 	return name == comp || isBlacklistT( name, comps... );
 }
 
-bool isBlacklist( const std::string& name )
+bool isBlacklist( const std::string_view name )
 {
 	// In order to 'inject' name into the arguments we have to create a function
 	// to unpack the parameter pack and slam it straight back into the function.
@@ -62,59 +54,76 @@ bool isBlacklist( const std::string& name )
 	return std::apply( func, blacklist_execs );
 }
 
-std::vector< std::filesystem::path > detectExecutables( FileScanner& scanner )
+bool ExecutableVisitor::visit( const FileInfo& file )
 {
-	std::vector< std::filesystem::path > potential_executables;
-
 	//Check for a valid game executable in the folder
-	for ( const auto& [ filename, ext, path, size, depth, relative ] : scanner )
+	if ( file.depth > 1 ) return false;
+	if ( file.directory ) return true;
+
+	//Only files named like an executable are read, once the walk is over
+	std::string lower_ext { file.ext };
+	std::transform(
+		lower_ext.begin(), lower_ext.end(), lower_ext.begin(), []( const unsigned char c ) { return std::tolower( c ); } );
+	if ( !isExecutableExtension( lower_ext ) ) return true;
+	if ( isBlacklist( file.filename ) ) return true;
+
+	m_candidates.emplace_back( Candidate { file.relative(), std::move( lower_ext ) } );
+	return true;
+}
+
+void ExecutableVisitor::finish( const std::filesystem::path& root )
+{
+	ZoneScoped;
+	std::vector< std::optional< ExecutableInfo > > found( m_candidates.size() );
+	{
+		TaskGroup group {};
+		for ( std::size_t i = 0; i < m_candidates.size(); ++i )
+			group.run( [ &, i ]()
+			           { found[ i ] = readExecutableInfo( root / m_candidates[ i ].relative, m_candidates[ i ].ext ); } );
+		group.wait();
+	}
+
+	std::vector< std::pair< std::filesystem::path, ExecutableInfo > > executables {};
+	for ( std::size_t i = 0; i < m_candidates.size(); ++i )
 	{
-		if ( depth > 1 ) break;
+		if ( !found[ i ] || found[ i ]->format == ExecutableFormat::MachO ) continue;
+		spdlog::debug( "Found executable:{}", root / m_candidates[ i ].relative );
+		executables.emplace_back( std::move( m_candidates[ i ].relative ), std::move( *found[ i ] ) );
+	}
+	m_candidates.clear();
 
-		if ( std::filesystem::is_regular_file( path ) )
-		{
-			if ( isBlacklist( filename ) ) continue;
-
-			QMimeDatabase mime_db;
-			const auto type {
-				mime_db.mimeTypeForFile( QString::fromStdString( path.string() ), QMimeDatabase::MatchContent )
-			};
-			//std::transform( ext.begin(), ext.end(), ext.begin(), ::toupper );
-			spdlog::info( "type:{} ext:{}", type.name(), ext );
-			//General executables
-			if ( type.inherits( "application/x-ms-dos-executable" ) )
-			{
-				spdlog::info( "Found executable:{}", path.string() );
-				//potential_executables.insert( potential_executables.begin(), relative );
-				//prioritize AMD64
-				path.string().std::string::find( "32" ) ?
-					potential_executables.insert( potential_executables.begin(), relative ) :
-					potential_executables.insert( potential_executables.end(), relative );
-				//potential_executables.emplace_back( relative );
-				continue;
-			}
-			else if ( type.inherits( "text/plain" ) && ext == ".html" )
-			{
-				spdlog::info( "Found HTML:{}", path.string() );
-				potential_executables.emplace_back( relative );
-				continue;
-			}
-
-			if constexpr ( sys::is_linux )
-			{
-				if ( type.inherits( "application/x-shellscript" ) && ext == ".sh" )
-				{
-					potential_executables.emplace_back( relative );
-					continue;
-				}
-			}
-			
-		}
+	m_executables.clear();
+	m_info.clear();
+	for ( auto& [ path, info ] : scoreExecutables( std::move( executables ) ) )
+	{
+		m_executables.emplace_back( std::move( path ) );
+		m_info.emplace_back( std::move( info ) );
 	}
+}
 
-	return scoreExecutables( std::move( potential_executables ) );
+std::vector< std::filesystem::path > detectExecutables( FileScanner& scanner )
+{
+	ExecutableVisitor visitor {};
+	scan( scanner, visitor );
+	return visitor.executables();
 }
 
+namespace
+{
+	//! Executables with other extensions are dropped
+	std::optional< int > extensionScore( const std::filesystem::path& path )
+	{
+		std::string ext { path.extension().string() };
+		std::transform( ext.begin(), ext.end(), ext.begin(), []( const unsigned char c ) { return std::tolower( c ); } );
+
+		if constexpr ( sys::is_linux )
+			if ( ext == ".sh" || ext == ".x86_64" ) return 20;
+
+		if ( ext == ".exe" || ext == ".html" ) return sys::is_linux ? 10 : 20;
+		return std::nullopt;
+	}
+} // namespace
+
 /**
  * @warning Provides no MIME checking. CHECK YOURSELF
  * @param paths
@@ -126,15 +135,9 @@ std::vector< std::filesystem::path >
 	std::vector< std::pair< std::filesystem::path, int > > execs;
 
 	for ( auto& path : paths )
-	{
-		if constexpr ( sys::is_linux )
-			if ( path.extension() == ".sh" ) execs.emplace_back( std::move( path ), 20 );
+		if ( const auto score = extensionScore( path ); score ) execs.emplace_back( std::move( path ), *score );
 
-		if ( path.extension() == ".exe" || path.extension() == ".EXE" ) execs.emplace_back( std::move( path ), sys::is_linux ? 10 : 20 );
-		if ( path.extension() == ".html" || path.extension() == ".HTML" ) execs.emplace_back( std::move( path ), sys::is_linux ? 10 : 20 );
-	}
-
-	std::sort(
+	std::stable_sort(
 		execs.begin(),
 		execs.end(),
 		[]( const auto& first, const auto& second ) { return first.second > second.second; } );
@@ -145,268 +148,167 @@ std::vector< std::filesystem::path >
 	return sorted_paths;
 }
 
-template <>
-QString engineNameT< UNKNOWN >()
-{
-	return "Unknown";
-}
-
-template < Engine engine >
-Engine findEngine( FileScanner& scanner )
-{
-	if constexpr ( engine == ENGINES_END )
-		return UNKNOWN;
-	else
-	{
-		if ( isEngineT< engine >( scanner ) )
-			return engine;
-		else
-			return findEngine< static_cast< Engine >( engine + 1 ) >( scanner );
-	}
-}
-
-Engine determineEngine( FileScanner& scanner )
-{
-	return findEngine< ENGINES_BEGIN >( scanner );
-}
-
-template < Engine engine_t >
-QString getEngineNameT( const Engine engine )
-{
-	if constexpr ( engine_t == ENGINES_END )
-		return engineNameT< UNKNOWN >();
-	else if constexpr ( engine_t == ENGINES_BEGIN )
-		return getEngineNameT< static_cast< Engine >( ENGINES_BEGIN + 1 ) >( engine );
-	else
-	{
-		if ( engine == engine_t )
-			return engineNameT< engine_t >();
-		else
-			return getEngineNameT< static_cast< Engine >( engine_t + 1 ) >( engine );
-	}
-}
-
-QString engineName( const Engine engine )
+std::vector< std::pair< std::filesystem::path, ExecutableInfo > > scoreExecutables(
+	std::vector< std::pair< std::filesystem::path, ExecutableInfo > > executables,
+	[[maybe_unused]] const Engine engine_type )
 {
-	return getEngineNameT< ENGINES_BEGIN >( engine );
-}
+	std::vector< std::pair< int, std::pair< std::filesystem::path, ExecutableInfo > > > execs;
 
-//Define all specializations of isEngine and engineNameT here
-
-template <>
-bool isEngineT< RenPy >( FileScanner& scanner )
-{
-	for ( const auto& file : scanner )
+	for ( auto& executable : executables )
 	{
-		if ( file.depth > 1 ) return false;
+		const auto score { extensionScore( executable.first ) };
+		if ( !score ) continue;
 
-		if ( file.filename == "renpy" && std::filesystem::is_directory( file.path ) ) return true;
+		//Less then the gap between extensions
+		const auto& info { executable.second };
+		const int bonus { ( info.isNative() ? 4 : 0 ) + ( info.bits == 64 ? 3 : 0 ) + ( info.isGui() ? 2 : 0 ) };
+		execs.emplace_back( *score + bonus, std::move( executable ) );
 	}
-	return false;
-}
-
-template <>
-QString engineNameT< RenPy >()
-{
-	return "Ren'Py";
-}
 
-template <>
-bool isEngineT< Unity >( FileScanner& scanner )
-{
-	for ( const auto& file : scanner )
+	std::stable_sort(
+		execs.begin(),
+		execs.end(),
+		[]( const auto& first, const auto& second ) { return first.first > second.first; } );
+
+	std::vector< std::pair< std::filesystem::path, ExecutableInfo > > sorted;
+	for ( auto& [ score, executable ] : execs ) sorted.emplace_back( std::move( executable ) );
+
+	return sorted;
+}
+
+namespace
+{
+	constexpr std::array< std::string_view, ENGINES_END > engine_names { "Unknown",
+		                                                                 "Ren'Py",
+		                                                                 "Unity",
+		                                                                 "Unreal",
+		                                                                 "RPG Maker",
+		                                                                 "Wolf RPG",
+		                                                                 "Visual Novel Maker",
+		                                                                 "TyanoBuilder Visual Novel Software",
+		                                                                 "Java",
+		                                                                 "Flash",
+		                                                                 "RAGS",
+		                                                                 "KiriKiri",
+		                                                                 "NScripter",
+		                                                                 "NVList",
+		                                                                 "Sukai2",
+		                                                                 "HTML" };
+
+	//FNV-1a of the kind followed by the text
+	constexpr std::uint64_t signatureHash( const SignatureKind kind, const std::string_view text )
 	{
-		if ( file.depth > 1 ) return false;
-
-		if ( file.filename == "Data" && std::filesystem::is_directory( file.path ) )
+		constexpr std::uint64_t prime { 1099511628211ull };
+		std::uint64_t hash { ( 14695981039346656037ull ^ static_cast< std::uint8_t >( kind ) ) * prime };
+		for ( const char c : text )
 		{
-			//Check deeper
-			return std::filesystem::exists( scanner.path() / "Data" / "Managed" / "Assembly-CSharp.dll" );
+			hash ^= static_cast< unsigned char >( c );
+			hash *= prime;
 		}
+		return hash;
 	}
 
-	return false;
-}
-
-template <>
-QString engineNameT< Unity >()
-{
-	return "Unity";
-}
-
-template <>
-bool isEngineT< Unreal >( [[maybe_unused]] FileScanner& scanner )
-{
-	return false;
-}
-
-template <>
-QString engineNameT< Unreal >()
-{
-	return "Unreal";
-}
-
-template <>
-bool isEngineT< RPGM >( [[maybe_unused]] FileScanner& scanner )
-{
-	return false;
-}
-
-template <>
-QString engineNameT< RPGM >()
-{
-	return "RPG Maker";
-}
-
-template <>
-bool isEngineT< WolfRPG >( [[maybe_unused]] FileScanner& scanner )
-{
-	return false;
-}
-
-template <>
-QString engineNameT< WolfRPG >()
-{
-	return "Wolf RPG";
-}
-
-template <>
-bool isEngineT< HTML >( [[maybe_unused]] FileScanner& scanner )
-{
-	bool html_found { false };
-
-	for ( const auto& file : scanner )
+	//! Open addressed table of every signature, built at compile time. Half empty so probes stay short
+	constexpr std::size_t slot_count { std::bit_ceil( engine_signatures.size() * 2 ) };
+	constexpr std::int16_t empty_slot { -1 };
+
+	constexpr auto signature_slots { []()
+		                             {
+										 std::array< std::int16_t, slot_count > slots {};
+										 slots.fill( empty_slot );
+										 for ( std::size_t i = 0; i < engine_signatures.size(); ++i )
+										 {
+											 const auto& signature { engine_signatures[ i ] };
+											 auto slot { signatureHash( signature.kind, signature.pattern )
+												         & ( slot_count - 1 ) };
+											 while ( slots[ slot ] != empty_slot ) slot = ( slot + 1 ) & ( slot_count - 1 );
+											 slots[ slot ] = static_cast< std::int16_t >( i );
+										 }
+										 return slots;
+									 }() };
+
+	//! Deepest a `Path` signature goes. Nothing below it is looked at
+	constexpr std::uint8_t signature_depth { []()
+		                                     {
+												 std::uint8_t depth { 1 };
+												 for ( const auto& signature : engine_signatures )
+													 if ( signature.kind == SignatureKind::Path )
+														 depth = std::max(
+															 depth,
+															 static_cast< std::uint8_t >(
+																 std::ranges::count( signature.pattern, '/' ) + 1 ) );
+												 return depth;
+											 }() };
+
+	static_assert( signature_depth <= 3, "Engine signatures deeper then 3 folders make every game scan deeper" );
+
+	//! Marks every signature matching `text` in `found`
+	template < std::size_t N >
+	void match( const SignatureKind kind, const std::string_view text, std::bitset< N >& found )
 	{
-		if ( file.depth > 1 ) return false;
-
-		if ( file.ext == ".exe" ) return false;
-		if ( file.ext == ".html" ) html_found = true;
+		//Equal signatures of different engines follow each other in the probe sequence
+		for ( auto slot = signatureHash( kind, text ) & ( slot_count - 1 ); signature_slots[ slot ] != empty_slot;
+		      slot = ( slot + 1 ) & ( slot_count - 1 ) )
+		{
+			const auto index { static_cast< std::size_t >( signature_slots[ slot ] ) };
+			const auto& signature { engine_signatures[ index ] };
+			if ( signature.kind == kind && signature.pattern == text ) found.set( index );
+		}
 	}
+} // namespace
 
-	return html_found;
-}
-
-template <>
-QString engineNameT< HTML >()
-{
-	return "HTML";
-}
-
-template <>
-bool isEngineT< VisualNovelMaker >( [[maybe_unused]] FileScanner& scanner )
+bool EngineVisitor::visit( const FileInfo& file )
 {
-	return false;
-}
-
-template <>
-QString engineNameT< VisualNovelMaker >()
-{
-	return "Visual Novel Maker";
-}
+	if ( file.depth > signature_depth ) return false;
 
-template <>
-bool isEngineT< TyanoBuilder >( [[maybe_unused]] FileScanner& scanner )
-{
-	for ( const auto& file : scanner )
+	if ( file.depth == 1 )
 	{
-		if ( file.depth > 1 ) return false;
-
-		if ( file.filename == "resources" && std::filesystem::is_directory( file.path ) )
+		if ( file.directory )
+			match( SignatureKind::Directory, file.filename, m_found );
+		else if ( !file.ext.empty() )
 		{
-			//Search deeper
-			return std::filesystem::exists( scanner.path() / "resources" / "app" / "tyrano" );
+			std::string ext { file.ext };
+			std::transform(
+				ext.begin(), ext.end(), ext.begin(), []( const unsigned char c ) { return std::tolower( c ); } );
+			match( SignatureKind::Extension, ext, m_found );
 		}
 	}
 
-	return false;
-}
-
-template <>
-QString engineNameT< TyanoBuilder >()
-{
-	return "TyanoBuilder Visual Novel Software";
-}
-
-template <>
-bool isEngineT< Java >( [[maybe_unused]] FileScanner& scanner )
-{
-	return false;
-}
-
-template <>
-QString engineNameT< Java >()
-{
-	return "Java";
-}
-
-template <>
-bool isEngineT< Flash >( [[maybe_unused]] FileScanner& scanner )
-{
-	return false;
-}
-
-template <>
-QString engineNameT< Flash >()
-{
-	return "Flash";
-}
-
-template <>
-bool isEngineT< RAGS >( [[maybe_unused]] FileScanner& scanner )
-{
-	return false;
-}
-
-template <>
-QString engineNameT< RAGS >()
-{
-	return "RAGS";
-}
-
-template <>
-bool isEngineT< KiriKiri >( [[maybe_unused]] FileScanner& scanner )
-{
-	return false;
-}
-
-template <>
-QString engineNameT< KiriKiri >()
-{
-	return "KiriKiri";
-}
-
-template <>
-bool isEngineT< NScripter >( [[maybe_unused]] FileScanner& scanner )
-{
-	return false;
+	match( SignatureKind::Path, file.relative().generic_string(), m_found );
+	return true;
 }
 
-template <>
-QString engineNameT< NScripter >()
+void EngineVisitor::finish( [[maybe_unused]] const std::filesystem::path& root )
 {
-	return "NScripter";
-}
+	m_scores.fill( 0 );
+	for ( std::size_t i = 0; i < engine_signatures.size(); ++i )
+		if ( m_found.test( i ) ) m_scores[ engine_signatures[ i ].engine ] += engine_signatures[ i ].weight;
 
-template <>
-bool isEngineT< NVList >( [[maybe_unused]] FileScanner& scanner )
-{
-	return false;
+	m_engine = UNKNOWN;
+	int best { engine_threshold - 1 };
+	for ( int engine = ENGINES_BEGIN + 1; engine < ENGINES_END; ++engine )
+		if ( m_scores[ static_cast< std::size_t >( engine ) ] > best )
+		{
+			best = m_scores[ static_cast< std::size_t >( engine ) ];
+			m_engine = static_cast< Engine >( engine );
+		}
 }
 
-template <>
-QString engineNameT< NVList >()
+int EngineVisitor::confidence( const Engine engine ) const
 {
-	return "NVList";
+	if ( engine <= ENGINES_BEGIN || engine >= ENGINES_END ) return 0;
+	return std::clamp( m_scores[ engine ], 0, 100 );
 }
 
-template <>
-bool isEngineT< Sukai2 >( [[maybe_unused]] FileScanner& scanner )
+Engine determineEngine( FileScanner& scanner )
 {
-	return false;
+	EngineVisitor visitor {};
+	scan( scanner, visitor );
+	return visitor.engine();
 }
 
-template <>
-QString engineNameT< Sukai2 >()
+QString engineName( const Engine engine )
 {
-	return "Sukai2";
+	if ( engine <= ENGINES_BEGIN || engine >= ENGINES_END ) return QString::fromUtf8( engine_names[ 0 ] );
+	return QString::fromUtf8( engine_names[ engine ] );
 }
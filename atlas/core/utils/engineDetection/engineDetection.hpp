@@ -5,12 +5,18 @@
 #ifndef ATLAS_ENGINEDETECTION_HPP
 #define ATLAS_ENGINEDETECTION_HPP
 
+#include <array>
+#include <bitset>
+#include <cstdint>
 #include <filesystem>
+#include <string_view>
 #include <vector>
 
 #include <QString>
 
+#include "core/utils/ExecutableInfo.hpp"
 #include "core/utils/FileScanner.hpp"
+#include "core/utils/ScanVisitor.hpp"
 
 enum Engine : int
 {
@@ -34,15 +40,106 @@ enum Engine : int
 	UNKNOWN
 };
 
-//! Function to be specialized for each Engine to return true if the engine is valid.
-template < Engine engine >
-bool isEngineT( FileScanner& scanner );
+//! What a signature is compared with
+enum class SignatureKind : std::uint8_t
+{
+	//! Name of a top level directory
+	Directory,
+	//! Extension of a top level file, lower case
+	Extension,
+	//! Path of a file or directory relative to the game, with '/' between folders
+	Path,
+};
+
+//! Something found in a game's folder that says which engine it uses
+struct EngineSignature
+{
+	Engine engine;
+	SignatureKind kind;
+	std::string_view pattern;
+	//! Added to the engine's score once if found. Negative for things the engine never has
+	int weight;
+};
+
+//! Every engine is detected from here. A new engine only needs it's signatures added
+/**
+ * An engine is detected once it's score reaches `engine_threshold`. The highest score wins,
+ * and the engine listed first in `Engine` wins a tie.
+ */
+inline constexpr std::array engine_signatures {
+	EngineSignature { RenPy, SignatureKind::Directory, "renpy", 100 },
+	EngineSignature { Unity, SignatureKind::Directory, "Data", 20 },
+	EngineSignature { Unity, SignatureKind::Path, "Data/Managed/Assembly-CSharp.dll", 80 },
+	EngineSignature { Unity, SignatureKind::Path, "UnityPlayer.dll", 60 },
+	EngineSignature { Unreal, SignatureKind::Path, "Engine/Binaries", 30 },
+	EngineSignature { Unreal, SignatureKind::Path, "Engine/Content/Paks", 30 },
+	EngineSignature { Unreal, SignatureKind::Extension, ".uproject", 70 },
+	EngineSignature { RPGM, SignatureKind::Extension, ".rgssad", 100 },
+	EngineSignature { RPGM, SignatureKind::Extension, ".rgss2a", 100 },
+	EngineSignature { RPGM, SignatureKind::Extension, ".rgss3a", 100 },
+	EngineSignature { RPGM, SignatureKind::Path, "www/js/rpg_core.js", 100 },
+	EngineSignature { RPGM, SignatureKind::Path, "js/rmmz_core.js", 100 },
+	EngineSignature { WolfRPG, SignatureKind::Extension, ".wolf", 100 },
+	EngineSignature { TyanoBuilder, SignatureKind::Directory, "resources", 20 },
+	EngineSignature { TyanoBuilder, SignatureKind::Path, "resources/app/tyrano", 80 },
+	EngineSignature { Flash, SignatureKind::Extension, ".swf", 60 },
+	EngineSignature { RAGS, SignatureKind::Extension, ".rag", 100 },
+	EngineSignature { KiriKiri, SignatureKind::Extension, ".xp3", 100 },
+	EngineSignature { NScripter, SignatureKind::Path, "nscript.dat", 100 },
+	EngineSignature { NScripter, SignatureKind::Path, "arc.nsa", 60 },
+	EngineSignature { HTML, SignatureKind::Extension, ".html", 60 },
+	EngineSignature { HTML, SignatureKind::Extension, ".exe", -100 },
+};
+
+inline constexpr int engine_threshold { 50 };
+
+//! Scores every engine from the signatures found in a single walk of the folder
+class EngineVisitor final : public ScanVisitor
+{
+	//! Signatures found, by their index in `engine_signatures`
+	std::bitset< engine_signatures.size() > m_found {};
+	std::array< int, ENGINES_END > m_scores {};
+	Engine m_engine { UNKNOWN };
+
+  public:
 
-//! String name of the engine.
-template < Engine engine >
-QString engineNameT();
+	bool visit( const FileInfo& file ) override;
+	void finish( const std::filesystem::path& root ) override;
 
-//std::vector<std::filesystem::path> createFileList(const std::filesystem::path& path);
+	//! UNKNOWN until finished
+	Engine engine() const { return m_engine; }
+
+	//! How sure the walk is that the folder uses `engine`, from 0 to 100. 0 until finished
+	int confidence( const Engine engine ) const;
+};
+
+//! Finds the executables at the top of a folder, best first
+/**
+ * Only names are looked at during the walk. The headers of the candidates are read in parallel once it's over.
+ */
+class ExecutableVisitor final : public ScanVisitor
+{
+	struct Candidate
+	{
+		std::filesystem::path relative;
+		//! Lower case
+		std::string ext;
+	};
+
+	std::vector< Candidate > m_candidates {};
+	std::vector< std::filesystem::path > m_executables {};
+	std::vector< ExecutableInfo > m_info {};
+
+  public:
+
+	bool visit( const FileInfo& file ) override;
+	void finish( const std::filesystem::path& root ) override;
+
+	const std::vector< std::filesystem::path >& executables() const { return m_executables; }
+
+	//! Same order as `executables()`
+	const std::vector< ExecutableInfo >& info() const { return m_info; }
+};
 
 //! Returns an engine type of ENGINES_END if no engine is determined
 Engine determineEngine( FileScanner& scanner );
@@ -55,4 +152,8 @@ std::vector< std::filesystem::path > detectExecutables( FileScanner& scanner );
 std::vector< std::filesystem::path >
 	scoreExecutables( std::vector< std::filesystem::path > paths, const Engine engine = UNKNOWN );
 
+//! Same as above, with native, 64 bit and GUI executables first among those with the same extension
+std::vector< std::pair< std::filesystem::path, ExecutableInfo > > scoreExecutables(
+	std::vector< std::pair< std::filesystem::path, ExecutableInfo > > executables, const Engine engine = UNKNOWN );
+
 #endif //ATLAS_ENGINEDETECTION_HPP
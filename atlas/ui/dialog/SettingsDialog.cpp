@@ -14,7 +14,7 @@
 
 #include "ProgressBarDialog.hpp"
 #include "core/config.hpp"
-#include "core/foldersize.hpp"
+#include "core/database/SizeCache.hpp"
 #include "core/logging.hpp"
 #include "ui_SettingsDialog.h"
 
@@ -68,6 +68,9 @@ SettingsDialog::SettingsDialog( QWidget* parent ) :
 
 SettingsDialog::~SettingsDialog()
 {
+	//The thread writes to the progress members. Finish it before they're gone
+	size_thread.request_stop();
+	if ( size_thread.joinable() ) size_thread.join();
 	delete ui;
 }
 
@@ -206,18 +209,61 @@ void SettingsDialog::preparePathsSettings()
 
 	QLocale locale { this->locale() };
 
-	//Set filesizes
-	ui->imagesSizeLabel
-		->setText( locale
-	                   .formattedDataSize( static_cast< qint64 >( folderSize( config::paths::images::getPath() ) ) ) );
+	//Set filesizes. Shows the last measured sizes right away, then counts them again in the background
+	const auto images_path { config::paths::images::getPath() };
+	const auto games_path { config::paths::games::getPath() };
 
-	ui->gamesSizeLabel
-		->setText( locale.formattedDataSize( static_cast< qint64 >( folderSize( config::paths::games::getPath() ) ) ) );
+	images_cached = size_cache::find( images_path, false );
+	//Versions imported in place aren't in the games folder, so their deltas don't count towards it
+	games_cached = size_cache::find( games_path, true );
+	updateSizeLabels();
+
+	size_thread = std::jthread(
+		[ this, images_path, games_path ]( std::stop_token stop )
+		{
+			const auto last_change { size_cache::lastChange() };
+			const auto images { directorySize( images_path, &images_size, stop ) };
+			const auto games { directorySize( games_path, &games_size, stop ) };
+
+			//A partial count would be wrong next time too
+			if ( stop.stop_requested() ) return;
+			size_cache::store( images_path, images, last_change );
+			size_cache::store( games_path, games, last_change );
+			sizes_done = true;
+		} );
+
+	size_timer = new QTimer( this );
+	connect( size_timer, &QTimer::timeout, this, &SettingsDialog::updateSizeLabels );
+	size_timer->start( 100 );
 
 	ui->databaseSizeLabel->setText( locale.formattedDataSize(
 		static_cast< qint64 >( std::filesystem::file_size( config::paths::database::getPath() / "atlas.db" ) ) ) );
 }
 
+void SettingsDialog::updateSizeLabels()
+{
+	const bool done { sizes_done };
+	const QLocale locale { this->locale() };
+
+	const auto text = [ & ]( const DirectorySizeProgress& progress, const std::optional< DirectorySize >& cached )
+	{
+		const auto format = [ &locale ]( const std::uint64_t bytes )
+		{ return locale.formattedDataSize( static_cast< qint64 >( bytes ) ); };
+
+		if ( done ) return format( progress.current().bytes );
+		//The last measured size is closer then a partial count
+		if ( cached ) return tr( "%1 (counting...)" ).arg( format( cached->bytes ) );
+
+		const auto current { progress.current() };
+		return tr( "%1 (counting %2 files...)" ).arg( format( current.bytes ) ).arg( current.files );
+	};
+
+	ui->imagesSizeLabel->setText( text( images_size, images_cached ) );
+	ui->gamesSizeLabel->setText( text( games_size, games_cached ) );
+
+	if ( done && size_timer ) size_timer->stop();
+}
+
 void SettingsDialog::savePathsSettings()
 {
 	//Handle pathSettings
@@ -8,6 +8,10 @@
 #include <QDialog>
 #include <QtWidgets>
 
+#include <thread>
+
+#include "core/utils/DirectorySize.hpp"
+
 #include "ui/delegates/RecordBannerDelegate.hpp"
 
 QT_BEGIN_NAMESPACE
@@ -38,6 +42,16 @@ class SettingsDialog final : public QDialog
 
 	void preparePathsSettings();
 	void savePathsSettings();
+
+	//! Measures the images and games folders in the background. Stopped and joined when the dialog closes
+	std::jthread size_thread {};
+	DirectorySizeProgress images_size {};
+	DirectorySizeProgress games_size {};
+	std::optional< DirectorySize > images_cached {};
+	std::optional< DirectorySize > games_cached {};
+	std::atomic< bool > sizes_done { false };
+	QTimer* size_timer { nullptr };
+	void updateSizeLabels();
 	QListView* qlv { nullptr };
 	QAbstractItemModel* gridPreviewModel { nullptr };
 	RecordBannerDelegate* gridPreviewDelegate { nullptr };
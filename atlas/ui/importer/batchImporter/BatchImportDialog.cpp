@@ -44,6 +44,8 @@ void BatchImportDialog::loadConfig()
 
 	ui->cbCheckLocal->setChecked( config::importer::searchGameInfo::get() );
 	ui->cbMoveImported->setChecked( config::importer::moveImported::get() );
+	ui->cbWatchFolder->setChecked( config::importer::watchLibrary::get() );
+	if ( ui->cbWatchFolder->isChecked() ) ui->tbPath->setText( config::importer::libraryRoot::get() );
 }
 
 void BatchImportDialog::saveConfig()
@@ -53,6 +55,9 @@ void BatchImportDialog::saveConfig()
 
 	config::importer::searchGameInfo::set( ui->cbCheckLocal->isChecked() );
 	config::importer::moveImported::set( ui->cbMoveImported->isChecked() );
+	config::importer::watchLibrary::set( ui->cbWatchFolder->isChecked() );
+	if ( ui->cbWatchFolder->isChecked() && !ui->tbPath->text().isEmpty() )
+		config::importer::libraryRoot::set( ui->tbPath->text() );
 }
 
 BatchImportDialog::~BatchImportDialog()
@@ -113,6 +118,24 @@ void BatchImportDialog::processFiles()
 	ui->twGames->resizeColumnsToContents();
 }
 
+void BatchImportDialog::setPending( const std::filesystem::path root, std::vector< GameImportData > games )
+{
+	ZoneScoped;
+	ui->tbPath->setText( QString::fromStdString( root.string() ) );
+
+	//Already scanned, so straight to the list
+	search_started = true;
+	ui->swImportGames->setCurrentIndex( 1 );
+	ui->btnBack->setHidden( false );
+	ui->btnBack->setEnabled( true );
+	ui->btnNext->setText( "Import" );
+
+	for ( auto& game : games ) emit addToModel( std::move( game ) );
+
+	ui->twGames->resizeColumnsToContents();
+	ui->statusLabel->setText( QString( "Found %1 new games in the library" ).arg( ui->twGames->model()->rowCount() ) );
+}
+
 void BatchImportDialog::importFiles()
 {
 	ZoneScoped;
@@ -131,6 +154,7 @@ void BatchImportDialog::importFiles()
 
 	const bool owning { ui->cbMoveImported->isChecked() };
 	const std::filesystem::path root { ui->tbPath->text().toStdString() };
+	for ( const auto& game : games ) imported_folders.emplace_back( root / game.path );
 
 	(void)QtConcurrent::run(
 		[ games, owning, root ]()
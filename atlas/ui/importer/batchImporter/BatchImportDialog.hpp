@@ -22,12 +22,19 @@ class BatchImportDialog final : public QDialog
 	explicit BatchImportDialog( QWidget* parent = nullptr );
 	~BatchImportDialog();
 
+	//! Skips the search and lists `games`, found under `root` by the LibraryWatcher
+	void setPending( const std::filesystem::path root, std::vector< GameImportData > games );
+
+	//! Folders of the games sent off to be imported. Empty if the dialog was cancelled
+	const std::vector< std::filesystem::path >& importedFolders() const { return imported_folders; }
+
   private:
 
 	GameScanner scanner {};
 	Ui::BatchImportDialog* ui;
 	bool search_started { false };
 	bool import_triggered { false };
+	std::vector< std::filesystem::path > imported_folders {};
 
 	void loadConfig();
 	void saveConfig();
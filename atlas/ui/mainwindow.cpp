@@ -26,6 +26,7 @@ MainWindow::MainWindow( QWidget* parent ) : QMainWindow( parent ), ui( new Ui::M
 	connect( this, &MainWindow::triggerSearch, &record_search, &Search::searchTextChanged );
 	connect( this, &MainWindow::triggerReSearch, &record_search, &Search::runQuery );
 	connect( &record_search, &Search::searchCompleted, ui->recordView, &RecordView::setRecords );
+	connect( &record_search, &Search::facetCountsChanged, this, &MainWindow::setFacetCounts );
 
 	connect( ui->recordView, &RecordView::openDetailedView, this, &MainWindow::switchToDetailed );
 	connect( ui->homeButton, &QToolButton::clicked, this, &MainWindow::on_homeButton_pressed );
@@ -80,6 +81,27 @@ MainWindow::MainWindow( QWidget* parent ) : QMainWindow( parent ), ui( new Ui::M
 
 	//Make sure mouse tracking is enabled for view
 	ui->recordView->setMouseTracking( true );
+
+	connect(
+		&library_watcher,
+		&LibraryWatcher::foundGames,
+		this,
+		[]( [[maybe_unused]] const std::filesystem::path root, const std::size_t count )
+		{
+			getNotificationPopup()->createNotification< NotificationMessage >(
+				QString( "Found %1 new games in the library. Open the bulk importer to add them" ).arg( count ) );
+		} );
+	updateLibraryWatcher();
+}
+
+void MainWindow::updateLibraryWatcher()
+{
+	const auto root { config::importer::libraryRoot::get() };
+	//Keeps running if the root and path template didn't change, so the library isn't walked again
+	if ( config::importer::watchLibrary::get() && !root.isEmpty() )
+		library_watcher.watch( root.toStdString(), config::importer::pathparse::get() );
+	else
+		library_watcher.clear();
 }
 
 MainWindow::~MainWindow()
@@ -116,7 +138,13 @@ void MainWindow::on_actionSingleImporter_triggered()
 void MainWindow::on_actionBulkImporter_triggered()
 {
 	BatchImportDialog importer { this };
+	if ( const auto root = config::importer::libraryRoot::get(); config::importer::watchLibrary::get() )
+		if ( auto pending = library_watcher.pending( root.toStdString() ); !pending.empty() )
+			importer.setPending( root.toStdString(), std::move( pending ) );
 	importer.exec();
+	//Only what was imported is dropped. Games that were skipped or cancelled show up again next time
+	library_watcher.removePending( importer.importedFolders() );
+	updateLibraryWatcher();
 	emit triggerReSearch();
 }
 
@@ -232,6 +260,41 @@ void MainWindow::searchTextChanged( const QString str )
 	emit triggerSearch( str, search_type, ui->sortOrderButton->text() == "ASC" );
 }
 
+void MainWindow::setFacetCounts( const std::vector< atlas::search::FacetCount > counts )
+{
+	using namespace atlas::search;
+	constexpr std::array< const char*, FacetTypeEnd > labels { "Tags",     "Catalog tags", "Genres",
+		                                                       "Languages", "Voice",        "Platforms",
+		                                                       "Engines",   "Creators",     "Status" };
+
+	//Groups are kept between updates so they stay expanded
+	if ( ui->facetTree->topLevelItemCount() == 0 )
+		for ( const auto label : labels ) ui->facetTree->addTopLevelItem( new QTreeWidgetItem( QStringList { label } ) );
+
+	for ( int i = 0; i < FacetTypeEnd; ++i ) qDeleteAll( ui->facetTree->topLevelItem( i )->takeChildren() );
+
+	for ( const auto& [ type, name, count ] : counts )
+	{
+		const auto text { QString::fromStdString( name ) };
+		auto* item { new QTreeWidgetItem( QStringList { QString( "%1 (%2)" ).arg( text ).arg( count ) } ) };
+		item->setData( 0, Qt::UserRole, QString::fromStdString( std::string( facet_namespaces[ type ] ) ) + ":" + text );
+		ui->facetTree->topLevelItem( type )->addChild( item );
+	}
+
+	for ( int i = 0; i < FacetTypeEnd; ++i )
+		ui->facetTree->topLevelItem( i )->setHidden( ui->facetTree->topLevelItem( i )->childCount() == 0 );
+}
+
+void MainWindow::on_facetTree_itemActivated( QTreeWidgetItem* item, [[maybe_unused]] int column )
+{
+	const auto term { item->data( 0, Qt::UserRole ).toString() };
+	if ( term.isEmpty() ) return;
+
+	//Narrows the current search. Setting the text triggers it
+	const auto current { ui->SearchBox->text().trimmed() };
+	ui->SearchBox->setText( current.isEmpty() ? term : current + " & " + term );
+}
+
 void MainWindow::on_sortOrderButton_clicked()
 {
 	if ( ui->sortOrderButton->text() == "ASC" )
@@ -7,6 +7,7 @@
 #include <QTreeWidget>
 
 #include "core/database/Search.hpp"
+#include "core/import/LibraryWatcher.hpp"
 QT_BEGIN_NAMESPACE
 
 namespace Ui
@@ -23,6 +24,7 @@ class MainWindow final : public QMainWindow
 
 	QThread search_thread {};
 	Search record_search {};
+	LibraryWatcher library_watcher {};
 
   public:
 
@@ -34,6 +36,8 @@ class MainWindow final : public QMainWindow
 	Ui::MainWindow* ui;
 
 	void openBatchImportDialog();
+	//! Watches the library root from the config, if it's turned on
+	void updateLibraryWatcher();
 	void resizeEvent( QResizeEvent* event ) override;
 	void showEvent( QShowEvent* event ) override;
 	void moveEvent( QMoveEvent* event ) override;
@@ -67,6 +71,8 @@ class MainWindow final : public QMainWindow
 	void on_btnShowMessageLog_clicked();
 	void movePopup();
 	void taskPopupResized();
+	void setFacetCounts( const std::vector< atlas::search::FacetCount > counts );
+	void on_facetTree_itemActivated( QTreeWidgetItem* item, int column );
 };
 
 #endif // MAINWINDOW_H
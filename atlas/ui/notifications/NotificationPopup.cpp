@@ -103,6 +103,11 @@ void initNotificationPopup( QWidget* parent )
 	if ( internal::taskPopup == nullptr ) internal::taskPopup = new NotificationPopup( parent );
 }
 
+bool hasNotificationPopup()
+{
+	return internal::taskPopup != nullptr;
+}
+
 NotificationPopup* getNotificationPopup()
 {
 	if ( internal::taskPopup == nullptr ) throw std::runtime_error( "NotificationPopup not initialized" );
@@ -171,6 +171,8 @@ class NotificationPopup final : public QDialog
 
 void initNotificationPopup( QWidget* parent );
 NotificationPopup* getNotificationPopup();
+//! False until `initNotificationPopup`. Nothing is shown without a main window, like in the tests
+bool hasNotificationPopup();
 
 template < typename T >
 	requires is_signaled_notification< T > && (!is_simple_notification< T >)
@@ -8,12 +8,35 @@
 
 #include <moc_ProgressMessage.cpp>
 
+#include <QLocale>
+
+#include <limits>
+
 #include <tracy/Tracy.hpp>
 
 #include "NotificationPopup.hpp"
 #include "core/logging.hpp"
 #include "ui_ProgressMessage.h"
 
+//! Interval the state is sampled at (~30Hz)
+constexpr int SAMPLE_INTERVAL_MS { 33 };
+//! Weight of the newest sample in the smoothed rate
+constexpr double RATE_SMOOTHING { 0.1 };
+
+namespace
+{
+	QString formatDuration( const std::int64_t total_seconds )
+	{
+		const auto hours { total_seconds / 3600 };
+		const auto minutes { ( total_seconds % 3600 ) / 60 };
+		const auto seconds { total_seconds % 60 };
+
+		if ( hours > 0 )
+			return QString( "%1:%2:%3" ).arg( hours ).arg( minutes, 2, 10, QChar( '0' ) ).arg( seconds, 2, 10, QChar( '0' ) );
+		return QString( "%1:%2" ).arg( minutes ).arg( seconds, 2, 10, QChar( '0' ) );
+	}
+} // namespace
+
 ProgressMessage::ProgressMessage( const QString name, QWidget* parent ) :
   QWidget( parent ),
   ui( new Ui::ProgressMessage )
@@ -21,6 +44,8 @@ ProgressMessage::ProgressMessage( const QString name, QWidget* parent ) :
 	ui->setupUi( this );
 
 	ui->lblPrimary->setText( name );
+
+	connect( &m_sample_timer, &QTimer::timeout, this, &ProgressMessage::sample );
 }
 
 ProgressMessage::~ProgressMessage()
@@ -31,66 +56,71 @@ ProgressMessage::~ProgressMessage()
 std::unique_ptr< ProgressMessageSignaler > ProgressMessage::getSignaler()
 {
 	ZoneScoped;
-	std::unique_ptr< ProgressMessageSignaler > signaler { std::make_unique< ProgressMessageSignaler >() };
-
-	connect( signaler.get(), &ProgressMessageSignaler::maxChanged, this, &ProgressMessage::changeMax );
-	connect( signaler.get(), &ProgressMessageSignaler::progressChanged, this, &ProgressMessage::changeProgress );
-	connect( signaler.get(), &ProgressMessageSignaler::messageChanged, this, &ProgressMessage::changeMessage );
-	connect( signaler.get(), &ProgressMessageSignaler::selfClose, this, &ProgressMessage::closeSelf );
+	m_clock.start();
+	m_sample_timer.start( SAMPLE_INTERVAL_MS );
 
-	return signaler;
+	return std::make_unique< ProgressMessageSignaler >( m_state );
 }
 
-void ProgressMessage::changeMax( int max )
-{
-	ui->progressBar->setMaximum( max );
-}
-
-void ProgressMessage::changeProgress( int progress )
+void ProgressMessage::sample()
 {
 	ZoneScoped;
-	ui->progressBar->setValue( progress );
+	const bool finished { m_state->finished.load( std::memory_order_acquire ) };
+	const auto max { m_state->max.load( std::memory_order_relaxed ) };
+	const auto progress { m_state->progress.load( std::memory_order_relaxed ) };
+
+	{
+		std::lock_guard guard { m_state->message_mtx };
+		if ( m_state->message_changed )
+		{
+			ui->lblProgressMsg->setText( m_state->message );
+			m_state->message_changed = false;
+		}
+	}
+
+	//QProgressBar only takes ints. Scale down anything larger
+	const std::int64_t scale { max / std::numeric_limits< int >::max() + 1 };
+	ui->progressBar->setMaximum( static_cast< int >( max / scale ) );
+	ui->progressBar->setValue( static_cast< int >( std::min( progress, max ) / scale ) );
+
+	const auto now { m_clock.elapsed() };
+	if ( const auto elapsed = now - m_last_time; elapsed > 0 )
+	{
+		const double instant { static_cast< double >( progress - m_last_progress ) * 1000.0
+			                   / static_cast< double >( elapsed ) };
+		m_rate = m_rate == 0.0 ? instant : m_rate + ( instant - m_rate ) * RATE_SMOOTHING;
+		m_last_time = now;
+		m_last_progress = progress;
+	}
 
-	if ( progress == ui->progressBar->maximum() )
+	if ( !finished && m_rate > 0.0 && max > progress )
 	{
+		const auto remaining { static_cast< std::int64_t >( static_cast< double >( max - progress ) / m_rate ) };
+		ui->progressBar->setFormat( QString( "%p% - %1/s - %2 left" )
+		                                .arg( QLocale().toString( m_rate, 'f', 1 ) )
+		                                .arg( formatDuration( remaining ) ) );
+	}
+	else
+		ui->progressBar->setFormat( "%p%" );
+
+	if ( finished )
+	{
+		m_sample_timer.stop();
+		ui->progressBar->setValue( ui->progressBar->maximum() );
 		ui->btnDismiss->setEnabled( true );
 		if ( ui->checkBox->isChecked() ) closeSelf();
 	}
 }
 
-void ProgressMessage::changeMessage( QString message )
-{
-	ZoneScoped;
-	ui->lblProgressMsg->setText( message );
-}
-
 void ProgressMessage::closeSelf()
 {
 	ZoneScoped;
-	if ( ui->progressBar->maximum() == ui->progressBar->value() ) getNotificationPopup()->removeMessage( this );
-}
-
-void ProgressMessageSignaler::setMax( int max )
-{
-	emit maxChanged( max );
-}
-
-void ProgressMessageSignaler::setProgress( int progress )
-{
-	emit progressChanged( progress );
+	if ( m_state->finished.load( std::memory_order_acquire ) ) getNotificationPopup()->removeMessage( this );
 }
 
 void ProgressMessageSignaler::setMessage( QString message )
 {
-	emit messageChanged( std::move( message ) );
-}
-
-void ProgressMessageSignaler::setFinished()
-{
-	emit selfClose();
-}
-
-void ProgressMessageSignaler::setRange( [[maybe_unused]] int min, int max )
-{
-	setMax( max );
+	std::lock_guard guard { m_state->message_mtx };
+	m_state->message = std::move( message );
+	m_state->message_changed = true;
 }
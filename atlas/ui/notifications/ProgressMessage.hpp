@@ -5,8 +5,14 @@
 #ifndef ATLASGAMEMANAGER_PROGRESSMESSAGE_HPP
 #define ATLASGAMEMANAGER_PROGRESSMESSAGE_HPP
 
+#include <QElapsedTimer>
+#include <QTimer>
 #include <QWidget>
 
+#include <atomic>
+#include <memory>
+#include <mutex>
+
 #include "NotificationPopup.hpp"
 
 QT_BEGIN_NAMESPACE
@@ -18,34 +24,51 @@ namespace Ui
 
 QT_END_NAMESPACE
 
-class ProgressMessageSignaler final : public QObject
+//! Progress shared between a worker and the ProgressMessage displaying it.
+/**
+ * Workers only touch atomics (and a mutex for the message). Nothing is sent to the UI thread.
+ * ProgressMessage samples the state at a fixed rate instead.
+ */
+struct ProgressState
 {
-	Q_OBJECT
+	std::atomic< std::int64_t > max { 0 };
+	std::atomic< std::int64_t > progress { 0 };
+	std::atomic< bool > finished { false };
+
+	std::mutex message_mtx {};
+	QString message {};
+	bool message_changed { false };
+};
+
+class ProgressMessageSignaler final
+{
+	std::shared_ptr< ProgressState > m_state;
+
 	Q_DISABLE_COPY_MOVE( ProgressMessageSignaler )
 
   public:
 
-	ProgressMessageSignaler( QObject* parent = nullptr ) : QObject( parent ) {}
+	ProgressMessageSignaler( std::shared_ptr< ProgressState > state ) : m_state( std::move( state ) ) {}
+
+	~ProgressMessageSignaler() { setFinished(); }
 
-	~ProgressMessageSignaler() override
+	void setMax( const std::int64_t max ) noexcept { m_state->max.store( max, std::memory_order_relaxed ); }
+
+	void setProgress( const std::int64_t progress ) noexcept
 	{
-		setFinished();
-		emit selfClose();
+		m_state->progress.store( progress, std::memory_order_relaxed );
 	}
 
-  public slots:
+	//! Safe to call from multiple workers sharing the same signaler
+	void addProgress( const std::int64_t count = 1 ) noexcept
+	{
+		m_state->progress.fetch_add( count, std::memory_order_relaxed );
+	}
 
-	void setMax( int max );
-	void setProgress( int progress );
 	void setMessage( QString message );
-	void setFinished();
-	void setRange( int min, int max );
-
-  signals:
-	void maxChanged( int max );
-	void progressChanged( int progress );
-	void messageChanged( QString message );
-	void selfClose();
+	void setFinished() noexcept { m_state->finished.store( true, std::memory_order_release ); }
+
+	void setRange( [[maybe_unused]] const std::int64_t min, const std::int64_t max ) noexcept { setMax( max ); }
 };
 
 class ProgressMessage final : public QWidget
@@ -60,6 +83,16 @@ class ProgressMessage final : public QWidget
 
 	Ui::ProgressMessage* ui;
 
+	std::shared_ptr< ProgressState > m_state { std::make_shared< ProgressState >() };
+	QTimer m_sample_timer {};
+
+	//! Time and progress of the last sample. Used for the rate
+	QElapsedTimer m_clock {};
+	std::int64_t m_last_time { 0 };
+	std::int64_t m_last_progress { 0 };
+	//! Smoothed progress per second
+	double m_rate { 0.0 };
+
 	friend class NotificationPopup;
 	template < typename T >
 	friend T::Signaler createNotification( const QString, const bool );
@@ -70,9 +103,7 @@ class ProgressMessage final : public QWidget
 	std::unique_ptr< ProgressMessageSignaler > getSignaler();
 
   private slots:
-	void changeMax( int max );
-	void changeProgress( int progress );
-	void changeMessage( QString message );
+	void sample();
 
   public slots:
 	void closeSelf();
@@ -68,6 +68,43 @@ void VersionView::reloadData()
 	ui->folderSizeLabel
 		->setText( QString( "Folder Size: %1" )
 	                   .arg( this->locale().formattedDataSize( static_cast< qint64 >( mdata.getFolderSize() ) ) ) );
+
+	//From what was stored at import. The executable isn't read again
+	QStringList details {};
+	if ( const auto info = mdata.getExecutableInfo(); info.has_value() )
+	{
+		switch ( info->format )
+		{
+			case ExecutableFormat::PE:
+				details << "Windows executable";
+				break;
+			case ExecutableFormat::ELF:
+				details << "Linux executable";
+				break;
+			case ExecutableFormat::MachO:
+				details << "macOS executable";
+				break;
+			case ExecutableFormat::Script:
+				details << "Script";
+				break;
+			case ExecutableFormat::HTML:
+				details << "HTML";
+				break;
+			case ExecutableFormat::None:
+				break;
+			default:
+				break;
+		}
+
+		if ( const auto machine = info->machineName(); !machine.empty() )
+			details << QString::fromStdString( machine );
+		if ( info->bits > 0 ) details << QString( "%1-bit" ).arg( info->bits );
+		if ( info->format == ExecutableFormat::PE ) details << ( info->isGui() ? "GUI" : "Console" );
+		if ( !info->version.empty() ) details << QString( "Version %1" ).arg( QString::fromStdString( info->version ) );
+	}
+
+	ui->executableInfoLabel->setText(
+		QString( "Executable details: %1" ).arg( details.isEmpty() ? "Unknown" : details.join( ", " ) ) );
 }
 
 void VersionView::on_btnChangeVersion_pressed()
@@ -109,5 +146,8 @@ void VersionView::on_btnChangeExec_pressed()
 		const auto rel_path { std::filesystem::relative( path, this->m_metadata->getPath() ) };
 
 		this->m_metadata->setRelativeExecPath( rel_path );
+		this->m_metadata->setExecutableInfo( readExecutableInfo( path ) );
 	}
+
+	reloadData();
 }
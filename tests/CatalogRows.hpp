@@ -0,0 +1,51 @@
+//
+// Created by kj16609 on 7/22/23.
+//
+
+#ifndef ATLASGAMEMANAGER_CATALOGROWS_HPP
+#define ATLASGAMEMANAGER_CATALOGROWS_HPP
+
+#include <string>
+#include <string_view>
+
+#include "core/logging.hpp"
+#include "core/remote/parsers/CatalogRow.hpp"
+
+//! Text of `column` in the rows below. `<prefix>_<id>`, with the column's name as the default prefix
+inline std::string fullRowText( const std::string_view column, const std::int64_t id, const std::string_view prefix )
+{
+	return fmt::format( "{}_{}", prefix.empty() ? column : prefix, id );
+}
+
+//! Atlas row with every column set. Integer columns are `id`, text columns see `fullRowText`
+inline remote::parsers::AtlasRow fullAtlasRow( const std::int64_t id, const std::string_view prefix = {} )
+{
+	using namespace remote::parsers;
+	AtlasRow row {};
+	for ( std::size_t i = 0; i < AtlasRow::column_count; ++i )
+	{
+		if ( atlas_columns[ i ].type == ColumnType::Integer )
+			row.set( i, id );
+		else
+			row.set( i, fullRowText( atlas_columns[ i ].name, id, prefix ) );
+	}
+	return row;
+}
+
+//! The same row as a JSON object, the way a package carries it
+inline std::string fullAtlasJson( const std::int64_t id, const std::string_view prefix = {} )
+{
+	using namespace remote::parsers;
+	std::string json { "{" };
+	for ( std::size_t i = 0; i < atlas_columns.size(); ++i )
+	{
+		if ( i != 0 ) json += ',';
+		if ( atlas_columns[ i ].type == ColumnType::Integer )
+			json += fmt::format( R"("{}": {})", atlas_columns[ i ].name, id );
+		else
+			json += fmt::format( R"("{}": "{}")", atlas_columns[ i ].name, fullRowText( atlas_columns[ i ].name, id, prefix ) );
+	}
+	return json + "}";
+}
+
+#endif //ATLASGAMEMANAGER_CATALOGROWS_HPP
@@ -0,0 +1,122 @@
+//
+// Created by kj16609 on 7/26/23.
+//
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wctor-dtor-privacy"
+#include <catch2/catch_test_macros.hpp>
+#pragma GCC diagnostic pop
+#else
+#include <catch2/catch_test_macros.hpp>
+#endif
+
+#include "CatalogRows.hpp"
+#include "core/database/Database.hpp"
+#include "core/database/Transaction.hpp"
+#include "core/remote/parsers/CatalogWriter.hpp"
+#include "core/search/QueryBuilder.hpp"
+
+using namespace remote::parsers;
+
+namespace
+{
+	AtlasRow taggedRow( const std::int64_t id, const std::string& tags, const std::string& genre )
+	{
+		auto row { fullAtlasRow( id ) };
+		row.set( *AtlasRow::columnIndex( "tags" ), tags );
+		row.set( *AtlasRow::columnIndex( "genre" ), genre );
+		return row;
+	}
+
+	//! Ids of the catalog entries found by the search `str`
+	std::string search( const std::string& str )
+	{
+		std::string ids {};
+		RapidTransaction() << "SELECT atlas_id FROM atlas_mapping WHERE" + processString( str ) + " ORDER BY atlas_id"
+			>> [ &ids ]( const std::int64_t id ) noexcept { ids += std::to_string( id ) + ";"; };
+		return ids;
+	}
+
+	int count( const std::string& table )
+	{
+		int rows { 0 };
+		RapidTransaction() << fmt::format( "SELECT count(*) FROM {}", table ) >> rows;
+		return rows;
+	}
+} // namespace
+
+TEST_CASE( "splitTags", "[remote][tags]" )
+{
+	REQUIRE( splitTags( "" ).empty() );
+	REQUIRE( splitTags( " , ," ).empty() );
+	REQUIRE( splitTags( "3DCG, Animated ,Sandbox" ) == std::vector< std::string_view > { "3DCG", "Animated", "Sandbox" } );
+}
+
+TEST_CASE( "Catalog tags", "[database][remote][tags]" )
+{
+	REQUIRE_NOTHROW( Database::initalize( ":memory:" ) );
+
+	{
+		Transaction transaction {};
+		CatalogWriter writer {};
+		writer.apply( taggedRow( 1, "3DCG, Sandbox", "RPG" ) );
+		writer.apply( taggedRow( 2, "sandbox, Animated", "Visual Novel" ) );
+		writer.apply( taggedRow( 3, "", "RPG" ) );
+		transaction.commit();
+	}
+
+	for ( std::int64_t id = 1; id <= 3; ++id )
+		RapidTransaction() << "INSERT INTO atlas_mapping (record_id, atlas_id) VALUES (?, ?)" << id << id;
+
+	SECTION( "Stored once" )
+	{
+		//3DCG, Sandbox, Animated, RPG, Visual Novel. Plus the generated text of the other tag columns
+		REQUIRE( count( "catalog_tags WHERE type IN (0, 1)" ) == 5 );
+		REQUIRE( count( "catalog_tag_map WHERE tag_id IN (SELECT tag_id FROM catalog_tags WHERE type IN (0, 1))" ) == 7 );
+	}
+
+	SECTION( "Search" )
+	{
+		REQUIRE( search( "catalog:sandbox" ) == "1;2;" );
+		REQUIRE( search( "genre:RPG" ) == "1;3;" );
+		REQUIRE( search( "catalog:Sandbox & genre:Visual Novel" ) == "2;" );
+		//Genres are not tags
+		REQUIRE( search( "catalog:RPG" ).empty() );
+		//Wildcards only when typed
+		REQUIRE( search( "catalog:sand%" ) == "1;2;" );
+		REQUIRE( search( "catalog:sand" ).empty() );
+	}
+
+	SECTION( "Updates replace the tags of a row" )
+	{
+		{
+			Transaction transaction {};
+			CatalogWriter writer {};
+			AtlasRow update {};
+			update.set( 0, std::int64_t( 1 ) );
+			update.set( *AtlasRow::columnIndex( "tags" ), std::string( "Animated" ) );
+			REQUIRE( writer.apply( update ) == CatalogWriter::Result::Updated );
+			transaction.commit();
+		}
+
+		REQUIRE( search( "catalog:sandbox" ) == "2;" );
+		REQUIRE( search( "catalog:animated" ) == "1;2;" );
+		//Untouched columns keep their tags
+		REQUIRE( search( "genre:RPG" ) == "1;3;" );
+	}
+
+	SECTION( "Indexed from existing rows" )
+	{
+		RapidTransaction() << "DELETE FROM catalog_tag_map";
+		RapidTransaction() << "DELETE FROM catalog_tags";
+
+		indexCatalogTags();
+
+		REQUIRE( search( "catalog:sandbox" ) == "1;2;" );
+		REQUIRE( search( "genre:visual novel" ) == "2;" );
+	}
+
+	Database::deinit();
+}
@@ -0,0 +1,184 @@
+//
+// Created by kj16609 on 7/25/23.
+//
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wctor-dtor-privacy"
+#include <catch2/catch_test_macros.hpp>
+#pragma GCC diagnostic pop
+#else
+#include <catch2/catch_test_macros.hpp>
+#endif
+
+#include <atomic>
+#include <thread>
+
+#include "core/database/Catalog.hpp"
+#include "core/database/Database.hpp"
+#include "core/database/Transaction.hpp"
+#include "core/logging.hpp"
+
+namespace
+{
+	std::filesystem::path freshDirectory()
+	{
+		const auto dir { std::filesystem::temp_directory_path() / "atlas_catalog_test" };
+		std::filesystem::remove_all( dir );
+		std::filesystem::create_directories( dir );
+		return dir;
+	}
+
+	std::string titles()
+	{
+		std::string out {};
+		RapidTransaction() << "SELECT title FROM atlas_data ORDER BY atlas_id" >> [ &out ]( const std::string title ) noexcept
+		{ out += title + ";"; };
+		return out;
+	}
+
+	void insertTitle( sqlite3& db, const int id, const std::string& title )
+	{
+		const auto sql { fmt::format( "INSERT INTO atlas_data (atlas_id, title) VALUES ({}, '{}')", id, title ) };
+		REQUIRE( sqlite3_exec( &db, sql.c_str(), nullptr, nullptr, nullptr ) == SQLITE_OK );
+	}
+} // namespace
+
+TEST_CASE( "Catalog", "[database][catalog]" )
+{
+	const auto dir { freshDirectory() };
+	const auto db_path { dir / "atlas.db" };
+
+	SECTION( "Attached in it's own file" )
+	{
+		REQUIRE_NOTHROW( Database::initalize( db_path ) );
+		REQUIRE( catalog::path() == dir / "catalog.db" );
+		REQUIRE( std::filesystem::exists( catalog::path() ) );
+
+		insertTitle( Database::ref(), 1, "first" );
+		REQUIRE( titles() == "first;" );
+
+		int main_tables { 0 };
+		RapidTransaction() << "SELECT count(*) FROM main.sqlite_master WHERE name = 'atlas_data'" >> main_tables;
+		REQUIRE( main_tables == 0 );
+
+		Database::deinit();
+	}
+
+	SECTION( "Tables in main are moved into the catalog" )
+	{
+		sqlite3* old { nullptr };
+		REQUIRE( sqlite3_open( db_path.string().c_str(), &old ) == SQLITE_OK );
+		REQUIRE(
+			sqlite3_exec(
+				old,
+				"CREATE TABLE atlas_data (atlas_id INTEGER PRIMARY KEY, title STRING);"
+				"INSERT INTO atlas_data VALUES (7, 'migrated');",
+				nullptr,
+				nullptr,
+				nullptr )
+			== SQLITE_OK );
+		sqlite3_close( old );
+
+		REQUIRE_NOTHROW( Database::initalize( db_path ) );
+		REQUIRE( titles() == "migrated;" );
+
+		int main_tables { 0 };
+		RapidTransaction() << "SELECT count(*) FROM main.sqlite_master WHERE name = 'atlas_data'" >> main_tables;
+		REQUIRE( main_tables == 0 );
+
+		Database::deinit();
+	}
+
+	SECTION( "Shadow" )
+	{
+		REQUIRE_NOTHROW( Database::initalize( db_path ) );
+		insertTitle( Database::ref(), 1, "live" );
+		RapidTransaction() << "INSERT INTO atlas_mapping (record_id, atlas_id) VALUES (1, 1)";
+
+		SECTION( "Copy of the live catalog" )
+		{
+			catalog::Shadow shadow { catalog::Shadow::Live };
+			shadow.write( []( sqlite3& db ) { insertTitle( db, 2, "shadow" ); } );
+
+			//Not visible until it's swapped in
+			REQUIRE( titles() == "live;" );
+
+			shadow.swap();
+			REQUIRE( titles() == "live;shadow;" );
+
+			//Views that join the catalog follow it
+			std::string title {};
+			RapidTransaction() << "SELECT title FROM record_atlas_data WHERE record_id = 1" >> title;
+			REQUIRE( title == "live" );
+
+			//Still writable after the swap
+			insertTitle( Database::ref(), 3, "after" );
+			REQUIRE( titles() == "live;shadow;after;" );
+		}
+
+		SECTION( "Full refresh" )
+		{
+			catalog::Shadow shadow { catalog::Shadow::Empty };
+			shadow.write( []( sqlite3& db ) { insertTitle( db, 2, "fresh" ); } );
+			shadow.swap();
+
+			REQUIRE( titles() == "fresh;" );
+		}
+
+		SECTION( "Readers during a swap" )
+		{
+			std::atomic< bool > done { false };
+			std::atomic< int > failures { 0 };
+			std::thread reader {
+				[ & ]()
+				{
+					while ( !done )
+					{
+						try
+						{
+							if ( titles().empty() ) ++failures;
+						}
+						catch ( ... )
+						{
+							++failures;
+						}
+					}
+				}
+			};
+
+			for ( int i = 0; i < 20; ++i )
+			{
+				catalog::Shadow shadow { catalog::Shadow::Live };
+				shadow.swap();
+			}
+
+			done = true;
+			reader.join();
+			REQUIRE( failures == 0 );
+			REQUIRE( titles() == "live;" );
+		}
+
+		SECTION( "Dropped without a swap" )
+		{
+			{
+				catalog::Shadow shadow { catalog::Shadow::Live };
+				REQUIRE_THROWS( shadow.write(
+					[]( sqlite3& db )
+					{
+						insertTitle( db, 2, "discarded" );
+						throw std::runtime_error( "Failed" );
+					} ) );
+			}
+
+			REQUIRE( titles() == "live;" );
+			for ( const auto& entry : std::filesystem::directory_iterator( dir ) )
+				REQUIRE( entry.path().extension() != ".shadow" );
+		}
+
+		Database::deinit();
+	}
+
+	std::filesystem::remove_all( dir );
+}
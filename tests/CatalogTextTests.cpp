@@ -0,0 +1,241 @@
+//
+// Created by kj16609 on 7/28/23.
+//
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wctor-dtor-privacy"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#pragma GCC diagnostic pop
+#else
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#endif
+
+#include <random>
+
+#include "CatalogRows.hpp"
+#include "core/database/Catalog.hpp"
+#include "core/database/CatalogText.hpp"
+#include "core/database/Database.hpp"
+#include "core/database/Transaction.hpp"
+#include "core/database/remote/AtlasData.hpp"
+#include "core/remote/parsers/CatalogWriter.hpp"
+
+using namespace remote::parsers;
+
+namespace
+{
+	//! Word salad about as compressible as a real overview
+	std::string overview( const std::size_t words, const std::uint32_t seed )
+	{
+		constexpr std::array< std::string_view, 24 > vocabulary {
+			"the",     "a",     "you",    "your",   "game", "story",   "town",    "night",
+			"choices", "will",  "decide", "how",    "new",  "friends", "college", "summer",
+			"and",     "while", "living", "secret", "must", "find",    "family",  "past"
+		};
+
+		std::mt19937 rng { seed };
+		std::uniform_int_distribution< std::size_t > pick { 0, vocabulary.size() - 1 };
+		std::string text {};
+		for ( std::size_t i = 0; i < words; ++i )
+		{
+			if ( i != 0 ) text += i % 14 == 0 ? ". " : " ";
+			text += vocabulary[ pick( rng ) ];
+		}
+		return text;
+	}
+
+	AtlasRow fullRow( const std::int64_t id, const std::string& text )
+	{
+		auto row { fullAtlasRow( id ) };
+		row.set( *AtlasRow::columnIndex( "overview" ), text );
+		return row;
+	}
+
+	std::string storedType( const std::int64_t id )
+	{
+		std::string type {};
+		RapidTransaction() << "SELECT typeof(overview) FROM atlas_data WHERE atlas_id = ?" << id >> type;
+		return type;
+	}
+
+	void exec( sqlite3& db, const std::string& sql )
+	{
+		REQUIRE( sqlite3_exec( &db, sql.c_str(), nullptr, nullptr, nullptr ) == SQLITE_OK );
+	}
+} // namespace
+
+TEST_CASE( "Compressed text", "[database][catalog][compression]" )
+{
+	const auto text { overview( 300, 1 ) };
+	const auto blob { catalog::compressText( text ) };
+
+	REQUIRE( blob.size() < text.size() );
+	REQUIRE( catalog::decompressText( blob ) == text );
+	REQUIRE( catalog::decompressText( catalog::compressText( "" ) ).empty() );
+
+	SECTION( "Corrupt" )
+	{
+		REQUIRE_THROWS( catalog::decompressText( std::span( blob ).first( 2 ) ) );
+		REQUIRE_THROWS( catalog::decompressText( std::span( blob ).first( blob.size() - 4 ) ) );
+
+		auto oversized { blob };
+		oversized[ 3 ] = std::byte { 0x7F };
+		REQUIRE_THROWS( catalog::decompressText( oversized ) );
+	}
+}
+
+TEST_CASE( "Compressed catalog columns", "[database][catalog][compression]" )
+{
+	REQUIRE_NOTHROW( Database::initalize( ":memory:" ) );
+
+	const auto long_text { overview( 300, 2 ) };
+
+	{
+		Transaction transaction {};
+		CatalogWriter writer {};
+		writer.apply( fullRow( 1, long_text ) );
+		writer.apply( fullRow( 2, "Short" ) );
+		transaction.commit();
+	}
+
+	SECTION( "Long text is stored compressed" )
+	{
+		REQUIRE( storedType( 1 ) == "blob" );
+		REQUIRE( storedType( 2 ) == "text" );
+
+		std::string text {};
+		RapidTransaction() << "SELECT catalog_text(overview) FROM atlas_data WHERE atlas_id = 1" >> text;
+		REQUIRE( text == long_text );
+
+		REQUIRE( AtlasData( 1 ).get< AtlasColumns::Overview >().toStdString() == long_text );
+		REQUIRE( AtlasData( 2 ).get< AtlasColumns::Overview >().toStdString() == "Short" );
+
+		const auto [ title, text_again ] = AtlasData( 1 ).get< AtlasColumns::Title, AtlasColumns::Overview >();
+		REQUIRE( title.toStdString() == "title_1" );
+		REQUIRE( text_again.toStdString() == long_text );
+	}
+
+	SECTION( "Unchanged rows are skipped" )
+	{
+		Transaction transaction {};
+		CatalogWriter writer {};
+		REQUIRE( writer.apply( fullRow( 1, long_text ) ) == CatalogWriter::Result::Skipped );
+
+		//Rows from before row_hash are compared against the stored text
+		RapidTransaction() << "UPDATE atlas_data SET row_hash = NULL";
+		AtlasRow update {};
+		update.set( 0, std::int64_t( 1 ) );
+		update.set( *AtlasRow::columnIndex( "overview" ), long_text );
+		REQUIRE( writer.apply( update ) == CatalogWriter::Result::Skipped );
+
+		update.set( *AtlasRow::columnIndex( "overview" ), long_text + " The end." );
+		REQUIRE( writer.apply( update ) == CatalogWriter::Result::Updated );
+		transaction.commit();
+
+		REQUIRE( AtlasData( 1 ).get< AtlasColumns::Overview >().toStdString() == long_text + " The end." );
+	}
+
+	SECTION( "Text from older versions is compressed" )
+	{
+		RapidTransaction() << "UPDATE atlas_data SET overview = ? WHERE atlas_id = 2" << long_text;
+		REQUIRE( storedType( 2 ) == "text" );
+
+		REQUIRE( catalog::compressColumns( Database::ref(), "catalog" ) == 1 );
+		REQUIRE( storedType( 2 ) == "blob" );
+		REQUIRE( AtlasData( 2 ).get< AtlasColumns::Overview >().toStdString() == long_text );
+
+		REQUIRE( catalog::compressColumns( Database::ref(), "catalog" ) == 0 );
+	}
+
+	Database::deinit();
+}
+
+TEST_CASE( "Compressed catalog migration", "[database][catalog][compression]" )
+{
+	const auto dir { std::filesystem::temp_directory_path() / "atlas_catalog_text_test" };
+	std::filesystem::remove_all( dir );
+	std::filesystem::create_directories( dir );
+
+	const auto long_text { overview( 300, 3 ) };
+
+	REQUIRE_NOTHROW( Database::initalize( dir / "atlas.db" ) );
+	RapidTransaction() << "INSERT INTO atlas_data (atlas_id, overview) VALUES (1, ?)" << long_text;
+	//As a catalog from before compression
+	exec( Database::ref(), "PRAGMA catalog.user_version = 0" );
+	Database::deinit();
+
+	REQUIRE_NOTHROW( Database::initalize( dir / "atlas.db" ) );
+	REQUIRE( storedType( 1 ) == "blob" );
+	REQUIRE( AtlasData( 1 ).get< AtlasColumns::Overview >().toStdString() == long_text );
+
+	int version { 0 };
+	RapidTransaction() << "PRAGMA catalog.user_version" >> version;
+	REQUIRE( version == 1 );
+	Database::deinit();
+
+	std::filesystem::remove_all( dir );
+}
+
+TEST_CASE( "Compressed catalog benchmark", "[database][catalog][compression][.][benchmark]" )
+{
+	const auto dir { std::filesystem::temp_directory_path() / "atlas_catalog_text_bench" };
+	std::filesystem::remove_all( dir );
+	std::filesystem::create_directories( dir );
+
+	REQUIRE_NOTHROW( Database::initalize( dir / "atlas.db" ) );
+	{
+		Transaction transaction {};
+		CatalogWriter writer {};
+		for ( std::int64_t id = 1; id <= 5000; ++id )
+			writer.apply( fullRow( id, overview( 150 + static_cast< std::size_t >( id % 200 ), static_cast< std::uint32_t >( id ) ) ) );
+		transaction.commit();
+	}
+
+	const auto compressed_path { dir / "compressed.db" };
+	const auto plain_path { dir / "plain.db" };
+	auto& db { Database::ref() };
+
+	exec( db, fmt::format( "VACUUM catalog INTO '{}'", compressed_path.string() ) );
+	exec( db, "UPDATE atlas_data SET overview = catalog_text(overview)" );
+	exec( db, fmt::format( "VACUUM catalog INTO '{}'", plain_path.string() ) );
+	Database::deinit();
+
+	const auto compressed_size { std::filesystem::file_size( compressed_path ) };
+	const auto plain_size { std::filesystem::file_size( plain_path ) };
+	WARN( fmt::format(
+		"Catalog size: {} KB as text, {} KB compressed ({:.1f}%)",
+		plain_size / 1024,
+		compressed_size / 1024,
+		100.0 * static_cast< double >( compressed_size ) / static_cast< double >( plain_size ) ) );
+	REQUIRE( compressed_size < plain_size );
+
+	//A fresh connection has an empty page cache. Every page of the table is read in for the scan
+	const auto coldScan = []( const std::filesystem::path& path )
+	{
+		sqlite3* conn { nullptr };
+		sqlite3_open_v2( path.string().c_str(), &conn, SQLITE_OPEN_READONLY, nullptr );
+		std::int64_t total { 0 };
+		sqlite3_stmt* stmt { nullptr };
+		sqlite3_prepare_v2( conn, "SELECT sum(length(title)) FROM atlas_data", -1, &stmt, nullptr );
+		if ( sqlite3_step( stmt ) == SQLITE_ROW ) total = sqlite3_column_int64( stmt, 0 );
+		sqlite3_finalize( stmt );
+		sqlite3_close_v2( conn );
+		return total;
+	};
+
+	BENCHMARK( "cold scan, text" )
+	{
+		return coldScan( plain_path );
+	};
+
+	BENCHMARK( "cold scan, compressed" )
+	{
+		return coldScan( compressed_path );
+	};
+
+	std::filesystem::remove_all( dir );
+}
@@ -0,0 +1,127 @@
+//
+// Created by kj16609 on 7/15/23.
+//
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wctor-dtor-privacy"
+#include <catch2/catch_test_macros.hpp>
+#pragma GCC diagnostic pop
+#else
+#include <catch2/catch_test_macros.hpp>
+#endif
+
+#include "CatalogRows.hpp"
+#include "core/database/Database.hpp"
+#include "core/database/Transaction.hpp"
+#include "core/remote/parsers/CatalogWriter.hpp"
+
+using namespace remote::parsers;
+
+namespace
+{
+	std::string atlasText( const std::int64_t id, const std::string_view column )
+	{
+		std::string str {};
+		RapidTransaction() << fmt::format( "SELECT {} FROM atlas_data WHERE atlas_id = ?", column ) << id >> str;
+		return str;
+	}
+} // namespace
+
+TEST_CASE( "CatalogWriter", "[database][remote]" )
+{
+	REQUIRE_NOTHROW( Database::initalize( ":memory:" ) );
+
+	{
+		Transaction transaction {};
+		CatalogWriter writer {};
+
+		for ( std::int64_t i = 1; i <= 10; ++i ) writer.apply( fullAtlasRow( i ) );
+
+		//Every full row shares the same hash lookup and insert
+		REQUIRE( writer.statementCount() == 2 );
+		REQUIRE( writer.stats().inserted == 10 );
+
+		SECTION( "Partial rows" )
+		{
+			AtlasRow update {};
+			update.set( 0, std::int64_t( 3 ) );
+			update.set( *AtlasRow::columnIndex( "title" ), std::string( "New title" ) );
+			update.set( *AtlasRow::columnIndex( "version" ), std::string( "v2" ) );
+
+			REQUIRE( writer.apply( update ) == CatalogWriter::Result::Updated );
+			REQUIRE( writer.statementCount() == 4 );
+
+			//Same set of keys, same statement
+			update.set( 0, std::int64_t( 4 ) );
+			REQUIRE( writer.apply( update ) == CatalogWriter::Result::Updated );
+			REQUIRE( writer.statementCount() == 4 );
+
+			//Nothing changed the second time around
+			REQUIRE( writer.apply( update ) == CatalogWriter::Result::Skipped );
+
+			REQUIRE( atlasText( 3, "title" ) == "New title" );
+			REQUIRE( atlasText( 3, "version" ) == "v2" );
+			REQUIRE( atlasText( 4, "title" ) == "New title" );
+			REQUIRE( atlasText( 3, "creator" ) == "creator_3" );
+			REQUIRE( atlasText( 5, "title" ) == "title_5" );
+		}
+
+		SECTION( "Full rows update existing entries" )
+		{
+			auto row { fullAtlasRow( 2 ) };
+			row.set( *AtlasRow::columnIndex( "title" ), std::string( "Replaced" ) );
+			writer.apply( row );
+
+			REQUIRE( atlasText( 2, "title" ) == "Replaced" );
+			REQUIRE( writer.stats().updated == 1 );
+		}
+
+		SECTION( "Unchanged rows are skipped" )
+		{
+			REQUIRE( writer.apply( fullAtlasRow( 5 ) ) == CatalogWriter::Result::Skipped );
+
+			//A partial row that matches what is stored is skipped too
+			AtlasRow update {};
+			update.set( 0, std::int64_t( 5 ) );
+			update.set( *AtlasRow::columnIndex( "title" ), std::string( "title_5" ) );
+			REQUIRE( writer.apply( update ) == CatalogWriter::Result::Skipped );
+
+			REQUIRE( writer.stats().skipped == 2 );
+		}
+
+		SECTION( "Partial update keeps the hash in sync" )
+		{
+			AtlasRow update {};
+			update.set( 0, std::int64_t( 6 ) );
+			update.set( *AtlasRow::columnIndex( "title" ), std::string( "Changed" ) );
+			REQUIRE( writer.apply( update ) == CatalogWriter::Result::Updated );
+
+			//Full row with the same values as what is now stored
+			auto row { fullAtlasRow( 6 ) };
+			row.set( *AtlasRow::columnIndex( "title" ), std::string( "Changed" ) );
+			REQUIRE( writer.apply( row ) == CatalogWriter::Result::Skipped );
+
+			REQUIRE( writer.apply( fullAtlasRow( 6 ) ) == CatalogWriter::Result::Updated );
+		}
+
+		SECTION( "Rows written before row_hash existed" )
+		{
+			RapidTransaction() << "UPDATE atlas_data SET row_hash = NULL WHERE atlas_id = 7";
+			REQUIRE( writer.apply( fullAtlasRow( 7 ) ) == CatalogWriter::Result::Updated );
+			REQUIRE( writer.apply( fullAtlasRow( 7 ) ) == CatalogWriter::Result::Skipped );
+		}
+
+		SECTION( "Missing key" )
+		{
+			AtlasRow row {};
+			row.set( *AtlasRow::columnIndex( "title" ), std::string( "No key" ) );
+			REQUIRE_THROWS( writer.apply( row ) );
+		}
+
+		transaction.commit();
+	}
+
+	Database::deinit();
+}
@@ -0,0 +1,187 @@
+//
+// Created by kj16609 on 8/2/23.
+//
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wctor-dtor-privacy"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#pragma GCC diagnostic pop
+#else
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#endif
+
+#include <atomic>
+#include <fstream>
+#include <sstream>
+
+#ifdef __linux__
+#include <sys/stat.h>
+#endif
+
+#include "core/logging.hpp"
+#include "core/utils/CopyEngine.hpp"
+
+namespace
+{
+	void write( const std::filesystem::path& path, const std::string& data )
+	{
+		std::filesystem::create_directories( path.parent_path() );
+		std::ofstream( path, std::ios::binary ) << data;
+	}
+
+	std::string read( const std::filesystem::path& path )
+	{
+		std::stringstream ss {};
+		ss << std::ifstream( path, std::ios::binary ).rdbuf();
+		return ss.str();
+	}
+
+	void makeGame( const std::filesystem::path& root )
+	{
+		write( root / "game.exe", std::string( 3 * 1024 * 1024, 'g' ) );
+		write( root / "www" / "data.json", "{}" );
+		for ( int i = 0; i < 30; ++i ) write( root / "www" / "img" / fmt::format( "{}.png", i ), std::string( 100, 'p' ) );
+		std::filesystem::create_directories( root / "saves" );
+	}
+
+	std::uint64_t gameSize()
+	{
+		return 3 * 1024 * 1024 + 2 + 30 * 100;
+	}
+} // namespace
+
+TEST_CASE( "Copy engine", "[copy_engine]" )
+{
+	const auto root { std::filesystem::temp_directory_path() / "atlas_copy_engine_test" };
+	std::filesystem::remove_all( root );
+	makeGame( root / "source" );
+
+	std::atomic< std::uint64_t > reported { 0 };
+	const auto count = [ &reported ]( const std::uint64_t bytes ) { reported += bytes; };
+
+	SECTION( "Copy file" )
+	{
+		const auto dest { root / "copy.exe" };
+		write( dest, "old and longer then the new file" );
+		write( root / "small", "new" );
+
+		REQUIRE( copyFile( root / "small", dest, count ) == 3 );
+		REQUIRE( read( dest ) == "new" );
+		REQUIRE( reported == 3 );
+		REQUIRE(
+			std::filesystem::last_write_time( dest ) == std::filesystem::last_write_time( root / "small" ) );
+
+		REQUIRE( copyFile( root / "source" / "game.exe", dest ) == 3 * 1024 * 1024 );
+		REQUIRE( read( dest ) == read( root / "source" / "game.exe" ) );
+	}
+
+	SECTION( "Renamed on the same filesystem" )
+	{
+		const auto dest { root / "games" / "creator" / "title" / "1.0" };
+		REQUIRE( moveDirectory( root / "source", dest, count ) == MoveMethod::Rename );
+		REQUIRE_FALSE( std::filesystem::exists( root / "source" ) );
+		REQUIRE( std::filesystem::file_size( dest / "game.exe" ) == 3 * 1024 * 1024 );
+		REQUIRE( std::filesystem::is_directory( dest / "saves" ) );
+		//Nothing was copied
+		REQUIRE( reported == 0 );
+	}
+
+	SECTION( "Renamed over an empty folder" )
+	{
+		const auto dest { root / "games" / "empty" };
+		std::filesystem::create_directories( dest );
+		REQUIRE( moveDirectory( root / "source", dest, count ) == MoveMethod::Rename );
+		REQUIRE( std::filesystem::exists( dest / "game.exe" ) );
+	}
+
+	SECTION( "Never merged into an existing folder" )
+	{
+		const auto dest { root / "games" / "existing" };
+		write( dest / "keep.txt", "kept" );
+
+		REQUIRE_THROWS( moveDirectory( root / "source", dest, count ) );
+		REQUIRE_THROWS( copyDirectory( root / "source", dest, count ) );
+		REQUIRE( std::filesystem::exists( root / "source" / "game.exe" ) );
+		REQUIRE_FALSE( std::filesystem::exists( dest / "game.exe" ) );
+		REQUIRE( read( dest / "keep.txt" ) == "kept" );
+	}
+
+	SECTION( "Copied" )
+	{
+		const auto dest { root / "games" / "copied" };
+
+		REQUIRE( copyDirectory( root / "source", dest, count, 3 ) == gameSize() );
+		REQUIRE( reported == gameSize() );
+		REQUIRE( read( dest / "www" / "img" / "29.png" ) == std::string( 100, 'p' ) );
+		REQUIRE( std::filesystem::is_directory( dest / "saves" ) );
+		REQUIRE_FALSE( std::filesystem::exists( root / "games" / "copied.partial" ) );
+	}
+
+#ifdef __linux__
+	SECTION( "Symlinks are copied as links" )
+	{
+		const auto outside { root / "outside" };
+		write( outside / "big.bin", std::string( 4096, 'o' ) );
+		std::filesystem::create_directory_symlink( outside, root / "source" / "linked_dir" );
+		std::filesystem::create_symlink( root / "missing", root / "source" / "dangling" );
+
+		const auto dest { root / "games" / "links" };
+		REQUIRE( copyDirectory( root / "source", dest, count ) == gameSize() );
+		REQUIRE( std::filesystem::is_symlink( dest / "linked_dir" ) );
+		REQUIRE( std::filesystem::read_symlink( dest / "linked_dir" ) == outside );
+		REQUIRE( std::filesystem::is_symlink( dest / "dangling" ) );
+	}
+
+	SECTION( "Nothing left behind when a copy fails" )
+	{
+		const auto dest { root / "games" / "failed" };
+		REQUIRE( ::mkfifo( ( root / "source" / "pipe" ).c_str(), 0600 ) == 0 );
+
+		REQUIRE_THROWS( copyDirectory( root / "source", dest, count, 1 ) );
+		REQUIRE( std::filesystem::exists( root / "source" / "game.exe" ) );
+		REQUIRE_FALSE( std::filesystem::exists( dest ) );
+		REQUIRE_FALSE( std::filesystem::exists( root / "games" / "failed.partial" ) );
+	}
+#endif
+
+	SECTION( "Missing source" )
+	{
+		REQUIRE_THROWS( moveDirectory( root / "missing", root / "games" / "missing" ) );
+	}
+
+	std::filesystem::remove_all( root );
+}
+
+TEST_CASE( "Copy engine benchmark", "[copy_engine][.][benchmark]" )
+{
+	const auto root { std::filesystem::temp_directory_path() / "atlas_copy_engine_bench" };
+	std::filesystem::remove_all( root );
+
+	for ( int i = 0; i < 2000; ++i )
+		write( root / "source" / fmt::format( "dir_{}", i / 50 ) / fmt::format( "{}.bin", i ), std::string( 64 * 1024, 'b' ) );
+
+	BENCHMARK( "std::filesystem::copy_file per file" )
+	{
+		const auto dest { root / "std" };
+		for ( const auto& entry : std::filesystem::recursive_directory_iterator( root / "source" ) )
+		{
+			if ( !entry.is_regular_file() ) continue;
+			const auto target { dest / std::filesystem::relative( entry.path(), root / "source" ) };
+			std::filesystem::create_directories( target.parent_path() );
+			std::filesystem::copy_file( entry.path(), target, std::filesystem::copy_options::overwrite_existing );
+		}
+		std::filesystem::remove_all( dest );
+	};
+
+	BENCHMARK( "copyDirectory" )
+	{
+		copyDirectory( root / "source", root / "engine" );
+		std::filesystem::remove_all( root / "engine" );
+	};
+
+	std::filesystem::remove_all( root );
+}
@@ -0,0 +1,199 @@
+//
+// Created by kj16609 on 8/1/23.
+//
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wctor-dtor-privacy"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#pragma GCC diagnostic pop
+#else
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#endif
+
+#include <fstream>
+
+#include "core/database/Database.hpp"
+#include "core/database/SizeCache.hpp"
+#include "core/database/Transaction.hpp"
+#include "core/database/record/Record.hpp"
+#include "core/utils/DirectorySize.hpp"
+
+namespace
+{
+	void write( const std::filesystem::path& path, const std::size_t size )
+	{
+		std::filesystem::create_directories( path.parent_path() );
+		std::ofstream( path, std::ios::binary ) << std::string( size, 'a' );
+	}
+
+	//! What the old recursive walk would have added up
+	DirectorySize iterated( const std::filesystem::path& path )
+	{
+		DirectorySize size {};
+		for ( const auto& entry : std::filesystem::recursive_directory_iterator( path ) )
+		{
+			if ( entry.is_symlink() || !entry.is_regular_file() ) continue;
+			size.bytes += entry.file_size();
+			++size.files;
+		}
+		return size;
+	}
+
+	void addChange( const std::int64_t delta, const bool in_place )
+	{
+		RapidTransaction() << "INSERT INTO data_change (timestamp, delta, in_place) VALUES (0, ?, ?)" << delta
+						   << in_place;
+	}
+} // namespace
+
+TEST_CASE( "Directory size", "[directory_size]" )
+{
+	const auto root { std::filesystem::temp_directory_path() / "atlas_directory_size_test" };
+	std::filesystem::remove_all( root );
+
+	write( root / "game.exe", 1000 );
+	write( root / "www" / "data.json", 250 );
+	for ( int i = 0; i < 40; ++i ) write( root / "www" / fmt::format( "img_{}", i / 10 ) / fmt::format( "{}.png", i ), 64 );
+	std::filesystem::create_directories( root / "empty" );
+
+	const auto expected { iterated( root ) };
+	REQUIRE( expected.files == 42 );
+
+	SECTION( "Matches a full walk" )
+	{
+		DirectorySizeProgress progress {};
+		const auto size { directorySize( root, &progress ) };
+		REQUIRE( size.bytes == expected.bytes );
+		REQUIRE( size.files == expected.files );
+		REQUIRE( size.allocated >= size.bytes );
+		REQUIRE( progress.current() == size );
+		REQUIRE( progress.directories == 7 );
+	}
+
+	SECTION( "Trailing separator" )
+	{
+		REQUIRE( directorySize( root.string() + "/" ).bytes == expected.bytes );
+	}
+
+#ifdef __linux__
+	SECTION( "Symlinks aren't followed" )
+	{
+		const auto outside { std::filesystem::temp_directory_path() / "atlas_directory_size_outside" };
+		std::filesystem::remove_all( outside );
+		write( outside / "big.bin", 4096 );
+
+		std::filesystem::create_directory_symlink( outside, root / "linked_dir" );
+		std::filesystem::create_symlink( outside / "big.bin", root / "linked_file" );
+		REQUIRE( directorySize( root ).bytes == expected.bytes );
+
+		std::filesystem::remove_all( outside );
+	}
+
+	SECTION( "Hard links count once" )
+	{
+		std::filesystem::create_hard_link( root / "game.exe", root / "www" / "game_link.exe" );
+		const auto size { directorySize( root ) };
+		REQUIRE( size.bytes == expected.bytes );
+		REQUIRE( size.files == expected.files );
+	}
+#endif
+
+	SECTION( "Stopped" )
+	{
+		std::stop_source source {};
+		source.request_stop();
+		REQUIRE( directorySize( root, nullptr, source.get_token() ) == DirectorySize {} );
+	}
+
+	SECTION( "Missing" )
+	{
+		REQUIRE( directorySize( root / "missing" ) == DirectorySize {} );
+		REQUIRE( directorySize( root / "game.exe" ) == DirectorySize {} );
+	}
+
+	std::filesystem::remove_all( root );
+}
+
+TEST_CASE( "Size cache", "[directory_size][size_cache]" )
+{
+	REQUIRE_NOTHROW( Database::initalize( ":memory:" ) );
+
+	const std::filesystem::path games { "/library/games" };
+	REQUIRE_FALSE( size_cache::find( games, true ) );
+
+	addChange( 500, false );
+	const auto last_change { size_cache::lastChange() };
+	REQUIRE( last_change > 0 );
+
+	const DirectorySize measured { 10000, 12288, 30 };
+	size_cache::store( games, measured, last_change );
+	REQUIRE( size_cache::find( games, true ) == measured );
+
+	SECTION( "Deltas after it are applied" )
+	{
+		addChange( 2000, false );
+		addChange( -500, false );
+		//Not in the games folder
+		addChange( 7000, true );
+
+		const auto size { size_cache::find( games, true ) };
+		REQUIRE( size );
+		REQUIRE( size->bytes == 11500 );
+		REQUIRE( size->allocated == 13788 );
+		REQUIRE( size->files == 30 );
+
+		REQUIRE( size_cache::find( games, false ) == measured );
+	}
+
+	SECTION( "Versions of records" )
+	{
+		const Record record { importRecord( "Size cache", "Creator", "Unity" ) };
+		//Moved into the games folder
+		record->addVersion( "1.0", games / "Creator" / "Size cache" / "1.0", "game.exe", 3000, false );
+		//Left where it was
+		record->addVersion( "1.1", "/elsewhere/1.1", "game.exe", 4000, true );
+
+		REQUIRE( size_cache::find( games, true )->bytes == 13000 );
+	}
+
+	SECTION( "Never below empty" )
+	{
+		addChange( -20000, false );
+		REQUIRE( size_cache::find( games, true )->bytes == 0 );
+	}
+
+	SECTION( "Measured again" )
+	{
+		addChange( 2000, false );
+		const DirectorySize remeasured { 12000, 14336, 31 };
+		size_cache::store( games, remeasured, size_cache::lastChange() );
+		REQUIRE( size_cache::find( games, true ) == remeasured );
+	}
+
+	Database::deinit();
+}
+
+TEST_CASE( "Directory size benchmark", "[directory_size][.][benchmark]" )
+{
+	const auto root { std::filesystem::temp_directory_path() / "atlas_directory_size_bench" };
+	std::filesystem::remove_all( root );
+
+	for ( int i = 0; i < 20000; ++i )
+		write( root / fmt::format( "game_{}", i / 200 ) / fmt::format( "dir_{}", i / 20 ) / fmt::format( "{}.bin", i ), 16 );
+
+	BENCHMARK( "Recursive iterator" )
+	{
+		return iterated( root ).bytes;
+	};
+
+	BENCHMARK( "directorySize" )
+	{
+		return directorySize( root ).bytes;
+	};
+
+	std::filesystem::remove_all( root );
+}
@@ -0,0 +1,184 @@
+//
+// Created by kj16609 on 7/31/23.
+//
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wctor-dtor-privacy"
+#include <catch2/catch_test_macros.hpp>
+#pragma GCC diagnostic pop
+#else
+#include <catch2/catch_test_macros.hpp>
+#endif
+
+#include <fstream>
+
+#include "core/utils/ExecutableInfo.hpp"
+#include "core/utils/engineDetection/engineDetection.hpp"
+
+namespace
+{
+	void put16( std::string& data, const std::size_t offset, const std::uint16_t value )
+	{
+		data[ offset ] = static_cast< char >( value & 0xFF );
+		data[ offset + 1 ] = static_cast< char >( value >> 8 );
+	}
+
+	void put32( std::string& data, const std::size_t offset, const std::uint32_t value )
+	{
+		put16( data, offset, static_cast< std::uint16_t >( value & 0xFFFF ) );
+		put16( data, offset + 2, static_cast< std::uint16_t >( value >> 16 ) );
+	}
+
+	//! Smallest PE that has everything the parser reads: One .rsrc section with an icon and a version resource
+	std::string makePe( const std::uint16_t machine, const bool pe32_plus, const std::uint16_t subsystem )
+	{
+		constexpr std::size_t nt { 0x40 };
+		constexpr std::size_t rsrc { 0x200 };
+		constexpr std::uint32_t rsrc_address { 0x1000 };
+		const std::uint16_t optional_size { static_cast< std::uint16_t >( pe32_plus ? 240 : 224 ) };
+		const std::size_t directories { nt + 24 + ( pe32_plus ? 112u : 96u ) };
+
+		std::string data( 0x400, '\0' );
+		data[ 0 ] = 'M';
+		data[ 1 ] = 'Z';
+		put32( data, 0x3C, nt );
+
+		data.replace( nt, 4, std::string( "PE\0\0", 4 ) );
+		put16( data, nt + 4, machine );
+		put16( data, nt + 6, 1 );
+		put16( data, nt + 20, optional_size );
+		put16( data, nt + 24, pe32_plus ? 0x20B : 0x10B );
+		put16( data, nt + 24 + 68, subsystem );
+		put32( data, directories - 4, 16 );
+		put32( data, directories + 16, rsrc_address );
+		put32( data, directories + 20, 0x200 );
+
+		const std::size_t section { nt + 24 + optional_size };
+		data.replace( section, 5, ".rsrc" );
+		put32( data, section + 8, 0x200 );
+		put32( data, section + 12, rsrc_address );
+		put32( data, section + 16, 0x200 );
+		put32( data, section + 20, rsrc );
+
+		//Type directory with RT_ICON and RT_VERSION, each with one name and one language
+		const auto directory = [ & ]( const std::size_t offset, const std::uint32_t id, const std::uint32_t target )
+		{
+			put16( data, rsrc + offset + 14, 1 );
+			put32( data, rsrc + offset + 16, id );
+			put32( data, rsrc + offset + 20, target );
+		};
+
+		put16( data, rsrc + 14, 2 );
+		put32( data, rsrc + 16, 3 );
+		put32( data, rsrc + 20, 0x80000000 | 0x20 );
+		put32( data, rsrc + 24, 16 );
+		put32( data, rsrc + 28, 0x80000000 | 0x38 );
+		directory( 0x20, 1, 0x80000000 | 0x50 );
+		directory( 0x50, 0x409, 0x80 );
+		directory( 0x38, 1, 0x80000000 | 0x68 );
+		directory( 0x68, 0x409, 0x90 );
+
+		put32( data, rsrc + 0x80, rsrc_address + 0x100 );
+		put32( data, rsrc + 0x84, 0x20 );
+		put32( data, rsrc + 0x90, rsrc_address + 0x120 );
+		put32( data, rsrc + 0x94, 0x60 );
+
+		//VS_VERSIONINFO header, then VS_FIXEDFILEINFO with version 1.2.3.4
+		put32( data, rsrc + 0x120 + 40, 0xFEEF04BD );
+		put32( data, rsrc + 0x120 + 48, ( 1 << 16 ) | 2 );
+		put32( data, rsrc + 0x120 + 52, ( 3 << 16 ) | 4 );
+
+		return data;
+	}
+
+	std::string makeElf( const bool is_64, const std::uint16_t machine )
+	{
+		std::string data( 64, '\0' );
+		data.replace( 0, 4, "\x7F"
+		                    "ELF" );
+		data[ 4 ] = is_64 ? 2 : 1;
+		data[ 5 ] = 1;
+		put16( data, 18, machine );
+		return data;
+	}
+} // namespace
+
+TEST_CASE( "Executable info", "[import][executable_info]" )
+{
+	const auto root { std::filesystem::temp_directory_path() / "atlas_executable_info_test" };
+	std::filesystem::remove_all( root );
+	std::filesystem::create_directories( root );
+
+	const auto write = [ & ]( const std::string& name, const std::string& data )
+	{
+		std::ofstream( root / name, std::ios::binary ) << data;
+		return root / name;
+	};
+
+	SECTION( "PE32+" )
+	{
+		const auto info { readExecutableInfo( write( "game.exe", makePe( 0x8664, true, 2 ) ) ) };
+		REQUIRE( info );
+		REQUIRE( info->format == ExecutableFormat::PE );
+		REQUIRE( info->bits == 64 );
+		REQUIRE( info->machineName() == "x86-64" );
+		REQUIRE( info->isGui() );
+		REQUIRE( info->version == "1.2.3.4" );
+		REQUIRE( info->icon_offset == 0x300 );
+	}
+
+	SECTION( "PE32 console" )
+	{
+		const auto info { readExecutableInfo( write( "tool.exe", makePe( 0x014C, false, 3 ) ) ) };
+		REQUIRE( info );
+		REQUIRE( info->bits == 32 );
+		REQUIRE( info->machineName() == "x86" );
+		REQUIRE_FALSE( info->isGui() );
+		REQUIRE( info->version == "1.2.3.4" );
+	}
+
+	SECTION( "Truncated PE" )
+	{
+		const auto info { readExecutableInfo( write( "broken.exe", makePe( 0x8664, true, 2 ).substr( 0, 0x80 ) ) ) };
+		REQUIRE( info );
+		REQUIRE( info->format == ExecutableFormat::PE );
+		REQUIRE( info->version.empty() );
+		REQUIRE( info->icon_offset == 0 );
+	}
+
+	SECTION( "ELF" )
+	{
+		const auto info { readExecutableInfo( write( "game.x86_64", makeElf( true, 62 ) ), ".sh" ) };
+		REQUIRE( info );
+		REQUIRE( info->format == ExecutableFormat::ELF );
+		REQUIRE( info->bits == 64 );
+		REQUIRE( info->machineName() == "x86-64" );
+	}
+
+	SECTION( "Not an executable" )
+	{
+		REQUIRE_FALSE( readExecutableInfo( write( "fake.exe", "nothing here" ) ) );
+		REQUIRE_FALSE( readExecutableInfo( root / "missing.exe" ) );
+	}
+
+	SECTION( "64 bit GUI executables are ranked first" )
+	{
+		write( "game32.exe", makePe( 0x014C, false, 2 ) );
+		write( "console64.exe", makePe( 0x8664, true, 3 ) );
+		write( "game64.exe", makePe( 0x8664, true, 2 ) );
+
+		FileScanner scanner { root };
+		ExecutableVisitor visitor {};
+		REQUIRE( scan( scanner, visitor ) );
+
+		REQUIRE(
+			visitor.executables()
+			== std::vector< std::filesystem::path > { "game64.exe", "console64.exe", "game32.exe" } );
+		REQUIRE( visitor.info().size() == 3 );
+		REQUIRE( visitor.info().front().bits == 64 );
+	}
+
+	std::filesystem::remove_all( root );
+}
@@ -0,0 +1,125 @@
+//
+// Created by kj16609 on 7/31/23.
+//
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wctor-dtor-privacy"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#pragma GCC diagnostic pop
+#else
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#endif
+
+#include <QMimeDatabase>
+
+#include <fstream>
+
+#include "core/utils/ExecutableSniffer.hpp"
+#include "core/logging.hpp"
+
+namespace
+{
+	ExecutableFormat sniff( const std::string_view header, const std::string_view ext )
+	{
+		return sniffHeader( { header.data(), header.size() }, ext );
+	}
+} // namespace
+
+TEST_CASE( "Executable sniffer", "[import][sniffer]" )
+{
+	SECTION( "Headers" )
+	{
+		REQUIRE( sniff( "MZ\x90\x00", ".exe" ) == ExecutableFormat::PE );
+		REQUIRE( sniff( std::string_view( "\x7F"
+		                                  "ELF\x02\x01",
+		                                  6 ),
+		                ".x86_64" )
+		         == ExecutableFormat::ELF );
+		REQUIRE( sniff( std::string_view( "\xCF\xFA\xED\xFE", 4 ), "" ) == ExecutableFormat::MachO );
+		REQUIRE( sniff( "#!/bin/bash\n", ".sh" ) == ExecutableFormat::Script );
+		REQUIRE( sniff( "\n  <!DOCTYPE html>", ".html" ) == ExecutableFormat::HTML );
+		REQUIRE( sniff( "<html>", ".html" ) == ExecutableFormat::HTML );
+	}
+
+	SECTION( "Header doesn't fit the extension" )
+	{
+		REQUIRE( sniff( "not an executable", ".exe" ) == ExecutableFormat::None );
+		REQUIRE( sniff( "MZ\x90", ".html" ) == ExecutableFormat::None );
+		REQUIRE( sniff( "#!/bin/bash\n", ".exe" ) == ExecutableFormat::None );
+		REQUIRE( sniff( std::string_view( "<html>\0\0", 8 ), ".html" ) == ExecutableFormat::None );
+		REQUIRE( sniff( "", ".exe" ) == ExecutableFormat::None );
+	}
+
+	SECTION( "Extensions" )
+	{
+		REQUIRE( isExecutableExtension( ".exe" ) );
+		REQUIRE( isExecutableExtension( ".html" ) );
+		REQUIRE_FALSE( isExecutableExtension( ".dll" ) );
+		REQUIRE_FALSE( isExecutableExtension( "" ) );
+	}
+
+	SECTION( "Files" )
+	{
+		const auto root { std::filesystem::temp_directory_path() / "atlas_sniffer_test" };
+		std::filesystem::remove_all( root );
+		std::filesystem::create_directories( root );
+
+		std::ofstream( root / "game.exe" ) << "MZ" << std::string( 4096, 'x' );
+		std::ofstream( root / "fake.exe" ) << "PK";
+
+		REQUIRE( sniffExecutable( root / "game.exe", ".exe" ) == ExecutableFormat::PE );
+		REQUIRE( sniffExecutable( root / "fake.exe", ".exe" ) == ExecutableFormat::None );
+		REQUIRE( sniffExecutable( root / "missing.exe", ".exe" ) == ExecutableFormat::None );
+
+		std::filesystem::remove_all( root );
+	}
+}
+
+TEST_CASE( "Executable sniffer benchmark", "[import][sniffer][.][benchmark]" )
+{
+	const auto root { std::filesystem::temp_directory_path() / "atlas_sniffer_bench" };
+	std::filesystem::remove_all( root );
+	std::filesystem::create_directories( root );
+
+	//What the top of a game folder looks like. A few executables among data files
+	std::vector< std::filesystem::path > files {};
+	for ( int i = 0; i < 500; ++i )
+	{
+		const auto ext { i % 5 == 0 ? ".exe" : i % 5 == 1 ? ".html" : ".dat" };
+		files.emplace_back( root / fmt::format( "file_{}{}", i, ext ) );
+		std::ofstream( files.back() ) << ( i % 5 == 0 ? "MZ" : "<!DOCTYPE html>" ) << std::string( 64 * 1024, 'x' );
+	}
+
+	BENCHMARK( "QMimeDatabase" )
+	{
+		std::size_t found { 0 };
+		for ( const auto& file : files )
+		{
+			QMimeDatabase mime_db;
+			const auto type {
+				mime_db.mimeTypeForFile( QString::fromStdString( file.string() ), QMimeDatabase::MatchContent )
+			};
+			if ( type.inherits( "application/x-ms-dos-executable" )
+			     || ( type.inherits( "text/plain" ) && file.extension() == ".html" ) )
+				++found;
+		}
+		return found;
+	};
+
+	BENCHMARK( "sniffer" )
+	{
+		std::size_t found { 0 };
+		for ( const auto& file : files )
+		{
+			const auto ext { file.extension().string() };
+			if ( isExecutableExtension( ext ) && sniffExecutable( file, ext ) != ExecutableFormat::None ) ++found;
+		}
+		return found;
+	};
+
+	std::filesystem::remove_all( root );
+}
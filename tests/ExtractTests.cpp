@@ -0,0 +1,162 @@
+//
+// Created by kj16609 on 7/13/23.
+//
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wctor-dtor-privacy"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#pragma GCC diagnostic pop
+#else
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#endif
+
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <lz4frame.h>
+
+#include "core/logging.hpp"
+#include "core/remote/extract.hpp"
+
+namespace
+{
+	//! Generates `size` bytes of json that looks roughly like an update package
+	std::vector< char > syntheticPackage( const std::size_t size )
+	{
+		std::vector< char > data {};
+		data.reserve( size + 512 );
+
+		std::string row {};
+		for ( std::size_t i = 0; data.size() < size; ++i )
+		{
+			row = fmt::format(
+				R"({{"atlas_id":{0},"id_name":"game_{0}","title":"Some Game {0}","creator":"creator_{1}","engine":"Ren'Py","version":"v0.{2}","tags":"tag_{1}, tag_{2}, tag_{3}","release_date":{4}}},)",
+				i,
+				i % 97,
+				i % 13,
+				i % 31,
+				1600000000 + i );
+			data.insert( data.end(), row.begin(), row.end() );
+		}
+
+		data.resize( size );
+		return data;
+	}
+
+	void writePackage( const std::filesystem::path& path, const std::vector< char >& data, const bool store_size )
+	{
+		LZ4F_preferences_t prefs {};
+		prefs.frameInfo.contentSize = store_size ? data.size() : 0;
+		prefs.frameInfo.blockSizeID = LZ4F_max4MB;
+
+		std::vector< char > compressed( LZ4F_compressFrameBound( data.size(), &prefs ) );
+		const auto compressed_size {
+			LZ4F_compressFrame( compressed.data(), compressed.size(), data.data(), data.size(), &prefs )
+		};
+		REQUIRE_FALSE( LZ4F_isError( compressed_size ) );
+
+		std::ofstream ofs( path, std::ios::binary );
+		ofs.write( compressed.data(), static_cast< std::streamsize >( compressed_size ) );
+	}
+
+	//! What extract() did before the mapped path. Reads the file in 64 KiB chunks and appends the output.
+	std::vector< char > streamExtract( const std::filesystem::path& path )
+	{
+		std::vector< char > out {};
+		atlas::FrameDecompressor decompressor { [ &out ]( const char* data, const std::size_t size )
+			                                    { out.insert( out.end(), data, data + size ); } };
+
+		std::ifstream ifs( path, std::ios::binary );
+		std::array< char, 1 << 16 > buffer;
+		while ( ifs )
+		{
+			ifs.read( buffer.data(), static_cast< std::streamsize >( buffer.size() ) );
+			const auto read_bytes { static_cast< std::size_t >( ifs.gcount() ) };
+			if ( read_bytes == 0 ) break;
+			decompressor.feed( buffer.data(), read_bytes );
+		}
+
+		return out;
+	}
+} // namespace
+
+TEST_CASE( "Extract", "[remote][extract]" )
+{
+	const auto data { syntheticPackage( 4 * 1024 * 1024 + 17 ) };
+
+	SECTION( "Known content size" )
+	{
+		writePackage( "./sized.update", data, true );
+		REQUIRE( atlas::extract( std::filesystem::path( "./sized.update" ) ) == data );
+		std::filesystem::remove( "./sized.update" );
+	}
+
+	SECTION( "Unknown content size" )
+	{
+		writePackage( "./unsized.update", data, false );
+		REQUIRE( atlas::extract( std::filesystem::path( "./unsized.update" ) ) == data );
+		std::filesystem::remove( "./unsized.update" );
+	}
+
+	SECTION( "Sink" )
+	{
+		writePackage( "./sink.update", data, true );
+
+		std::vector< char > out {};
+		atlas::extract(
+			"./sink.update",
+			[ &out ]( const char* ptr, const std::size_t size ) { out.insert( out.end(), ptr, ptr + size ); } );
+
+		REQUIRE( out == data );
+		std::filesystem::remove( "./sink.update" );
+	}
+
+	SECTION( "Output is a multiple of the staging buffer" )
+	{
+		const auto aligned { syntheticPackage( 1024 * 1024 ) };
+		writePackage( "./aligned.update", aligned, false );
+		REQUIRE( atlas::extract( std::filesystem::path( "./aligned.update" ) ) == aligned );
+		std::filesystem::remove( "./aligned.update" );
+	}
+
+	SECTION( "Truncated" )
+	{
+		writePackage( "./truncated.update", data, false );
+		std::filesystem::resize_file(
+			"./truncated.update", std::filesystem::file_size( "./truncated.update" ) / 2 );
+
+		REQUIRE_THROWS( atlas::extract( std::filesystem::path( "./truncated.update" ) ) );
+		std::filesystem::remove( "./truncated.update" );
+	}
+}
+
+TEST_CASE( "Extract benchmark", "[remote][extract][.][benchmark]" )
+{
+	const auto data { syntheticPackage( 100 * 1024 * 1024 ) };
+	writePackage( "./bench_sized.update", data, true );
+	writePackage( "./bench_unsized.update", data, false );
+
+	BENCHMARK( "Streamed ifstream (Previous)" )
+	{
+		return streamExtract( "./bench_sized.update" );
+	};
+
+	BENCHMARK( "Mapped, pre-sized" )
+	{
+		return atlas::extract( std::filesystem::path( "./bench_sized.update" ) );
+	};
+
+	BENCHMARK( "Mapped, unknown size" )
+	{
+		return atlas::extract( std::filesystem::path( "./bench_unsized.update" ) );
+	};
+
+	std::filesystem::remove( "./bench_sized.update" );
+	std::filesystem::remove( "./bench_unsized.update" );
+}
@@ -0,0 +1,305 @@
+//
+// Created by kj16609 on 7/27/23.
+//
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wctor-dtor-privacy"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#pragma GCC diagnostic pop
+#else
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#endif
+
+#include <random>
+#include <set>
+
+#include "core/database/Database.hpp"
+#include "core/database/Transaction.hpp"
+#include "core/remote/parsers/CatalogTags.hpp"
+#include "core/search/FacetIndex.hpp"
+#include "core/search/QueryBuilder.hpp"
+
+using namespace atlas::search;
+
+namespace
+{
+	Bitmap fromSet( const std::set< std::uint32_t >& values )
+	{
+		Bitmap bitmap {};
+		for ( const auto value : values ) bitmap.add( value );
+		return bitmap;
+	}
+
+	std::vector< std::uint32_t > toVector( const std::set< std::uint32_t >& values )
+	{
+		return { values.begin(), values.end() };
+	}
+
+	//! `count` random values below `max`
+	std::set< std::uint32_t > randomSet( std::mt19937& rng, const std::size_t count, const std::uint32_t max )
+	{
+		std::uniform_int_distribution< std::uint32_t > dist { 0, max - 1 };
+		std::set< std::uint32_t > values {};
+		while ( values.size() < count ) values.insert( dist( rng ) );
+		return values;
+	}
+
+	void addRecord( const RecordID id, const std::string& creator, const std::string& engine )
+	{
+		RapidTransaction() << "INSERT INTO records (record_id, title, creator, engine) VALUES (?, ?, ?, ?)" << id
+						   << fmt::format( "title_{}", id ) << creator << engine;
+	}
+
+	void tagRecord( const RecordID id, const std::string& tag )
+	{
+		RapidTransaction() << "INSERT OR IGNORE INTO tags (tag) VALUES (?)" << tag;
+		RapidTransaction() << "INSERT INTO tag_mappings (record_id, tag_id) VALUES (?, (SELECT tag_id FROM tags WHERE tag = ?))"
+						   << id << tag;
+	}
+
+	//! Ids found by the index for `search`, or "sql" if it left it to SQL
+	std::string ids( FacetIndex& index, const std::string_view search )
+	{
+		const auto matches { index.evaluate( search ) };
+		if ( !matches ) return "sql";
+
+		std::string str {};
+		for ( const auto id : index.records( *matches ) ) str += std::to_string( id ) + ";";
+		return str;
+	}
+
+	std::string sqlIDs( const std::string& search )
+	{
+		std::string str {};
+		RapidTransaction() << "SELECT record_id FROM records WHERE" + processString( search ) + " ORDER BY record_id"
+			>> [ &str ]( const RecordID id ) noexcept { str += std::to_string( id ) + ";"; };
+		return str;
+	}
+} // namespace
+
+TEST_CASE( "Bitmap", "[search][bitmap]" )
+{
+	std::mt19937 rng { 39 };
+
+	//Sparse, dense enough for bitset containers and spread over several containers
+	const auto left { randomSet( rng, 12000, 70000 ) };
+	const auto right { randomSet( rng, 3000, 200000 ) };
+	const auto a { fromSet( left ) };
+	const auto b { fromSet( right ) };
+
+	REQUIRE( a.cardinality() == left.size() );
+	REQUIRE( a.values() == toVector( left ) );
+
+	std::set< std::uint32_t > both {};
+	std::set< std::uint32_t > either { left };
+	std::set< std::uint32_t > only_left {};
+	either.insert( right.begin(), right.end() );
+	std::set_intersection( left.begin(), left.end(), right.begin(), right.end(), std::inserter( both, both.end() ) );
+	std::set_difference(
+		left.begin(), left.end(), right.begin(), right.end(), std::inserter( only_left, only_left.end() ) );
+
+	REQUIRE( ( a & b ).values() == toVector( both ) );
+	REQUIRE( ( a | b ).values() == toVector( either ) );
+	REQUIRE( a.andNot( b ).values() == toVector( only_left ) );
+	REQUIRE( a.andCardinality( b ) == both.size() );
+	REQUIRE( b.andCardinality( a ) == both.size() );
+
+	SECTION( "Remove" )
+	{
+		auto c { a };
+		std::set< std::uint32_t > kept {};
+		std::size_t i { 0 };
+		for ( const auto value : left )
+		{
+			if ( i++ % 3 == 0 )
+				kept.insert( value );
+			else
+				c.remove( value );
+		}
+		//Not in the set
+		c.remove( 199999 );
+
+		REQUIRE( c.values() == toVector( kept ) );
+		REQUIRE( c.cardinality() == kept.size() );
+
+		for ( const auto value : left ) c.remove( value );
+		REQUIRE( c.empty() );
+	}
+
+	SECTION( "Range" )
+	{
+		REQUIRE( Bitmap::range( 0 ).empty() );
+		REQUIRE( Bitmap::range( 70001 ).cardinality() == 70001 );
+		REQUIRE( Bitmap::range( 70001 ).contains( 70000 ) );
+		REQUIRE_FALSE( Bitmap::range( 70001 ).contains( 70001 ) );
+		REQUIRE( Bitmap::range( 100 ).andNot( Bitmap::range( 64 ) ).values().front() == 64 );
+	}
+}
+
+TEST_CASE( "Facet index", "[database][search][facets]" )
+{
+	REQUIRE_NOTHROW( Database::initalize( ":memory:" ) );
+
+	addRecord( 2, "Alice", "Ren'Py" );
+	addRecord( 3, "Bob", "Ren'Py" );
+	addRecord( 4, "Alice", "Unity" );
+	addRecord( 5, "Bob", "Unity" );
+	tagRecord( 2, "a" );
+	tagRecord( 2, "b" );
+	tagRecord( 3, "a" );
+	tagRecord( 3, "c" );
+	tagRecord( 4, "b" );
+
+	RapidTransaction() << "INSERT INTO atlas_data (atlas_id, status) VALUES (10, 'Completed')";
+	RapidTransaction() << "INSERT INTO catalog_tags (tag_id, type, tag) VALUES (1, 0, 'Sandbox')";
+	RapidTransaction() << "INSERT INTO catalog_tag_map (atlas_id, tag_id) VALUES (10, 1)";
+	RapidTransaction() << "INSERT INTO atlas_mapping (record_id, atlas_id) VALUES (2, 10)";
+
+	{
+		FacetIndex index {};
+
+		SECTION( "Evaluate" )
+		{
+			REQUIRE( ids( index, "tag:a & tag:b" ) == "2;" );
+			REQUIRE( ids( index, "tag:A & engine:ren'py & !tag:c" ) == "2;" );
+			REQUIRE( ids( index, "tag:c | engine:Unity" ) == "3;4;5;" );
+			REQUIRE( ids( index, "tag:a | tag:b & engine:Unity" ) == "2;3;4;" );
+			REQUIRE( ids( index, "!(tag:a | tag:b)" ) == "5;" );
+			REQUIRE( ids( index, "catalog:sandbox & status:completed" ) == "2;" );
+			REQUIRE( ids( index, "tag:missing" ).empty() );
+		}
+
+		SECTION( "Same results as SQL" )
+		{
+			for ( const std::string search : { "tag:a & tag:b",
+			                                   "creator:Alice | tag:c",
+			                                   "engine:Unity & !tag:b",
+			                                   "creator:bob & (tag:a | tag:b)",
+			                                   "status:Completed | engine:unity" } )
+				REQUIRE( ids( index, search ) == sqlIDs( search ) );
+		}
+
+		SECTION( "Left to SQL" )
+		{
+			REQUIRE( ids( index, "title:title_2" ) == "sql" );
+			REQUIRE( ids( index, "tag:a%" ) == "sql" );
+			REQUIRE( ids( index, "tag:a & system:size > 5G" ) == "sql" );
+			REQUIRE( ids( index, "tag:a tag:b" ) == "sql" );
+		}
+
+		SECTION( "Follows changes" )
+		{
+			tagRecord( 5, "a" );
+			REQUIRE( ids( index, "tag:a" ) == "2;3;5;" );
+
+			RapidTransaction() << "DELETE FROM tag_mappings WHERE record_id = 2";
+			REQUIRE( ids( index, "tag:a" ) == "3;5;" );
+
+			addRecord( 6, "Carol", "Unity" );
+			RapidTransaction() << "UPDATE records SET engine = 'RPGM' WHERE record_id = 4";
+			REQUIRE( ids( index, "engine:unity" ) == "5;6;" );
+			REQUIRE( ids( index, "engine:rpgm" ) == "4;" );
+
+			RapidTransaction() << "DELETE FROM records WHERE record_id = 5";
+			REQUIRE( ids( index, "engine:unity" ) == "6;" );
+			REQUIRE( ids( index, "!engine:unity" ) == "2;3;4;" );
+
+			RapidTransaction() << "UPDATE atlas_data SET status = 'Abandoned' WHERE atlas_id = 10";
+			REQUIRE( ids( index, "status:completed" ).empty() );
+			REQUIRE( ids( index, "status:abandoned" ) == "2;" );
+
+			//catalog_tag_map is WITHOUT ROWID. The update hook never hears about this, the catalog generation does
+			{
+				remote::parsers::CatalogTagWriter writer {};
+				remote::parsers::AtlasRow row {};
+				row.set( 0, std::int64_t( 10 ) );
+				row.set( *remote::parsers::AtlasRow::columnIndex( "tags" ), std::string( "" ) );
+				writer.apply( row );
+			}
+			REQUIRE( ids( index, "catalog:sandbox" ).empty() );
+		}
+
+		SECTION( "Counts" )
+		{
+			const auto find = []( const std::vector< FacetCount >& counts, const FacetType type, const std::string& name )
+			{
+				for ( const auto& count : counts )
+					if ( count.type == type && count.name == name ) return count.count;
+				return std::size_t( 0 );
+			};
+
+			const auto all { index.counts( index.all() ) };
+			REQUIRE( find( all, FacetEngine, "Ren'Py" ) == 2 );
+			REQUIRE( find( all, FacetEngine, "Unity" ) == 2 );
+			REQUIRE( find( all, FacetUserTag, "b" ) == 2 );
+			REQUIRE( find( all, FacetCatalogTag, "Sandbox" ) == 1 );
+
+			const auto within { index.counts( index.select( { 2, 4 } ) ) };
+			REQUIRE( find( within, FacetUserTag, "b" ) == 2 );
+			REQUIRE( find( within, FacetUserTag, "c" ) == 0 );
+			REQUIRE( find( within, FacetCreator, "Alice" ) == 2 );
+
+			//Largest first, limited per type
+			const auto limited { index.counts( index.all(), 1 ) };
+			REQUIRE( std::count_if(
+						 limited.begin(), limited.end(), []( const FacetCount& count ) { return count.type == FacetUserTag; } )
+			         == 1 );
+			REQUIRE( find( limited, FacetUserTag, "a" ) + find( limited, FacetUserTag, "b" ) == 2 );
+		}
+	}
+
+	Database::deinit();
+}
+
+TEST_CASE( "Facet index benchmark", "[database][search][facets][.][benchmark]" )
+{
+	REQUIRE_NOTHROW( Database::initalize( ":memory:" ) );
+
+	{
+		Transaction transaction {};
+		std::mt19937 rng { 39 };
+		std::uniform_int_distribution< int > tag_dist { 0, 499 };
+		for ( RecordID id = 2; id < 20000; ++id )
+		{
+			transaction << "INSERT INTO records (record_id, title, creator, engine) VALUES (?, ?, ?, ?)" << id
+						<< fmt::format( "title_{}", id ) << fmt::format( "creator {}", id % 900 )
+						<< fmt::format( "engine {}", id % 12 );
+			for ( int i = 0; i < 8; ++i )
+			{
+				const auto tag { fmt::format( "tag {}", tag_dist( rng ) ) };
+				transaction << "INSERT OR IGNORE INTO tags (tag) VALUES (?)" << tag;
+				transaction << "INSERT OR IGNORE INTO tag_mappings (record_id, tag_id) VALUES (?, (SELECT tag_id FROM tags WHERE tag = ?))"
+							<< id << tag;
+			}
+		}
+		transaction.commit();
+	}
+
+	const std::string search { "tag:tag 1 & tag:tag 2 & engine:engine 3 & !tag:tag 4" };
+
+	{
+		FacetIndex index {};
+		const auto all { index.all() };
+
+		BENCHMARK( "bitmap evaluate" )
+		{
+			return index.evaluate( search )->cardinality();
+		};
+
+		BENCHMARK( "sql evaluate" )
+		{
+			return sqlIDs( search ).size();
+		};
+
+		BENCHMARK( "counts" )
+		{
+			return index.counts( all ).size();
+		};
+	}
+
+	Database::deinit();
+}
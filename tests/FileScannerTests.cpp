@@ -0,0 +1,392 @@
+//
+// Created by kj16609 on 7/29/23.
+//
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wctor-dtor-privacy"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#pragma GCC diagnostic pop
+#else
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#endif
+
+#include <fstream>
+#include <future>
+#include <queue>
+
+#include "core/utils/FileScanner.hpp"
+#include "core/utils/ScanVisitor.hpp"
+#include "core/utils/WorkStealingPool.hpp"
+#include "core/utils/engineDetection/engineDetection.hpp"
+
+namespace
+{
+	//! `creators` creators with `games` games each. Every game has a few files, an empty folder and a nested folder
+	std::filesystem::path makeLibrary( const std::string& name, const int creators, const int games )
+	{
+		const auto root { std::filesystem::temp_directory_path() / name };
+		std::filesystem::remove_all( root );
+
+		for ( int c = 0; c < creators; ++c )
+			for ( int g = 0; g < games; ++g )
+			{
+				const auto game { root / fmt::format( "creator_{}", c ) / fmt::format( "game_{}", g ) };
+				std::filesystem::create_directories( game / "www" / "img" );
+				std::filesystem::create_directories( game / "empty" );
+
+				std::ofstream( game / "game.exe" ) << "MZ" << std::string( static_cast< std::size_t >( 98 + g ), 'x' );
+				std::ofstream( game / ".hidden" ) << "a";
+				std::ofstream( game / "www" / "index.html" ) << "<!DOCTYPE html>";
+				std::ofstream( game / "www" / "img" / "banner.tar.gz" ) << std::string( 4096, 'x' );
+			}
+
+		return root;
+	}
+
+	//! What FileScanner gives, from std::filesystem. Relative paths keep symlinks as found, `std::filesystem::relative` would resolve them
+	std::vector< std::string > reference( const std::filesystem::path& root )
+	{
+		std::vector< std::string > output {};
+		std::queue< std::pair< std::filesystem::path, int > > dirs {};
+		dirs.push( { root, 0 } );
+
+		while ( !dirs.empty() )
+		{
+			const auto [ dir, depth ] { dirs.front() };
+			dirs.pop();
+
+			std::vector< std::filesystem::path > nested {};
+			for ( const auto& entry : std::filesystem::directory_iterator( dir ) )
+			{
+				if ( entry.is_directory() )
+				{
+					nested.emplace_back( entry.path() );
+					continue;
+				}
+
+				output.emplace_back( fmt::format(
+					"{} {} {} {} {}",
+					entry.path().lexically_relative( root ).string(),
+					entry.path().filename().string(),
+					entry.path().extension().string(),
+					entry.is_regular_file() ? entry.file_size() : 0,
+					depth + 1 ) );
+			}
+
+			for ( const auto& path : nested )
+			{
+				output.emplace_back( fmt::format(
+					"{} {} {} 0 {}",
+					path.lexically_relative( root ).string(),
+					path.filename().string(),
+					path.extension().string(),
+					depth + 1 ) );
+				dirs.push( { path, depth + 1 } );
+			}
+		}
+
+		return output;
+	}
+
+	std::vector< std::string > scanned( const std::filesystem::path& root )
+	{
+		std::vector< std::string > output {};
+		FileScanner scanner { root };
+		for ( const auto& file : scanner )
+		{
+			output.emplace_back( fmt::format(
+				"{} {} {} {} {}", file.relative_path, file.filename, file.ext, file.size, file.depth ) );
+			REQUIRE( file.path() == root / file.relative() );
+		}
+		return output;
+	}
+} // namespace
+
+TEST_CASE( "FileScanner", "[scanner]" )
+{
+	const auto root { makeLibrary( "atlas_file_scanner_test", 4, 6 ) };
+
+	SECTION( "Same as std::filesystem" )
+	{
+		REQUIRE( scanned( root ) == reference( root ) );
+
+		//A trailing separator doesn't change the relative paths
+		REQUIRE( scanned( root.string() + "/" ) == reference( root ) );
+	}
+
+	SECTION( "Symlinks are followed" )
+	{
+		std::filesystem::create_directory_symlink( root / "creator_0", root / "linked" );
+		std::filesystem::create_symlink( root / "creator_0" / "game_0" / "game.exe", root / "linked.exe" );
+		std::filesystem::create_symlink( root / "missing", root / "broken" );
+
+		REQUIRE( scanned( root ) == reference( root ) );
+	}
+
+	SECTION( "Stops at the depth read" )
+	{
+		FileScanner scanner { root };
+		std::size_t creators { 0 };
+		for ( const auto& file : scanner )
+		{
+			if ( file.depth > 1 ) break;
+			++creators;
+		}
+		REQUIRE( creators == 4 );
+
+		//The games haven't been read yet, so a removed folder doesn't show up
+		std::filesystem::remove_all( root / "creator_3" / "game_5" / "www" );
+		std::size_t games { 0 };
+		for ( const auto& file : scanner )
+		{
+			if ( file.depth == 2 ) ++games;
+			REQUIRE( file.relative() != std::filesystem::path( "creator_3/game_5/www" ) );
+		}
+		REQUIRE( games == 4 * 6 );
+	}
+
+	SECTION( "Empty directory" )
+	{
+		std::filesystem::create_directories( root / "nothing" );
+		FileScanner scanner { root / "nothing" };
+
+		std::vector< std::filesystem::path > output {};
+		for ( const auto& file : scanner ) output.emplace_back( file.relative() );
+		REQUIRE( output == std::vector< std::filesystem::path > { "." } );
+	}
+
+	SECTION( "Missing directory" )
+	{
+		REQUIRE_THROWS( FileScanner( root / "missing" ) );
+		REQUIRE_THROWS( FileScanner( root / "creator_0" / "game_0" / "game.exe" ) );
+	}
+
+	std::filesystem::remove_all( root );
+}
+
+TEST_CASE( "Scan visitors", "[scanner]" )
+{
+	const auto root { makeLibrary( "atlas_scan_visitor_test", 1, 2 ) };
+	const auto game { root / "creator_0" / "game_0" };
+
+	//Counts what it's given, up to `max_depth`
+	struct DepthVisitor final : public ScanVisitor
+	{
+		std::uint8_t max_depth;
+		std::size_t seen { 0 };
+		bool finished { false };
+
+		DepthVisitor( const std::uint8_t depth ) : max_depth( depth ) {}
+
+		bool visit( const FileInfo& file ) override
+		{
+			if ( file.depth > max_depth ) return false;
+			++seen;
+			return true;
+		}
+
+		void finish( [[maybe_unused]] const std::filesystem::path& path ) override { finished = true; }
+	};
+
+	SECTION( "Size" )
+	{
+		std::size_t bytes { 0 };
+		std::size_t files { 0 };
+		for ( const auto& entry : std::filesystem::recursive_directory_iterator( root ) )
+			if ( entry.is_regular_file() )
+			{
+				bytes += entry.file_size();
+				++files;
+			}
+
+		FileScanner scanner { root };
+		SizeVisitor size {};
+		REQUIRE( scan( scanner, size ) );
+		REQUIRE( size.bytes() == bytes );
+		REQUIRE( size.files() == files );
+	}
+
+	SECTION( "One walk for every visitor" )
+	{
+		std::filesystem::create_directory( game / "renpy" );
+
+		FileScanner scanner { game };
+		DepthVisitor shallow { 1 };
+		DepthVisitor deep { 2 };
+		EngineVisitor engine {};
+		ExecutableVisitor executables {};
+		REQUIRE( scan( scanner, shallow, deep, engine, executables ) );
+
+		//game.exe, .hidden, www, empty and renpy, then index.html and img from www
+		REQUIRE( shallow.seen == 5 );
+		REQUIRE( deep.seen == 7 );
+		REQUIRE( shallow.finished );
+		REQUIRE( engine.engine() == RenPy );
+		REQUIRE( executables.executables() == std::vector< std::filesystem::path > { "game.exe" } );
+	}
+
+	SECTION( "Engines are checked in order" )
+	{
+		std::filesystem::remove( game / "game.exe" );
+		std::ofstream( game / "index.html" ) << "<!DOCTYPE html>";
+		REQUIRE( [ & ]()
+		         {
+					 FileScanner scanner { game };
+					 return determineEngine( scanner );
+				 }() == HTML );
+
+		std::filesystem::create_directories( game / "Data" / "Managed" );
+		std::ofstream( game / "Data" / "Managed" / "Assembly-CSharp.dll" ) << "";
+		FileScanner scanner { game };
+		REQUIRE( determineEngine( scanner ) == Unity );
+	}
+
+	SECTION( "Engine confidence" )
+	{
+		std::filesystem::create_directory( game / "Data" );
+		std::ofstream( game / "Game.RGSS3A" ) << "";
+
+		FileScanner scanner { game };
+		EngineVisitor engine {};
+		REQUIRE( scan( scanner, engine ) );
+
+		//Extensions are matched in any case, and a Data folder alone isn't enough for Unity
+		REQUIRE( engine.engine() == RPGM );
+		REQUIRE( engine.confidence( RPGM ) == 100 );
+		REQUIRE( engine.confidence( Unity ) == 20 );
+		REQUIRE( engine.confidence( HTML ) == 0 );
+		REQUIRE( engineName( engine.engine() ) == "RPG Maker" );
+		REQUIRE( engineName( UNKNOWN ) == "Unknown" );
+	}
+
+	SECTION( "Stopped" )
+	{
+		std::stop_source stop {};
+		stop.request_stop();
+
+		FileScanner scanner { root };
+		DepthVisitor visitor { 10 };
+		const std::array< ScanVisitor*, 1 > visitors { &visitor };
+		REQUIRE_FALSE( scan( scanner, visitors, stop.get_token() ) );
+		REQUIRE_FALSE( visitor.finished );
+	}
+
+	std::filesystem::remove_all( root );
+}
+
+TEST_CASE( "Work stealing pool", "[scanner][pool]" )
+{
+	WorkStealingPool pool { 3 };
+
+	SECTION( "Nested groups" )
+	{
+		std::atomic< int > count { 0 };
+		TaskGroup group { pool };
+		for ( int i = 0; i < 20; ++i )
+			group.run(
+				[ & ]()
+				{
+					//Waiting from inside a task runs other tasks instead of blocking a worker
+					TaskGroup inner { pool };
+					for ( int j = 0; j < 20; ++j ) inner.run( [ & ]() { ++count; } );
+					inner.wait();
+				} );
+		group.wait();
+
+		REQUIRE( count == 400 );
+	}
+
+	SECTION( "Waiting on a single worker" )
+	{
+		WorkStealingPool single { 1 };
+		std::atomic< int > count { 0 };
+		TaskGroup group { single };
+		for ( int i = 0; i < 5; ++i )
+			group.run(
+				[ & ]()
+				{
+					//Uses the worker's pool without being told
+					TaskGroup inner {};
+					for ( int j = 0; j < 5; ++j ) inner.run( [ & ]() { ++count; } );
+					inner.wait();
+				} );
+		group.wait();
+
+		REQUIRE( count == 25 );
+		REQUIRE( &WorkStealingPool::current() == &WorkStealingPool::global() );
+	}
+
+	SECTION( "Plain tasks queued on top of a group" )
+	{
+		WorkStealingPool single { 1 };
+		std::atomic< int > count { 0 };
+		std::promise< void > done {};
+		single.submit(
+			[ & ]()
+			{
+				TaskGroup inner {};
+				inner.run( [ & ]() { ++count; } );
+				//Lands above the first task in the worker's queue, which the wait has to get past
+				inner.run( [ & ]() { WorkStealingPool::current().submit( [ & ]() { ++count; } ); } );
+				inner.wait();
+				done.set_value();
+			} );
+
+		REQUIRE( done.get_future().wait_for( std::chrono::seconds( 10 ) ) == std::future_status::ready );
+		REQUIRE( count == 2 );
+	}
+
+	SECTION( "Waits leave older tasks alone" )
+	{
+		WorkStealingPool single { 1 };
+		std::atomic< bool > older_ran { false };
+		std::promise< bool > ran_during_wait {};
+		single.submit(
+			[ & ]()
+			{
+				//Queued before the group, like the games a scan spawns. Running it inside the wait would nest it
+				WorkStealingPool::current().submit( [ & ]() { older_ran = true; } );
+				TaskGroup inner {};
+				inner.run( []() {} );
+				inner.wait();
+				ran_during_wait.set_value( older_ran );
+			} );
+
+		auto result { ran_during_wait.get_future() };
+		REQUIRE( result.wait_for( std::chrono::seconds( 10 ) ) == std::future_status::ready );
+		REQUIRE_FALSE( result.get() );
+	}
+
+	SECTION( "Exceptions" )
+	{
+		TaskGroup group { pool };
+		group.run( []() { throw std::runtime_error( "failed" ); } );
+		group.run( []() {} );
+		REQUIRE_THROWS( group.wait() );
+		REQUIRE_NOTHROW( group.wait() );
+	}
+}
+
+TEST_CASE( "FileScanner benchmark", "[scanner][.][benchmark]" )
+{
+	const auto root { makeLibrary( "atlas_file_scanner_bench", 40, 50 ) };
+
+	BENCHMARK( "std::filesystem" )
+	{
+		return reference( root ).size();
+	};
+
+	BENCHMARK( "FileScanner" )
+	{
+		std::size_t count { 0 };
+		FileScanner scanner { root };
+		for ( const auto& file : scanner ) count += file.size;
+		return count;
+	};
+
+	std::filesystem::remove_all( root );
+}
@@ -80,7 +80,7 @@ TEST_CASE( "File Scanner", "[import]" )
 
 	std::vector< std::filesystem::path > output;
 
-	for ( const auto& file : scanner ) output.emplace_back( file.relative );
+	for ( const auto& file : scanner ) output.emplace_back( file.relative() );
 
 	REQUIRE( expected == output );
 
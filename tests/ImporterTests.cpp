@@ -0,0 +1,74 @@
+//
+// Created by kj16609 on 8/2/23.
+//
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wctor-dtor-privacy"
+#include <catch2/catch_test_macros.hpp>
+#pragma GCC diagnostic pop
+#else
+#include <catch2/catch_test_macros.hpp>
+#endif
+
+#include <QThreadPool>
+
+#include <fstream>
+
+#include "core/database/Database.hpp"
+#include "core/database/GameMetadata.hpp"
+#include "core/database/record/Record.hpp"
+#include "core/import/GameImportData.hpp"
+#include "core/import/Importer.hpp"
+
+namespace
+{
+	GameImportData gameData( const std::filesystem::path& path, const QString& version )
+	{
+		return GameImportData { path, "Importer test", "Creator", "", version, 0, { "game.exe" }, "game.exe", {}, {} };
+	}
+} // namespace
+
+TEST_CASE( "Importer", "[import]" )
+{
+	REQUIRE_NOTHROW( Database::initalize( ":memory:" ) );
+
+	const auto root { std::filesystem::temp_directory_path() / "atlas_importer_test" };
+	std::filesystem::remove_all( root );
+	const auto previous_games { config::paths::games::get() };
+	config::paths::games::setPath( root / "games" );
+
+	for ( const auto& version : { "1.0", "1.1" } )
+	{
+		std::filesystem::create_directories( root / "library" / "Creator" / version );
+		std::ofstream( root / "library" / "Creator" / version / "game.exe" ) << "MZ";
+	}
+
+	QThreadPool pool {};
+
+	SECTION( "Owned games point at where they were moved" )
+	{
+		const auto id { importGame( gameData( "Creator/1.0", "1.0" ), root / "library", true, pool ).result() };
+
+		REQUIRE_FALSE( std::filesystem::exists( root / "library" / "Creator" / "1.0" ) );
+		const auto version { Record( id )->getVersion( "1.0" ) };
+		REQUIRE( version.has_value() );
+		REQUIRE( version->getRelativeExecPath() == "game.exe" );
+		REQUIRE( std::filesystem::exists( version->getExecPath() ) );
+		REQUIRE( version->getExecPath().string().starts_with( ( root / "games" ).string() ) );
+	}
+
+	SECTION( "Games left in place" )
+	{
+		const auto id { importGame( gameData( "Creator/1.1", "1.1" ), root / "library", false, pool ).result() };
+
+		const auto version { Record( id )->getVersion( "1.1" ) };
+		REQUIRE( version.has_value() );
+		REQUIRE( version->getExecPath() == root / "library" / "Creator" / "1.1" / "game.exe" );
+	}
+
+	config::paths::games::set( previous_games );
+	std::filesystem::remove_all( root );
+	Database::deinit();
+}
@@ -0,0 +1,136 @@
+//
+// Created by kj16609 on 7/14/23.
+//
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wctor-dtor-privacy"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators_all.hpp>
+#pragma GCC diagnostic pop
+#else
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators_all.hpp>
+#endif
+
+#include <string>
+#include <vector>
+
+#include "core/logging.hpp"
+#include "core/remote/parsers/JsonRowReader.hpp"
+
+using namespace remote::parsers;
+
+namespace
+{
+	std::string testDocument( const std::size_t rows )
+	{
+		std::string doc { R"({"min_ver": 0, "atlas": [)" };
+		for ( std::size_t i = 0; i < rows; ++i )
+		{
+			if ( i != 0 ) doc += ',';
+			doc += fmt::format(
+				R"({{"atlas_id": {0}, "title": "Game \"{0}\" é😀", "release_date": "{1}", "unknown": null}})",
+				i + 1,
+				1600000000 + i );
+		}
+		doc += R"(], "f95_zone": [{"f95_id": 5, "atlas_id": 1, "rating": 4, "views": 10.0}]})";
+		return doc;
+	}
+
+	struct Collected
+	{
+		std::vector< AtlasRow > atlas {};
+		std::vector< F95Row > f95 {};
+		std::int64_t min_ver { -1 };
+	};
+
+	JsonRowReader::Callbacks collector( Collected& out )
+	{
+		return { [ &out ]( AtlasRow&& row ) { out.atlas.emplace_back( std::move( row ) ); },
+			     [ &out ]( F95Row&& row ) { out.f95.emplace_back( std::move( row ) ); },
+			     [ &out ]( const std::string_view key, const FieldValue& value )
+			     {
+					 if ( key == "min_ver" ) out.min_ver = std::get< std::int64_t >( value );
+				 } };
+	}
+} // namespace
+
+TEST_CASE( "JsonRowReader", "[remote][parser]" )
+{
+	const auto doc { testDocument( 6000 ) };
+
+	SECTION( "Chunked input" )
+	{
+		const auto chunk_size { GENERATE( 1, 3, 7, 4096, 1 << 20 ) };
+
+		Collected out {};
+		JsonRowReader reader { collector( out ) };
+		for ( std::size_t i = 0; i < doc.size(); i += static_cast< std::size_t >( chunk_size ) )
+			reader.feed( doc.data() + i, std::min( static_cast< std::size_t >( chunk_size ), doc.size() - i ) );
+		REQUIRE_NOTHROW( reader.finish() );
+
+		REQUIRE( out.min_ver == 0 );
+		REQUIRE( out.atlas.size() == 6000 );
+		REQUIRE( out.f95.size() == 1 );
+
+		const auto& row { out.atlas[ 41 ] };
+		REQUIRE( row.key() == 42 );
+		REQUIRE( !row.isFull() );
+		REQUIRE( std::get< std::string >( row.values[ *AtlasRow::columnIndex( "title" ) ] ) == "Game \"42\" é😀" );
+		REQUIRE( std::get< std::int64_t >( row.values[ *AtlasRow::columnIndex( "release_date" ) ] ) == 1600000041 );
+
+		const auto& f95 { out.f95[ 0 ] };
+		REQUIRE( std::get< double >( f95.values[ *F95Row::columnIndex( "rating" ) ] ) == 4.0 );
+		REQUIRE( std::get< std::int64_t >( f95.values[ *F95Row::columnIndex( "views" ) ] ) == 10 );
+	}
+
+	SECTION( "Batches" )
+	{
+		Collected out {};
+		std::size_t batch_count { 0 };
+
+		auto callbacks { collector( out ) };
+		callbacks.row_batch = [ & ]( const DataSet set, std::string&& text, const std::size_t row_count )
+		{
+			++batch_count;
+			const auto before { out.atlas.size() + out.f95.size() };
+
+			JsonRowReader batch_reader { collector( out ), set };
+			batch_reader.feed( text.data(), text.size() );
+			REQUIRE_NOTHROW( batch_reader.finish() );
+
+			REQUIRE( out.atlas.size() + out.f95.size() - before == row_count );
+		};
+
+		JsonRowReader reader { std::move( callbacks ) };
+		for ( std::size_t i = 0; i < doc.size(); i += 1000 )
+			reader.feed( doc.data() + i, std::min( std::size_t( 1000 ), doc.size() - i ) );
+		REQUIRE_NOTHROW( reader.finish() );
+
+		REQUIRE( batch_count > 2 );
+		REQUIRE( out.atlas.size() == 6000 );
+		REQUIRE( out.f95.size() == 1 );
+		REQUIRE( out.atlas[ 5999 ].key() == 6000 );
+		REQUIRE(
+			std::get< std::string >( out.atlas[ 41 ].values[ *AtlasRow::columnIndex( "title" ) ] )
+			== "Game \"42\" é😀" );
+	}
+
+	SECTION( "Truncated" )
+	{
+		Collected out {};
+		JsonRowReader reader { collector( out ) };
+		reader.feed( doc.data(), doc.size() / 2 );
+		REQUIRE_THROWS( reader.finish() );
+	}
+
+	SECTION( "Unknown set" )
+	{
+		const std::string bad { R"({"min_ver": 0, "steam": []})" };
+		Collected out {};
+		JsonRowReader reader { collector( out ) };
+		REQUIRE_THROWS( reader.feed( bad.data(), bad.size() ) );
+	}
+}
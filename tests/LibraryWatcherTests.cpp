@@ -0,0 +1,129 @@
+//
+// Created by kj16609 on 7/30/23.
+//
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wctor-dtor-privacy"
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators_all.hpp>
+#pragma GCC diagnostic pop
+#else
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators_all.hpp>
+#endif
+
+#include <fstream>
+
+#include "core/database/Database.hpp"
+#include "core/database/Transaction.hpp"
+#include "core/import/LibraryWatcher.hpp"
+
+using namespace std::chrono_literals;
+
+namespace
+{
+	void makeGame( const std::filesystem::path& game )
+	{
+		std::filesystem::create_directories( game );
+		std::ofstream( game / "game.exe" ) << "MZ";
+	}
+
+	//! Relative paths of the games pending under `root`, once there are `count` of them or it took too long.
+	//! They are removed after, as if they were imported
+	std::vector< std::filesystem::path >
+		pending( LibraryWatcher& watcher, const std::filesystem::path& root, const std::size_t count )
+	{
+		std::vector< std::filesystem::path > paths {};
+		std::vector< std::filesystem::path > folders {};
+		for ( int i = 0; i < 100 && paths.size() < count; ++i )
+		{
+			for ( const auto& game : watcher.pending( root ) )
+			{
+				paths.emplace_back( game.path );
+				folders.emplace_back( root / game.path );
+			}
+			watcher.removePending( folders );
+			std::this_thread::sleep_for( 50ms );
+		}
+		return paths;
+	}
+} // namespace
+
+TEST_CASE( "Library watcher", "[import][watcher]" )
+{
+	REQUIRE_NOTHROW( Database::initalize( ":memory:" ) );
+
+	const bool polling { GENERATE( false, true ) };
+	const auto root { std::filesystem::temp_directory_path() / "atlas_library_watcher_test" };
+	std::filesystem::remove_all( root );
+	makeGame( root / "creator" / "title" / "v1" );
+
+	LibraryWatcher watcher { 100ms, 200ms, polling };
+	watcher.watch( root, "{creator}/{title}/{version}" );
+
+	//Games that were already there are found first
+	REQUIRE( pending( watcher, root, 1 ) == std::vector< std::filesystem::path > { "creator/title/v1" } );
+
+	SECTION( "New version" )
+	{
+		makeGame( root / "creator" / "title" / "v2" );
+		REQUIRE( pending( watcher, root, 1 ) == std::vector< std::filesystem::path > { "creator/title/v2" } );
+	}
+
+	SECTION( "New creator" )
+	{
+		makeGame( root / "other" / "title" / "v1" );
+		makeGame( root / "other" / "title" / "v2" );
+		auto found { pending( watcher, root, 2 ) };
+		std::sort( found.begin(), found.end() );
+		REQUIRE(
+			found == std::vector< std::filesystem::path > { "other/title/v1", "other/title/v2" } );
+	}
+
+	SECTION( "Imported games are skipped" )
+	{
+		RapidTransaction() << "INSERT INTO game_metadata (record_id, version, game_path) VALUES (1, 'v3', ?)"
+						   << ( root / "creator" / "title" / "v3" ).string();
+		makeGame( root / "creator" / "title" / "v3" );
+		makeGame( root / "creator" / "title" / "v4" );
+		REQUIRE( pending( watcher, root, 2 ) == std::vector< std::filesystem::path > { "creator/title/v4" } );
+	}
+
+	SECTION( "Kept until removed" )
+	{
+		makeGame( root / "creator" / "title" / "v7" );
+		for ( int i = 0; i < 100 && watcher.pending( root ).empty(); ++i ) std::this_thread::sleep_for( 50ms );
+
+		//Looked at, but not imported. Still there for the next look
+		REQUIRE( watcher.pending( root ).size() == 1 );
+		REQUIRE( watcher.pending( root ).size() == 1 );
+
+		watcher.removePending( { root / "creator" / "title" / "v7" } );
+		REQUIRE( watcher.pending( root ).empty() );
+	}
+
+	SECTION( "Watching the same root again" )
+	{
+		//Nothing is walked again, so games already seen don't come back
+		watcher.watch( root, "{creator}/{title}/{version}" );
+		REQUIRE( watcher.isWatching() );
+		REQUIRE( pending( watcher, root, 1 ).empty() );
+
+		makeGame( root / "creator" / "title" / "v6" );
+		REQUIRE( pending( watcher, root, 1 ) == std::vector< std::filesystem::path > { "creator/title/v6" } );
+	}
+
+	SECTION( "Not watching" )
+	{
+		watcher.clear();
+		REQUIRE_FALSE( watcher.isWatching() );
+		makeGame( root / "creator" / "title" / "v5" );
+		REQUIRE( pending( watcher, root, 1 ).empty() );
+	}
+
+	watcher.clear();
+	std::filesystem::remove_all( root );
+	Database::deinit();
+}
@@ -0,0 +1,148 @@
+//
+// Created by kj16609 on 7/20/23.
+//
+
+#ifndef ATLASGAMEMANAGER_LOCALHTTPSERVER_HPP
+#define ATLASGAMEMANAGER_LOCALHTTPSERVER_HPP
+
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUrl>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+//! Minimal HTTP/1.1 server on loopback. Stands in for the remote in tests.
+/**
+ * Only GET is understood. Every response closes the connection.
+ */
+class LocalHttpServer
+{
+  public:
+
+	struct Response
+	{
+		int status { 200 };
+		QByteArray body {};
+		//! Extra header lines. Each must end with "\r\n"
+		QByteArray headers {};
+	};
+
+	struct Request
+	{
+		QString path {};
+		//! The full header block as it was received
+		QByteArray raw {};
+	};
+
+  private:
+
+	QTcpServer m_server {};
+	std::map< QString, Response > m_routes {};
+	std::vector< Request > m_requests {};
+
+	std::size_t m_open { 0 };
+	std::size_t m_peak_open { 0 };
+
+	//! Delay before a response is sent. Keeps requests open so concurrency can be observed
+	int m_delay_ms { 0 };
+	//! If not zero the body is sent in pieces of this size, one per event loop pass
+	qsizetype m_chunk_size { 0 };
+
+	void respond( QTcpSocket* socket, const QString path )
+	{
+		const auto itter { m_routes.find( path ) };
+		const Response response { itter == m_routes.end() ? Response { 404, "not found", {} } : itter->second };
+
+		QByteArray head { QString( "HTTP/1.1 %1 %2\r\n" )
+			                  .arg( response.status )
+			                  .arg( response.status < 400 ? "OK" : "Error" )
+			                  .toLatin1() };
+		head += QString( "Content-Length: %1\r\n" ).arg( response.body.size() ).toLatin1();
+		head += "Connection: close\r\n";
+		head += response.headers;
+		head += "\r\n";
+		socket->write( head );
+
+		if ( m_chunk_size == 0 )
+		{
+			socket->write( response.body );
+			finish( socket );
+			return;
+		}
+
+		sendChunk( socket, std::make_shared< QByteArray >( response.body ) );
+	}
+
+	void sendChunk( QTcpSocket* socket, const std::shared_ptr< QByteArray > remaining )
+	{
+		socket->write( remaining->left( m_chunk_size ) );
+		remaining->remove( 0, std::min( m_chunk_size, remaining->size() ) );
+
+		if ( remaining->isEmpty() )
+			finish( socket );
+		else
+			QTimer::singleShot( 0, socket, [ this, socket, remaining ]() { sendChunk( socket, remaining ); } );
+	}
+
+	void finish( QTcpSocket* socket )
+	{
+		--m_open;
+		socket->disconnectFromHost();
+	}
+
+  public:
+
+	LocalHttpServer()
+	{
+		m_server.listen( QHostAddress::LocalHost, 0 );
+
+		QObject::connect(
+			&m_server,
+			&QTcpServer::newConnection,
+			[ this ]()
+			{
+				QTcpSocket* socket { m_server.nextPendingConnection() };
+				QObject::connect( socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater );
+
+				auto buffer { std::make_shared< QByteArray >() };
+				QObject::connect(
+					socket,
+					&QTcpSocket::readyRead,
+					socket,
+					[ this, socket, buffer ]()
+					{
+						*buffer += socket->readAll();
+						if ( !buffer->contains( "\r\n\r\n" ) ) return;
+
+						//"GET /path HTTP/1.1"
+						const auto request_line { buffer->left( buffer->indexOf( "\r\n" ) ).split( ' ' ) };
+						const QString path { request_line.size() > 1 ? QString::fromLatin1( request_line[ 1 ] ) :
+							                                            QString() };
+						m_requests.emplace_back( path, *buffer );
+						buffer->clear();
+
+						++m_open;
+						m_peak_open = std::max( m_peak_open, m_open );
+
+						QTimer::singleShot( m_delay_ms, socket, [ this, socket, path ]() { respond( socket, path ); } );
+					} );
+			} );
+	}
+
+	QUrl url() const { return QUrl( QString( "http://127.0.0.1:%1/" ).arg( m_server.serverPort() ) ); }
+
+	void serve( const QString path, Response response ) { m_routes[ path ] = std::move( response ); }
+
+	void setDelay( const int ms ) { m_delay_ms = ms; }
+
+	void setChunkSize( const qsizetype size ) { m_chunk_size = size; }
+
+	const std::vector< Request >& requests() const { return m_requests; }
+
+	std::size_t peakOpen() const { return m_peak_open; }
+};
+
+#endif //ATLASGAMEMANAGER_LOCALHTTPSERVER_HPP
@@ -0,0 +1,96 @@
+//
+// Created by kj16609 on 7/22/23.
+//
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wctor-dtor-privacy"
+#include <catch2/catch_test_macros.hpp>
+#pragma GCC diagnostic pop
+#else
+#include <catch2/catch_test_macros.hpp>
+#endif
+
+#include <QSignalSpy>
+
+#include "LocalHttpServer.hpp"
+#include "core/remote/Manifest.hpp"
+
+using namespace atlas;
+
+namespace
+{
+	std::vector< std::uint64_t > times( const std::vector< ManifestEntry >& entries )
+	{
+		std::vector< std::uint64_t > out {};
+		for ( const auto& entry : entries ) out.emplace_back( entry.update_time );
+		return out;
+	}
+
+	QNetworkReply* get( QNetworkAccessManager& manager, const QNetworkRequest& request )
+	{
+		auto* reply { manager.get( request ) };
+		QSignalSpy spy { reply, &QNetworkReply::finished };
+		REQUIRE( spy.wait( 10000 ) );
+		return reply;
+	}
+} // namespace
+
+TEST_CASE( "Manifest", "[remote][manifest]" )
+{
+	const QByteArray json {
+		R"([{"date": 30, "name": "30.update", "md5": "00ff"}, {"date": 10, "name": "10.update", "md5": "0a0b"}, {"date": 20, "name": "20.update", "md5": "ffff"}])"
+	};
+
+	SECTION( "Parse" )
+	{
+		const auto entries { parseManifest( json ) };
+		REQUIRE( times( entries ) == std::vector< std::uint64_t > { 10, 20, 30 } );
+		REQUIRE( entries[ 0 ].md5 == QByteArray( "\x0a\x0b", 2 ) );
+
+		REQUIRE_THROWS( parseManifest( R"({"date": 10})" ) );
+		REQUIRE_THROWS( parseManifest( R"([{"date": 10, "name": "10.update"}])" ) );
+	}
+
+	SECTION( "New entries" )
+	{
+		const auto entries { parseManifest( json ) };
+		REQUIRE( times( newEntries( entries, {} ) ) == std::vector< std::uint64_t > { 10, 20, 30 } );
+		REQUIRE( times( newEntries( entries, { 5, 20 } ) ) == std::vector< std::uint64_t > { 10, 30 } );
+		REQUIRE( newEntries( entries, { 10, 20, 30, 40 } ).empty() );
+	}
+
+	SECTION( "Cache sends validators" )
+	{
+		const auto dir { std::filesystem::temp_directory_path() / "atlas_manifest_test" };
+		std::filesystem::remove_all( dir );
+		const ManifestCache cache { dir };
+
+		LocalHttpServer server {};
+		server.serve(
+			"/api/updates",
+			{ 200, json, "ETag: \"abc\"\r\nLast-Modified: Wed, 19 Jul 2023 10:00:00 GMT\r\n" } );
+		QNetworkAccessManager manager {};
+
+		QNetworkRequest request { server.url().resolved( QUrl( "api/updates" ) ) };
+		cache.addConditionalHeaders( request );
+		REQUIRE_FALSE( request.hasRawHeader( "If-None-Match" ) );
+
+		auto* reply { get( manager, request ) };
+		const auto body { reply->readAll() };
+		cache.store( body, *reply );
+		reply->deleteLater();
+
+		REQUIRE( cache.load() == json );
+
+		QNetworkRequest conditional { server.url().resolved( QUrl( "api/updates" ) ) };
+		cache.addConditionalHeaders( conditional );
+		REQUIRE( conditional.rawHeader( "If-None-Match" ) == "\"abc\"" );
+		REQUIRE( conditional.rawHeader( "If-Modified-Since" ) == "Wed, 19 Jul 2023 10:00:00 GMT" );
+
+		get( manager, conditional )->deleteLater();
+		REQUIRE( server.requests().size() == 2 );
+		REQUIRE( server.requests()[ 1 ].raw.contains( "If-None-Match: \"abc\"" ) );
+	}
+}
@@ -0,0 +1,150 @@
+//
+// Created by kj16609 on 7/30/23.
+//
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wctor-dtor-privacy"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#pragma GCC diagnostic pop
+#else
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#endif
+
+#include <fstream>
+#include <thread>
+
+#include "core/database/Database.hpp"
+#include "core/import/ScanCache.hpp"
+
+namespace
+{
+	scan_cache::Entry sampleEntry()
+	{
+		return { "RenPy", 4096, { "game.exe", "game.sh" }, { { 0, "banner.png" }, { 2, "cover.jpg" } }, { "previews/1.png" } };
+	}
+
+	//! Long enough for the filesystem to give a newer mtime
+	void tick()
+	{
+		std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+	}
+} // namespace
+
+TEST_CASE( "Scan cache", "[import][scan_cache]" )
+{
+	REQUIRE_NOTHROW( Database::initalize( ":memory:" ) );
+
+	const auto game { std::filesystem::temp_directory_path() / "atlas_scan_cache_test" };
+	std::filesystem::remove_all( game );
+	std::filesystem::create_directories( game / "www" );
+	std::ofstream( game / "game.exe" ) << "MZ";
+
+	const auto stamp { scan_cache::stamp( game, true ) };
+	REQUIRE( stamp );
+	REQUIRE( scan_cache::stamp( game, true ) == stamp );
+	REQUIRE_FALSE( scan_cache::find( *stamp ) );
+
+	scan_cache::store( *stamp, sampleEntry() );
+	REQUIRE( scan_cache::find( *stamp ) == sampleEntry() );
+
+	SECTION( "Stored again" )
+	{
+		auto entry { sampleEntry() };
+		entry.executables = { "other.exe" };
+		entry.banners.clear();
+		scan_cache::store( *stamp, entry );
+		REQUIRE( scan_cache::find( *stamp ) == entry );
+	}
+
+	SECTION( "Executable headers" )
+	{
+		auto entry { sampleEntry() };
+		entry.executable_info = { ExecutableInfo { ExecutableFormat::PE, 0x8664, 64, 2, "1.2.3.4", 0x300 },
+			                      ExecutableInfo { ExecutableFormat::Script, 0, 0, 0, "", 0 } };
+		scan_cache::store( *stamp, entry );
+		REQUIRE( scan_cache::find( *stamp ) == entry );
+	}
+
+	SECTION( "Renamed folder" )
+	{
+		const auto renamed { game.parent_path() / "atlas_scan_cache_test_renamed" };
+		std::filesystem::remove_all( renamed );
+		std::filesystem::rename( game, renamed );
+
+		const auto moved { scan_cache::stamp( renamed, true ) };
+		REQUIRE( moved );
+		REQUIRE( scan_cache::find( *moved ) == sampleEntry() );
+
+		std::filesystem::rename( renamed, game );
+	}
+
+	SECTION( "File added" )
+	{
+		tick();
+		std::ofstream( game / "new.txt" ) << "a";
+		const auto changed { scan_cache::stamp( game, false ) };
+		REQUIRE( changed );
+		REQUIRE_FALSE( scan_cache::find( *changed ) );
+	}
+
+	SECTION( "File replaced in place" )
+	{
+		tick();
+		std::ofstream( game / "game.exe" ) << "MZ again";
+
+		//The folder itself is untouched. Only it's children show it
+		const auto changed { scan_cache::stamp( game, true ) };
+		REQUIRE( changed );
+		REQUIRE( changed->mtime == stamp->mtime );
+		REQUIRE_FALSE( scan_cache::find( *changed ) );
+	}
+
+	SECTION( "Children not checked" )
+	{
+		//Stored with the children's mtime, so it's a different stamp
+		const auto shallow { scan_cache::stamp( game, false ) };
+		REQUIRE( shallow );
+		REQUIRE( shallow->children_mtime == 0 );
+		REQUIRE_FALSE( scan_cache::find( *shallow ) );
+	}
+
+	SECTION( "Missing folder" )
+	{
+		REQUIRE_FALSE( scan_cache::stamp( game / "missing", true ) );
+	}
+
+	std::filesystem::remove_all( game );
+	Database::deinit();
+}
+
+TEST_CASE( "Scan cache benchmark", "[import][scan_cache][.][benchmark]" )
+{
+	REQUIRE_NOTHROW( Database::initalize( ":memory:" ) );
+
+	const auto root { std::filesystem::temp_directory_path() / "atlas_scan_cache_bench" };
+	std::filesystem::remove_all( root );
+
+	std::vector< std::filesystem::path > games {};
+	for ( int i = 0; i < 3000; ++i )
+	{
+		games.emplace_back( root / fmt::format( "creator_{}", i / 10 ) / fmt::format( "game_{}", i ) );
+		std::filesystem::create_directories( games.back() / "www" );
+		std::ofstream( games.back() / "game.exe" ) << "MZ";
+		scan_cache::store( *scan_cache::stamp( games.back(), true ), sampleEntry() );
+	}
+
+	BENCHMARK( "Unchanged library" )
+	{
+		std::size_t hits { 0 };
+		for ( const auto& game : games )
+			if ( const auto stamp = scan_cache::stamp( game, true ); stamp && scan_cache::find( *stamp ) ) ++hits;
+		return hits;
+	};
+
+	std::filesystem::remove_all( root );
+	Database::deinit();
+}
@@ -0,0 +1,131 @@
+//
+// Created by kj16609 on 7/23/23.
+//
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wctor-dtor-privacy"
+#include <catch2/catch_test_macros.hpp>
+#pragma GCC diagnostic pop
+#else
+#include <catch2/catch_test_macros.hpp>
+#endif
+
+#include <fstream>
+#include <lz4frame.h>
+
+#include "CatalogRows.hpp"
+#include "core/database/Database.hpp"
+#include "core/database/Transaction.hpp"
+#include "core/logging.hpp"
+#include "core/remote/parsers/parser.hpp"
+#include "core/utils/MappedFile.hpp"
+#include "ui/notifications/ProgressMessage.hpp"
+
+using namespace remote::parsers;
+
+namespace
+{
+	//! Key and columns [from, to) of `fullAtlasJson( id, "part" )`
+	std::string partialAtlasJson( const std::int64_t id, const std::size_t from, const std::size_t to )
+	{
+		std::string row { fmt::format( R"({{"atlas_id": {})", id ) };
+		for ( std::size_t c = std::max< std::size_t >( from, 1 ); c < to; ++c )
+		{
+			if ( atlas_columns[ c ].type == ColumnType::Integer )
+				row += fmt::format( R"(, "{}": {})", atlas_columns[ c ].name, id );
+			else
+				row += fmt::format( R"(, "{}": "{}")", atlas_columns[ c ].name, fullRowText( atlas_columns[ c ].name, id, "part" ) );
+		}
+		return row + "}";
+	}
+
+	std::filesystem::path writePackage( const std::string& name, const std::string& doc )
+	{
+		LZ4F_preferences_t prefs {};
+		std::vector< char > compressed( LZ4F_compressFrameBound( doc.size(), &prefs ) );
+		const auto size { LZ4F_compressFrame( compressed.data(), compressed.size(), doc.data(), doc.size(), &prefs ) };
+		REQUIRE_FALSE( LZ4F_isError( size ) );
+
+		const auto path { std::filesystem::temp_directory_path() / name };
+		std::ofstream ofs { path, std::ios::binary };
+		ofs.write( compressed.data(), static_cast< std::streamsize >( size ) );
+		return path;
+	}
+
+	//! Every row and column we care about. Used to compare two databases
+	std::string catalogDump()
+	{
+		std::string atlas {};
+		RapidTransaction() << "SELECT group_concat(atlas_id || ':' || title || ':' || version || ':' || developer, ';') FROM "
+							  "(SELECT * FROM atlas_data ORDER BY atlas_id)"
+			>> atlas;
+		std::string f95 {};
+		RapidTransaction() << "SELECT group_concat(f95_id || ':' || atlas_id || ':' || views || ':' || likes, ';') FROM "
+							  "(SELECT * FROM f95_zone_data ORDER BY f95_id)"
+			>> f95;
+		return atlas + "|" + f95;
+	}
+} // namespace
+
+TEST_CASE( "Update compaction", "[remote][parser][database]" )
+{
+	std::string first { R"({"min_ver": 0, "atlas": [)" };
+	for ( std::size_t i = 1; i <= 50; ++i )
+	{
+		if ( i != 1 ) first += ',';
+		first += fullAtlasJson( static_cast< std::int64_t >( i ), "v1" );
+	}
+	first +=
+		R"(], "f95_zone": [{"f95_id": 1, "atlas_id": 1, "banner_url": "b", "site_url": "s", "last_thread_comment": 1, "thread_publish_date": 1, "views": 10, "likes": 1, "tags": "t", "rating": 4.5, "screens": "x", "replies": 3}]})";
+
+	//Partial rows over the first package plus a new full row
+	std::string second { R"({"min_ver": 0, "atlas": [)" };
+	for ( std::size_t i = 1; i <= 10; ++i )
+		second += fmt::format( R"({{"atlas_id": {}, "title": "v2_{}"}},)", i, i );
+	second += fullAtlasJson( 51, "v2" );
+	//Half of a row that doesn't exist. The other half is in the third package
+	second += ',' + partialAtlasJson( 60, 0, atlas_columns.size() / 2 );
+	second += R"(], "f95_zone": [{"f95_id": 1, "views": 20}]})";
+
+	//Overwrites part of the second package again
+	const std::string third {
+		R"({"min_ver": 0, "atlas": [{"atlas_id": 5, "title": "v3_5", "version": "v3"}, {"atlas_id": 51, "developer": "v3"}, )"
+		+ partialAtlasJson( 60, atlas_columns.size() / 2, atlas_columns.size() ) + R"(], "f95_zone": [{"f95_id": 1, "likes": 7}]})"
+	};
+
+	const std::vector< std::filesystem::path > paths { writePackage( "atlas_compaction_1.update", first ),
+		                                               writePackage( "atlas_compaction_2.update", second ),
+		                                               writePackage( "atlas_compaction_3.update", third ) };
+
+	ProgressMessageSignaler signaler { std::make_shared< ProgressState >() };
+
+	REQUIRE_NOTHROW( Database::initalize( ":memory:" ) );
+	for ( const auto& path : paths )
+	{
+		const MappedFile file { path };
+		const auto data { file.data() };
+		v0::processPackage( [ &data ]( const PackageFeed& feed ) { feed( data ); }, file.size(), signaler );
+	}
+	const auto sequential { catalogDump() };
+	Database::deinit();
+
+	REQUIRE_NOTHROW( Database::initalize( ":memory:" ) );
+	const auto stats { v0::processFiles( paths, signaler ) };
+	const auto compacted { catalogDump() };
+	Database::deinit();
+
+	REQUIRE( compacted == sequential );
+	REQUIRE( compacted.find( "5:v3_5:v3:" ) != std::string::npos );
+	REQUIRE( compacted.find( "51:v2_51:v2_51:v3" ) != std::string::npos );
+	//Partial rows only update. Together they covered every column, but there was nothing to update
+	REQUIRE( compacted.find( ";60:" ) == std::string::npos );
+	REQUIRE( compacted.ends_with( "|1:1:20:7" ) );
+
+	//Every key is written once
+	REQUIRE( stats.inserted == 52 );
+	REQUIRE( stats.updated == 0 );
+
+	for ( const auto& path : paths ) std::filesystem::remove( path );
+}
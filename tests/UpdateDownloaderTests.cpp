@@ -0,0 +1,124 @@
+//
+// Created by kj16609 on 7/20/23.
+//
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wctor-dtor-privacy"
+#include <catch2/catch_test_macros.hpp>
+#pragma GCC diagnostic pop
+#else
+#include <catch2/catch_test_macros.hpp>
+#endif
+
+#include <QSignalSpy>
+
+#include <fstream>
+
+#include "LocalHttpServer.hpp"
+#include "core/remote/UpdateDownloader.hpp"
+
+using namespace atlas;
+
+namespace
+{
+	QByteArray packageBody( const std::uint64_t update_time )
+	{
+		return QByteArray( 50000, static_cast< char >( 'a' + update_time % 26 ) )
+		     + QByteArray::number( static_cast< qulonglong >( update_time ) );
+	}
+
+	QByteArray md5Of( const QByteArray& data )
+	{
+		return QCryptographicHash::hash( data, QCryptographicHash::Md5 );
+	}
+
+	QByteArray readFile( const std::filesystem::path& path )
+	{
+		std::ifstream ifs { path, std::ios::binary };
+		return QByteArray::fromStdString( { std::istreambuf_iterator< char >( ifs ), {} } );
+	}
+
+	std::filesystem::path testDir()
+	{
+		const auto dir { std::filesystem::temp_directory_path() / "atlas_update_downloader_test" };
+		std::filesystem::remove_all( dir );
+		return dir;
+	}
+} // namespace
+
+TEST_CASE( "UpdateDownloader", "[remote][download]" )
+{
+	LocalHttpServer server {};
+	QNetworkAccessManager manager {};
+	const auto dest { testDir() };
+
+	std::vector< std::uint64_t > downloaded {};
+	std::vector< std::uint64_t > failed {};
+
+	SECTION( "Downloads concurrently up to the limit" )
+	{
+		server.setDelay( 50 );
+		for ( std::uint64_t i = 1; i <= 6; ++i )
+			server.serve( QString( "/packages/%1.update" ).arg( i ), { 200, packageBody( i ), {} } );
+
+		UpdateDownloader downloader { manager, server.url(), dest, 2 };
+		QObject::connect(
+			&downloader, &UpdateDownloader::downloaded, [ & ]( const std::uint64_t t ) { downloaded.push_back( t ); } );
+		QObject::connect(
+			&downloader, &UpdateDownloader::failed, [ & ]( const std::uint64_t t ) { failed.push_back( t ); } );
+		QSignalSpy done { &downloader, &UpdateDownloader::finished };
+
+		for ( std::uint64_t i = 1; i <= 6; ++i ) downloader.enqueue( i, md5Of( packageBody( i ) ) );
+		//Already queued. Should not be requested twice
+		downloader.enqueue( 3, md5Of( packageBody( 3 ) ) );
+
+		REQUIRE( done.wait( 10000 ) );
+		REQUIRE( downloader.idle() );
+
+		REQUIRE( failed.empty() );
+		REQUIRE( downloaded.size() == 6 );
+		REQUIRE( server.requests().size() == 6 );
+		REQUIRE( downloader.peakActive() == 2 );
+		REQUIRE( server.peakOpen() <= 2 );
+
+		for ( std::uint64_t i = 1; i <= 6; ++i )
+		{
+			const auto path { UpdateDownloader::packagePath( dest, i ) };
+			REQUIRE( std::filesystem::exists( path ) );
+			REQUIRE( readFile( path ) == packageBody( i ) );
+		}
+	}
+
+	SECTION( "Rejects packages that do not match their md5" )
+	{
+		server.serve( "/packages/1.update", { 200, packageBody( 1 ), {} } );
+
+		UpdateDownloader downloader { manager, server.url(), dest, 2 };
+		QObject::connect(
+			&downloader, &UpdateDownloader::failed, [ & ]( const std::uint64_t t ) { failed.push_back( t ); } );
+		QSignalSpy done { &downloader, &UpdateDownloader::finished };
+
+		downloader.enqueue( 1, md5Of( "something else" ) );
+
+		REQUIRE( done.wait( 10000 ) );
+		REQUIRE( failed == std::vector< std::uint64_t > { 1 } );
+		REQUIRE_FALSE( std::filesystem::exists( UpdateDownloader::packagePath( dest, 1 ) ) );
+		REQUIRE_FALSE( std::filesystem::exists( UpdateDownloader::packagePath( dest, 1 ).string() + ".part" ) );
+	}
+
+	SECTION( "Reports missing packages" )
+	{
+		UpdateDownloader downloader { manager, server.url(), dest, 2 };
+		QObject::connect(
+			&downloader, &UpdateDownloader::failed, [ & ]( const std::uint64_t t ) { failed.push_back( t ); } );
+		QSignalSpy done { &downloader, &UpdateDownloader::finished };
+
+		downloader.enqueue( 7, {} );
+
+		REQUIRE( done.wait( 10000 ) );
+		REQUIRE( failed == std::vector< std::uint64_t > { 7 } );
+		REQUIRE_FALSE( std::filesystem::exists( UpdateDownloader::packagePath( dest, 7 ) ) );
+	}
+}
@@ -0,0 +1,157 @@
+//
+// Created by kj16609 on 7/21/23.
+//
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wctor-dtor-privacy"
+#include <catch2/catch_test_macros.hpp>
+#pragma GCC diagnostic pop
+#else
+#include <catch2/catch_test_macros.hpp>
+#endif
+
+#include <QCoreApplication>
+#include <QtConcurrent>
+
+#include <fstream>
+#include <lz4frame.h>
+
+#include "CatalogRows.hpp"
+#include "LocalHttpServer.hpp"
+#include "core/database/Database.hpp"
+#include "core/database/Transaction.hpp"
+#include "core/remote/PackageStream.hpp"
+#include "core/remote/UpdateDownloader.hpp"
+#include "core/remote/parsers/parser.hpp"
+#include "ui/notifications/ProgressMessage.hpp"
+
+using namespace remote::parsers;
+
+namespace
+{
+	//! A package as the remote serves it. Full atlas rows only, no content size in the frame header
+	QByteArray recordedPackage( const std::size_t rows )
+	{
+		std::string doc { R"({"min_ver": 0, "atlas": [)" };
+		for ( std::size_t i = 0; i < rows; ++i )
+		{
+			if ( i != 0 ) doc += ',';
+			doc += fullAtlasJson( static_cast< std::int64_t >( i + 1 ) );
+		}
+		doc += R"(], "f95_zone": []})";
+
+		LZ4F_preferences_t prefs {};
+		QByteArray compressed( static_cast< qsizetype >( LZ4F_compressFrameBound( doc.size(), &prefs ) ), '\0' );
+		const auto size { LZ4F_compressFrame(
+			compressed.data(), static_cast< std::size_t >( compressed.size() ), doc.data(), doc.size(), &prefs ) };
+		REQUIRE_FALSE( LZ4F_isError( size ) );
+		compressed.resize( static_cast< qsizetype >( size ) );
+
+		return compressed;
+	}
+
+	QFuture< CatalogWriter::Stats > applyStream( const std::shared_ptr< atlas::PackageStream > stream )
+	{
+		return QtConcurrent::run(
+			[ stream ]()
+			{
+				ProgressMessageSignaler signaler { std::make_shared< ProgressState >() };
+				return v0::processPackage(
+					[ &stream ]( const PackageFeed& feed ) { stream->drain( feed ); }, 0, signaler );
+			} );
+	}
+
+	//! Runs the event loop (and so the download) until `future` is done
+	void pumpUntilFinished( const QFuture< CatalogWriter::Stats >& future )
+	{
+		const auto timeout { std::chrono::steady_clock::now() + std::chrono::seconds( 30 ) };
+		while ( !future.isFinished() && std::chrono::steady_clock::now() < timeout )
+			QCoreApplication::processEvents( QEventLoop::AllEvents, 50 );
+		REQUIRE( future.isFinished() );
+	}
+
+	std::size_t atlasRowCount()
+	{
+		std::size_t count { 0 };
+		RapidTransaction() << "SELECT count(*) FROM atlas_data" >> count;
+		return count;
+	}
+} // namespace
+
+TEST_CASE( "Update applied while downloading", "[remote][download][database]" )
+{
+	REQUIRE_NOTHROW( Database::initalize( ":memory:" ) );
+
+	constexpr std::size_t row_count { 3000 };
+	const QByteArray package { recordedPackage( row_count ) };
+
+	LocalHttpServer server {};
+	//Small pieces so parsing starts well before the download ends
+	server.setChunkSize( 4096 );
+	server.serve( "/packages/1.update", { 200, package, {} } );
+
+	QNetworkAccessManager manager {};
+	const auto dest { std::filesystem::temp_directory_path() / "atlas_update_stream_test" };
+	std::filesystem::remove_all( dest );
+
+	atlas::UpdateDownloader downloader { manager, server.url(), dest, 2 };
+	auto stream { std::make_shared< atlas::PackageStream >() };
+
+	SECTION( "Verified package is committed and kept on disk" )
+	{
+		downloader.enqueue( 1, QCryptographicHash::hash( package, QCryptographicHash::Md5 ) );
+		REQUIRE( downloader.attach( 1, stream ) );
+		//Only one reader per package
+		REQUIRE_FALSE( downloader.attach( 1, std::make_shared< atlas::PackageStream >() ) );
+
+		const auto future { applyStream( stream ) };
+		pumpUntilFinished( future );
+
+		REQUIRE( future.result().inserted == row_count );
+		REQUIRE( atlasRowCount() == row_count );
+
+		//Teed to disk for retries
+		std::ifstream ifs { atlas::UpdateDownloader::packagePath( dest, 1 ), std::ios::binary };
+		const std::string on_disk { std::istreambuf_iterator< char >( ifs ), {} };
+		REQUIRE( QByteArray::fromStdString( on_disk ) == package );
+	}
+
+	SECTION( "Package with a bad md5 is rolled back" )
+	{
+		downloader.enqueue( 1, QCryptographicHash::hash( "not the package", QCryptographicHash::Md5 ) );
+		REQUIRE( downloader.attach( 1, stream ) );
+
+		const auto future { applyStream( stream ) };
+		pumpUntilFinished( future );
+
+		REQUIRE_THROWS( future.result() );
+		REQUIRE( atlasRowCount() == 0 );
+		REQUIRE_FALSE( std::filesystem::exists( atlas::UpdateDownloader::packagePath( dest, 1 ) ) );
+	}
+
+	Database::deinit();
+}
+
+TEST_CASE( "Package stream is bounded", "[remote][download]" )
+{
+	atlas::PackageStream stream {};
+	const QByteArray chunk( atlas::PackageStream::max_buffered / 4, 'a' );
+
+	for ( int i = 0; i < 3; ++i ) stream.push( chunk );
+	REQUIRE_FALSE( stream.full() );
+	stream.push( chunk );
+	REQUIRE( stream.full() );
+
+	REQUIRE( stream.pop() );
+	REQUIRE_FALSE( stream.full() );
+
+	SECTION( "Abandoned" )
+	{
+		stream.push( chunk );
+		REQUIRE( stream.full() );
+		REQUIRE_THROWS( stream.drain( []( std::span< const char > ) { throw std::runtime_error( "parser failed" ); } ) );
+		REQUIRE_FALSE( stream.full() );
+	}
+}
@@ -0,0 +1,137 @@
+//
+// Created by kj16609 on 7/24/23.
+//
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Weffc++"
+#pragma GCC diagnostic ignored "-Wctor-dtor-privacy"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#pragma GCC diagnostic pop
+#else
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#endif
+
+#include "core/logging.hpp"
+#include "core/remote/parsers/JsonRowReader.hpp"
+#include "core/remote/parsers/parser.hpp"
+#include "core/remote/parsers/v1_format.hpp"
+#include "core/remote/parsers/v1_writer.hpp"
+
+using namespace remote::parsers;
+
+namespace
+{
+	std::string catalogJson( const std::size_t rows )
+	{
+		constexpr std::array< std::string_view, 4 > engines { "Ren'Py", "Unity", "RPGM", "Other" };
+
+		std::string doc { R"({"min_ver": 0, "atlas": [)" };
+		for ( std::size_t i = 0; i < rows; ++i )
+		{
+			if ( i != 0 ) doc += ',';
+			doc += fmt::format(
+				R"({{"atlas_id": {0}, "title": "Game \"{0}\" é😀", "engine": "{1}", "status": "{2}", "release_date": {3}, "overview": {4}, "version": {5}}})",
+				i + 1,
+				engines[ i % engines.size() ],
+				i % 3 == 0 ? "Completed" : "Ongoing",
+				1600000000 + i,
+				//Some nulls and some values
+				i % 5 == 0 ? std::string( "null" ) : fmt::format( R"("Overview {}")", i ),
+				//Numbers and strings in the same column
+				i % 2 == 0 ? fmt::format( "{}", i ) : fmt::format( R"("v{}")", i ) );
+		}
+		doc += R"(], "f95_zone": [{"f95_id": 5, "atlas_id": 1, "rating": 4.5, "views": 10}, {"f95_id": 6, "likes": 2}]})";
+		return doc;
+	}
+
+	struct Rows
+	{
+		std::vector< AtlasRow > atlas {};
+		std::vector< F95Row > f95 {};
+	};
+
+	Rows readJson( const std::string& json )
+	{
+		Rows rows {};
+		JsonRowReader reader { { [ &rows ]( AtlasRow&& row ) { rows.atlas.emplace_back( std::move( row ) ); },
+			                     [ &rows ]( F95Row&& row ) { rows.f95.emplace_back( std::move( row ) ); } } };
+		reader.feed( json.data(), json.size() );
+		reader.finish();
+		return rows;
+	}
+
+	Rows readV1( const std::vector< char >& package )
+	{
+		Rows rows {};
+		v1::readRows(
+			package,
+			[ &rows ]( AtlasRow&& row ) { rows.atlas.emplace_back( std::move( row ) ); },
+			[ &rows ]( F95Row&& row ) { rows.f95.emplace_back( std::move( row ) ); } );
+		return rows;
+	}
+
+	template < DataSet set >
+	void requireSame( const std::vector< CatalogRow< set > >& left, const std::vector< CatalogRow< set > >& right )
+	{
+		REQUIRE( left.size() == right.size() );
+		for ( std::size_t i = 0; i < left.size(); ++i )
+		{
+			REQUIRE( left[ i ].present == right[ i ].present );
+			REQUIRE( left[ i ].values == right[ i ].values );
+		}
+	}
+} // namespace
+
+TEST_CASE( "v1 packages", "[remote][parser][v1]" )
+{
+	const auto json { catalogJson( 2000 ) };
+	const auto package { v1::convert( json ) };
+
+	SECTION( "Round trip" )
+	{
+		REQUIRE( v1::isPackage( package ) );
+
+		const auto expected { readJson( json ) };
+		const auto actual { readV1( package ) };
+
+		requireSame( expected.atlas, actual.atlas );
+		requireSame( expected.f95, actual.f95 );
+	}
+
+	SECTION( "Smaller then the json" )
+	{
+		REQUIRE( package.size() < json.size() / 2 );
+	}
+
+	SECTION( "Truncated" )
+	{
+		const std::vector< char > truncated { package.begin(), package.begin() + static_cast< std::ptrdiff_t >( package.size() / 2 ) };
+		REQUIRE_THROWS( readV1( truncated ) );
+	}
+
+	SECTION( "Not a package" )
+	{
+		const std::vector< char > garbage( 64, 'x' );
+		REQUIRE_FALSE( v1::isPackage( garbage ) );
+		REQUIRE_THROWS( readV1( garbage ) );
+	}
+}
+
+TEST_CASE( "v1 package benchmark", "[remote][parser][v1][.][benchmark]" )
+{
+	const auto json { catalogJson( 200000 ) };
+	const auto package { v1::convert( json ) };
+
+	BENCHMARK( "v0 json" )
+	{
+		return readJson( json ).atlas.size();
+	};
+
+	BENCHMARK( "v1 columnar" )
+	{
+		return readV1( package ).atlas.size();
+	};
+}
@@ -0,0 +1,42 @@
+//
+// Created by kj16609 on 7/24/23.
+//
+
+#include <fstream>
+
+#include "core/logging.hpp"
+#include "core/remote/extract.hpp"
+#include "core/remote/parsers/v1_writer.hpp"
+
+//! Converts a v0 update package into a v1 package. See @ref V1Packages
+int main( int argc, char** argv )
+{
+	if ( argc != 3 )
+	{
+		fmt::print( stderr, "Usage: {} <v0 package> <v1 package>\n", argv[ 0 ] );
+		return 1;
+	}
+
+	const std::filesystem::path in_path { argv[ 1 ] };
+	const std::filesystem::path out_path { argv[ 2 ] };
+
+	try
+	{
+		const auto json { atlas::extract( in_path ) };
+		const auto package { remote::parsers::v1::convert( json ) };
+
+		std::ofstream out { out_path, std::ios::binary | std::ios::trunc };
+		out.write( package.data(), static_cast< std::streamsize >( package.size() ) );
+		if ( !out ) throw std::runtime_error( fmt::format( "Failed to write {}", out_path.string() ) );
+
+		fmt::print(
+			"{} ({} bytes json) -> {} ({} bytes)\n", in_path.string(), json.size(), out_path.string(), package.size() );
+	}
+	catch ( const std::exception& e )
+	{
+		fmt::print( stderr, "Failed to convert {}: {}\n", in_path.string(), e.what() );
+		return 1;
+	}
+
+	return 0;
+}